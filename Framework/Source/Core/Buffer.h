@@ -26,6 +26,7 @@
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 ***************************************************************************/
 #pragma once
+#include "Utils/MemoryTracker.h"
 
 namespace Falcor
 {
@@ -47,6 +48,7 @@ namespace Falcor
             Dynamic     = 1, ///< Buffer will be updated using Buffer#updateData().
             MapRead     = 2, ///< Buffer will mapped for CPU read.
             MapWrite    = 4, ///< Buffer will mapped for CPU Write.
+            Persistent  = 8, ///< Buffer can stay mapped while the GPU is using it. The mapped memory is coherent, but it's the user's responsibility not to overwrite data the GPU didn't consume yet. Ignored by D3D11, which doesn't support persistent mapping.
         };
 
         /** Buffer GPU access flags.
@@ -137,6 +139,14 @@ namespace Falcor
         */
         size_t getSize() const { return mSize; }
 
+        /** Get the bind flags the buffer was created with
+        */
+        BindFlags getBindFlags() const { return mBindFlags; }
+
+        /** Get the MemoryTracker category the buffer is accounted in, based on its bind flags
+        */
+        MemoryTracker::Category getMemoryCategory() const;
+
         /** Map the buffer
         */
         void* map(MapType Type);
@@ -184,4 +194,12 @@ namespace Falcor
     {
         return static_cast<Buffer::BindFlags>(static_cast<int>(a) | static_cast<int>(b));
     }
+
+    inline MemoryTracker::Category Buffer::getMemoryCategory() const
+    {
+        if((mBindFlags & BindFlags::Vertex) != BindFlags::None) return MemoryTracker::Category::VertexBuffer;
+        if((mBindFlags & BindFlags::Index) != BindFlags::None) return MemoryTracker::Category::IndexBuffer;
+        if((mBindFlags & BindFlags::Uniform) != BindFlags::None) return MemoryTracker::Category::UniformBuffer;
+        return MemoryTracker::Category::OtherBuffer;
+    }
 }
\ No newline at end of file
@@ -84,11 +84,15 @@ namespace Falcor
         }
 
         dx11_call(getD3D11Device()->CreateBuffer(&desc, pSubresource, &pBuffer->mApiHandle));
+        MemoryTracker::allocate(pBuffer->getMemoryCategory(), size);
 
         return pBuffer;
     }
 
-    Buffer::~Buffer() = default;
+    Buffer::~Buffer()
+    {
+        MemoryTracker::release(getMemoryCategory(), mSize);
+    }
 
     void Buffer::copy(Buffer* pDst) const
     {
@@ -109,8 +113,8 @@ namespace Falcor
         }
 
         struct D3D11_BOX srcBox;
-        srcBox.left = (UINT)dstOffset;
-        srcBox.right = (UINT)(dstOffset + count);
+        srcBox.left = (UINT)srcOffset;
+        srcBox.right = (UINT)(srcOffset + count);
         srcBox.top = 0;
         srcBox.bottom = 1;
         srcBox.front = 0;
@@ -173,6 +177,7 @@ namespace Falcor
             break;
         case MapType::WriteNoOverwrite:
             dxFlag = D3D11_MAP_WRITE_NO_OVERWRITE;
+            break;
         default:
             should_not_get_here();
         }
@@ -60,6 +60,8 @@ namespace Falcor
     // Device
     MAKE_SMART_COM_PTR(ID3D11Device);
     MAKE_SMART_COM_PTR(ID3D11DeviceContext);
+    MAKE_SMART_COM_PTR(ID3D11DeviceContext1);
+    MAKE_SMART_COM_PTR(ID3D11Query);
     MAKE_SMART_COM_PTR(ID3D11InputLayout);
 
     // DXGI
@@ -116,6 +118,7 @@ namespace Falcor
     using BlendStateHandle          = ID3D11BlendStatePtr;
     using SamplerApiHandle          = ID3D11SamplerStatePtr;
     using ShaderResourceViewHandle  = ID3D11ShaderResourceViewPtr;
+    using FenceHandle               = ID3D11QueryPtr;
 
     void dx11TraceHR(const std::string& Msg, HRESULT hr);
     /*! @} */
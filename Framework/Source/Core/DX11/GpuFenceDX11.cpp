@@ -0,0 +1,70 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#ifdef FALCOR_DX11
+#include "Core/GpuFence.h"
+
+namespace Falcor
+{
+    GpuFence::GpuFence()
+    {
+    }
+
+    GpuFence::~GpuFence()
+    {
+    }
+
+    uint64_t GpuFence::signal()
+    {
+        D3D11_QUERY_DESC desc;
+        desc.Query = D3D11_QUERY_EVENT;
+        desc.MiscFlags = 0;
+
+        Marker marker;
+        dx11_call(getD3D11Device()->CreateQuery(&desc, &marker.apiHandle));
+        getD3D11ImmediateContext()->End(marker.apiHandle);
+        marker.value = ++mSignaledValue;
+        mMarkers.push_back(marker);
+        return mSignaledValue;
+    }
+
+    bool GpuFence::isMarkerComplete(FenceHandle& marker, bool waitForResult)
+    {
+        BOOL isDone = FALSE;
+        // Without the flush flag, GetData() will flush the command buffer which ensures the marker is eventually reached
+        while(getD3D11ImmediateContext()->GetData(marker, &isDone, sizeof(isDone), 0) != S_OK)
+        {
+            if(waitForResult == false)
+            {
+                return false;
+            }
+        }
+        return isDone != FALSE;
+    }
+}
+#endif //#ifdef FALCOR_DX11
@@ -46,6 +46,7 @@ namespace Falcor
     {
         SharedPtr pCtx = SharedPtr(new RenderContext(D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE));
         pCtx->mState.pUniformBuffers.assign(D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT, nullptr);
+        pCtx->mBoundUniformBufferRanges.resize(D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT);
         pCtx->mState.pShaderStorageBuffers.assign(D3D11_1_UAV_SLOT_COUNT, nullptr);
         return pCtx;
     }
@@ -148,13 +149,27 @@ namespace Falcor
 
     void RenderContext::applyUniformBuffer(uint32_t Index) const
     {
-        ID3D11Buffer* pBuffer = nullptr;
-        if(mState.pUniformBuffers[Index] && mState.pUniformBuffers[Index]->getBuffer())
+        const UniformBuffer* pUbo = mState.pUniformBuffers[Index].get();
+        const Buffer* pGpuBuffer = pUbo ? pUbo->getGpuBuffer() : nullptr;
+        ID3D11Buffer* pBuffer = pGpuBuffer ? pGpuBuffer->getApiHandle() : nullptr;
+        mBoundUniformBufferRanges[Index].pBuffer = pGpuBuffer;
+        mBoundUniformBufferRanges[Index].offset = pUbo ? pUbo->getGpuOffset() : 0;
+
+        auto pCtx = getD3D11ImmediateContext();
+        if(pGpuBuffer && (pGpuBuffer != pUbo->getBuffer().get()))
         {
-            pBuffer = mState.pUniformBuffers[Index]->getBuffer()->getApiHandle();
+            // A slice of the frame ring. The range is specified in 16-byte constants. UniformBufferRing only exists if the device supports D3D11.1
+            ID3D11DeviceContext1Ptr pCtx1 = pCtx;
+            UINT firstConstant = (UINT)(pUbo->getGpuOffset() / 16);
+            UINT numConstants = (UINT)(pUbo->getGpuSize() / 16);
+            pCtx1->VSSetConstantBuffers1(Index, 1, &pBuffer, &firstConstant, &numConstants);
+            pCtx1->PSSetConstantBuffers1(Index, 1, &pBuffer, &firstConstant, &numConstants);
+            pCtx1->DSSetConstantBuffers1(Index, 1, &pBuffer, &firstConstant, &numConstants);
+            pCtx1->HSSetConstantBuffers1(Index, 1, &pBuffer, &firstConstant, &numConstants);
+            pCtx1->GSSetConstantBuffers1(Index, 1, &pBuffer, &firstConstant, &numConstants);
+            return;
         }
 
-        auto pCtx = getD3D11ImmediateContext();
         pCtx->VSSetConstantBuffers(Index, 1, &pBuffer);
         pCtx->PSSetConstantBuffers(Index, 1, &pBuffer);
         pCtx->DSSetConstantBuffers(Index, 1, &pBuffer);
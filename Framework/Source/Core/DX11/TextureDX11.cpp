@@ -117,6 +117,7 @@ namespace Falcor
 
     Texture::~Texture()
     {
+        MemoryTracker::release(MemoryTracker::Category::Texture, mTrackedBytes);
     }
 
     uint64_t Texture::makeResident(const Sampler* pSampler) const
@@ -142,11 +143,14 @@ namespace Falcor
         {
             for(uint32_t mip = 0; mip < mipLevels; mip++)
             {
+                uint32_t mipWidth = max(1U, width >> mip);
+                uint32_t mipHeight = max(1U, height >> mip);
+                uint32_t mipDepth = max(1U, depth >> mip);
                 auto& data = initData[D3D11CalcSubresource(mip, array, mipLevels)];
                 data.pSysMem = pSrc;
-                data.SysMemPitch = getFormatBytesPerBlock(format) * (width >> mip);
-                data.SysMemSlicePitch = data.SysMemPitch * (height >> mip);
-                pSrc += data.SysMemSlicePitch * depth;
+                data.SysMemPitch = getFormatRowPitch(format, mipWidth);
+                data.SysMemSlicePitch = getFormatImageSize(format, mipWidth, mipHeight);
+                pSrc += data.SysMemSlicePitch * mipDepth;
             }
         }
 
@@ -217,14 +221,16 @@ namespace Falcor
         {
             Logger::log(Logger::Level::Warning, "Texture::CreateTexture2DDesc() - can't automatically generate mip levels for depth texture");
         }
+        // Compressed textures can't be render-targets, so their mips can't be generated by the GPU
+        bool isCompressed = isCompressedFormat(format);
         D3D11_TEXTURE2D_DESC desc;
         desc.ArraySize = arraySize;
         desc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-        desc.BindFlags = isDepth ? D3D11_BIND_DEPTH_STENCIL : (D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET);
+        desc.BindFlags = isDepth ? D3D11_BIND_DEPTH_STENCIL : (isCompressed ? D3D11_BIND_SHADER_RESOURCE : (D3D11_BIND_SHADER_RESOURCE | D3D11_BIND_RENDER_TARGET));
         desc.CPUAccessFlags = 0;
         desc.Format = getDxgiFormat(format);
         desc.MipLevels = (mipLevels == Texture::kEntireMipChain) ? 1 : mipLevels;
-        desc.MiscFlags = isDepth ? 0 : D3D11_RESOURCE_MISC_GENERATE_MIPS;
+        desc.MiscFlags = (isDepth || isCompressed) ? 0 : D3D11_RESOURCE_MISC_GENERATE_MIPS;
         desc.Usage = D3D11_USAGE_DEFAULT;
         desc.Width = width;
         desc.Height = height;
@@ -234,8 +240,14 @@ namespace Falcor
         return desc;
     }
 
-    Texture::SharedPtr Texture::create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pData)
+    Texture::SharedPtr Texture::create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pData, bool isSparse)
     {
+        if(isSparse)
+        {
+            UNSUPPORTED_IN_DX11("Sparse textures");
+            return nullptr;
+        }
+
         D3D11_TEXTURE2D_DESC desc = CreateTexture2DDesc(width, height, format, arraySize, mipLevels);
 
         std::vector<D3D11_SUBRESOURCE_DATA> initData;
@@ -366,11 +378,38 @@ namespace Falcor
         UNSUPPORTED_IN_DX11("Texture::uploadSubresourceData()");
     }
 
-    void Texture::compress2DTexture()
+    void Texture::uploadSubresourceRegion(const void* pData, uint32_t mipLevel, uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth)
+    {
+        UNSUPPORTED_IN_DX11("Texture::uploadSubresourceRegion()");
+    }
+
+    void Texture::setSparseResidencyPageIndex(bool isResident, uint32_t mipLevel, uint32_t pageX, uint32_t pageY, uint32_t pageZ, uint32_t width, uint32_t height, uint32_t depth)
+    {
+        UNSUPPORTED_IN_DX11("Texture::setSparseResidencyPageIndex()");
+    }
+
+    void Texture::setSparseResidencyRegion(bool isResident, uint32_t mipLevel, uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth)
+    {
+        UNSUPPORTED_IN_DX11("Texture::setSparseResidencyRegion()");
+    }
+
+    void Texture::getSparsePageSize(uint32_t& width, uint32_t& height, uint32_t& depth) const
+    {
+        UNSUPPORTED_IN_DX11("Texture::getSparsePageSize()");
+        width = height = depth = 0;
+    }
+
+    void Texture::compress2DTexture(bool isNormalMap, BlockCompressionQuality quality)
     {
         UNSUPPORTED_IN_DX11("Texture::compress2DTexture");
     }
 
+    Texture::SharedPtr Texture::createCompressed2DTexture(bool isNormalMap, BlockCompressionQuality quality) const
+    {
+        UNSUPPORTED_IN_DX11("Texture::createCompressed2DTexture");
+        return nullptr;
+    }
+
 	void Texture::generateMips() const
 	{
 		UNSUPPORTED_IN_DX11("Texture::GenerateMips");
@@ -0,0 +1,69 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#ifdef FALCOR_DX11
+#include "Core/UniformBufferRing.h"
+
+namespace Falcor
+{
+    UniformBufferRing::~UniformBufferRing() = default;
+
+    bool UniformBufferRing::apiInit()
+    {
+        // Binding a constant buffer at an offset and mapping it with NO_OVERWRITE both require D3D11.1
+        ID3D11DeviceContext1Ptr pCtx1 = getD3D11ImmediateContext();
+        if(pCtx1 == nullptr)
+        {
+            return false;
+        }
+        D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+        if(FAILED(getD3D11Device()->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(options))))
+        {
+            return false;
+        }
+        if(!options.ConstantBufferOffsetting || !options.MapNoOverwriteOnDynamicConstantBuffer)
+        {
+            return false;
+        }
+
+        // Offsets are specified in multiples of 16 constants
+        mAlignment = 16 * 16;
+        mpBuffer = Buffer::create(mAllocator.getCapacity(), Buffer::BindFlags::Uniform, Buffer::AccessFlags::MapWrite, nullptr);
+        return mpBuffer != nullptr;
+    }
+
+    void UniformBufferRing::apiWrite(size_t offset, const void* pData, size_t size)
+    {
+        // A dynamic buffer has to be mapped with discard before it can be mapped with no-overwrite
+        uint8_t* pDst = (uint8_t*)mpBuffer->map(mFirstWrite ? Buffer::MapType::WriteDiscard : Buffer::MapType::WriteNoOverwrite);
+        mFirstWrite = false;
+        memcpy(pDst + offset, pData, size);
+        mpBuffer->unmap();
+    }
+}
+#endif //#ifdef FALCOR_DX11
@@ -119,6 +119,8 @@ namespace Falcor
         BC4Snorm,   // RGTC Signed Red
         BC5Unorm,   // RGTC Unsigned RG
         BC5Snorm,   // RGTC Signed RG
+        BC7Unorm,   // BPTC
+        BC7UnormSrgb,
     };
     
     /** Falcor format Type
@@ -217,6 +219,22 @@ namespace Falcor
         return kFormatDesc[(uint32_t)format].compressionRatio.height;
     }
 
+    /** Get the number of bytes in a row of a tightly packed image. For compressed formats, this is a row of blocks
+    */
+    inline uint32_t getFormatRowPitch(ResourceFormat format, uint32_t width)
+    {
+        uint32_t ratio = getFormatWidthCompressionRatio(format);
+        return ((width + ratio - 1) / ratio) * getFormatBytesPerBlock(format);
+    }
+
+    /** Get the number of bytes in a tightly packed 2D image. For compressed formats, partial blocks along the edges are rounded up to entire blocks
+    */
+    inline uint32_t getFormatImageSize(ResourceFormat format, uint32_t width, uint32_t height)
+    {
+        uint32_t ratio = getFormatHeightCompressionRatio(format);
+        return getFormatRowPitch(format, width) * ((height + ratio - 1) / ratio);
+    }
+
     /** Get the number of channels
     */
     inline uint32_t getFormatChannelCount(ResourceFormat format)
@@ -38,6 +38,7 @@ namespace Falcor
         glFlags |= ((flags & Buffer::AccessFlags::Dynamic) != Buffer::AccessFlags::None) ? GL_DYNAMIC_STORAGE_BIT : 0;
         glFlags |= ((flags & Buffer::AccessFlags::MapRead) != Buffer::AccessFlags::None) ? GL_MAP_READ_BIT : 0;
         glFlags |= ((flags & Buffer::AccessFlags::MapWrite) != Buffer::AccessFlags::None) ? GL_MAP_WRITE_BIT : 0;
+        glFlags |= ((flags & Buffer::AccessFlags::Persistent) != Buffer::AccessFlags::None) ? (GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT) : 0;
 
         return glFlags;
     }
@@ -45,6 +46,7 @@ namespace Falcor
     Buffer::~Buffer()
     {
         glDeleteBuffers(1, &mApiHandle);
+        MemoryTracker::release(getMemoryCategory(), mSize);
     }
 
     Buffer::SharedPtr Buffer::create(size_t size, BindFlags usage, AccessFlags access, const void* pInitData)
@@ -52,6 +54,7 @@ namespace Falcor
         auto pBuffer = SharedPtr(new Buffer(size, usage, access));
         gl_call(glCreateBuffers(1, &pBuffer->mApiHandle));
         gl_call(glNamedBufferStorage(pBuffer->mApiHandle, size, pInitData, getGlUsageFlags(access)));
+        MemoryTracker::allocate(pBuffer->getMemoryCategory(), size);
         return pBuffer;
     }
 
@@ -134,9 +137,11 @@ namespace Falcor
             flags = GL_MAP_READ_BIT;
             break;
         case MapType::Write:
-        case MapType::WriteNoOverwrite:
             flags = GL_MAP_WRITE_BIT;
             break;
+        case MapType::WriteNoOverwrite:
+            flags = GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
+            break;
         case MapType::ReadWrite:
             flags = GL_MAP_READ_BIT | GL_MAP_WRITE_BIT;
             break;
@@ -148,6 +153,11 @@ namespace Falcor
             return nullptr;
         }
 
+        if((mAccessFlags & AccessFlags::Persistent) != AccessFlags::None)
+        {
+            flags |= GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        }
+
         void* pData = gl_call(glMapNamedBufferRange(mApiHandle, 0, mSize, flags));
         mIsMapped = true;
         return pData;
@@ -110,6 +110,7 @@ namespace Falcor
     using BlendStateHandle          = GLuint;
     using SamplerApiHandle          = GLuint;
     using ShaderResourceViewHandle  = GLuint;
+    using FenceHandle               = GLsync;
 }
 
 #pragma comment(lib, "glew32.lib")
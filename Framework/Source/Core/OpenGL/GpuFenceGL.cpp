@@ -0,0 +1,73 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#ifdef FALCOR_GL
+#include "Core/GpuFence.h"
+
+namespace Falcor
+{
+    GpuFence::GpuFence()
+    {
+    }
+
+    GpuFence::~GpuFence()
+    {
+        for(auto& marker : mMarkers)
+        {
+            glDeleteSync(marker.apiHandle);
+        }
+    }
+
+    uint64_t GpuFence::signal()
+    {
+        Marker marker;
+        marker.apiHandle = gl_call(glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0));
+        marker.value = ++mSignaledValue;
+        mMarkers.push_back(marker);
+        return mSignaledValue;
+    }
+
+    bool GpuFence::isMarkerComplete(FenceHandle& marker, bool waitForResult)
+    {
+        GLenum result;
+        do
+        {
+            // Flush the first time we wait, otherwise the marker might never reach the GPU
+            result = gl_call(glClientWaitSync(marker, waitForResult ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, waitForResult ? 1000000 : 0));
+        } while(waitForResult && (result == GL_TIMEOUT_EXPIRED));
+
+        bool isDone = (result == GL_ALREADY_SIGNALED) || (result == GL_CONDITION_SATISFIED);
+        if(isDone)
+        {
+            glDeleteSync(marker);
+            marker = nullptr;
+        }
+        return isDone;
+    }
+}
+#endif //#ifdef FALCOR_GL
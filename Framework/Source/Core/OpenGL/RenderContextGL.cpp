@@ -53,6 +53,7 @@ namespace Falcor
         int uniformBlockCount;
         gl_call(glGetIntegerv(GL_MAX_COMBINED_UNIFORM_BLOCKS, &uniformBlockCount));
         pCtx->mState.pUniformBuffers.assign(uniformBlockCount, nullptr);
+        pCtx->mBoundUniformBufferRanges.resize(uniformBlockCount);
 
         int shaderStorageBlockCount;
         gl_call(glGetIntegerv(GL_MAX_COMBINED_SHADER_STORAGE_BLOCKS, &shaderStorageBlockCount));
@@ -450,8 +451,20 @@ namespace Falcor
     void RenderContext::applyUniformBuffer(uint32_t index) const
     {
         const auto pBuffer = mState.pUniformBuffers[index];
-        uint32_t apiHandle = pBuffer ? pBuffer->getBuffer()->getApiHandle() : 0;
-        glBindBufferBase(GL_UNIFORM_BUFFER, index, apiHandle);
+        const Buffer* pGpuBuffer = pBuffer ? pBuffer->getGpuBuffer() : nullptr;
+        uint32_t apiHandle = pGpuBuffer ? pGpuBuffer->getApiHandle() : 0;
+        mBoundUniformBufferRanges[index].pBuffer = pGpuBuffer;
+        mBoundUniformBufferRanges[index].offset = pBuffer ? pBuffer->getGpuOffset() : 0;
+
+        if(pGpuBuffer && (pGpuBuffer != pBuffer->getBuffer().get()))
+        {
+            // A slice of the frame ring
+            glBindBufferRange(GL_UNIFORM_BUFFER, index, apiHandle, pBuffer->getGpuOffset(), pBuffer->getGpuSize());
+        }
+        else
+        {
+            glBindBufferBase(GL_UNIFORM_BUFFER, index, apiHandle);
+        }
     }
 
     void RenderContext::applyShaderStorageBuffer(uint32_t index) const
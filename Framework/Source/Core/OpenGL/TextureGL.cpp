@@ -63,6 +63,7 @@ namespace Falcor
         }
 
         glDeleteTextures(1, &mApiHandle);
+        MemoryTracker::release(MemoryTracker::Category::Texture, mTrackedBytes);
     }
         
     uint64_t Texture::makeResident(const Sampler* pSampler) const
@@ -135,10 +136,17 @@ namespace Falcor
         return apiHandle;
     }
 
-    uint32_t init2DTextureStorage(GLenum Type, uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels)
+    uint32_t init2DTextureStorage(GLenum Type, uint32_t width, uint32_t height, ResourceFormat format, uint32_t mipLevels, bool isSparse = false)
     {
         uint32_t apiHandle;
         gl_call(glCreateTextures(Type, 1, &apiHandle));
+
+        if(isSparse)
+        {
+            assert(Falcor::checkExtensionSupport("GL_ARB_sparse_texture"));
+            gl_call(glTextureParameteri(apiHandle, GL_TEXTURE_SPARSE_ARB, GL_TRUE));
+        }
+
         GLenum glFormat = getGlSizedFormat(format);
         gl_call(glTextureStorage2D(apiHandle, mipLevels, glFormat, width, height));
         return apiHandle;
@@ -153,14 +161,14 @@ namespace Falcor
             if(isCompressedFormat(format))
             {
 				GLenum glFormat = getGlSizedFormat(format);
-				uint32_t requiredSize;
 				uint8_t *data = (uint8_t*)pData;
 				for (uint32_t i = 0; i < mipLevels; ++i) 
 				{
-					gl_call(glGetTextureLevelParameteriv(apiHandle, i, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, (int*)&requiredSize));
-					glCompressedTextureSubImage2D(apiHandle, i, 0, 0, width, height, glFormat, requiredSize, data);
-					uint32_t offset = getFormatBytesPerBlock(format) * (width >> i) * (height >> i) / getFormatPixelsPerBlock(format);
-					data += offset;
+					uint32_t mipWidth = max(1U, width >> i);
+					uint32_t mipHeight = max(1U, height >> i);
+					uint32_t mipSize = getFormatImageSize(format, mipWidth, mipHeight);
+					gl_call(glCompressedTextureSubImage2D(apiHandle, i, 0, 0, mipWidth, mipHeight, glFormat, mipSize, data));
+					data += mipSize;
 					if (autoGenerateMipMaps)
 					{
 						break;
@@ -174,9 +182,10 @@ namespace Falcor
 				uint8_t *data = (uint8_t*)pData;
 				for (uint32_t i = 0; i < mipLevels; ++i)
 				{
-					gl_call(glTextureSubImage2D(apiHandle, i, 0, 0, width, height, baseFormat, baseType, data));
-					uint32_t offset = getFormatBytesPerBlock(format) * (width >> i) * (height >> i) / getFormatPixelsPerBlock(format);
-					data += offset;
+					uint32_t mipWidth = max(1U, width >> i);
+					uint32_t mipHeight = max(1U, height >> i);
+					gl_call(glTextureSubImage2D(apiHandle, i, 0, 0, mipWidth, mipHeight, baseFormat, baseType, data));
+					data += getFormatImageSize(format, mipWidth, mipHeight);
 					if (autoGenerateMipMaps)
 					{
 						break;
@@ -302,11 +311,18 @@ namespace Falcor
         return pResource;
     }
     
-    Texture::SharedPtr Texture::create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pData)
+    Texture::SharedPtr Texture::create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize, uint32_t mipLevels, const void* pData, bool isSparse)
     {
         auto pResource = SharedPtr(new Texture(width, height, 1, arraySize, mipLevels, 1, format, Texture::Type::Texture2D));
 
-        if(pResource->mArraySize > 1)
+        if(isSparse)
+        {
+            assert(pData == nullptr && arraySize == 1);
+            pResource->mIsSparse = true;
+            pResource->updateTrackedMemory();
+            pResource->mApiHandle = init2DTextureStorage(GL_TEXTURE_2D, pResource->mWidth, pResource->mHeight, pResource->mFormat, pResource->mMipLevels, true);
+        }
+        else if(pResource->mArraySize > 1)
         {
             pResource->mApiHandle = init3DTexture(GL_TEXTURE_2D_ARRAY, pResource->mWidth, pResource->mHeight, pResource->mArraySize, pResource->mFormat, pResource->mMipLevels, pData, mipLevels == kEntireMipChain);
         }
@@ -323,6 +339,7 @@ namespace Falcor
         auto pResource = SharedPtr(new Texture(width, height, depth, 1, mipLevels, 1, format, Texture::Type::Texture3D));
 
 		pResource->mIsSparse = isSparse;
+        pResource->updateTrackedMemory();
         pResource->mApiHandle = init3DTexture(GL_TEXTURE_3D, pResource->mWidth, pResource->mHeight, pResource->mDepth, pResource->mFormat, pResource->mMipLevels, pData, mipLevels == kEntireMipChain, isSparse);
     
         return pResource;
@@ -545,7 +562,7 @@ namespace Falcor
 		{
 			GLenum glFormat = getGlSizedFormat(mFormat);
 			uint32_t requiredSize;
-			gl_call(glGetTextureLevelParameteriv(mApiHandle, 0, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, (int*)&requiredSize));
+			gl_call(glGetTextureLevelParameteriv(mApiHandle, mipLevel, GL_TEXTURE_COMPRESSED_IMAGE_SIZE, (int*)&requiredSize));
 
 			if (mType == Type::Texture3D)
 			{
@@ -588,69 +605,120 @@ namespace Falcor
 
     }
 
-    void Texture::compress2DTexture()
+    // Compress the entire mip-chain of a 2D texture on the CPU. Shared by compress2DTexture() and createCompressed2DTexture()
+    static bool compressMipChain(const Texture* pTexture, bool isNormalMap, BlockCompressionQuality quality, const std::string& funcName, ResourceFormat& compressedFormat, std::vector<uint8_t>& data)
     {
-        if(mType != Type::Texture2D)
+        const ResourceFormat format = pTexture->getFormat();
+        if(pTexture->getType() != Texture::Type::Texture2D)
         {
-            Logger::log(Logger::Level::Error, "Texture::compress2DTexture() only supports 2D texture compression\n");
-            return;
+            Logger::log(Logger::Level::Error, "Texture::" + funcName + "() only supports 2D texture compression\n");
+            return false;
         }
 
-        if(mArraySize > 1)
+        if(pTexture->getArraySize() > 1)
         {
-            Logger::log(Logger::Level::Error, "Texture::compress2DTexture() only supports 2D texture compression with a single array slice\n");
-            return;
+            Logger::log(Logger::Level::Error, "Texture::" + funcName + "() only supports 2D texture compression with a single array slice\n");
+            return false;
         }
 
-        if(isDepthStencilFormat(mFormat))
+        if(isDepthStencilFormat(format))
         {
-            Logger::log(Logger::Level::Error, "Texture::compress2DTexture(): Can't compress depth-stencil resource\n");
-            return;
+            Logger::log(Logger::Level::Error, "Texture::" + funcName + "(): Can't compress depth-stencil resource\n");
+            return false;
         }
 
-        if(isCompressedFormat(mFormat))
+        if(isCompressedFormat(format))
         {
             // Already compressed
-            return;
+            return false;
         }
 
-        // Read the old data
-        std::vector<uint8_t> data;
-        uint32_t requiredSize = getMipLevelDataSize(0);
-        data.resize(requiredSize);
+        // Read all the mip-levels and convert them to RGBA8
+        const uint32_t mipLevels = pTexture->getMipLevels();
+        std::vector<std::vector<uint8_t>> rgbaMips(mipLevels);
+        bool hasAlpha = false;
+        for(uint32_t mip = 0; mip < mipLevels; mip++)
+        {
+            uint32_t mipWidth, mipHeight;
+            pTexture->getMipLevelImageSize(mip, mipWidth, mipHeight);
+            uint32_t requiredSize = pTexture->getMipLevelDataSize(mip);
+            std::vector<uint8_t> mipData(requiredSize);
+            pTexture->readSubresourceData(mipData.data(), requiredSize, mip, 0);
+
+            if(convertToRgba8(format, mipData.data(), mipWidth * mipHeight, rgbaMips[mip]) == false)
+            {
+                Logger::log(Logger::Level::Error, "Texture::" + funcName + "(): Unsupported source format " + to_string(format) + "\n");
+                return false;
+            }
 
-        readSubresourceData(data.data(), requiredSize, 0, 0);
+            if(mip == 0)
+            {
+                for(size_t i = 3; i < rgbaMips[mip].size(); i += 4)
+                {
+                    if(rgbaMips[mip][i] != 255)
+                    {
+                        hasAlpha = true;
+                        break;
+                    }
+                }
+            }
+        }
 
         // Select format
-        ResourceFormat compressedFormat = ResourceFormat::Unknown;
-        bool isSrgb = isSrgbFormat(mFormat);
-
-        switch(getFormatChannelCount(mFormat))
-        {
-        case 1:
-            assert(isSrgb == false);
-            compressedFormat = ResourceFormat::BC4Unorm;
-            break;
-        case 2:
-            assert(isSrgb == false);
-            compressedFormat = ResourceFormat::BC5Unorm;
-            break;
-        case 3:
-            compressedFormat = isSrgb ? ResourceFormat::BC1UnormSrgb : ResourceFormat::BC1Unorm;
-            break;
-        case 4:
-            compressedFormat = isSrgb ? ResourceFormat::BC3UnormSrgb : ResourceFormat::BC3Unorm;
-            break;
-        default:
-            should_not_get_here();
+        compressedFormat = getBlockCompressedFormat(format, hasAlpha, isNormalMap, quality);
+        if(compressedFormat == ResourceFormat::Unknown)
+        {
+            Logger::log(Logger::Level::Error, "Texture::" + funcName + "(): Can't find a block-compressed format for " + to_string(format) + "\n");
+            return false;
+        }
+
+        // Compress the entire mip-chain
+        data.clear();
+        for(uint32_t mip = 0; mip < mipLevels; mip++)
+        {
+            uint32_t mipWidth, mipHeight;
+            pTexture->getMipLevelImageSize(mip, mipWidth, mipHeight);
+            std::vector<uint8_t> blocks;
+            if(compressImage(compressedFormat, mipWidth, mipHeight, rgbaMips[mip].data(), blocks, quality) == false)
+            {
+                return false;
+            }
+            data.insert(data.end(), blocks.begin(), blocks.end());
+        }
+        return true;
+    }
+
+    void Texture::compress2DTexture(bool isNormalMap, BlockCompressionQuality quality)
+    {
+        ResourceFormat compressedFormat;
+        std::vector<uint8_t> data;
+        if(compressMipChain(this, isNormalMap, quality, "compress2DTexture", compressedFormat, data) == false)
+        {
+            return;
         }
 
         // Delete the old resource
         gl_call(glDeleteTextures(1, &mApiHandle));
         
         // create a new texture
-        mApiHandle = init2DTexture(GL_TEXTURE_2D, mWidth, mHeight, compressedFormat, mMipLevels, data.data(), mFormat, true);
+        mApiHandle = init2DTexture(GL_TEXTURE_2D, mWidth, mHeight, compressedFormat, mMipLevels, data.data(), compressedFormat, false);
         mFormat = compressedFormat;
+        updateTrackedMemory();
+    }
+
+    Texture::SharedPtr Texture::createCompressed2DTexture(bool isNormalMap, BlockCompressionQuality quality) const
+    {
+        ResourceFormat compressedFormat;
+        std::vector<uint8_t> data;
+        if(compressMipChain(this, isNormalMap, quality, "createCompressed2DTexture", compressedFormat, data) == false)
+        {
+            return nullptr;
+        }
+
+        SharedPtr pCompressed = create2D(mWidth, mHeight, compressedFormat, 1, mMipLevels, data.data());
+        pCompressed->setName(mName);
+        pCompressed->setSourceFilename(mSourceFilename);
+        return pCompressed;
     }
 
 	void Texture::generateMips() const
@@ -704,19 +772,73 @@ namespace Falcor
 
 	void Texture::setSparseResidencyPageIndex(bool isResident, uint32_t mipLevel,  uint32_t pageX, uint32_t pageY, uint32_t pageZ, uint32_t width, uint32_t height, uint32_t depth)
 	{
-		assert(mIsSparse);
+        uint32_t pageWidth, pageHeight, pageDepth;
+        getSparsePageSize(pageWidth, pageHeight, pageDepth);
+        setSparseResidencyRegion(isResident, mipLevel, pageWidth * pageX, pageHeight * pageY, pageDepth * pageZ, pageWidth * width, pageHeight * height, pageDepth * depth);
+	}
 
-		if(mSparsePageWidth==0)
-		{
-			glGetInternalformativ(GL_TEXTURE_3D, getGlSizedFormat(mFormat), GL_VIRTUAL_PAGE_SIZE_X_ARB, 1, &mSparsePageWidth);
-			glGetInternalformativ(GL_TEXTURE_3D, getGlSizedFormat(mFormat), GL_VIRTUAL_PAGE_SIZE_Y_ARB, 1, &mSparsePageHeight);
-			glGetInternalformativ(GL_TEXTURE_3D, getGlSizedFormat(mFormat), GL_VIRTUAL_PAGE_SIZE_Z_ARB, 1, &mSparsePageDepth);
-		}
-		
+    void Texture::setSparseResidencyRegion(bool isResident, uint32_t mipLevel, uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth)
+    {
+        assert(mIsSparse);
+        gl_call(glTexturePageCommitmentEXT(getApiHandle(), mipLevel, static_cast<GLint>(x), static_cast<GLint>(y), static_cast<GLint>(z),
+            static_cast<GLsizei>(width), static_cast<GLsizei>(height), static_cast<GLsizei>(depth), isResident));
+    }
 
-		glTexturePageCommitmentEXT(getApiHandle(), mipLevel, static_cast<GLsizei>(mSparsePageWidth * pageX), static_cast<GLsizei>(mSparsePageHeight * pageY), static_cast<GLsizei>(mSparsePageDepth * pageZ),
-			static_cast<GLsizei>(mSparsePageWidth*width), static_cast<GLsizei>(mSparsePageHeight*height), static_cast<GLsizei>(mSparsePageDepth*depth),
-			isResident);
-	}
+    void Texture::getSparsePageSize(uint32_t& width, uint32_t& height, uint32_t& depth) const
+    {
+        if(mSparsePageWidth == 0)
+        {
+            GLenum target = convertTexTypeToGL(mType, mArraySize);
+            gl_call(glGetInternalformativ(target, getGlSizedFormat(mFormat), GL_VIRTUAL_PAGE_SIZE_X_ARB, 1, &mSparsePageWidth));
+            gl_call(glGetInternalformativ(target, getGlSizedFormat(mFormat), GL_VIRTUAL_PAGE_SIZE_Y_ARB, 1, &mSparsePageHeight));
+            gl_call(glGetInternalformativ(target, getGlSizedFormat(mFormat), GL_VIRTUAL_PAGE_SIZE_Z_ARB, 1, &mSparsePageDepth));
+        }
+        width = mSparsePageWidth;
+        height = mSparsePageHeight;
+        depth = mSparsePageDepth;
+    }
+
+    void Texture::uploadSubresourceRegion(const void* pData, uint32_t mipLevel, uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth)
+    {
+        if(mipLevel >= mMipLevels)
+        {
+            Logger::log(Logger::Level::Error, "Texture::uploadSubresourceRegion() - Requested mip level " + std::to_string(mipLevel) + " is out-of-bound. Texture has " + std::to_string(mMipLevels) + "mip-levels. Ignoring call.");
+            return;
+        }
+
+        gl_call(glPixelStorei(GL_UNPACK_ALIGNMENT, 1));
+        if(isCompressedFormat(mFormat))
+        {
+            GLenum glFormat = getGlSizedFormat(mFormat);
+            GLsizei dataSize = getFormatImageSize(mFormat, width, height) * depth;
+            switch(mType)
+            {
+            case Type::Texture2D:
+                gl_call(glCompressedTextureSubImage2D(mApiHandle, mipLevel, x, y, width, height, glFormat, dataSize, pData));
+                break;
+            case Type::Texture3D:
+                gl_call(glCompressedTextureSubImage3D(mApiHandle, mipLevel, x, y, z, width, height, depth, glFormat, dataSize, pData));
+                break;
+            default:
+                Logger::log(Logger::Level::Error, "Texture::uploadSubresourceRegion() - Only 2D and 3D textures are supported.");
+            }
+        }
+        else
+        {
+            GLenum baseFormat = getGlBaseFormat(mFormat);
+            GLenum baseType = getGlFormatType(mFormat);
+            switch(mType)
+            {
+            case Type::Texture2D:
+                gl_call(glTextureSubImage2D(mApiHandle, mipLevel, x, y, width, height, baseFormat, baseType, pData));
+                break;
+            case Type::Texture3D:
+                gl_call(glTextureSubImage3D(mApiHandle, mipLevel, x, y, z, width, height, depth, baseFormat, baseType, pData));
+                break;
+            default:
+                Logger::log(Logger::Level::Error, "Texture::uploadSubresourceRegion() - Only 2D and 3D textures are supported.");
+            }
+        }
+    }
 }
 #endif //#ifdef FALCOR_GL
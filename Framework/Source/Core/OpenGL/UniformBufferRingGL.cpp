@@ -0,0 +1,64 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#ifdef FALCOR_GL
+#include "Core/UniformBufferRing.h"
+
+namespace Falcor
+{
+    UniformBufferRing::~UniformBufferRing()
+    {
+        if(mpMappedData)
+        {
+            mpBuffer->unmap();
+        }
+    }
+
+    bool UniformBufferRing::apiInit()
+    {
+        int32_t alignment;
+        gl_call(glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment));
+        mAlignment = max((size_t)alignment, (size_t)16);
+
+        mpBuffer = Buffer::create(mAllocator.getCapacity(), Buffer::BindFlags::Uniform, Buffer::AccessFlags::MapWrite | Buffer::AccessFlags::Persistent, nullptr);
+        if(mpBuffer == nullptr)
+        {
+            return false;
+        }
+
+        // The buffer stays mapped for the lifetime of the ring
+        mpMappedData = (uint8_t*)mpBuffer->map(Buffer::MapType::Write);
+        return mpMappedData != nullptr;
+    }
+
+    void UniformBufferRing::apiWrite(size_t offset, const void* pData, size_t size)
+    {
+        memcpy(mpMappedData + offset, pData, size);
+    }
+}
+#endif //#ifdef FALCOR_GL
@@ -278,11 +278,17 @@ namespace Falcor
 
     void RenderContext::prepareForDraw() const
     {
-        for(auto& pUBO : mState.pUniformBuffers)
+        for(uint32_t i = 0; i < mState.pUniformBuffers.size(); i++)
         {
+            const auto& pUBO = mState.pUniformBuffers[i];
             if(pUBO)
             {
                 pUBO->uploadToGPU();
+                const UniformBufferRange& range = mBoundUniformBufferRanges[i];
+                if((range.pBuffer != pUBO->getGpuBuffer()) || (range.offset != pUBO->getGpuOffset()))
+                {
+                    applyUniformBuffer(i);
+                }
             }
         }
 
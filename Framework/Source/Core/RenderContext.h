@@ -271,6 +271,14 @@ namespace Falcor
         std::vector<std::stack<Viewport>> mVpStack;
         std::vector<std::stack<Scissor>> mScStack;
 
+        // The buffer range each uniform buffer slot is bound to. Transient uniform buffers move to a new slice of the frame ring when they are uploaded, so prepareForDraw() rebinds them when the range changes
+        struct UniformBufferRange
+        {
+            const Buffer* pBuffer = nullptr;
+            size_t offset = 0;
+        };
+        mutable std::vector<UniformBufferRange> mBoundUniformBufferRanges;
+
         // Default state objects
         RasterizerState::SharedConstPtr mpDefaultRastState;
         BlendState::SharedConstPtr mpDefaultBlendState;
@@ -42,5 +42,40 @@ namespace Falcor
             _BitScanReverse(&bits, dims);
             mMipLevels = (uint32_t)bits + 1;
         }
+        updateTrackedMemory();
+    }
+
+    uint64_t Texture::getMemoryUsage() const
+    {
+        if(mIsSparse)
+        {
+            return 0;
+        }
+
+        uint64_t size = 0;
+        uint32_t width = mWidth;
+        uint32_t height = mHeight;
+        uint32_t depth = mDepth;
+        for(uint32_t mip = 0; mip < mMipLevels; mip++)
+        {
+            size += uint64_t(getFormatImageSize(mFormat, width, height)) * depth;
+            width = max(1U, width >> 1);
+            height = max(1U, height >> 1);
+            depth = max(1U, depth >> 1);
+        }
+
+        uint32_t arraySize = mArraySize * ((mType == Type::TextureCube) ? 6 : 1);
+        return size * arraySize * max(mSampleCount, 1U);
+    }
+
+    void Texture::updateTrackedMemory()
+    {
+        uint64_t bytes = getMemoryUsage();
+        if(bytes != mTrackedBytes)
+        {
+            MemoryTracker::release(MemoryTracker::Category::Texture, mTrackedBytes);
+            MemoryTracker::allocate(MemoryTracker::Category::Texture, bytes);
+            mTrackedBytes = bytes;
+        }
     }
 }
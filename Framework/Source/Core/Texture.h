@@ -29,6 +29,8 @@
 #include <map>
 #include "Core/Formats.h"
 #include "../Framework.h" //For should_not_get_here
+#include "Utils/BlockCompression.h"
+#include "Utils/MemoryTracker.h"
 
 namespace Falcor
 {
@@ -90,6 +92,10 @@ namespace Falcor
         */
         uint32_t getArraySize() const { return mArraySize; }
 
+        /** Get the size of the texture's storage in bytes, including all mip-levels, array slices and samples. Sparse textures report 0, since their pages are committed separately
+        */
+        uint64_t getMemoryUsage() const;
+
         /** Get the resource format
         */
         ResourceFormat getFormat() const { return mFormat; }
@@ -120,9 +126,10 @@ namespace Falcor
             \param arraySize The array size of the texture.
 			\param mipLevels if equal to kEntireMipChain then an entire mip chain will be generated from mip level 0. If any other value is given then the data for at least that number of miplevels must be provided.
 			\param pInitData Optional. If different than nullptr, pointer to a buffer containing data to initialize the texture with.
+			\param isSparse Optional. If true, the texture is created as a sparse texture (GL_ARB_sparse_texture) without any physical memory allocated. pInitData must be null in this case.
             \return A pointer to a new texture, or nullptr if creation failed
         */
-        static SharedPtr create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize = 1, uint32_t mipLevels = kEntireMipChain, const void* pInitData = nullptr);
+        static SharedPtr create2D(uint32_t width, uint32_t height, ResourceFormat format, uint32_t arraySize = 1, uint32_t mipLevels = kEntireMipChain, const void* pInitData = nullptr, bool isSparse = false);
         /** create a 3D texture
             \param width The width of the texture.
             \param height The height of the texture.
@@ -187,6 +194,15 @@ namespace Falcor
         */
         void uploadSubresourceData(const void* pData, uint32_t dataSize, uint32_t mipLevel = 0, uint32_t arraySlice = 0);
 
+        /** Upload data to a region of a 2D or 3D texture's mip-level.\n
+            For compressed formats the region must be aligned to the block size, unless it extends to the edge of the mip-level.
+            \param pData Pointer to the data. Rows are tightly packed
+            \param mipLevel Mip-level to update
+            \param x, y, z The region's offset in texels
+            \param width, height, depth The region's size in texels
+        */
+        void uploadSubresourceRegion(const void* pData, uint32_t mipLevel, uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth = 1);
+
         /** Capture the texture to a PNG image.\n
         \param[in] mipLevel Requested mip-level
         \param[in] arraySlice Requested array-slice
@@ -194,7 +210,19 @@ namespace Falcor
         */
         void captureToPng(uint32_t mipLevel, uint32_t arraySlice, const std::string& filename) const;
 
-        void compress2DTexture();
+        /** Compress the texture into a block-compressed format, using the CPU block-compressor. The entire mip-chain is compressed.\n
+            The target format is selected based on the texture's channel count, its alpha content and the requested quality (see getBlockCompressedFormat()).
+            \param[in] isNormalMap If true, the texture is compressed into a two-channel BC5 texture. Shaders should reconstruct the normal's Z component.
+            \param[in] quality The compression quality
+        */
+        void compress2DTexture(bool isNormalMap = false, BlockCompressionQuality quality = BlockCompressionQuality::Normal);
+
+        /** Create a block-compressed copy of the texture, the same way compress2DTexture() does. The texture itself isn't changed, so use this for textures which might be shared, for example ones returned by TextureCache.
+            \param[in] isNormalMap If true, the texture is compressed into a two-channel BC5 texture
+            \param[in] quality The compression quality
+            \return The compressed texture, or nullptr if the texture is already compressed or can't be compressed
+        */
+        SharedPtr createCompressed2DTexture(bool isNormalMap = false, BlockCompressionQuality quality = BlockCompressionQuality::Normal) const;
 		
         /** Generates mipmaps for a specified texture object.
         */
@@ -226,6 +254,19 @@ namespace Falcor
         */
 		void setSparseResidencyPageIndex(bool isResident, uint32_t mipLevel,  uint32_t pageX, uint32_t pageY, uint32_t pageZ, uint32_t width=1, uint32_t height=1, uint32_t depth=1);
 
+        /** If the texture has been created as using sparse storage, makes a region of a mip-level resident or non-resident.
+            The region is specified in texels. It must be aligned to the sparse page size (see getSparsePageSize()), unless it extends to the edge of the mip-level.
+        */
+        void setSparseResidencyRegion(bool isResident, uint32_t mipLevel, uint32_t x, uint32_t y, uint32_t z, uint32_t width, uint32_t height, uint32_t depth = 1);
+
+        /** Get the size in texels of a sparse page for the texture's type and format
+        */
+        void getSparsePageSize(uint32_t& width, uint32_t& height, uint32_t& depth) const;
+
+        /** Check if the texture was created with sparse storage
+        */
+        bool isSparse() const { return mIsSparse; }
+
     protected:
         friend class Window;
         
@@ -235,6 +276,8 @@ namespace Falcor
         std::string mSourceFilename;
 
         Texture(uint32_t width, uint32_t height, uint32_t depth, uint32_t arraySize, uint32_t mipLevels, uint32_t sampleCount, ResourceFormat format, Type Type);
+        void updateTrackedMemory();     ///< Report a change in getMemoryUsage() to the MemoryTracker
+        uint64_t mTrackedBytes = 0;
         TextureHandle mApiHandle = 0;
         uint32_t mWidth = 0;
         uint32_t mHeight = 0;
@@ -246,9 +289,9 @@ namespace Falcor
         ResourceFormat mFormat = ResourceFormat::Unknown;
         bool mHasFixedSampleLocations = true;
 		bool mIsSparse = false;
-		int32_t mSparsePageWidth = 0;
-		int32_t mSparsePageHeight = 0;
-		int32_t mSparsePageDepth = 0;
+		mutable int32_t mSparsePageWidth = 0;
+		mutable int32_t mSparsePageHeight = 0;
+		mutable int32_t mSparsePageDepth = 0;
 
         mutable ShaderResourceViewHandle mpSRV;
         mutable std::map<uint32_t, uint64_t> mBindlessTextureHandle;
@@ -36,6 +36,10 @@ namespace Falcor
 {
     using namespace ShaderReflection;
 
+    uint64_t UniformBuffer::sFrameId = 0;
+    size_t UniformBuffer::sFrameUploadedBytes = 0;
+    size_t UniformBuffer::sLastFrameUploadedBytes = 0;
+
     inline const std::string removeLastArrayIndex(const std::string& name)
     {
         size_t dot = name.find_last_of(".");
@@ -93,19 +97,33 @@ namespace Falcor
 
     void UniformBuffer::uploadToGPU(size_t offset, size_t size) const
     {
-        if(mDirty == false)
+        if(mpBuffer == nullptr)
+        {
+            return;     // Can happen in DX11, if the buffer only contained textures
+        }
+
+        if(mTransient && uploadToRing())
         {
             return;
         }
 
-        if(mpBuffer == nullptr)
+        if(mDirty == false)
         {
-            return;     // Can happen in DX11, if the buffer only contained textures
+            return;
         }
 
         if(size == -1)
         {
-            size = mSize - offset;
+            if(offset == 0)
+            {
+                // Upload the dirty range
+                offset = min(mDirtyBegin, mSize);
+                size = min(mDirtyEnd, mSize) - offset;
+            }
+            else
+            {
+                size = mSize - offset;
+            }
         }
 
         if(size + offset > mSize)
@@ -114,17 +132,104 @@ namespace Falcor
             return;
         }
 
-        Buffer::MapType mapType = Buffer::MapType::Write;
-        if((offset == 0) && (size = mSize))
+#ifdef FALCOR_DX11
+        // Dynamic constant buffers can only be mapped with WRITE_DISCARD, which invalidates the entire buffer
+        offset = 0;
+        size = mSize;
+#endif
+
+        if(size)
         {
-            mapType = Buffer::MapType::WriteDiscard; // Updating the entire buffer
+            Buffer::MapType mapType = Buffer::MapType::Write;
+            if((offset == 0) && (size == mSize))
+            {
+                mapType = Buffer::MapType::WriteDiscard; // Updating the entire buffer
+            }
+
+            uint8_t* pData = (uint8_t*)mpBuffer->map(mapType);
+            assert(pData);
+            memcpy(pData + offset, mData.data() + offset, size);
+            mpBuffer->unmap();
+            updateUploadStats(size);
+        }
+
+        // The buffer is clean only if the upload covered the entire dirty range
+        if((offset <= mDirtyBegin) && (offset + size >= min(mDirtyEnd, mSize)))
+        {
+            mDirty = false;
+            mDirtyBegin = (size_t)-1;
+            mDirtyEnd = 0;
+        }
+    }
+
+    void UniformBuffer::setTransient(bool transient)
+    {
+        mTransient = transient;
+        mRingAllocation = UniformBufferRing::Allocation();
+        markDirty(0, mSize);
+    }
+
+    bool UniformBuffer::uploadToRing() const
+    {
+        UniformBufferRing* pRing = UniformBufferRing::getFrameRing();
+        if(pRing == nullptr)
+        {
+            return false;
         }
 
-        uint8_t* pData = (uint8_t*)mpBuffer->map(mapType);
-        assert(pData);
-        memcpy(pData + offset, mData.data() + offset, size);
-        mpBuffer->unmap();
+        // A slice is only valid during the frame it was allocated in, so it has to be reallocated on the first upload of every frame
+        if(mRingAllocation.pBuffer && (mDirty == false) && (mRingFrameId == pRing->getFrameId()))
+        {
+            return true;
+        }
+
+        if(pRing->allocate(mData.data(), mSize, mRingAllocation) == false)
+        {
+            // Fall back to the buffer object. It must contain the entire buffer
+            mRingAllocation = UniformBufferRing::Allocation();
+            mDirty = true;
+            mDirtyBegin = 0;
+            mDirtyEnd = mSize;
+            return false;
+        }
+
+        mRingFrameId = pRing->getFrameId();
+        updateUploadStats(mSize);
         mDirty = false;
+        mDirtyBegin = (size_t)-1;
+        mDirtyEnd = 0;
+        return true;
+    }
+
+    void UniformBuffer::updateUploadStats(size_t uploadedBytes) const
+    {
+        getUploadedBytes();     // Rolls the counters over if a new frame started
+        mFrameUploadedBytes += uploadedBytes;
+        sFrameUploadedBytes += uploadedBytes;
+    }
+
+    size_t UniformBuffer::getUploadedBytes() const
+    {
+        if(mStatsFrameId != sFrameId)
+        {
+            mLastFrameUploadedBytes = (mStatsFrameId + 1 == sFrameId) ? mFrameUploadedBytes : 0;
+            mFrameUploadedBytes = 0;
+            mStatsFrameId = sFrameId;
+        }
+        return mLastFrameUploadedBytes;
+    }
+
+    void UniformBuffer::endFrame()
+    {
+        UniformBufferRing* pRing = UniformBufferRing::getFrameRing(false);
+        if(pRing)
+        {
+            pRing->endFrame();
+        }
+
+        sLastFrameUploadedBytes = sFrameUploadedBytes;
+        sFrameUploadedBytes = 0;
+        sFrameId++;
     }
 
     template<bool ExpectArrayIndex>
@@ -270,7 +375,7 @@ namespace Falcor
         {                                                       \
             const uint8_t* pVar = mData.data() + offset;        \
             *(_c_type*)pVar = value;                            \
-            mDirty = true;                                      \
+            markDirty(offset, sizeof(_c_type));                 \
         }                                                       \
     }
 
@@ -368,7 +473,7 @@ namespace Falcor
             {                                                                                                       \
                 pData[i] = pValue[i];                                                                               \
             }                                                                                                       \
-            mDirty = true;                                                                                          \
+            markDirty(offset, sizeof(_c_type) * count);                                                             \
         }                                                                                                           \
     }
 
@@ -457,6 +562,59 @@ namespace Falcor
 
 #undef set_uniform_array_string
 
+#define get_variable_handle(_var_type, _c_type) \
+    template<> UniformBuffer::VarHandle<_c_type> UniformBuffer::getVariableHandle(const std::string& name) const     \
+    {                                                                                                               \
+        size_t offset;                                                                                              \
+        const auto pUniform = getVariableData<false>(name, offset);                                                 \
+        if(pUniform && checkVariableType(VariableDesc::Type::_var_type, pUniform->type, name, mName))               \
+        {                                                                                                           \
+            size_t arraySize = 1;                                                                                   \
+            if(pUniform->arraySize > 0 && pUniform->arrayStride > 0)                                                \
+            {                                                                                                       \
+                arraySize = pUniform->arraySize - (offset - pUniform->offset) / pUniform->arrayStride;              \
+            }                                                                                                       \
+            return VarHandle<_c_type>(offset, arraySize);                                                           \
+        }                                                                                                           \
+        return VarHandle<_c_type>();                                                                                \
+    }
+
+    get_variable_handle(Bool, bool);
+    get_variable_handle(Bool2, glm::bvec2);
+    get_variable_handle(Bool3, glm::bvec3);
+    get_variable_handle(Bool4, glm::bvec4);
+
+    get_variable_handle(Uint, uint32_t);
+    get_variable_handle(Uint2, glm::uvec2);
+    get_variable_handle(Uint3, glm::uvec3);
+    get_variable_handle(Uint4, glm::uvec4);
+
+    get_variable_handle(Int, int32_t);
+    get_variable_handle(Int2, glm::ivec2);
+    get_variable_handle(Int3, glm::ivec3);
+    get_variable_handle(Int4, glm::ivec4);
+
+    get_variable_handle(Float, float);
+    get_variable_handle(Float2, glm::vec2);
+    get_variable_handle(Float3, glm::vec3);
+    get_variable_handle(Float4, glm::vec4);
+
+    get_variable_handle(Float2x2, glm::mat2);
+    get_variable_handle(Float2x3, glm::mat2x3);
+    get_variable_handle(Float2x4, glm::mat2x4);
+
+    get_variable_handle(Float3x3, glm::mat3);
+    get_variable_handle(Float3x2, glm::mat3x2);
+    get_variable_handle(Float3x4, glm::mat3x4);
+
+    get_variable_handle(Float4x4, glm::mat4);
+    get_variable_handle(Float4x2, glm::mat4x2);
+    get_variable_handle(Float4x3, glm::mat4x3);
+
+    get_variable_handle(GpuPtr, uint64_t);
+
+#undef get_variable_handle
+
     size_t UniformBuffer::getVariableOffset(const std::string& varName) const
     {
         size_t offset;
@@ -474,7 +632,7 @@ namespace Falcor
             return;
         }
         memcpy(mData.data() + offset, pSrc, size);
-        mDirty = true;
+        markDirty(offset, size);
     }
 
     bool checkResourceDimension(const Texture* pTexture, const ShaderResourceDesc& shaderDesc, bool bindAsImage, const std::string& name, const std::string& bufferName)
@@ -637,7 +795,7 @@ namespace Falcor
 
         if(bOK)
         {
-            mDirty = true;
+            markDirty(offset, sizeof(uint64_t));
             setTextureInternal(offset, pTexture, pSampler);
         }
     }
@@ -30,6 +30,7 @@
 #include "ShaderReflection.h"
 #include "Texture.h"
 #include "Buffer.h"
+#include "UniformBufferRing.h"
 
 namespace Falcor
 {
@@ -72,6 +73,25 @@ namespace Falcor
         using SharedPtr = SharedPtrT<UboVar<UniformBuffer>>;
         using SharedConstPtr = std::shared_ptr<const UniformBuffer>;
 
+        /** A handle to a variable, resolved once by name using getVariableHandle().\n
+            Setting a variable through a handle writes directly at its offset. There's no name lookup and the type was already validated when the handle was resolved, so this is the fastest way to update a variable.
+            A handle can be used with any buffer which has the same layout as the buffer which created it.
+        */
+        template<typename T>
+        class VarHandle
+        {
+        public:
+            VarHandle() {}
+            bool isValid() const { return mOffset != (size_t)-1; }
+            size_t getOffset() const { return mOffset; }
+            size_t getArraySize() const { return mArraySize; }
+        private:
+            friend class UniformBuffer;
+            VarHandle(size_t offset, size_t arraySize) : mOffset(offset), mArraySize(arraySize) {}
+            size_t mOffset = (size_t)-1;
+            size_t mArraySize = 0;      ///< Number of array elements starting at the offset. 1 for variables which are not arrays
+        };
+
         /** create a new uniform buffer.\n
             Even though the buffer is created with a specific program, it can be used with other programs as long as the buffer declarations are the same across programs.
             \param[in] pProgram A program object with the uniform buffer declared
@@ -117,6 +137,41 @@ namespace Falcor
         template<typename T>
         void setVariableArray(const std::string& name, const T* pValue, size_t count);
 
+        /** Resolve a variable handle. The function will validate that T matches the declaration in the shader. If there's a mismatch, an error will be logged and an invalid handle is returned.
+        \param[in] name The uniform name. See notes about naming in the UniformBuffer class description. For arrays, the handle points to the element the name refers to (the first element if the name has no index).
+        */
+        template<typename T>
+        VarHandle<T> getVariableHandle(const std::string& name) const;
+
+        /** Set a uniform using a pre-resolved handle.
+        \param[in] handle The variable handle. Must be valid
+        \param[in] value Value to set
+        */
+        template<typename T>
+        void setVariable(const VarHandle<T>& handle, const T& value)
+        {
+            assert(handle.isValid());
+            *(T*)(mData.data() + handle.mOffset) = value;
+            markDirty(handle.mOffset, sizeof(T));
+        }
+
+        /** Set a uniform array using a pre-resolved handle.
+        \param[in] handle The variable handle. Must be valid
+        \param[in] pValue Pointer to an array of values to set
+        \param[in] count pValue array size. Must not exceed the handle's array size
+        */
+        template<typename T>
+        void setVariableArray(const VarHandle<T>& handle, const T* pValue, size_t count)
+        {
+            assert(handle.isValid() && count <= handle.mArraySize);
+            T* pData = (T*)(mData.data() + handle.mOffset);
+            for(size_t i = 0; i < count; i++)
+            {
+                pData[i] = pValue[i];
+            }
+            markDirty(handle.mOffset, sizeof(T) * count);
+        }
+
         /** Set a texture or image.
         The function will validate that the resource Type matches the declaration in the shader. If there's a mismatch, an error will be logged and the call will be ignored.
         \param[in] name The uniform name in the program. See notes about naming in the UniformBuffer class description.
@@ -146,16 +201,52 @@ namespace Falcor
         void setTexture(size_t Offset, const Texture* pTexture, const Sampler* pSampler, bool bindAsImage = false);
 
         /** Apply the changes to the actual GPU buffer.
+            The buffer tracks the range of bytes which changed since the last upload. When called with the default arguments, only that range is uploaded.
             Note that it is possible to use this function to update only part of the GPU copy of the buffer. This might lead to inconsistencies between the GPU and CPU buffer, so make sure you know what you are doing.
+            With D3D11, constant buffers can only be mapped with discard, so the entire buffer is uploaded whenever it's dirty.
             \param[in] offset Offset into the buffer to write to
-            \param[in] size   Number of bytes to upload. If this value is -1, will update the [Offset, EndOfBuffer] range.
+            \param[in] size   Number of bytes to upload. If this value is -1, will update the [Offset, EndOfBuffer] range, or the dirty range if offset is 0.
         */
         void uploadToGPU(size_t offset = 0, size_t size = -1) const;
 
+        /** Get the number of bytes this buffer uploaded to the GPU during the previous frame. See endFrame()
+        */
+        size_t getUploadedBytes() const;
+
+        /** Get the number of bytes all the uniform buffers uploaded to the GPU during the previous frame
+        */
+        static size_t getTotalUploadedBytes() { return sLastFrameUploadedBytes; }
+
+        /** Mark the end of a frame for the upload statistics and close the frame of the transient frame ring. Sample calls this once per frame
+        */
+        static void endFrame();
+
         /** Get the internal buffer object
         */
         Buffer::SharedPtr getBuffer() const { return mpBuffer; }
 
+        /** Enable or disable transient mode.\n
+            A transient buffer doesn't upload into its own buffer object. Instead, each upload copies the entire buffer into a new slice of the frame ring (see UniformBufferRing::getFrameRing()), and the render context binds the slice at its offset. Use it for buffers which are updated between draws, so that updating them doesn't force the driver to synchronize or rename the buffer.
+            If the frame ring isn't supported or is full, the buffer falls back to uploading into its own buffer object.
+        */
+        void setTransient(bool transient);
+
+        /** Check if the buffer is in transient mode
+        */
+        bool isTransient() const { return mTransient; }
+
+        /** Get the buffer object which holds the GPU copy of the data. For transient buffers, this is the frame ring's buffer
+        */
+        const Buffer* getGpuBuffer() const { return mRingAllocation.pBuffer ? mRingAllocation.pBuffer : mpBuffer.get(); }
+
+        /** Get the offset of the GPU copy of the data inside the buffer returned by getGpuBuffer()
+        */
+        size_t getGpuOffset() const { return mRingAllocation.offset; }
+
+        /** Get the size of the range which should be bound. For transient buffers, this is the size of the frame ring slice
+        */
+        size_t getGpuSize() const { return mRingAllocation.pBuffer ? mRingAllocation.size : mSize; }
+
         /** Get uniform offset inside the buffer. See notes about naming in the UniformBuffer class description. Uniform name can be provided with an implicit array-index, similar to UniformBuffer#SetVariableArray.
         */
         size_t getVariableOffset(const std::string& varName) const;
@@ -180,6 +271,29 @@ namespace Falcor
         std::vector<uint8_t> mData;
         size_t mSize = 0;
         mutable bool mDirty = true;
+        mutable size_t mDirtyBegin = 0;             ///< The dirty byte range is [mDirtyBegin, mDirtyEnd)
+        mutable size_t mDirtyEnd = (size_t)-1;
+        void markDirty(size_t offset, size_t size)
+        {
+            mDirty = true;
+            mDirtyBegin = min(mDirtyBegin, offset);
+            mDirtyEnd = max(mDirtyEnd, offset + size);
+        }
+
+        // Transient mode
+        bool mTransient = false;
+        mutable UniformBufferRing::Allocation mRingAllocation;
+        mutable uint64_t mRingFrameId = 0;
+        bool uploadToRing() const;
+
+        // Upload statistics
+        mutable uint64_t mStatsFrameId = 0;
+        mutable size_t mFrameUploadedBytes = 0;
+        mutable size_t mLastFrameUploadedBytes = 0;
+        void updateUploadStats(size_t uploadedBytes) const;
+        static uint64_t sFrameId;
+        static size_t sFrameUploadedBytes;
+        static size_t sLastFrameUploadedBytes;
 
         ShaderReflection::VariableDescMap mVariables;
         ShaderReflection::ShaderResourceDescMap mResources;
@@ -0,0 +1,94 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "Core/UniformBufferRing.h"
+
+namespace Falcor
+{
+    UniformBufferRing::SharedPtr UniformBufferRing::spFrameRing;
+    bool UniformBufferRing::sFrameRingCreated = false;
+
+    UniformBufferRing::UniformBufferRing(size_t size) : mAllocator(size)
+    {
+    }
+
+    UniformBufferRing::SharedPtr UniformBufferRing::create(size_t size)
+    {
+        SharedPtr pRing = SharedPtr(new UniformBufferRing(size));
+        if(pRing->apiInit() == false)
+        {
+            return nullptr;
+        }
+        pRing->mpFence = GpuFence::create();
+        return pRing;
+    }
+
+    UniformBufferRing* UniformBufferRing::getFrameRing(bool createIfMissing)
+    {
+        if(createIfMissing && (sFrameRingCreated == false))
+        {
+            sFrameRingCreated = true;
+            spFrameRing = create();
+            if(spFrameRing == nullptr)
+            {
+                Logger::log(Logger::Level::Info, "Uniform buffers can't be bound at an offset on this device. Transient uniform buffers will use their own buffers.");
+            }
+        }
+        return spFrameRing.get();
+    }
+
+    bool UniformBufferRing::allocate(const void* pData, size_t size, Allocation& allocation)
+    {
+        size_t sliceSize = (size + mAlignment - 1) & ~(mAlignment - 1);
+        size_t offset = mAllocator.allocate(sliceSize, mAlignment);
+        while(offset == FrameRingAllocator::kInvalidOffset)
+        {
+            if(mAllocator.getInFlightFrameCount() == 0)
+            {
+                // The current frame alone filled the ring
+                return false;
+            }
+            mpFence->syncCpu(mAllocator.getOldestFrameFenceValue());
+            mAllocator.releaseCompletedFrames(mpFence->getCompletedValue());
+            offset = mAllocator.allocate(sliceSize, mAlignment);
+        }
+
+        apiWrite(offset, pData, size);
+        allocation.pBuffer = mpBuffer.get();
+        allocation.offset = offset;
+        allocation.size = sliceSize;
+        return true;
+    }
+
+    void UniformBufferRing::endFrame()
+    {
+        mAllocator.endFrame(mpFence->signal());
+        mAllocator.releaseCompletedFrames(mpFence->getCompletedValue());
+        mFrameId++;
+    }
+}
@@ -0,0 +1,108 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <memory>
+#include "Core/Buffer.h"
+#include "Core/GpuFence.h"
+#include "Utils/FrameRingAllocator.h"
+
+namespace Falcor
+{
+    /** A ring of transient uniform-buffer memory, partitioned into frames.\n
+        Each allocation is an aligned slice of one large buffer, which is bound to the pipeline at the slice's offset. The memory of a frame is recycled once a GPU fence signals the GPU finished executing the frame, so writing into a slice never stalls on the GPU or forces the driver to rename the buffer.\n
+        With OpenGL, the buffer is persistently mapped. With D3D11, the ring requires D3D11.1 support for constant-buffer offsetting and no-overwrite mapping of constant buffers.
+    */
+    class UniformBufferRing
+    {
+    public:
+        using SharedPtr = std::shared_ptr<UniformBufferRing>;
+
+        struct Allocation
+        {
+            const Buffer* pBuffer = nullptr;
+            size_t offset = 0;
+            size_t size = 0;    ///< The slice size. This is the requested size rounded up to the offset alignment
+        };
+
+        /** Create a new ring
+            \param[in] size The size in bytes of the ring's buffer
+            \return A new object, or nullptr if the API doesn't support binding uniform buffers at an offset
+        */
+        static SharedPtr create(size_t size = kDefaultSize);
+
+        /** Get the process-wide ring used by transient uniform buffers (see UniformBuffer::setTransient()). UniformBuffer::endFrame() closes its frames.
+            \param[in] createIfMissing If true, the ring is created on the first call
+            \return The ring, or nullptr if it isn't supported or wasn't created yet
+        */
+        static UniformBufferRing* getFrameRing(bool createIfMissing = true);
+
+        /** Copy data into a new slice of the current frame.
+            If the ring is full, the call blocks until the GPU finished the oldest in-flight frame.
+            \param[in] pData The data to copy
+            \param[in] size Number of bytes to copy
+            \param[out] allocation On success, the slice the data was copied to
+            \return false if the size exceeds the ring's capacity, otherwise true
+        */
+        bool allocate(const void* pData, size_t size, Allocation& allocation);
+
+        /** Close the current frame and recycle the frames the GPU is done with
+        */
+        void endFrame();
+
+        /** Get the number of frames closed so far. Slices allocated when this value was different belong to a frame which might have been recycled
+        */
+        uint64_t getFrameId() const { return mFrameId; }
+
+        /** Get the bookkeeping of the ring
+        */
+        const FrameRingAllocator& getAllocator() const { return mAllocator; }
+
+        /** Get the alignment of the slices' offsets
+        */
+        size_t getOffsetAlignment() const { return mAlignment; }
+
+        ~UniformBufferRing();
+
+        static const size_t kDefaultSize = 4 * 1024 * 1024;
+    private:
+        UniformBufferRing(size_t size);
+        bool apiInit();
+        void apiWrite(size_t offset, const void* pData, size_t size);
+
+        FrameRingAllocator mAllocator;
+        GpuFence::SharedPtr mpFence;
+        Buffer::SharedPtr mpBuffer;
+        uint8_t* mpMappedData = nullptr;
+        size_t mAlignment = 256;
+        uint64_t mFrameId = 0;
+        bool mFirstWrite = true;
+
+        static SharedPtr spFrameRing;
+        static bool sFrameRingCreated;
+    };
+}
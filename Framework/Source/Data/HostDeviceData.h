@@ -298,6 +298,8 @@ struct MaterialDesc
     uint32_t            hasNormalMap    DEFAULTS(0);
     uint32_t            hasHeightMap    DEFAULTS(0);
     uint32_t            hasAmbientMap   DEFAULTS(0);
+    vec3                pad             DEFAULTS(vec3(0, 0, 0));
+    uint32_t            hasTwoChannelNormalMap  DEFAULTS(0);    // The normal map only stores X and Y (BC5), Z is reconstructed in the shader
 };
 
 struct MaterialValues
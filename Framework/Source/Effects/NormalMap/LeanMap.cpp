@@ -30,73 +30,287 @@
 #include "Data/Effects/LeanMapData.h"
 #include "Graphics/Material/Material.h"
 #include "Graphics/Scene/Scene.h"
+#include "Graphics/TextureHelper.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/OS.h"
+#include <emmintrin.h>
+#include <fstream>
 
 namespace Falcor
 {
+    static const uint32_t kLeanCacheMagic = 0x434D4C46;     // 'FLMC'
+    static const uint32_t kLeanCacheVersion = 1;
+    static const float kLeanEpsilon = 1e-3f;
+
+    struct LeanCacheHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t sourceHash;
+        uint32_t width;
+        uint32_t height;
+    };
+
+    /** Converts the rows of a normal map to LEAN data. The format is resolved once per texture, by picking the matching instantiation of generateRow()
+    */
+    using GenerateRowFunc = void(*)(const uint8_t* pSrc, uint32_t width, const float* pLut, vec4* pDst);
+
+    static vec4 calcLeanTexel(vec3 tn)
+    {
+        // Unpack and normalize the normal
+        vec3 n = tn * 2.f - vec3(1.f);
+        n.z = max(n.z, kLeanEpsilon);
+        n = normalize(n);
+
+        // Write out the first moment (mean) in slope space
+        vec2 b = vec2(n.x, n.y) / max(n.z, kLeanEpsilon);
+        vec2 m = b*b;
+        return vec4(b.x*0.5f + 0.5f, b.y*0.5f + 0.5f, m.x, m.y);
+    }
+
+    /** Load 4 RGBA8 texels and convert them to floats in [0, 1]. Returns the texels transposed - one register per channel
+    */
+    template<bool isSrgb>
+    static void loadTexels(const uint8_t* pSrc, const float* pLut, __m128& c0, __m128& c1, __m128& c2)
+    {
+        __m128 t0, t1, t2, t3;
+        if(isSrgb)
+        {
+            t0 = _mm_setr_ps(pLut[pSrc[0]], pLut[pSrc[1]], pLut[pSrc[2]], 0);
+            t1 = _mm_setr_ps(pLut[pSrc[4]], pLut[pSrc[5]], pLut[pSrc[6]], 0);
+            t2 = _mm_setr_ps(pLut[pSrc[8]], pLut[pSrc[9]], pLut[pSrc[10]], 0);
+            t3 = _mm_setr_ps(pLut[pSrc[12]], pLut[pSrc[13]], pLut[pSrc[14]], 0);
+        }
+        else
+        {
+            const __m128i zero = _mm_setzero_si128();
+            const __m128 scale = _mm_set1_ps(1.0f / 255.0f);
+            __m128i bytes = _mm_loadu_si128((const __m128i*)pSrc);
+            __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            t0 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale);
+            t1 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale);
+            t2 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale);
+            t3 = _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale);
+        }
+        _MM_TRANSPOSE4_PS(t0, t1, t2, t3);
+        c0 = t0;
+        c1 = t1;
+        c2 = t2;
+    }
+
+    template<bool isSrgb, bool isBgr>
+    static void generateRow(const uint8_t* pSrc, uint32_t width, const float* pLut, vec4* pDst)
+    {
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 two = _mm_set1_ps(2.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        const __m128 epsilon = _mm_set1_ps(kLeanEpsilon);
+
+        uint32_t x = 0;
+        for(; x + 4 <= width; x += 4)
+        {
+            __m128 c0, c1, c2;
+            loadTexels<isSrgb>(pSrc + x * 4, pLut, c0, c1, c2);
+
+            // Unpack and normalize the normals
+            __m128 nx = _mm_sub_ps(_mm_mul_ps(isBgr ? c2 : c0, two), one);
+            __m128 ny = _mm_sub_ps(_mm_mul_ps(c1, two), one);
+            __m128 nz = _mm_max_ps(_mm_sub_ps(_mm_mul_ps(isBgr ? c0 : c2, two), one), epsilon);
+            __m128 lengthSquared = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, nx), _mm_mul_ps(ny, ny)), _mm_mul_ps(nz, nz));
+            __m128 invLength = _mm_div_ps(one, _mm_sqrt_ps(lengthSquared));
+            nx = _mm_mul_ps(nx, invLength);
+            ny = _mm_mul_ps(ny, invLength);
+            nz = _mm_max_ps(_mm_mul_ps(nz, invLength), epsilon);
+
+            // First moment in slope space, and the squares for the second moment
+            __m128 bx = _mm_div_ps(nx, nz);
+            __m128 by = _mm_div_ps(ny, nz);
+            __m128 o0 = _mm_add_ps(_mm_mul_ps(bx, half), half);
+            __m128 o1 = _mm_add_ps(_mm_mul_ps(by, half), half);
+            __m128 o2 = _mm_mul_ps(bx, bx);
+            __m128 o3 = _mm_mul_ps(by, by);
+            _MM_TRANSPOSE4_PS(o0, o1, o2, o3);
+            _mm_storeu_ps(&pDst[x + 0].x, o0);
+            _mm_storeu_ps(&pDst[x + 1].x, o1);
+            _mm_storeu_ps(&pDst[x + 2].x, o2);
+            _mm_storeu_ps(&pDst[x + 3].x, o3);
+        }
+
+        // Leftover texels
+        for(; x < width; x++)
+        {
+            const uint8_t* pTexel = pSrc + x * 4;
+            vec3 tn(pLut[pTexel[0]], pLut[pTexel[1]], pLut[pTexel[2]]);
+            if(isBgr)
+            {
+                std::swap(tn.x, tn.z);
+            }
+            pDst[x] = calcLeanTexel(tn);
+        }
+    }
+
+    static GenerateRowFunc getGenerateRowFunc(ResourceFormat format)
+    {
+        switch(format)
+        {
+        case ResourceFormat::RGBA8Unorm:
+            return generateRow<false, false>;
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRX8Unorm:
+            return generateRow<false, true>;
+        case ResourceFormat::RGBA8UnormSrgb:
+            return generateRow<true, false>;
+        case ResourceFormat::BGRA8UnormSrgb:
+            return generateRow<true, true>;
+        default:
+            return nullptr;
+        }
+    }
+
+    void LeanMap::generateLeanData(const uint8_t* pNormalMapData, uint32_t width, uint32_t height, ResourceFormat format, vec4* pLeanData)
+    {
+        GenerateRowFunc generateRowFunc = getGenerateRowFunc(format);
+        assert(generateRowFunc);
+
+        float lut[256];
+        for(uint32_t i = 0; i < 256; i++)
+        {
+            float value = float(i) * (1.0f / 255.0f);
+            lut[i] = clamp(isSrgbFormat(format) ? SRGBToLinear(value) : value, 0.0f, 1.0f);
+        }
+
+        ThreadPool::getDefaultPool()->parallelFor(0, height, [&](uint32_t y)
+        {
+            generateRowFunc(pNormalMapData + size_t(y) * width * 4, width, lut, pLeanData + size_t(y) * width);
+        });
+    }
+
+    /** Hash the normal map's source file. The dimensions, format and graphics API are part of the key, since they affect the texture's content
+    */
+    static bool getSourceHash(const Texture* pNormalMap, std::string& sourceFullpath, uint64_t& hash)
+    {
+        if(pNormalMap->getSourceFilename().empty() || findFileInDataDirectories(pNormalMap->getSourceFilename(), sourceFullpath) == false)
+        {
+            return false;
+        }
+
+        std::ifstream stream(sourceFullpath, std::ios::binary);
+        std::vector<char> fileData((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+        if(stream.bad())
+        {
+            return false;
+        }
+
+        struct
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t format;
+            uint32_t isTopDown;
+        } textureInfo;
+        textureInfo.width = pNormalMap->getWidth();
+        textureInfo.height = pNormalMap->getHeight();
+        textureInfo.format = (uint32_t)pNormalMap->getFormat();
+#ifdef FALCOR_GL
+        textureInfo.isTopDown = 0;
+#else
+        textureInfo.isTopDown = 1;
+#endif
+        hash = hashBytes(fileData.data(), fileData.size());
+        hash = hashBytes(&textureInfo, sizeof(textureInfo), hash);
+        return true;
+    }
+
+    static std::string getCacheFilename(const std::string& sourceFullpath)
+    {
+        return sourceFullpath + ".lean";
+    }
+
+    static bool loadFromCache(const std::string& cacheFilename, uint64_t sourceHash, uint32_t width, uint32_t height, std::vector<vec4>& leanData)
+    {
+        std::ifstream stream(cacheFilename, std::ios::binary);
+        if(stream.fail())
+        {
+            return false;
+        }
+
+        LeanCacheHeader header;
+        stream.read((char*)&header, sizeof(header));
+        if(stream.fail() || header.magic != kLeanCacheMagic || header.version != kLeanCacheVersion || header.sourceHash != sourceHash || header.width != width || header.height != height)
+        {
+            return false;
+        }
+
+        leanData.resize(size_t(width) * height);
+        stream.read((char*)leanData.data(), leanData.size() * sizeof(vec4));
+        return stream.fail() == false;
+    }
+
+    static void saveToCache(const std::string& cacheFilename, uint64_t sourceHash, uint32_t width, uint32_t height, const std::vector<vec4>& leanData)
+    {
+        std::ofstream stream(cacheFilename, std::ios::binary);
+        LeanCacheHeader header;
+        header.magic = kLeanCacheMagic;
+        header.version = kLeanCacheVersion;
+        header.sourceHash = sourceHash;
+        header.width = width;
+        header.height = height;
+        stream.write((const char*)&header, sizeof(header));
+        stream.write((const char*)leanData.data(), leanData.size() * sizeof(vec4));
+        if(stream.fail())
+        {
+            Logger::log(Logger::Level::Warning, "Can't write LEAN map cache file '" + cacheFilename + "'.");
+        }
+    }
+
     Texture::SharedPtr LeanMap::createFromNormalMap(const Falcor::Texture* pNormalMap)
     {
         uint32_t texW = pNormalMap->getWidth();
         uint32_t texH = pNormalMap->getHeight();
 
+        // Normal maps compressed after loading (see Model::CompressTextures) only keep two channels. The LEAN map is generated from the uncompressed file instead
+        bool useSourceFile = isCompressedFormat(pNormalMap->getFormat()) && pNormalMap->getSourceFilename().size();
+        if(useSourceFile == false && getGenerateRowFunc(pNormalMap->getFormat()) == nullptr)
+        {
+            Logger::log(Logger::Level::Error, "Can't generate LEAN map. Unsupported normal map format.");
+            return nullptr;
+        }
+
         std::vector<vec4> leanData;
+        std::string sourceFullpath;
+        uint64_t sourceHash;
+        bool useCache = getSourceHash(pNormalMap, sourceFullpath, sourceHash);
+        if(useCache == false || loadFromCache(getCacheFilename(sourceFullpath), sourceHash, texW, texH, leanData) == false)
+        {
+            // The texture cache returns the uncompressed texture if another model still uses it, otherwise the file is loaded again
+            const Texture* pData = pNormalMap;
+            Texture::SharedPtr pSource;
+            if(useSourceFile)
+            {
+                pSource = createTextureFromFile(pNormalMap->getSourceFilename(), pNormalMap->getMipLevels() > 1, false);
+                if(pSource && pSource->getWidth() == texW && pSource->getHeight() == texH)
+                {
+                    pData = pSource.get();
+                }
+            }
 
-        leanData.resize(texW * texH);
+            if(getGenerateRowFunc(pData->getFormat()) == nullptr)
+            {
+                Logger::log(Logger::Level::Error, "Can't generate LEAN map. Unsupported normal map format.");
+                return nullptr;
+            }
 
-        uint32_t normalMapDataSize = pNormalMap->getMipLevelDataSize(0);
-        std::vector<uint8_t> normalMapData(normalMapDataSize);
-        pNormalMap->readSubresourceData(normalMapData.data(), normalMapDataSize, 0, 0);
+            uint32_t normalMapDataSize = pData->getMipLevelDataSize(0);
+            std::vector<uint8_t> normalMapData(normalMapDataSize);
+            pData->readSubresourceData(normalMapData.data(), normalMapDataSize, 0, 0);
 
-        const float oneBy255 = 1.0f / 255.0f;
-        for(auto y = 0u; y < texH; y++)
-        {
-            for(auto x = 0u; x < texW; x++)
-            {
-                auto texIdx = (x + y * texW);
-                vec3 tn;
+            leanData.resize(size_t(texW) * texH);
+            generateLeanData(normalMapData.data(), texW, texH, pData->getFormat(), leanData.data());
 
-                switch(pNormalMap->getFormat())
-                {
-                case ResourceFormat::RGBA8Unorm:
-                {
-                    tn.x = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 0]), 0.0f, 1.0f);
-                    tn.y = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 1]), 0.0f, 1.0f);
-                    tn.z = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 2]), 0.0f, 1.0f);
-                } break;
-                case ResourceFormat::BGRA8Unorm:
-                case ResourceFormat::BGRX8Unorm:
-                {
-                    tn.z = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 0]), 0.0f, 1.0f);
-                    tn.y = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 1]), 0.0f, 1.0f);
-                    tn.x = clamp(oneBy255 * (float)(normalMapData[texIdx * 4 + 2]), 0.0f, 1.0f);
-                } break;
-                case ResourceFormat::RGBA8UnormSrgb:
-                {
-                    tn.x = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 0])), 0.0f, 1.0f);
-                    tn.y = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 1])), 0.0f, 1.0f);
-                    tn.z = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 2])), 0.0f, 1.0f);
-                } break;
-                case ResourceFormat::BGRA8UnormSrgb:
-                {
-                    tn.z = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 0])), 0.0f, 1.0f);
-                    tn.y = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 1])), 0.0f, 1.0f);
-                    tn.x = clamp(SRGBToLinear(oneBy255 * (float)(normalMapData[texIdx * 4 + 2])), 0.0f, 1.0f);
-                } break;
-                default: 
-                    Logger::log(Logger::Level::Error, "Can't generate LEAN map. Unsupported normal map format.");
-                    return nullptr;
-                };
-
-                // Unpack
-                static const float epsilon = 1e-3f;
-                vec3 n = tn * 2.f - vec3(1.f);
-                // And normalize the normal
-                n.z = max(n.z, epsilon);
-                n = normalize(n);
-
-                // Write out the first moment (mean) in slope space
-                vec2 b = vec2(n.x, n.y) / max(n.z, epsilon);
-                vec2 m = b*b;
-                leanData[texIdx] = vec4(b.x*0.5f + 0.5f, b.y*0.5f + 0.5f, m.x, m.y);
+            if(useCache)
+            {
+                saveToCache(getCacheFilename(sourceFullpath), sourceHash, texW, texH, leanData);
             }
         }
 
@@ -117,7 +331,17 @@ namespace Falcor
         const Texture* pNormalMap = pMaterial->getNormalValue().texture.pTexture.get();
         if(pNormalMap)
         {
-            mpLeanMaps[materialID] = createFromNormalMap(pNormalMap);
+            // Materials often share normal maps
+            auto existing = mpLeanMapsBySource.find(pNormalMap);
+            if(existing != mpLeanMapsBySource.end())
+            {
+                mpLeanMaps[materialID] = existing->second;
+            }
+            else
+            {
+                mpLeanMaps[materialID] = createFromNormalMap(pNormalMap);
+                mpLeanMapsBySource[pNormalMap] = mpLeanMaps[materialID];
+            }
             mShaderArraySize = max(materialID + 1, mShaderArraySize);
         }
         return true;
@@ -43,8 +43,21 @@ namespace Falcor
     public:
         using UniquePtr = std::unique_ptr<LeanMap>;
         static UniquePtr create(const Falcor::Scene* pScene);
+
+        /** Create a LEAN map from a normal map. The normal map must use one of the 8-bit RGBA/BGRA formats, or be a block-compressed copy of a file which does (see Model::CompressTextures). In that case the file is loaded again uncompressed.\n
+            If the normal map was loaded from a file, the result is cached in a '.lean' file next to it. The cache is keyed by a hash of the file's content, so it's regenerated when the normal map changes.
+        */
         static Falcor::Texture::SharedPtr createFromNormalMap(const Falcor::Texture* pNormalMap);
 
+        /** Generate the LEAN data of a normal map on the CPU.
+            \param[in] pNormalMapData The normal map texels, 4 bytes per texel, rows tightly packed
+            \param[in] width The normal map width
+            \param[in] height The normal map height
+            \param[in] format The normal map format. Must be one of the 8-bit RGBA/BGRA formats
+            \param[out] pLeanData width * height LEAN texels
+        */
+        static void generateLeanData(const uint8_t* pNormalMapData, uint32_t width, uint32_t height, ResourceFormat format, glm::vec4* pLeanData);
+
         Falcor::Texture* getLeanMap(uint32_t sceneMaterialID) { return mpLeanMaps[sceneMaterialID].get(); }
         void setIntoUniformBuffer(Falcor::UniformBuffer* pUB, size_t offset, Falcor::Sampler* pSampler = nullptr) const;
         void setIntoUniformBuffer(Falcor::UniformBuffer* pUB, const std::string& varName, Falcor::Sampler* pSampler = nullptr) const;
@@ -53,6 +66,7 @@ namespace Falcor
         LeanMap() = default;
         bool createLeanMap(const Falcor::Material* pMaterial);
         std::map<uint32_t, Falcor::Texture::SharedPtr> mpLeanMaps;
+        std::map<const Falcor::Texture*, Falcor::Texture::SharedPtr> mpLeanMapsBySource;
         uint32_t mShaderArraySize = 0;
     };
 }
\ No newline at end of file
@@ -51,6 +51,7 @@
 #include "Core/VAO.h"
 #include "Core/FBO.h"
 #include "Core/GpuTimer.h"
+#include "Core/GpuFence.h"
 #include "Core/UniformBuffer.h"
 #include "Core/VertexLayout.h"
 #include "Core/ShaderStorageBuffer.h"
@@ -62,6 +63,9 @@
 // Graphics
 #include "Graphics/FullScreenPass.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCooker.h"
+#include "Graphics/TextureCache.h"
+#include "Graphics/ResidencyManager.h"
 #include "Graphics/Light.h"
 #include "Graphics/Program.h"
 #include "Graphics/Program.h"
@@ -83,6 +87,13 @@
 #include "Graphics/Scene/SceneRenderer.h"
 #include "Graphics/Scene/SceneEditor.h"
 #include "Graphics/Scene/SceneUtils.h"
+#include "Graphics/Scene/SceneBenchmark.h"
+#include "Graphics/Scene/SceneSnapshot.h"
+#include "Graphics/Scene/StreamingScheduler.h"
+#include "Graphics/Scene/SceneStreamer.h"
+
+// Virtual texture
+#include "Graphics/VirtualTexture/VirtualTexture.h"
 
 
 // Math
@@ -103,6 +114,8 @@
 #include "Utils/Profiler.h"
 #include "Utils/StringUtils.h"
 #include "Utils/BinaryFileStream.h"
+#include "Utils/PixelConversion.h"
+#include "Utils/MemoryTracker.h"
 #include "Utils/Video/VideoEncoder.h"
 #include "Utils/Video/VideoEncoderUI.h"
 #include "Utils/Video/VideoDecoder.h"
@@ -29,6 +29,7 @@
 #include "FalcorConfig.h"
 #include <stdint.h>
 #include <memory>
+#include <functional>
 #include "glm/glm.hpp"
 
 #ifndef arraysize
@@ -112,6 +113,31 @@ namespace Falcor
     {
         return (a > b) ? a : b;
     }
+
+    /** Combine the hash of a value into a seed. Use it to hash aggregate keys.
+    */
+    template<typename T>
+    inline void hashCombine(size_t& seed, const T& value)
+    {
+        seed ^= std::hash<T>()(value) + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+    }
+
+    /** Compute a 64-bit FNV-1a hash of a memory block
+        \param[in] pData The data to hash
+        \param[in] size The size of the data in bytes
+        \param[in] seed Optional. Pass the hash of a previous block to hash multiple blocks together.
+    */
+    inline uint64_t hashBytes(const void* pData, size_t size, uint64_t seed = 14695981039346656037ull)
+    {
+        const uint8_t* pBytes = (const uint8_t*)pData;
+        uint64_t hash = seed;
+        for(size_t i = 0; i < size; i++)
+        {
+            hash ^= pBytes[i];
+            hash *= 1099511628211ull;
+        }
+        return hash;
+    }
     /*! @} */
 }
 
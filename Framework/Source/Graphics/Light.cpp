@@ -30,6 +30,7 @@
 #include "Utils/Gui.h"
 #include "Core/UniformBuffer.h"
 #include "Core/Buffer.h"
+#include "Graphics/ResidencyManager.h"
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include "Data/VertexAttrib.h"
@@ -307,16 +308,13 @@ namespace Falcor
 
 	void AreaLight::prepareGPUData()
 	{
-		// Set OGL buffer pointers for indices, vertices, and texcoord
-		if (mData.indexPtr.ptr == 0ull)
-		{
-			mData.indexPtr.ptr = mIndexBuf->makeResident();
-			mData.vertexPtr.ptr = mVertexBuf->makeResident();
-			if (mTexCoordBuf)
-				mData.texCoordPtr.ptr = mTexCoordBuf->makeResident();
-			// Store the mesh CDF buffer id
-			mData.meshCDFPtr.ptr = mMeshCDFBuf->makeResident();
-		}
+		// Set OGL buffer pointers for indices, vertices, and texcoord. The residency manager might have evicted the buffers since the last call, so the pointers are fetched every time
+		mData.indexPtr.ptr = ResidencyManager::makeBufferResident(mIndexBuf.get());
+		mData.vertexPtr.ptr = ResidencyManager::makeBufferResident(mVertexBuf.get());
+		if (mTexCoordBuf)
+			mData.texCoordPtr.ptr = ResidencyManager::makeBufferResident(mTexCoordBuf.get());
+		// Store the mesh CDF buffer id
+		mData.meshCDFPtr.ptr = ResidencyManager::makeBufferResident(mMeshCDFBuf.get());
 		mData.numIndices = uint32_t(mIndexBuf->getSize() / sizeof(glm::ivec3));
 
 		// Get the surface area of the geometry mesh
@@ -334,11 +332,15 @@ namespace Falcor
 	void AreaLight::unloadGPUData()
 	{
 	    // Unload GPU data by calling makeNonResident()
-		mIndexBuf->makeNonResident();
-		mVertexBuf->makeNonResident();
+		ResidencyManager::makeBufferNonResident(mIndexBuf.get());
+		ResidencyManager::makeBufferNonResident(mVertexBuf.get());
 		if (mTexCoordBuf)
-			mTexCoordBuf->makeNonResident();
-		mMeshCDFBuf->makeNonResident();
+			ResidencyManager::makeBufferNonResident(mTexCoordBuf.get());
+		ResidencyManager::makeBufferNonResident(mMeshCDFBuf.get());
+		mData.indexPtr.ptr = 0;
+		mData.vertexPtr.ptr = 0;
+		mData.texCoordPtr.ptr = 0;
+		mData.meshCDFPtr.ptr = 0;
 	}
 
 	void AreaLight::setMeshData(const Mesh::SharedPtr& pMesh, uint32_t instanceId)
@@ -33,11 +33,12 @@
 #include "Utils/os.h"
 #include "Utils/Math/FalcorMath.h"
 #include "MaterialSystem.h"
+#include "Graphics/ResidencyManager.h"
 
 namespace Falcor
 {
 	uint32_t Material::sMaterialCounter = 0;
-    std::vector<Material::DescId> Material::sDescIdentifier;
+    std::unordered_map<uint64_t, std::vector<Material::DescId>> Material::sDescIdentifier;
 
     // Please add your texture here every time you add another texture slot into material
     static const size_t kTextureSlots[] = {
@@ -134,6 +135,7 @@ namespace Falcor
         mData.desc.layers[numLayers].hasRoughnessTexture = values.roughness.texture.pTexture ? true : false;
         mData.desc.layers[numLayers].hasExtraParamTexture = values.extraParam.texture.pTexture ? true : false;
         mDescDirty = true;
+        mHashDirty = true;
 
 		return true;
 	}
@@ -167,6 +169,7 @@ namespace Falcor
         }
 
         mDescDirty = true;
+        mHashDirty = true;
     }
 
 	void Material::normalize()
@@ -263,23 +266,41 @@ namespace Falcor
 #define check_offset(_a)
 #endif
 
-    void Material::setIntoUniformBuffer(UniformBuffer* pBuffer, const std::string& varName) const
+    size_t Material::getUniformBufferOffset(const UniformBuffer* pBuffer, const std::string& varName)
     {
-        finalize();
-        static const size_t dataSize = sizeof(MaterialData);
-        static_assert(dataSize % sizeof(glm::vec4) == 0, "Material::MaterialData size should be a multiple of 16");
-
         size_t offset = pBuffer->getVariableOffset(varName + ".desc.layers[0].type");
 
         if(offset == UniformBuffer::kInvalidUniformOffset)
         {
             Logger::log(Logger::Level::Warning, "Material::setIntoUniformBuffer() - variable \"" + varName + "\"not found in uniform buffer\n");
-            return;
+            return UniformBuffer::kInvalidUniformOffset;
         }
 
         check_offset(values.layers[0].albedo.texture.ptr);
         check_offset(values.ambientMap.texture.ptr);
         check_offset(values.id);
+        return offset;
+    }
+
+    void Material::setIntoUniformBuffer(UniformBuffer* pBuffer, const std::string& varName) const
+    {
+        size_t offset = getUniformBufferOffset(pBuffer, varName);
+        if(offset != UniformBuffer::kInvalidUniformOffset)
+        {
+            setIntoUniformBuffer(pBuffer, offset);
+        }
+    }
+
+    void Material::setIntoUniformBuffer(UniformBuffer* pBuffer, size_t offset) const
+    {
+        if(offset == UniformBuffer::kInvalidUniformOffset)
+        {
+            return;
+        }
+
+        finalize();
+        static const size_t dataSize = sizeof(MaterialData);
+        static_assert(dataSize % sizeof(glm::vec4) == 0, "Material::MaterialData size should be a multiple of 16");
         assert(offset + dataSize <= pBuffer->getBuffer()->getSize());
 
         bindTextures();
@@ -306,18 +327,83 @@ namespace Falcor
         }
     }
 
+    void Material::replaceTexture(const Texture* pOld, const Texture::SharedPtr& pNew)
+    {
+        for(uint32_t i = 0; i < arraysize(kTextureSlots); i++)
+        {
+            TexPtr& gpuTex = getTexture(&mData.values, kTextureSlots[i]);
+            if(gpuTex.pTexture.get() == pOld)
+            {
+                gpuTex.pTexture = pNew;
+                gpuTex.ptr = 0;
+                mHashDirty = true;
+            }
+        }
+    }
+
 	void Material::bindTextures() const
     {
         for(uint32_t i = 0; i < arraysize(kTextureSlots); i++)
         {
             TexPtr& gpuTex = getTexture(&mData.values, kTextureSlots[i]);
-			gpuTex.ptr = gpuTex.pTexture ? gpuTex.pTexture->makeResident(mpSamplerOverride.get()) : 0;
+			gpuTex.ptr = gpuTex.pTexture ? ResidencyManager::makeTextureResident(gpuTex.pTexture.get(), mpSamplerOverride.get()) : 0;
         }
     }
    
+    void Material::getComparableData(MaterialData& data) const
+    {
+        // The ID identifies the object, and the texture handles depend on residency. Neither is part of the material's content
+        // The texture pointers are compared separately, the shared pointer's bytes include its control block. The TexPtr padding is never initialized
+        data = mData;
+        data.values.id = 0;
+        for(uint32_t i = 0; i < arraysize(kTextureSlots); i++)
+        {
+            TexPtr& tex = getTexture(&data.values, kTextureSlots[i]);
+            tex.ptr = 0;
+            tex.pTexture = nullptr;
+            tex.pad = 0;
+        }
+    }
+
     bool Material::operator==(const Material& other) const
     {
-		return memcmp(&mData, &other.mData, sizeof(mData)) == 0 && mpSamplerOverride == other.mpSamplerOverride;
+        if(getHash() != other.getHash() || mpSamplerOverride != other.mpSamplerOverride || mDoubleSided != other.mDoubleSided)
+        {
+            return false;
+        }
+
+        for(uint32_t i = 0; i < arraysize(kTextureSlots); i++)
+        {
+            if(getTexture(&mData.values, kTextureSlots[i]).pTexture != getTexture(&other.mData.values, kTextureSlots[i]).pTexture)
+            {
+                return false;
+            }
+        }
+
+        MaterialData data, otherData;
+        getComparableData(data);
+        other.getComparableData(otherData);
+        return memcmp(&data, &otherData, sizeof(data)) == 0;
+    }
+
+    uint64_t Material::getHash() const
+    {
+        if(mHashDirty)
+        {
+            MaterialData data;
+            getComparableData(data);
+            mHash = hashBytes(&data, sizeof(data));
+            for(uint32_t i = 0; i < arraysize(kTextureSlots); i++)
+            {
+                const Texture* pTexture = getTexture(&mData.values, kTextureSlots[i]).pTexture.get();
+                mHash = hashBytes(&pTexture, sizeof(pTexture), mHash);
+            }
+            const Sampler* pSampler = mpSamplerOverride.get();
+            mHash = hashBytes(&pSampler, sizeof(pSampler), mHash);
+            mHash = hashBytes(&mDoubleSided, sizeof(mDoubleSided), mHash);
+            mHashDirty = false;
+        }
+        return mHash;
     }
 
     void Material::unloadTextures() const
@@ -327,7 +413,7 @@ namespace Falcor
             TexPtr& GpuTex = getTexture(&mData.values, kTextureSlots[i]);
 			if(GpuTex.pTexture)
             {
-                GpuTex.pTexture->makeNonResident(mpSamplerOverride.get());
+                ResidencyManager::makeTextureNonResident(GpuTex.pTexture.get(), mpSamplerOverride.get());
                 GpuTex.ptr = 0;
             }
         }
@@ -337,7 +423,16 @@ namespace Falcor
     {
         mData.values.normalMap = normal; 
         mData.desc.hasNormalMap = normal.texture.pTexture ? true : false; 
+        mData.desc.hasTwoChannelNormalMap = (normal.texture.pTexture && normal.texture.pTexture->getFormat() == ResourceFormat::BC5Unorm) ? true : false;
         mDescDirty = true;
+        mHashDirty = true;
+    }
+
+    void Material::setTwoChannelNormalMap(bool twoChannel)
+    {
+        mData.desc.hasTwoChannelNormalMap = twoChannel ? true : false;
+        mDescDirty = true;
+        mHashDirty = true;
     }
 
     void Material::setAlphaValue(const MaterialValue& alpha) 
@@ -345,6 +440,7 @@ namespace Falcor
         mData.values.alphaMap = alpha; 
         mData.desc.hasAlphaMap = alpha.texture.pTexture ? true : false; 
         mDescDirty = true;
+        mHashDirty = true;
     }
 
     void Material::setAmbientValue(const MaterialValue& ambient)
@@ -352,6 +448,7 @@ namespace Falcor
         mData.values.ambientMap = ambient;
         mData.desc.hasAmbientMap = ambient.texture.pTexture ? true : false;
         mDescDirty = true;
+        mHashDirty = true;
     }
 
     void Material::setHeightValue(const MaterialValue& height) 
@@ -359,22 +456,39 @@ namespace Falcor
         mData.values.heightMap = height; 
         mData.desc.hasHeightMap = height.texture.pTexture ? true : false; 
         mDescDirty = true;
+        mHashDirty = true;
     }
 
     void Material::removeDescIdentifier() const
     {
-        for(size_t i = 0 ; i < sDescIdentifier.size() ; i++)
+        if(mDescIdentifier == kInvalidDescIdentifier)
         {
-            if(mDescIdentifier == sDescIdentifier[i].id)
+            return;
+        }
+
+        auto bucket = sDescIdentifier.find(mDescHash);
+        if(bucket != sDescIdentifier.end())
+        {
+            auto& descs = bucket->second;
+            for(size_t i = 0; i < descs.size(); i++)
             {
-                sDescIdentifier[i].refCount--;
-                if(sDescIdentifier[i].refCount == 0)
+                if(mDescIdentifier == descs[i].id)
                 {
-                    MaterialSystem::removeMaterial(mDescIdentifier);
-                    sDescIdentifier.erase(sDescIdentifier.begin() + i);
+                    descs[i].refCount--;
+                    if(descs[i].refCount == 0)
+                    {
+                        MaterialSystem::removeMaterial(mDescIdentifier);
+                        descs.erase(descs.begin() + i);
+                        if(descs.empty())
+                        {
+                            sDescIdentifier.erase(bucket);
+                        }
+                    }
+                    break;
                 }
             }
         }
+        mDescIdentifier = kInvalidDescIdentifier;
     }
 
     void Material::updateDescIdentifier() const
@@ -383,7 +497,9 @@ namespace Falcor
 
         removeDescIdentifier();
         mDescDirty = false;
-        for(auto& a : sDescIdentifier)
+        mDescHash = hashBytes(&mData.desc, sizeof(mData.desc));
+        auto& descs = sDescIdentifier[mDescHash];
+        for(auto& a : descs)
         {
             if(memcmp(&mData.desc, &a.desc, sizeof(mData.desc)) == 0)
             {
@@ -393,8 +509,8 @@ namespace Falcor
             }
         }
 
-        // Not found, add it to the vector            
-        sDescIdentifier.push_back({mData.desc, identifier, 1});
+        // Not found, add it to the bucket
+        descs.push_back({mData.desc, identifier, 1});
         mDescIdentifier = identifier;
         identifier++;
     }
@@ -412,6 +528,7 @@ namespace Falcor
             updateDescIdentifier();
             const_cast<Material*>(this)->normalize();
             mDescDirty = false;
+            mHashDirty = true;
         }
     }
 
@@ -479,6 +596,7 @@ namespace Falcor
         }
         shaderDcl += "},";
         shaderDcl += std::to_string(mData.desc.hasAlphaMap) + ',' + std::to_string(mData.desc.hasNormalMap) + ',' + std::to_string(mData.desc.hasHeightMap) + ',' + std::to_string(mData.desc.hasAmbientMap);
+        shaderDcl += ",{" + std::to_string(mData.desc.pad.x) + "," + std::to_string(mData.desc.pad.y) + "," + std::to_string(mData.desc.pad.z) + "}," + std::to_string(mData.desc.hasTwoChannelNormalMap);
         shaderDcl += '}';
     }
 
@@ -29,6 +29,7 @@
 #include "glm/vec3.hpp"
 #include <map>
 #include <vector>
+#include <unordered_map>
 #include "glm/common.hpp"
 #include "glm/geometric.hpp"
 #include "Core/Texture.h"
@@ -158,6 +159,14 @@ namespace Falcor
 		*/
 		const MaterialValue& getNormalValue() const { return mData.values.normalMap; }
 
+        /** Set whether the normal map only stores the X and Y components, in which case the shader reconstructs Z. setNormalValue() sets it for BC5 textures
+        */
+        void setTwoChannelNormalMap(bool twoChannel);
+
+        /** Check if the normal map only stores the X and Y components
+        */
+        bool hasTwoChannelNormalMap() const { return mData.desc.hasTwoChannelNormalMap != 0; }
+
         /** Set the alpha test value
         */
         void setAlphaValue(const MaterialValue& alpha);
@@ -187,18 +196,37 @@ namespace Falcor
 		*/
         void getActiveTextures(std::vector<Texture::SharedConstPtr>& textures) const;
 
+        /** Replace a texture in all the texture slots which use it
+            \param[in] pOld The texture to replace
+            \param[in] pNew The new texture
+        */
+        void replaceTexture(const Texture* pOld, const Texture::SharedPtr& pNew);
+
 		/** Check if this is a double-sided material. Meshes with double sided materials should be drawn without culling, and for backfacing polygons, the normal has to be inverted.
         */
         bool isDoubleSided() const      { return mDoubleSided; }
         /** Set the material as double-sided. Meshes with double sided materials should be drawn without culling, and for backfacing polygons, the normal has to be inverted.
         */
-        void setDoubleSided(bool doubleSided) { mDoubleSided = doubleSided; mDescDirty = true; }
+        void setDoubleSided(bool doubleSided) { mDoubleSided = doubleSided; mDescDirty = true; mHashDirty = true; }
 
         /** Set the material parameters into a uniform buffer. To use this you need to include 'Falcor.h' inside your shader.
             \param[in] pBuffer The uniform buffer to set the parameters into.
             \param[in] VarName The name of the material variable in the program.
         */
         void setIntoUniformBuffer(UniformBuffer* pBuffer, const std::string& varName) const;
+
+        /** Set the material parameters into a uniform buffer, at an offset which was resolved ahead of time. Use this in per-draw code to avoid looking up the variable for every material.
+            \param[in] pBuffer The uniform buffer to set the parameters into.
+            \param[in] offset The offset of the material variable in the buffer. Get it with getUniformBufferOffset().
+        */
+        void setIntoUniformBuffer(UniformBuffer* pBuffer, size_t offset) const;
+
+        /** Get the offset of a material variable in a uniform buffer.
+            \param[in] pBuffer The uniform buffer.
+            \param[in] varName The name of the material variable in the program.
+            \return The offset, or UniformBuffer::kInvalidUniformOffset if the variable wasn't found.
+        */
+        static size_t getUniformBufferOffset(const UniformBuffer* pBuffer, const std::string& varName);
         
         /** Returns the raw material data
         */
@@ -206,7 +234,7 @@ namespace Falcor
         
         /** Override all sampling types of materials
         */
-        void overrideAllSamplers(const Sampler::SharedPtr& pSampler) { mpSamplerOverride = pSampler; }
+        void overrideAllSamplers(const Sampler::SharedPtr& pSampler) { mpSamplerOverride = pSampler; mHashDirty = true; }
                 
         /** Return global sampler override 
         */
@@ -220,10 +248,15 @@ namespace Falcor
         */
         void unloadTextures() const;
 
-        /** Comparison operator
+        /** Comparison operator. Compares the material descriptor, values, textures, sampler override and double-sided flag. The material ID and the resident texture handles are ignored
         */
         bool operator==(const Material& other) const;
 
+        /** Get a hash of the data compared by operator==(). Materials which compare equal have the same hash.
+            The hash is cached and only recomputed after the material changes, so it's cheap to use it as a key in hash tables
+        */
+        uint64_t getHash() const;
+
         /** The a string for a MaterialDesc string which can be patched into the shader. It can be used to statically compile the material into a program, resulting in better generated code
         */
         void getMaterialDescStr(std::string& shaderDcl) const;
@@ -237,9 +270,15 @@ namespace Falcor
         void finalize() const;
     private:
         mutable bool mDescDirty   = false;
-        mutable size_t mDescIdentifier;
+        mutable size_t mDescIdentifier = kInvalidDescIdentifier;
+        mutable uint64_t mDescHash = 0;
         void updateDescIdentifier() const;
         void removeDescIdentifier() const;
+        static const size_t kInvalidDescIdentifier = (size_t)-1;
+
+        mutable bool mHashDirty = true;
+        mutable uint64_t mHash = 0;
+        void getComparableData(MaterialData& data) const;
 
         void normalize();
 
@@ -250,9 +289,8 @@ namespace Falcor
             uint64_t id;
             uint32_t refCount;
         };
-        // Can't use map directly, since it requires a 'less' operator for the MaterialDesc.
-        // vector is slower, but materials are usually not dirty, so shouldn't really affect performance
-        static std::vector<DescId> sDescIdentifier;
+        // Descriptors are bucketed by their hash. Each bucket is a vector, since different descriptors might have the same hash
+        static std::unordered_map<uint64_t, std::vector<DescId>> sDescIdentifier;
 
 		/** create a new material
             \param[in] Name The material name
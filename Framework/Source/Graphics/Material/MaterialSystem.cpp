@@ -29,83 +29,116 @@
 #include "MaterialSystem.h"
 #include "Material.h"
 #include "Graphics/Program.h"
-#include <map>
+#include <unordered_map>
+#include <set>
 
 namespace Falcor
 {
     namespace MaterialSystem
     {
-        using ProgramVersionMap = std::map<const ProgramVersion*, ProgramVersion::SharedConstPtr>;
-        using MaterialProgramMap = std::map<uint64_t, ProgramVersionMap>;
+        // Maps a material descriptor and a generic program version to the program version specialized for the descriptor
+        struct VariantKey
+        {
+            uint64_t descIdentifier;
+            const ProgramVersion* pVersion;
+            bool operator==(const VariantKey& other) const { return descIdentifier == other.descIdentifier && pVersion == other.pVersion; }
+        };
+
+        struct VariantKeyHash
+        {
+            size_t operator()(const VariantKey& key) const
+            {
+                size_t hash = 0;
+                hashCombine(hash, key.descIdentifier);
+                hashCombine(hash, key.pVersion);
+                return hash;
+            }
+        };
 
-        static MaterialProgramMap gMaterialProgramMap;
+        using VariantMap = std::unordered_map<VariantKey, ProgramVersion::SharedConstPtr, VariantKeyHash>;
+        static VariantMap gVariantMap;
 
         void reset()
         {
-            gMaterialProgramMap.clear();
+            gVariantMap.clear();
         }
 
         void removeMaterial(uint64_t descIdentifier)
         {
-            gMaterialProgramMap.erase(descIdentifier);
-        }
-
-        void removeProgramVersion(const ProgramVersion* pProgramVersion)
-        {
-            if(gMaterialProgramMap.size())
+            for(auto it = gVariantMap.begin(); it != gVariantMap.end();)
             {
-                for(auto& it : gMaterialProgramMap)
-                {
-                    it.second.erase(pProgramVersion);
-                }
+                it = (it->first.descIdentifier == descIdentifier) ? gVariantMap.erase(it) : std::next(it);
             }
         }
 
-        static ProgramVersion::SharedConstPtr findProgramInMap(ProgramVersionMap& programMap, const ProgramVersion* pVersion)
-        {
-            auto& it = programMap.find(pVersion);
-            return (it == programMap.end()) ? nullptr : it->second;
-        }
-
-        static ProgramVersionMap& getMaterialProgramMap(const Material* pMaterial)
+        void removeProgramVersion(const ProgramVersion* pProgramVersion)
         {
-            uint64_t descId = pMaterial->getDescIdentifier();
-            auto& it = gMaterialProgramMap.find(descId);
-            if(it == gMaterialProgramMap.end())
+            for(auto it = gVariantMap.begin(); it != gVariantMap.end();)
             {
-                gMaterialProgramMap[descId] = ProgramVersionMap();
+                it = (it->first.pVersion == pProgramVersion) ? gVariantMap.erase(it) : std::next(it);
             }
-
-            return gMaterialProgramMap[descId];
         }
 
         ProgramVersion::SharedConstPtr patchActiveProgramVersion(Program* pProgram, const Material* pMaterial)
         {
             // Get the active program version
-            const ProgramVersion* pProgVersion = pProgram->getActiveProgramVersion().get();
+            ProgramVersion::SharedConstPtr pActiveVersion = pProgram->getActiveProgramVersion();
+            const ProgramVersion* pProgVersion = pActiveVersion.get();
 
-            // Get the material's program map
-            ProgramVersionMap& programMap = getMaterialProgramMap(pMaterial);
+            // If the program is still compiling, this is the fallback version. Don't patch it, the patched version would be cached under the wrong key
+            if(pProgram->isActiveProgramVersionReady() == false)
+            {
+                return pActiveVersion;
+            }
 
             // Check if it we have data for it
-            ProgramVersion::SharedConstPtr pMaterialProg = findProgramInMap(programMap, pProgVersion);
-            if(pMaterialProg == nullptr)
+            VariantKey key = {pMaterial->getDescIdentifier(), pProgVersion};
+            const auto& it = gVariantMap.find(key);
+            if(it != gVariantMap.end())
             {
-                // Add the material desc
-                std::string materialDesc;
-                pMaterial->getMaterialDescStr(materialDesc);
-                pProgram->addDefine("_MS_STATIC_MATERIAL_DESC", materialDesc);
+                return it->second;
+            }
 
-               
-                // Get the program version and set it into the map
-                pMaterialProg = pProgram->getActiveProgramVersion();
-                programMap[pProgVersion] = pMaterialProg;
+            // Add the material desc
+            std::string materialDesc;
+            pMaterial->getMaterialDescStr(materialDesc);
+            pProgram->addDefine("_MS_STATIC_MATERIAL_DESC", materialDesc);
 
-                // Restore the previous define string
-                pProgram->removeDefine("_MS_STATIC_MATERIAL_DESC");
+            // Get the program version and set it into the map. If the patched version is still compiling, use the generic version until it's ready
+            ProgramVersion::SharedConstPtr pMaterialProg = pProgram->getActiveProgramVersion();
+            if(pProgram->isActiveProgramVersionReady())
+            {
+                gVariantMap[key] = pMaterialProg;
+            }
+            else
+            {
+                pMaterialProg = pActiveVersion;
             }
 
+            // Restore the previous define string
+            pProgram->removeDefine("_MS_STATIC_MATERIAL_DESC");
+
             return pMaterialProg;
         }
+
+        void prewarmProgramVersions(Program* pProgram, const std::vector<const Material*>& materials, bool waitForCompletion)
+        {
+            std::vector<Program::DefineList> defineLists;
+            std::set<uint64_t> descIdentifiers;
+            for(const Material* pMaterial : materials)
+            {
+                // Materials with the same descriptor share a program version
+                if(descIdentifiers.insert(pMaterial->getDescIdentifier()).second)
+                {
+                    std::string materialDesc;
+                    pMaterial->getMaterialDescStr(materialDesc);
+                    Program::DefineList defines = pProgram->getActiveDefinesList();
+                    defines.add("_MS_STATIC_MATERIAL_DESC", materialDesc);
+                    defineLists.push_back(defines);
+                }
+            }
+
+            pProgram->prewarm(defineLists, waitForCompletion);
+        }
     }
 }
\ No newline at end of file
@@ -27,6 +27,7 @@
 ***************************************************************************/
 #pragma once
 #include "Core/ProgramVersion.h"
+#include <vector>
 
 namespace Falcor
 {
@@ -39,5 +40,12 @@ namespace Falcor
         ProgramVersion::SharedConstPtr patchActiveProgramVersion(Program* pProgram, const Material* pMaterial);
         void removeMaterial(uint64_t descIdentifier);
         void removeProgramVersion(const ProgramVersion* pProgramVersion);
+
+        /** Compile the material-specialized versions of a program ahead of time, using the program's current define list. See Program::prewarm().
+            \param[in] pProgram The program to compile
+            \param[in] materials The materials which will be rendered with the program. Materials with identical descriptors are compiled once.
+            \param[in] waitForCompletion Optional. If true, blocks until all the versions are ready.
+        */
+        void prewarmProgramVersions(Program* pProgram, const std::vector<const Material*>& materials, bool waitForCompletion = true);
     };
 }
\ No newline at end of file
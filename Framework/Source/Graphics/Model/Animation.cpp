@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Animation.h"
 #include "AnimationController.h"
+#include "Utils/MemoryTracker.h"
 #include "glm/gtc/matrix_transform.hpp"
 #include "glm/gtx/transform.hpp"
 
@@ -40,10 +41,26 @@ namespace Falcor
 
     Animation::Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond) : mName(name), mAnimationSets(animationSets), mDuration(duration), mTicksPerSecond(ticksPerSecond)
     {
+        MemoryTracker::allocate(MemoryTracker::Category::AnimationData, getMemoryUsage());
+    }
 
+    Animation::~Animation()
+    {
+        // The keys never change after creation, so this matches what the constructor tracked
+        MemoryTracker::release(MemoryTracker::Category::AnimationData, getMemoryUsage());
     }
 
-    Animation::~Animation() = default;
+    uint64_t Animation::getMemoryUsage() const
+    {
+        uint64_t bytes = mAnimationSets.capacity() * sizeof(AnimationSet);
+        for(const auto& set : mAnimationSets)
+        {
+            bytes += set.translation.keys.capacity() * sizeof(AnimationKey<glm::vec3>);
+            bytes += set.scaling.keys.capacity() * sizeof(AnimationKey<glm::vec3>);
+            bytes += set.rotation.keys.capacity() * sizeof(AnimationKey<glm::quat>);
+        }
+        return bytes;
+    }
 
     template<typename T>
     uint32_t findCurrentFrame(T channel, float ticks)
@@ -68,6 +68,10 @@ namespace Falcor
         void animate(double totalTime, AnimationController* pAnimationController);
         const std::string& getName() const { return mName; }
 
+        /** Get the CPU memory used by the animation keys
+        */
+        uint64_t getMemoryUsage() const;
+
     private:
         Animation(const std::string& name, const std::vector<AnimationSet>& animationSets, float duration, float ticksPerSecond);
         
@@ -30,6 +30,7 @@
 #include "Model.h"
 #include <fstream>
 #include "Animation.h"
+#include "Utils/MemoryTracker.h"
 #include <algorithm>
 
 namespace Falcor
@@ -70,6 +71,13 @@ namespace Falcor
     {
         mBones = Bones;
         mBoneTransforms.resize(mBones.size());
+
+        mTrackedBytes = mBones.capacity() * sizeof(Bone) + mBoneTransforms.capacity() * sizeof(glm::mat4);
+        for(const auto& bone : mBones)
+        {
+            mTrackedBytes += bone.name.capacity();
+        }
+        MemoryTracker::allocate(MemoryTracker::Category::AnimationData, mTrackedBytes);
     }
 
     void AnimationController::addAnimation(Animation::UniquePtr pAnimation)
@@ -77,7 +85,20 @@ namespace Falcor
         mAnimations.push_back(std::move(pAnimation));
     }
 
-    AnimationController::~AnimationController() = default;
+    AnimationController::~AnimationController()
+    {
+        MemoryTracker::release(MemoryTracker::Category::AnimationData, mTrackedBytes);
+    }
+
+    uint64_t AnimationController::getMemoryUsage() const
+    {
+        uint64_t bytes = mTrackedBytes;
+        for(const auto& pAnimation : mAnimations)
+        {
+            bytes += pAnimation->getMemoryUsage();
+        }
+        return bytes;
+    }
 
     void AnimationController::setBoneLocalTransform(uint32_t boneID, const glm::mat4& transform)
     {
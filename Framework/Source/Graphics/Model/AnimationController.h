@@ -71,6 +71,10 @@ namespace Falcor
         uint32_t getBoneCount() const { return uint32_t(mBones.size()); }
 
         uint32_t getBoneIdFromName(const std::string& name) const;
+
+        /** Get the CPU memory used by the bones and all the animations
+        */
+        uint64_t getMemoryUsage() const;
         void setBoneLocalTransform(uint32_t boneID, const glm::mat4& transform);
 
     private:
@@ -81,6 +85,7 @@ namespace Falcor
         std::vector<Animation::UniquePtr> mAnimations;
 
         uint32_t mActiveAnimation = BIND_POSE_ANIMATION_ID;
+        uint64_t mTrackedBytes = 0;     ///< Bone memory reported to the MemoryTracker. The animations track their own memory
 
         void calculateBoneTransforms();
     };
@@ -27,6 +27,8 @@
 ***************************************************************************/
 #include "Framework.h"
 #include "AssimpModelImporter.h"
+#include <set>
+#include <unordered_map>
 #include "../Model.h"
 #include "Importer.hpp"
 #include "postprocess.h"
@@ -44,6 +46,7 @@
 #include "Core/VertexLayout.h"
 #include "Data/VertexAttrib.h"
 #include "Utils/StringUtils.h"
+#include "Utils/ThreadPool.h"
 
 namespace Falcor
 {
@@ -207,23 +210,12 @@ namespace Falcor
                     continue;
                 }
 
-                // Check if the texture was already loaded
+                // The textures were loaded by loadAllTextures()
                 const auto& a = mTextureCache.find(s);
                 if(a != mTextureCache.end())
                 {
                     pTex = a->second;
                 }
-                else
-                {
-                    // create a new texture
-                    std::string fullpath = folder + '\\' + s;
-                    pTex = createTextureFromFile(fullpath, true, isSrgbRequired(aiType, useSrgb));
-                    if(pTex)
-                    {
-                        mpModel->addTexture(pTex);
-                        mTextureCache[s] = pTex;
-                    }
-                }
 
                 assert(pTex != nullptr);
                 BasicMaterial::MapType texSlot = getFalcorTexTypeFromAi(aiType, isObjFile);
@@ -336,8 +328,56 @@ namespace Falcor
         mpModel = Model::SharedPtr(new Model);
     }
 
+    void AssimpModelImporter::loadAllTextures(const aiScene* pScene, const std::string& modelFolder, bool useSrgb)
+    {
+        // Collect the unique texture paths. The first material referencing a texture decides its color space
+        std::vector<std::string> names;
+        std::vector<TextureFileRequest> requests;
+        std::set<std::string> uniqueNames;
+        for(uint32_t m = 0; m < pScene->mNumMaterials; m++)
+        {
+            const aiMaterial* pAiMaterial = pScene->mMaterials[m];
+            for(int i = 0; i < AI_TEXTURE_TYPE_MAX; ++i)
+            {
+                aiTextureType aiType = (aiTextureType)i;
+                if(pAiMaterial->GetTextureCount(aiType) != 1)
+                {
+                    continue;
+                }
+
+                aiString path;
+                pAiMaterial->GetTexture(aiType, 0, &path);
+                std::string s(path.data);
+                if(s.empty() || uniqueNames.insert(s).second == false)
+                {
+                    continue;
+                }
+
+                TextureFileRequest request;
+                request.filename = modelFolder + '\\' + s;
+                request.generateMipLevels = true;
+                request.loadAsSrgb = isSrgbRequired(aiType, useSrgb);
+                requests.push_back(request);
+                names.push_back(s);
+            }
+        }
+
+        // Decode all the textures in parallel
+        std::vector<Texture::SharedPtr> textures = createTexturesFromFiles(requests);
+        for(size_t i = 0; i < textures.size(); i++)
+        {
+            if(textures[i])
+            {
+                mpModel->addTexture(textures[i]);
+                mTextureCache[names[i]] = textures[i];
+            }
+        }
+    }
+
     bool AssimpModelImporter::createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb)
     {
+        loadAllTextures(pScene, modelFolder, useSrgb);
+
         for(uint32_t i = 0; i < pScene->mNumMaterials; i++)
         {
             const aiMaterial* pAiMaterial = pScene->mMaterials[i];
@@ -359,7 +399,7 @@ namespace Falcor
         return true;
     }
 
-    bool AssimpModelImporter::parseAiSceneNode(const aiNode* pCurrnet, const aiScene* pScene, std::map<uint32_t, Mesh::SharedPtr>& aiToFalcorMesh)
+    bool AssimpModelImporter::parseAiSceneNode(const aiNode* pCurrnet, const aiScene* pScene, const std::vector<MeshReference>& meshReferences, std::map<uint32_t, Mesh::SharedPtr>& aiToFalcorMesh)
     {
         if(pCurrnet->mNumMeshes)
         {
@@ -375,7 +415,8 @@ namespace Falcor
             // Initialize the meshes
             for(uint32_t i = 0; i < pCurrnet->mNumMeshes; i++)
             {
-                uint32_t aiId = pCurrnet->mMeshes[i];
+                const MeshReference& reference = meshReferences[pCurrnet->mMeshes[i]];
+                uint32_t aiId = reference.aiMeshID;
                 if(aiToFalcorMesh.find(aiId) == aiToFalcorMesh.end())
                 {
                     // New mesh
@@ -391,7 +432,7 @@ namespace Falcor
                     assert(0);
                     return false;
                 }
-                pMesh->addInstance(aiMatToGLM(transform));
+                pMesh->addInstance(aiMatToGLM(transform) * reference.transform);
             }
         }
 
@@ -399,26 +440,28 @@ namespace Falcor
         // visit the children
         for(uint32_t i = 0; i < pCurrnet->mNumChildren; i++)
         {
-            b |= parseAiSceneNode(pCurrnet->mChildren[i], pScene, aiToFalcorMesh);
+            b |= parseAiSceneNode(pCurrnet->mChildren[i], pScene, meshReferences, aiToFalcorMesh);
         }
         return b;
     }
 
-    bool AssimpModelImporter::createDrawList(const aiScene* pScene)
+    bool AssimpModelImporter::createDrawList(const aiScene* pScene, const std::vector<MeshReference>& meshReferences)
     {
         createAnimationController(pScene);
         std::map<uint32_t, Mesh::SharedPtr> aiToFalcorMesh;
         aiNode* pRoot = pScene->mRootNode;
-        return parseAiSceneNode(pRoot, pScene, aiToFalcorMesh);
+        return parseAiSceneNode(pRoot, pScene, meshReferences, aiToFalcorMesh);
     }
 
-    bool AssimpModelImporter::initModel(const std::string& filename)
+    AssimpModelImporter::ParsedFile::ParsedFile() = default;
+    AssimpModelImporter::ParsedFile::~ParsedFile() = default;
+
+    bool AssimpModelImporter::parseFile(const std::string& filename, uint32_t flags, ParsedFile& parsed)
     {
-        std::string fullpath;
-        if(findFileInDataDirectories(filename, fullpath) == false)
+        if(findFileInDataDirectories(filename, parsed.fullpath) == false)
         {
             Logger::log(Logger::Level::Error, std::string("Can't find model file ") + filename, true);
-            return nullptr;
+            return false;
         }
 
         uint32_t AssimpFlags = aiProcessPreset_TargetRealtime_MaxQuality |
@@ -427,34 +470,47 @@ namespace Falcor
             0;
 
         // aiProcessPreset_TargetRealtime_MaxQuality enabled some optimizations the user might not want
-        if((mFlags & Model::FindDegeneratePrimitives) == 0)
+        if((flags & Model::FindDegeneratePrimitives) == 0)
         {
             AssimpFlags &= ~aiProcess_FindDegenerates;
         }
         // Avoid merging original meshes
-        if((mFlags & Model::DontMergeMeshes) != 0)
+        if((flags & Model::DontMergeMeshes) != 0)
         {
             AssimpFlags &= ~aiProcess_OptimizeGraph;
         }
-        if((mFlags & Model::GenerateTangentSpace) == 0)
+        // Merging meshes would join the copies we are looking for into larger meshes
+        if((flags & (Model::DeduplicateMeshes | Model::DeduplicateRigidMeshes)) != 0)
+        {
+            AssimpFlags &= ~(aiProcess_OptimizeGraph | aiProcess_OptimizeMeshes);
+        }
+        if((flags & Model::GenerateTangentSpace) == 0)
         {
             AssimpFlags &= ~(aiProcess_CalcTangentSpace);
         }
 
-        Assimp::Importer importer;
-        const aiScene* pScene = importer.ReadFile(fullpath, AssimpFlags);
+        // Every file gets its own importer, so this can run concurrently for different files
+        parsed.pImporter = std::make_unique<Assimp::Importer>();
+        parsed.pScene = parsed.pImporter->ReadFile(parsed.fullpath, AssimpFlags);
 
-        if((pScene == nullptr) || (verifyScene(pScene) == false))
+        if((parsed.pScene == nullptr) || (verifyScene(parsed.pScene) == false))
         {
             std::string str("Can't open model file '");
-            str = str + std::string(filename) + "'\n" + importer.GetErrorString();
+            str = str + std::string(filename) + "'\n" + parsed.pImporter->GetErrorString();
             Logger::log(Logger::Level::Error, str, true);
+            parsed.pScene = nullptr;
             return false;
         }
+        return true;
+    }
+
+    bool AssimpModelImporter::initModel(const std::string& filename, const ParsedFile& parsed)
+    {
+        const aiScene* pScene = parsed.pScene;
 
         // Extract the folder name
-        auto last = fullpath.find_last_of("/\\");
-        std::string modelFolder = fullpath.substr(0, last);
+        auto last = parsed.fullpath.find_last_of("/\\");
+        std::string modelFolder = parsed.fullpath.substr(0, last);
 
         // Order of initialization matters, materials, bones and animations need to loaded before mesh initialization
         bool isObjFile = hasSuffix(filename, ".obj", false);
@@ -465,7 +521,10 @@ namespace Falcor
             return false;
         }
 
-        if(createDrawList(pScene) == false)
+        std::vector<MeshReference> meshReferences;
+        findDuplicateMeshes(pScene, filename, meshReferences);
+
+        if(createDrawList(pScene, meshReferences) == false)
         {
             Logger::log(Logger::Level::Error, std::string("Can't create draw lists for model ") + filename, true);
             return false;
@@ -476,10 +535,24 @@ namespace Falcor
 
     Model::SharedPtr AssimpModelImporter::createFromFile(const std::string& filename, uint32_t flags)
     {
-        AssimpModelImporter loader(flags);
+        ParsedFile parsed;
+        if(parseFile(filename, flags, parsed) == false)
+        {
+            return nullptr;
+        }
+
+        return createFromParsedFile(filename, parsed, flags);
+    }
+
+    Model::SharedPtr AssimpModelImporter::createFromParsedFile(const std::string& filename, const ParsedFile& parsed, uint32_t flags)
+    {
+        if(parsed.pScene == nullptr)
+        {
+            return nullptr;
+        }
 
-        // Init the model
-        if(loader.initModel(filename) == false)
+        AssimpModelImporter loader(flags);
+        if(loader.initModel(filename, parsed) == false)
         {
             loader.mpModel = nullptr;
         }
@@ -487,6 +560,26 @@ namespace Falcor
         return loader.mpModel;
     }
 
+    std::vector<Model::SharedPtr> AssimpModelImporter::createFromFiles(const std::vector<std::string>& filenames, uint32_t flags)
+    {
+        // Parsing and post-processing the files is CPU-only work, so it runs on the pool. Resources are created on the calling thread
+        std::vector<ParsedFile> parsed(filenames.size());
+        ThreadPool::getDefaultPool()->parallelFor(0, (uint32_t)filenames.size(), [&](uint32_t i)
+        {
+            parseFile(filenames[i], flags, parsed[i]);
+        });
+
+        std::vector<Model::SharedPtr> models(filenames.size());
+        for(size_t i = 0; i < filenames.size(); i++)
+        {
+            models[i] = createFromParsedFile(filenames[i], parsed[i], flags);
+            // Release the importer and its scene as soon as the model was created
+            parsed[i].pScene = nullptr;
+            parsed[i].pImporter = nullptr;
+        }
+        return models;
+    }
+
     uint32_t AssimpModelImporter::initBone(const aiNode* pCurNode, uint32_t parentID, uint32_t boneID)
     {
         assert(mBoneNameToIdMap.find(pCurNode->mName.C_Str()) != mBoneNameToIdMap.end());
@@ -771,6 +864,310 @@ namespace Falcor
         return true;
     }
 
+    namespace
+    {
+        const float kPositionTolerance = 1e-4f;     // Relative to the size of the mesh
+        const float kFloatError = 1e-6f;            // Relative to the distance from the origin, since copies far from the origin lose precision
+        const float kDirectionTolerance = 1e-3f;
+
+        glm::vec3 aiVecToGLM(const aiVector3D& v)
+        {
+            return glm::vec3(v.x, v.y, v.z);
+        }
+
+        uint32_t getUsedElements(const aiMesh* pAiMesh)
+        {
+            uint32_t mask = 0;
+            for(uint32_t location = 0; location < VERTEX_LOCATION_COUNT; location++)
+            {
+                if(isElementUsed(pAiMesh, location))
+                {
+                    mask |= (1 << location);
+                }
+            }
+            return mask;
+        }
+
+        /** Get the size of the vertex and index buffers createMesh() creates for a mesh
+        */
+        uint64_t getMeshBytes(const aiMesh* pAiMesh)
+        {
+            uint64_t vertexSize = 0;
+            for(uint32_t location = 0; location < VERTEX_LOCATION_COUNT; location++)
+            {
+                if(isElementUsed(pAiMesh, location))
+                {
+                    vertexSize += getFormatBytesPerBlock(kLayoutData[location].format);
+                }
+            }
+            uint64_t indexCount = pAiMesh->mNumFaces * pAiMesh->mFaces[0].mNumIndices;
+            return vertexSize * pAiMesh->mNumVertices + indexCount * sizeof(uint32_t);
+        }
+
+        template<typename T>
+        uint64_t hashArray(const T* pData, uint32_t count, uint64_t hash)
+        {
+            return pData ? hashBytes(pData, count * sizeof(T), hash) : hash;
+        }
+
+        template<typename T>
+        bool compareArrays(const T* pA, const T* pB, uint32_t count)
+        {
+            if((pA == nullptr) || (pB == nullptr))
+            {
+                return pA == pB;
+            }
+            return memcmp(pA, pB, count * sizeof(T)) == 0;
+        }
+
+        /** Hash a mesh's topology and attributes. Positions and directions are only hashed when looking for exact copies, since they change when a copy is rotated or translated
+        */
+        uint64_t hashMesh(const aiMesh* pAiMesh, bool allowRigidTransform)
+        {
+            const uint32_t vertexCount = pAiMesh->mNumVertices;
+            uint32_t header[] = { vertexCount, pAiMesh->mNumFaces, pAiMesh->mFaces[0].mNumIndices, pAiMesh->mMaterialIndex, getUsedElements(pAiMesh) };
+            uint64_t hash = hashBytes(header, sizeof(header));
+
+            std::vector<uint32_t> indices = createIndexBufferData(pAiMesh);
+            hash = hashBytes(indices.data(), indices.size() * sizeof(uint32_t), hash);
+            hash = hashArray(pAiMesh->mTextureCoords[0], vertexCount, hash);
+            hash = hashArray(pAiMesh->mColors[0], vertexCount, hash);
+
+            if(allowRigidTransform == false)
+            {
+                hash = hashArray(pAiMesh->mVertices, vertexCount, hash);
+                hash = hashArray(pAiMesh->mNormals, vertexCount, hash);
+                hash = hashArray(pAiMesh->mTangents, vertexCount, hash);
+                hash = hashArray(pAiMesh->mBitangents, vertexCount, hash);
+            }
+            else
+            {
+                // Separate meshes which share their topology by their spread around the centroid. Copies close to a rounding boundary get different hashes and are not folded, which is harmless
+                glm::vec3 centroid;
+                for(uint32_t i = 0; i < vertexCount; i++)
+                {
+                    centroid += aiVecToGLM(pAiMesh->mVertices[i]);
+                }
+                centroid /= (float)vertexCount;
+
+                float spread = 0;
+                for(uint32_t i = 0; i < vertexCount; i++)
+                {
+                    glm::vec3 offset = aiVecToGLM(pAiMesh->mVertices[i]) - centroid;
+                    spread += glm::dot(offset, offset);
+                }
+
+                int32_t exponent;
+                float mantissa = std::frexp(spread / vertexCount, &exponent);
+                int32_t quantized[] = { exponent, (int32_t)(mantissa * 256) };
+                hash = hashBytes(quantized, sizeof(quantized), hash);
+            }
+            return hash;
+        }
+
+        /** Create an orthonormal frame from three points
+            \return false if the points are collinear
+        */
+        bool createFrame(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, glm::mat3& frame)
+        {
+            glm::vec3 x = p1 - p0;
+            glm::vec3 z = glm::cross(x, p2 - p0);
+            if(glm::length(z) <= 1e-6f * glm::dot(x, x))
+            {
+                return false;
+            }
+
+            x = glm::normalize(x);
+            z = glm::normalize(z);
+            frame = glm::mat3(x, glm::cross(z, x), z);
+            return true;
+        }
+
+        bool compareDirections(const aiVector3D* pA, const aiVector3D* pB, uint32_t count, const glm::mat3& rotation)
+        {
+            if((pA == nullptr) || (pB == nullptr))
+            {
+                return pA == pB;
+            }
+
+            for(uint32_t i = 0; i < count; i++)
+            {
+                if(glm::length(rotation * aiVecToGLM(pA[i]) - aiVecToGLM(pB[i])) > kDirectionTolerance)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /** Check if a mesh is a copy of a reference mesh.
+            \param[in] pRef The reference mesh
+            \param[in] pAiMesh The mesh to check
+            \param[in] allowRigidTransform Whether the copy can be rotated and translated
+            \param[out] transform Transforms the reference's vertices into the copy's space
+            \return true if the mesh is a copy of the reference
+        */
+        bool matchMeshes(const aiMesh* pRef, const aiMesh* pAiMesh, bool allowRigidTransform, glm::mat4& transform)
+        {
+            // Equal hashes don't guarantee equal meshes
+            const uint32_t vertexCount = pAiMesh->mNumVertices;
+            if((pRef->mNumVertices != vertexCount) || (pRef->mNumFaces != pAiMesh->mNumFaces) || (pRef->mMaterialIndex != pAiMesh->mMaterialIndex) || (getUsedElements(pRef) != getUsedElements(pAiMesh)))
+            {
+                return false;
+            }
+
+            for(uint32_t i = 0; i < pAiMesh->mNumFaces; i++)
+            {
+                const aiFace& refFace = pRef->mFaces[i];
+                const aiFace& face = pAiMesh->mFaces[i];
+                if((refFace.mNumIndices != face.mNumIndices) || (compareArrays(refFace.mIndices, face.mIndices, face.mNumIndices) == false))
+                {
+                    return false;
+                }
+            }
+
+            if((compareArrays(pRef->mTextureCoords[0], pAiMesh->mTextureCoords[0], vertexCount) == false) || (compareArrays(pRef->mColors[0], pAiMesh->mColors[0], vertexCount) == false))
+            {
+                return false;
+            }
+
+            transform = glm::mat4();
+            if(compareArrays(pRef->mVertices, pAiMesh->mVertices, vertexCount) &&
+                compareArrays(pRef->mNormals, pAiMesh->mNormals, vertexCount) &&
+                compareArrays(pRef->mTangents, pAiMesh->mTangents, vertexCount) &&
+                compareArrays(pRef->mBitangents, pAiMesh->mBitangents, vertexCount))
+            {
+                return true;
+            }
+
+            if(allowRigidTransform == false)
+            {
+                return false;
+            }
+
+            // Find the rotation between the frames spanned by the same three vertices in both meshes. Use vertices which are far apart, to reduce the error
+            const aiVector3D* pRefPos = pRef->mVertices;
+            const aiVector3D* pPos = pAiMesh->mVertices;
+            const glm::vec3 origin = aiVecToGLM(pRefPos[0]);
+
+            uint32_t i1 = 0;
+            float maxDistance = 0;
+            for(uint32_t i = 0; i < vertexCount; i++)
+            {
+                glm::vec3 offset = aiVecToGLM(pRefPos[i]) - origin;
+                float distance = glm::dot(offset, offset);
+                if(distance > maxDistance)
+                {
+                    maxDistance = distance;
+                    i1 = i;
+                }
+            }
+
+            uint32_t i2 = 0;
+            float maxArea = 0;
+            const glm::vec3 axis = aiVecToGLM(pRefPos[i1]) - origin;
+            for(uint32_t i = 0; i < vertexCount; i++)
+            {
+                float area = glm::length(glm::cross(axis, aiVecToGLM(pRefPos[i]) - origin));
+                if(area > maxArea)
+                {
+                    maxArea = area;
+                    i2 = i;
+                }
+            }
+
+            glm::mat3 refFrame, frame;
+            if((createFrame(origin, aiVecToGLM(pRefPos[i1]), aiVecToGLM(pRefPos[i2]), refFrame) == false) ||
+                (createFrame(aiVecToGLM(pPos[0]), aiVecToGLM(pPos[i1]), aiVecToGLM(pPos[i2]), frame) == false))
+            {
+                return false;
+            }
+
+            const glm::mat3 rotation = frame * glm::transpose(refFrame);
+            const glm::vec3 translation = aiVecToGLM(pPos[0]) - rotation * origin;
+
+            // The frames only match three vertices. Check the rest
+            const float sizeTolerance = kPositionTolerance * std::sqrt(maxDistance);
+            for(uint32_t i = 0; i < vertexCount; i++)
+            {
+                glm::vec3 position = aiVecToGLM(pPos[i]);
+                float error = glm::length(rotation * aiVecToGLM(pRefPos[i]) + translation - position);
+                if(error > sizeTolerance + kFloatError * glm::length(position))
+                {
+                    return false;
+                }
+            }
+
+            if((compareDirections(pRef->mNormals, pAiMesh->mNormals, vertexCount, rotation) == false) ||
+                (compareDirections(pRef->mTangents, pAiMesh->mTangents, vertexCount, rotation) == false) ||
+                (compareDirections(pRef->mBitangents, pAiMesh->mBitangents, vertexCount, rotation) == false))
+            {
+                return false;
+            }
+
+            transform = glm::mat4(rotation);
+            transform[3] = glm::vec4(translation, 1);
+            return true;
+        }
+    }
+
+    void AssimpModelImporter::findDuplicateMeshes(const aiScene* pScene, const std::string& filename, std::vector<MeshReference>& meshReferences)
+    {
+        meshReferences.resize(pScene->mNumMeshes);
+        for(uint32_t meshID = 0; meshID < pScene->mNumMeshes; meshID++)
+        {
+            meshReferences[meshID].aiMeshID = meshID;
+            meshReferences[meshID].transform = glm::mat4();
+        }
+
+        const bool allowRigidTransform = (mFlags & Model::DeduplicateRigidMeshes) != 0;
+        if(((mFlags & Model::DeduplicateMeshes) == 0) && (allowRigidTransform == false))
+        {
+            return;
+        }
+
+        // The meshes found so far which are not copies of other meshes, by hash
+        std::unordered_map<uint64_t, std::vector<uint32_t>> uniqueMeshes;
+        uint32_t duplicateCount = 0;
+        uint64_t savedBytes = 0;
+
+        for(uint32_t meshID = 0; meshID < pScene->mNumMeshes; meshID++)
+        {
+            // Skinned meshes are deformed by their own bones, so they can't be shared
+            const aiMesh* pAiMesh = pScene->mMeshes[meshID];
+            if(pAiMesh->HasBones() || (pAiMesh->mNumFaces == 0) || (pAiMesh->HasPositions() == false))
+            {
+                continue;
+            }
+
+            std::vector<uint32_t>& candidates = uniqueMeshes[hashMesh(pAiMesh, allowRigidTransform)];
+            bool isCopy = false;
+            for(uint32_t candidateID : candidates)
+            {
+                glm::mat4 transform;
+                if(matchMeshes(pScene->mMeshes[candidateID], pAiMesh, allowRigidTransform, transform))
+                {
+                    meshReferences[meshID].aiMeshID = candidateID;
+                    meshReferences[meshID].transform = transform;
+                    duplicateCount++;
+                    savedBytes += getMeshBytes(pAiMesh);
+                    isCopy = true;
+                    break;
+                }
+            }
+
+            if(isCopy == false)
+            {
+                candidates.push_back(meshID);
+            }
+        }
+
+        if(duplicateCount)
+        {
+            Logger::log(Logger::Level::Info, "Model " + filename + " - replaced " + std::to_string(duplicateCount) + " duplicate meshes with instances, saving " + std::to_string(savedBytes) + " bytes of vertex and index data");
+        }
+    }
+
     Buffer::SharedPtr AssimpModelImporter::createVertexBuffer(const aiMesh* pAiMesh, uint32_t vertexCount, BoundingBox& boundingBox, const VertexLayout* pLayout)
     {
         const uint32_t vertexStride = pLayout->getTotalStride();
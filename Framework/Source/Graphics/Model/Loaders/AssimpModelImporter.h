@@ -38,6 +38,11 @@ struct aiAnimation;
 struct aiMesh;
 struct aiMaterial;
 
+namespace Assimp
+{
+    class Importer;
+}
+
 namespace Falcor
 {
     class Animation;
@@ -55,14 +60,54 @@ namespace Falcor
         */
         static Model::SharedPtr createFromFile(const std::string& filename, uint32_t flags);
 
+        /** create models from a list of files. The files are parsed concurrently on the default thread pool, the models' resources are created on the calling thread.
+            \param[in] filenames Models' filenames. Loader will look for them in the data directories.
+            \param[in] flags Flags controlling model creation
+            returns a vector with an entry per filename. Entries of files which failed to load are nullptr
+        */
+        static std::vector<Model::SharedPtr> createFromFiles(const std::vector<std::string>& filenames, uint32_t flags);
+
+        /** A file read and post-processed by ASSIMP, before any resource was created
+        */
+        struct ParsedFile
+        {
+            ParsedFile();
+            ~ParsedFile();
+            std::string fullpath;
+            std::unique_ptr<Assimp::Importer> pImporter;    // Owns pScene
+            const aiScene* pScene = nullptr;
+        };
+
+        /** Parse a file without creating any resources. This can be called from any thread
+            \param[in] filename Model's filename. Loader will look for it in the data directories.
+            \param[in] flags Flags controlling model creation
+            \param[out] parsed The parsed file
+            returns false if the file couldn't be parsed
+        */
+        static bool parseFile(const std::string& filename, uint32_t flags, ParsedFile& parsed);
+
+        /** Create a model from a file parsed with parseFile(). Must be called on the main thread
+            returns nullptr if creating the model failed, otherwise a new Model object
+        */
+        static Model::SharedPtr createFromParsedFile(const std::string& filename, const ParsedFile& parsed, uint32_t flags);
+
     private:
         AssimpModelImporter(uint32_t flags);
         AssimpModelImporter(const AssimpModelImporter&) = delete;        
         void operator=(const AssimpModelImporter&) = delete;
 
-        bool initModel(const std::string& filename);
-        bool createDrawList(const aiScene* pScene);
-        bool parseAiSceneNode(const aiNode* pCurrnet, const aiScene* pScene, std::map<uint32_t, Mesh::SharedPtr>& aiToFalcorMesh);
+        bool initModel(const std::string& filename, const ParsedFile& parsed);
+        /** The mesh whose data is used for an ASSIMP mesh. Duplicate meshes reference the first mesh with the same data
+        */
+        struct MeshReference
+        {
+            uint32_t aiMeshID;
+            glm::mat4 transform;    // Transforms the referenced mesh's vertices into the duplicate's local space
+        };
+
+        bool createDrawList(const aiScene* pScene, const std::vector<MeshReference>& meshReferences);
+        bool parseAiSceneNode(const aiNode* pCurrnet, const aiScene* pScene, const std::vector<MeshReference>& meshReferences, std::map<uint32_t, Mesh::SharedPtr>& aiToFalcorMesh);
+        void findDuplicateMeshes(const aiScene* pScene, const std::string& filename, std::vector<MeshReference>& meshReferences);
         bool createAllMaterials(const aiScene* pScene, const std::string& modelFolder, bool isObjFile, bool useSrgb);
 
         void createAnimationController(const aiScene* pScene);
@@ -77,6 +122,7 @@ namespace Falcor
         Buffer::SharedPtr createIndexBuffer(const aiMesh* pAiMesh);
         Buffer::SharedPtr createVertexBuffer(const aiMesh* pAiMesh, uint32_t vertexCount, BoundingBox& boundingBox, const VertexLayout* pLayout);
         void loadBones(const aiMesh* pAiMesh, uint8_t* pVertexData, uint32_t vertexCount, uint32_t vertexStride);
+        void loadAllTextures(const aiScene* pScene, const std::string& modelFolder, bool useSrgb);
         void loadTextures(const aiMaterial* pAiMaterial, const std::string& folder, BasicMaterial* pMaterial, bool isObjFile, bool useSrgb);
         Material::SharedPtr createMaterial(const aiMaterial* pAiMaterial, const std::string& folder, bool isObjFile, bool useSrgb);
 
@@ -211,7 +211,7 @@ namespace Falcor
             }
 
             auto pVao = pMesh->getVao();
-            auto& submesh = mMeshes[pVao.get()];
+            auto& submesh = mMeshes[std::make_pair(pVao.get(), pMesh->getBaseVertex())];
             submesh.push_back(pMesh);
         }
 
@@ -285,9 +285,12 @@ namespace Falcor
 
             // Most of the buffers we use were created without any access flags, so can't be mapped.
             // We create a temporary staging buffer to overcome this.
+            // The VB might be shared with other meshes, so only copy this mesh's vertices
 			const Buffer* pVB = pVao->getVertexBuffer(i).get();
-			vbInfo[i].pBuffer = Buffer::create(pVB->getSize(), Buffer::BindFlags::None, Buffer::AccessFlags::MapRead, nullptr);
-            pVB->copy(vbInfo[i].pBuffer.get());
+            const size_t stride = pVao->getVertexBufferStride(i);
+            const size_t size = stride * pMesh->getVertexCount();
+			vbInfo[i].pBuffer = Buffer::create(size, Buffer::BindFlags::None, Buffer::AccessFlags::MapRead, nullptr);
+            pVB->copy(vbInfo[i].pBuffer.get(), stride * pMesh->getBaseVertex(), 0, size);
 
             vbInfo[i].pData = (size_t)vbInfo[i].pBuffer->map(Buffer::MapType::Read);
 
@@ -353,8 +356,9 @@ namespace Falcor
         // Output the index buffer
         // Most of the buffers we use were created without any access flags, so can't be mapped.
         // We create a temporary staging buffer to overcome this.
-        auto pStaging = Buffer::create(pMesh->getVao()->getIndexBuffer()->getSize(), Buffer::BindFlags::None, Buffer::AccessFlags::MapRead, nullptr);
-        pMesh->getVao()->getIndexBuffer()->copy(pStaging.get());
+        const size_t ibSize = indexCount * sizeof(uint32_t);
+        auto pStaging = Buffer::create(ibSize, Buffer::BindFlags::None, Buffer::AccessFlags::MapRead, nullptr);
+        pMesh->getVao()->getIndexBuffer()->copy(pStaging.get(), pMesh->getStartIndex() * sizeof(uint32_t), 0, ibSize);
 
         const void* pIndices = pStaging->map(Buffer::MapType::Read);
         mStream.write(pIndices, indexCount * sizeof(uint32_t));
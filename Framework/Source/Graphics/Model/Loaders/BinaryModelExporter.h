@@ -68,7 +68,7 @@ namespace Falcor
         void warning(const std::string& Msg);
 
         bool prepareSubmeshes();
-        std::map<const Vao*, std::vector<Mesh::SharedPtr>> mMeshes;
+        std::map<std::pair<const Vao*, uint32_t>, std::vector<Mesh::SharedPtr>> mMeshes;    // Keyed by VAO and base vertex, since meshes can share a range of the vertex buffers or the whole buffers
         std::map<const Texture*, int32_t> mTextureHash;
         uint32_t mInstanceCount = 0;   // Not the same as Model::Instance count. Model keeps the total instance count, while the binary format has a concept of meshes and submeshes, and the instance count there is the mesh instance count.
     };
@@ -39,6 +39,8 @@
 #include "Core/Formats.h"
 #include "Core/Texture.h"
 #include "Graphics/Material/Material.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/PixelConversion.h"
 #include "glm/geometric.hpp"
 
 namespace Falcor
@@ -50,6 +52,7 @@ namespace Falcor
         ResourceFormat format = ResourceFormat::Unknown;
         std::vector<uint8_t> data;
         std::string name;
+        bool isPackedRgb = false;   // 3-channel data which wasn't expanded to RGBX yet
     };
 
     bool isSpecialFloat(float f)
@@ -449,26 +452,26 @@ namespace Falcor
 
         data.data.resize(storageSize);
         stream.read(data.data.data(), dataSize);
+        data.isPackedRgb = (bpp == 3);
 
-        // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
-        if(bpp == 3)
+        return true;
+    }
+
+    // Convert 3-channel 8-bits RGB formats to 4-channel RGBX by adding padding
+    void expandPackedRgb(TextureData& data)
+    {
+        if(data.isPackedRgb)
         {
-            for(int32_t i=texelCount-1;i>=0;--i)
-            {
-                data.data[i * 4 + 0] = data.data[i * 3 + 0];
-                data.data[i * 4 + 1] = data.data[i * 3 + 1];
-                data.data[i * 4 + 2] = data.data[i * 3 + 2];
-                data.data[i * 4 + 3] = 0xff;
-            }
+            expandRgb8ToRgba8(data.data.data(), data.data.data(), size_t(data.width) * data.height);
+            data.isPackedRgb = false;
         }
-
-        return true;
     }
 
     bool importTextures(std::vector<TextureData>& textures, uint32_t textureCount, BinaryFileStream& stream, const std::string& modelName)
     {
         textures.assign(textureCount, TextureData());
 
+        // The stream is read serially, the texel conversion runs in parallel
         for(uint32_t i = 0; i < textureCount; i++)
         {
             textures[i].name = readString(stream);
@@ -478,6 +481,11 @@ namespace Falcor
             }
         }
 
+        ThreadPool::getDefaultPool()->parallelFor(0, textureCount, [&](uint32_t i)
+        {
+            expandPackedRgb(textures[i]);
+        });
+
         return true;
     }
 
@@ -42,6 +42,11 @@ namespace Falcor
 	uint32_t Mesh::sMeshCounter = 0;
     Mesh::~Mesh() = default;
 
+    uint64_t Mesh::getCpuMemoryUsage() const
+    {
+        return (mInstanceMatrices.capacity() + mOriginalInstanceMatrices.capacity()) * sizeof(glm::mat4) + mInstanceBoundingBox.capacity() * sizeof(BoundingBox);
+    }
+
     Mesh::SharedPtr Mesh::create(const Vao::VertexBufferDescVector& vertexBuffers,
         uint32_t vertexCount,
         const Buffer::SharedPtr& pIndexBuffer,
@@ -100,10 +105,13 @@ namespace Falcor
             const auto& pLayout = mpVao->getVertexBufferLayout(i);
             const uint32_t stride = mpVao->getVertexBufferStride(i);
             Buffer* pBuffer = const_cast<Buffer*>(mpVao->getVertexBuffer(i).get());
-            size_t numVerts = pBuffer->getSize() / stride;
+            // The buffer might be shared with other meshes. Only touch this mesh's vertices
+            size_t numVerts = mVertexCount;
+            size_t offset = size_t(mBaseVertex) * stride;
+            size_t size = numVerts * stride;
 
-            float* tempData = new float[(pBuffer->getSize()+sizeof(float)-1)/sizeof(float)];
-            pBuffer->readData(tempData, 0,pBuffer->getSize());
+            float* tempData = new float[(size+sizeof(float)-1)/sizeof(float)];
+            pBuffer->readData(tempData, offset, size);
 
             for(uint32_t j = 0u; j<pLayout->getElementCount(); ++j)
             {
@@ -170,7 +178,7 @@ namespace Falcor
                 }
             }
 
-            pBuffer->updateData(tempData, 0, pBuffer->getSize(), true);
+            pBuffer->updateData(tempData, offset, size, true);
             delete [] tempData;
         }
 
@@ -186,6 +194,13 @@ namespace Falcor
         }
     }
 
+    void Mesh::setBufferRange(const Vao::SharedPtr& pVao, uint32_t baseVertex, uint32_t startIndex)
+    {
+        mpVao = pVao;
+        mBaseVertex = baseVertex;
+        mStartIndex = startIndex;
+    }
+
     void Mesh::addInstance(const glm::mat4& transform)
     {
         assert(mInstanceMatrices.size() == mInstanceBoundingBox.size());
@@ -47,6 +47,7 @@ namespace Falcor
     class AssimpModelImporter;
     class BinaryModelImporter;
     class SimpleModelImporter;
+    class SceneSnapshot;
 
     /** Class representing a single mesh
     */
@@ -96,6 +97,12 @@ namespace Falcor
         /** Get the number of indices in the index buffer. Use this value when drawing the mesh.
         */
         uint32_t getIndexCount() const { return mIndexCount; }
+        /** Get the location of the mesh's first vertex in the vertex buffers. It is added to the indices when drawing. Non-zero when the mesh shares its buffers with other meshes, see Model::BatchStaticMeshes
+        */
+        uint32_t getBaseVertex() const { return mBaseVertex; }
+        /** Get the location of the mesh's first index in the index buffer
+        */
+        uint32_t getStartIndex() const { return mStartIndex; }
 
         /** Get a pointer to the mesh's material
         */
@@ -137,6 +144,10 @@ namespace Falcor
         */
         const glm::mat4* getInstanceMatrices() const {  return mInstanceMatrices.data(); }
 
+        /** Get the CPU memory used by the instance matrices and bounding-boxes
+        */
+        uint64_t getCpuMemoryUsage() const;
+
         /** Delete culled instances from the mesh based on the camera frustum cull test.
         */
         void deleteCulledInstances(const Camera* pCamera);
@@ -154,7 +165,10 @@ namespace Falcor
         friend AssimpModelImporter;
         friend BinaryModelImporter;
         friend SimpleModelImporter;
+        friend SceneSnapshot;
+        friend Model;
         void addInstance(const glm::mat4& transform);
+        void setBufferRange(const Vao::SharedPtr& pVao, uint32_t baseVertex, uint32_t startIndex);
         static const uint32_t kMaxBonesPerVertex = 4;              ///> Max supported bones per vertex
 
     private:
@@ -173,6 +187,8 @@ namespace Falcor
         uint32_t mIndexCount = 0;
         uint32_t mVertexCount = 0;
         uint32_t mPrimitiveCount = 0;
+        uint32_t mBaseVertex = 0;
+        uint32_t mStartIndex = 0;
         bool mHasBones = false;
         Material::SharedPtr mpMaterial;
         RenderContext::Topology mTopology;
@@ -38,9 +38,13 @@
 #include "Core/Buffer.h"
 #include "Core/Texture.h"
 #include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCache.h"
 #include "Utils/StringUtils.h"
 #include "Graphics/Camera/Camera.h"
 #include "core/VAO.h"
+#include "Core/VertexLayout.h"
+#include <set>
+#include <algorithm>
 
 namespace Falcor
 {
@@ -62,6 +66,76 @@ namespace Falcor
 
     Model::~Model() = default;
 
+    MemoryTracker::Report Model::getMemoryReport(std::set<const void*>* pCountedResources) const
+    {
+        std::set<const void*> countedResources;
+        if(pCountedResources == nullptr)
+        {
+            pCountedResources = &countedResources;
+        }
+
+        // Collect the buffers. Meshes can reference buffers which weren't added to the model
+        std::vector<const Buffer*> buffers;
+        for(const auto& pBuffer : mpBuffers)
+        {
+            buffers.push_back(pBuffer.get());
+        }
+        uint64_t meshBytes = 0;
+        for(const auto& pMesh : mpMeshes)
+        {
+            const Vao* pVao = pMesh->getVao().get();
+            for(uint32_t i = 0; i < pVao->getVertexBuffersCount(); i++)
+            {
+                buffers.push_back(pVao->getVertexBuffer(i).get());
+            }
+            buffers.push_back(pVao->getIndexBuffer().get());
+            meshBytes += pMesh->getCpuMemoryUsage();
+        }
+
+        MemoryTracker::Report categories[(uint32_t)MemoryTracker::Category::Count];
+        for(uint32_t c = 0; c < arraysize(categories); c++)
+        {
+            categories[c].name = MemoryTracker::getCategoryName(MemoryTracker::Category(c));
+        }
+
+        for(const Buffer* pBuffer : buffers)
+        {
+            if(pBuffer && pCountedResources->insert(pBuffer).second)
+            {
+                categories[(uint32_t)pBuffer->getMemoryCategory()].bytes += pBuffer->getSize();
+            }
+        }
+
+        for(const auto& pTexture : mpTextures)
+        {
+            if(pCountedResources->insert(pTexture.get()).second)
+            {
+                categories[(uint32_t)MemoryTracker::Category::Texture].bytes += pTexture->getMemoryUsage();
+            }
+        }
+
+        if(mpAnimationController)
+        {
+            categories[(uint32_t)MemoryTracker::Category::AnimationData].bytes += mpAnimationController->getMemoryUsage();
+        }
+
+        MemoryTracker::Report report;
+        report.name = mName;
+        for(const auto& category : categories)
+        {
+            if(category.bytes)
+            {
+                report.addChild(category);
+            }
+        }
+
+        MemoryTracker::Report meshData;
+        meshData.name = "Mesh instance data";
+        meshData.bytes = meshBytes;
+        report.addChild(meshData);
+        return report;
+    }
+
     /** Permanently transform all meshes of the object by the given transform
     */
     void Model::applyTransform(const glm::mat4& transform) 
@@ -74,6 +148,111 @@ namespace Falcor
         calculateModelProperties();
     }
 
+    namespace
+    {
+        bool isEmissive(const Material* pMaterial)
+        {
+            if(pMaterial)
+            {
+                for(uint32_t layerId = 0; layerId < pMaterial->getNumActiveLayers(); layerId++)
+                {
+                    if(pMaterial->getLayerDesc(layerId)->type == MatEmissive)
+                    {
+                        return true;
+                    }
+                }
+            }
+            return false;
+        }
+
+        bool isSameVertexLayout(const Vao* pVao1, const Vao* pVao2)
+        {
+            if(pVao1->getVertexBuffersCount() != pVao2->getVertexBuffersCount())
+            {
+                return false;
+            }
+
+            for(uint32_t i = 0; i < pVao1->getVertexBuffersCount(); i++)
+            {
+                const VertexLayout* pLayout1 = pVao1->getVertexBufferLayout(i).get();
+                const VertexLayout* pLayout2 = pVao2->getVertexBufferLayout(i).get();
+                if((pVao1->getVertexBufferStride(i) != pVao2->getVertexBufferStride(i)) ||
+                    (pLayout1->getInputClass() != pLayout2->getInputClass()) ||
+                    (pLayout1->getInstanceStepRate() != pLayout2->getInstanceStepRate()) ||
+                    (pLayout1->getElementCount() != pLayout2->getElementCount()))
+                {
+                    return false;
+                }
+
+                for(uint32_t e = 0; e < pLayout1->getElementCount(); e++)
+                {
+                    if((pLayout1->getElementName(e) != pLayout2->getElementName(e)) ||
+                        (pLayout1->getElementOffset(e) != pLayout2->getElementOffset(e)) ||
+                        (pLayout1->getElementFormat(e) != pLayout2->getElementFormat(e)) ||
+                        (pLayout1->getElementArraySize(e) != pLayout2->getElementArraySize(e)) ||
+                        (pLayout1->getElementShaderLocation(e) != pLayout2->getElementShaderLocation(e)))
+                    {
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        VertexLayout::SharedPtr copyVertexLayout(const VertexLayout* pLayout)
+        {
+            VertexLayout::SharedPtr pCopy = VertexLayout::create();
+            pCopy->setInputClass(pLayout->getInputClass(), pLayout->getInstanceStepRate());
+            for(uint32_t e = 0; e < pLayout->getElementCount(); e++)
+            {
+                pCopy->addElement(pLayout->getElementName(e), pLayout->getElementOffset(e), pLayout->getElementFormat(e), pLayout->getElementArraySize(e), pLayout->getElementShaderLocation(e));
+            }
+            return pCopy;
+        }
+
+        // Meshes can share vertex and index buffers. A range of the source buffers is copied into the batch once, no matter how many meshes use it
+        using VertexRangeKey = std::pair<std::vector<const Buffer*>, uint32_t>;
+        using IndexRangeKey = std::pair<const Buffer*, uint32_t>;
+
+        VertexRangeKey getVertexRangeKey(const Mesh* pMesh)
+        {
+            const Vao* pVao = pMesh->getVao().get();
+            VertexRangeKey key;
+            for(uint32_t i = 0; i < pVao->getVertexBuffersCount(); i++)
+            {
+                key.first.push_back(pVao->getVertexBuffer(i).get());
+            }
+            key.second = pMesh->getBaseVertex();
+            return key;
+        }
+
+        IndexRangeKey getIndexRangeKey(const Mesh* pMesh)
+        {
+            return IndexRangeKey(pMesh->getVao()->getIndexBuffer().get(), pMesh->getStartIndex());
+        }
+
+        struct BatchRange
+        {
+            Vao::SharedPtr pSrcVao;
+            uint32_t srcFirst;
+            uint32_t count;
+            uint32_t dstFirst;
+        };
+
+        struct MeshBatch
+        {
+            std::vector<Mesh*> meshes;
+            std::vector<uint32_t> meshVertexRange;      // Per mesh, index into vertexRanges
+            std::vector<uint32_t> meshIndexRange;       // Per mesh, index into indexRanges
+            std::vector<BatchRange> vertexRanges;
+            std::vector<BatchRange> indexRanges;
+            std::map<VertexRangeKey, uint32_t> vertexRangeMap;
+            std::map<IndexRangeKey, uint32_t> indexRangeMap;
+            uint32_t vertexCount = 0;
+            uint32_t indexCount = 0;
+        };
+    }
+
     Model::SharedPtr Model::createFromFile(const std::string& filename, uint32_t flags)
     {
         Model::SharedPtr pModel;
@@ -89,17 +268,265 @@ namespace Falcor
 
         if(pModel)
         {
-            if(flags & CompressTextures)
+            pModel->finishLoading(flags);
+        }
+
+        return pModel;
+    }
+
+    std::vector<Model::SharedPtr> Model::createFromFiles(const std::vector<std::string>& filenames, uint32_t flags)
+    {
+        std::vector<Model::SharedPtr> models(filenames.size());
+
+        // Binary files are loaded one after the other, their textures are already decoded in parallel. The rest go through ASSIMP in one batch
+        std::vector<std::string> assimpFiles;
+        std::vector<size_t> assimpIndices;
+        for(size_t i = 0; i < filenames.size(); i++)
+        {
+            if(hasSuffix(filenames[i], ".bin", false))
             {
-                pModel->compressAllTextures();
+                models[i] = BinaryModelImporter::createFromFile(filenames[i], flags);
             }
+            else
+            {
+                assimpFiles.push_back(filenames[i]);
+                assimpIndices.push_back(i);
+            }
+        }
 
-            pModel->calculateModelProperties();
+        if(assimpFiles.size())
+        {
+            std::vector<Model::SharedPtr> assimpModels = AssimpModelImporter::createFromFiles(assimpFiles, flags);
+            for(size_t i = 0; i < assimpModels.size(); i++)
+            {
+                models[assimpIndices[i]] = assimpModels[i];
+            }
+        }
+
+        for(auto& pModel : models)
+        {
+            if(pModel)
+            {
+                pModel->finishLoading(flags);
+            }
+        }
+
+        return models;
+    }
+
+    struct Model::ParsedFile
+    {
+        std::string filename;
+        uint32_t flags = 0;
+        bool isBinary = false;
+        AssimpModelImporter::ParsedFile assimpFile;
+    };
+
+    std::shared_ptr<Model::ParsedFile> Model::parseFile(const std::string& filename, uint32_t flags)
+    {
+        std::shared_ptr<ParsedFile> pParsed = std::make_shared<ParsedFile>();
+        pParsed->filename = filename;
+        pParsed->flags = flags;
+        pParsed->isBinary = hasSuffix(filename, ".bin", false);
+
+        if((pParsed->isBinary == false) && (AssimpModelImporter::parseFile(filename, flags, pParsed->assimpFile) == false))
+        {
+            return nullptr;
+        }
+        return pParsed;
+    }
+
+    Model::SharedPtr Model::createFromParsedFile(const ParsedFile* pParsed)
+    {
+        Model::SharedPtr pModel;
+
+        if(pParsed->isBinary)
+        {
+            pModel = BinaryModelImporter::createFromFile(pParsed->filename, pParsed->flags);
+        }
+        else
+        {
+            pModel = AssimpModelImporter::createFromParsedFile(pParsed->filename, pParsed->assimpFile, pParsed->flags);
+        }
+
+        if(pModel)
+        {
+            pModel->finishLoading(pParsed->flags);
         }
 
         return pModel;
     }
 
+    void Model::finishLoading(uint32_t flags)
+    {
+        if(flags & CompressTextures)
+        {
+            compressAllTextures();
+        }
+
+        if(flags & BatchStaticMeshes)
+        {
+            batchStaticMeshes();
+        }
+
+        calculateModelProperties();
+    }
+
+    void Model::batchStaticMeshes(size_t maxBufferSize)
+    {
+        // Group the meshes which can be packed by vertex layout
+        std::vector<std::vector<Mesh*>> groups;
+        for(const auto& pMesh : mpMeshes)
+        {
+            const Vao* pVao = pMesh->getVao().get();
+            if(pMesh->hasBones() || (pVao->getIndexBuffer() == nullptr) || (pVao->getVertexBuffersCount() == 0) || isEmissive(pMesh->getMaterial().get()))
+            {
+                continue;
+            }
+
+            auto group = std::find_if(groups.begin(), groups.end(), [pVao](const std::vector<Mesh*>& g) { return isSameVertexLayout(g[0]->getVao().get(), pVao); });
+            if(group == groups.end())
+            {
+                groups.push_back(std::vector<Mesh*>());
+                group = groups.end() - 1;
+            }
+            group->push_back(pMesh.get());
+        }
+
+        // Split each group into batches which fit in the max buffer size
+        std::vector<MeshBatch> batches;
+        for(const auto& group : groups)
+        {
+            // Meshes sharing a range can have different vertex counts. Make sure the range covers all of them
+            std::map<VertexRangeKey, uint32_t> vertexCounts;
+            std::map<IndexRangeKey, uint32_t> indexCounts;
+            for(const Mesh* pMesh : group)
+            {
+                uint32_t& vertexCount = vertexCounts[getVertexRangeKey(pMesh)];
+                vertexCount = max(vertexCount, pMesh->getVertexCount());
+                uint32_t& indexCount = indexCounts[getIndexRangeKey(pMesh)];
+                indexCount = max(indexCount, pMesh->getIndexCount());
+            }
+
+            const Vao* pLayoutVao = group[0]->getVao().get();
+            uint32_t maxStride = 0;
+            for(uint32_t i = 0; i < pLayoutVao->getVertexBuffersCount(); i++)
+            {
+                maxStride = max(maxStride, pLayoutVao->getVertexBufferStride(i));
+            }
+
+            batches.push_back(MeshBatch());
+            MeshBatch* pBatch = &batches.back();
+            for(Mesh* pMesh : group)
+            {
+                VertexRangeKey vertexKey = getVertexRangeKey(pMesh);
+                IndexRangeKey indexKey = getIndexRangeKey(pMesh);
+                bool newVertices = pBatch->vertexRangeMap.find(vertexKey) == pBatch->vertexRangeMap.end();
+                bool newIndices = pBatch->indexRangeMap.find(indexKey) == pBatch->indexRangeMap.end();
+                uint32_t vertexCount = vertexCounts[vertexKey];
+                uint32_t indexCount = indexCounts[indexKey];
+
+                size_t vbSize = size_t(pBatch->vertexCount + (newVertices ? vertexCount : 0)) * maxStride;
+                size_t ibSize = size_t(pBatch->indexCount + (newIndices ? indexCount : 0)) * sizeof(uint32_t);
+                if((vbSize > maxBufferSize || ibSize > maxBufferSize) && pBatch->meshes.size())
+                {
+                    batches.push_back(MeshBatch());
+                    pBatch = &batches.back();
+                    newVertices = true;
+                    newIndices = true;
+                }
+
+                if(newVertices)
+                {
+                    BatchRange range = {pMesh->getVao(), pMesh->getBaseVertex(), vertexCount, pBatch->vertexCount};
+                    pBatch->vertexRangeMap[vertexKey] = (uint32_t)pBatch->vertexRanges.size();
+                    pBatch->vertexRanges.push_back(range);
+                    pBatch->vertexCount += vertexCount;
+                }
+                if(newIndices)
+                {
+                    BatchRange range = {pMesh->getVao(), pMesh->getStartIndex(), indexCount, pBatch->indexCount};
+                    pBatch->indexRangeMap[indexKey] = (uint32_t)pBatch->indexRanges.size();
+                    pBatch->indexRanges.push_back(range);
+                    pBatch->indexCount += indexCount;
+                }
+
+                pBatch->meshes.push_back(pMesh);
+                pBatch->meshVertexRange.push_back(pBatch->vertexRangeMap[vertexKey]);
+                pBatch->meshIndexRange.push_back(pBatch->indexRangeMap[indexKey]);
+            }
+        }
+
+        // Create the shared buffers. The source buffers are copied on the GPU, indices don't change since each mesh is drawn with its own base vertex
+        uint32_t batchedMeshCount = 0;
+        uint32_t batchCount = 0;
+        for(const auto& batch : batches)
+        {
+            std::set<const Vao*> vaos;
+            for(const Mesh* pMesh : batch.meshes)
+            {
+                vaos.insert(pMesh->getVao().get());
+            }
+            if(vaos.size() < 2)
+            {
+                // Nothing to gain
+                continue;
+            }
+
+            const Vao* pLayoutVao = batch.meshes[0]->getVao().get();
+            Vao::VertexBufferDescVector vbDesc(pLayoutVao->getVertexBuffersCount());
+            for(uint32_t i = 0; i < pLayoutVao->getVertexBuffersCount(); i++)
+            {
+                const uint32_t stride = pLayoutVao->getVertexBufferStride(i);
+                vbDesc[i].stride = stride;
+                vbDesc[i].pLayout = copyVertexLayout(pLayoutVao->getVertexBufferLayout(i).get());
+                vbDesc[i].pBuffer = Buffer::create(size_t(batch.vertexCount) * stride, Buffer::BindFlags::Vertex, Buffer::AccessFlags::None, nullptr);
+                for(const auto& range : batch.vertexRanges)
+                {
+                    range.pSrcVao->getVertexBuffer(i)->copy(vbDesc[i].pBuffer.get(), size_t(range.srcFirst) * stride, size_t(range.dstFirst) * stride, size_t(range.count) * stride);
+                }
+                addBuffer(vbDesc[i].pBuffer);
+            }
+
+            Buffer::SharedPtr pIB = Buffer::create(size_t(batch.indexCount) * sizeof(uint32_t), Buffer::BindFlags::Index, Buffer::AccessFlags::None, nullptr);
+            for(const auto& range : batch.indexRanges)
+            {
+                range.pSrcVao->getIndexBuffer()->copy(pIB.get(), size_t(range.srcFirst) * sizeof(uint32_t), size_t(range.dstFirst) * sizeof(uint32_t), size_t(range.count) * sizeof(uint32_t));
+            }
+            addBuffer(pIB);
+
+            Vao::SharedPtr pVao = Vao::create(vbDesc, pIB);
+            for(size_t m = 0; m < batch.meshes.size(); m++)
+            {
+                batch.meshes[m]->setBufferRange(pVao, batch.vertexRanges[batch.meshVertexRange[m]].dstFirst, batch.indexRanges[batch.meshIndexRange[m]].dstFirst);
+            }
+
+            batchedMeshCount += (uint32_t)batch.meshes.size();
+            batchCount++;
+        }
+
+        if(batchCount == 0)
+        {
+            return;
+        }
+
+        // Release the buffers which were copied into the batches
+        std::map<const Buffer*, bool> usedBuffers;
+        for(const auto& pMesh : mpMeshes)
+        {
+            const auto pVao = pMesh->getVao();
+            usedBuffers[pVao->getIndexBuffer().get()] = true;
+            for(uint32_t i = 0; i < pVao->getVertexBuffersCount(); i++)
+            {
+                usedBuffers[pVao->getVertexBuffer(i).get()] = true;
+            }
+        }
+        deleteUnusedBuffers(usedBuffers);
+        calculateModelProperties();
+
+        Logger::log(Logger::Level::Info, "Model '" + mName + "': packed " + std::to_string(batchedMeshCount) + " static meshes into " + std::to_string(batchCount) + " shared vertex/index buffer sets");
+    }
+
     void Model::exportToBinaryFile(const std::string& filename)
     {
         if(hasSuffix(filename, ".bin", false) == false)
@@ -120,7 +547,7 @@ namespace Falcor
         //std::sort(mpMeshes.begin(), mpMeshes.end(), compareMeshes);
 
         vec3 modelMin = vec3(1e25f), modelMax = vec3(-1e25f);
-        std::map<const Buffer*, bool> vbFound;
+        std::map<std::pair<const Buffer*, uint32_t>, bool> vbFound;   // Meshes can share the vertex buffers, either the whole buffer or a range of it
 
         for(const auto& pMesh : mpMeshes)
         {
@@ -134,10 +561,11 @@ namespace Falcor
                 modelMin = min(modelMin, meshMin);
                 modelMax = max(modelMax, meshMax);
 
-                if(vbFound.find(pMesh->getVao()->getVertexBuffer(0).get()) == vbFound.end())
+                auto vbRange = std::make_pair(pMesh->getVao()->getVertexBuffer(0).get(), pMesh->getBaseVertex());
+                if(vbFound.find(vbRange) == vbFound.end())
                 {
                     mVertexCount += pMesh->getVertexCount();
-                    vbFound[pMesh->getVao()->getVertexBuffer(0).get()] = true;
+                    vbFound[vbRange] = true;
                 }
 
                 mPrimitiveCount += pMesh->getPrimitiveCount();
@@ -227,19 +655,31 @@ namespace Falcor
         mpMeshes.push_back(std::move(pMesh));
     }
 
-    Material::SharedPtr Model::getOrAddMaterial(const Material::SharedPtr& pMaterial)
+    Material::SharedPtr Model::findMaterial(const MaterialIndex& materialIndex, const Material* pMaterial)
     {
-        // Check if the material already exists
-        for(const auto& a : mpMaterials)
+        auto range = materialIndex.equal_range(pMaterial->getHash());
+        for(auto it = range.first; it != range.second; it++)
         {
-            if(*pMaterial == *a)
+            if(*pMaterial == *it->second)
             {
-                return a;
+                return it->second;
             }
         }
+        return nullptr;
+    }
+
+    Material::SharedPtr Model::getOrAddMaterial(const Material::SharedPtr& pMaterial)
+    {
+        // Check if the material already exists
+        Material::SharedPtr pExisting = findMaterial(mMaterialIndex, pMaterial.get());
+        if(pExisting)
+        {
+            return pExisting;
+        }
 
         // New material
         mpMaterials.push_back(pMaterial);
+        mMaterialIndex.insert(std::make_pair(pMaterial->getHash(), pMaterial));
         return pMaterial;
     }
 
@@ -250,7 +690,11 @@ namespace Falcor
 
     void Model::addTexture(const Texture::SharedConstPtr& pTexture)
     {
-        mpTextures.push_back(pTexture);
+        // Textures are shared through the texture cache, so different paths can resolve to the same texture
+        if(std::find(mpTextures.begin(), mpTextures.end(), pTexture) == mpTextures.end())
+        {
+            mpTextures.push_back(pTexture);
+        }
     }
     
     template<typename T>
@@ -337,6 +781,7 @@ namespace Falcor
             }
         }
         removeNullElements(mpMaterials);
+        rebuildMaterialIndex();
 
         // Now remove unused textures
         for(auto& texture : mpTextures)
@@ -349,12 +794,63 @@ namespace Falcor
         removeNullElements(mpTextures);
     }
 
+    void Model::rebuildMaterialIndex()
+    {
+        mMaterialIndex.clear();
+        for(const auto& pMaterial : mpMaterials)
+        {
+            mMaterialIndex.insert(std::make_pair(pMaterial->getHash(), pMaterial));
+        }
+    }
+
+    void Model::shareMaterials(MaterialIndex& materialIndex)
+    {
+        std::map<const Material*, Material::SharedPtr> replacements;
+        for(auto& pMaterial : mpMaterials)
+        {
+            Material::SharedPtr pShared = findMaterial(materialIndex, pMaterial.get());
+            if(pShared)
+            {
+                replacements[pMaterial.get()] = pShared;
+                pMaterial = pShared;
+            }
+            else
+            {
+                materialIndex.insert(std::make_pair(pMaterial->getHash(), pMaterial));
+            }
+        }
+
+        if(replacements.size())
+        {
+            for(auto& pMesh : mpMeshes)
+            {
+                const auto& it = replacements.find(pMesh->getMaterial().get());
+                if(it != replacements.end())
+                {
+                    pMesh->setMaterial(it->second);
+                }
+            }
+
+            // The materials list might contain duplicates now. Remove them, keeping the order of the rest
+            std::set<const Material*> uniqueMaterials;
+            for(auto& pMaterial : mpMaterials)
+            {
+                if(uniqueMaterials.insert(pMaterial.get()).second == false)
+                {
+                    pMaterial = nullptr;
+                }
+            }
+            removeNullElements(mpMaterials);
+            rebuildMaterialIndex();
+        }
+    }
+
     void Model::compressAllTextures()
     {
         std::map<const Texture*, uint32_t> texturesIndex;
         std::vector<bool> isNormalMap(mpTextures.size(), false);
 
-        // Find all normal maps. We don't compress them.
+        // Find all normal maps. They are compressed into two-channel formats.
         for(uint32_t i = 0; i < mpTextures.size(); i++)
         {
             texturesIndex[mpTextures[i].get()] = i;
@@ -370,20 +866,45 @@ namespace Falcor
             }
         }
 
-        std::vector<uint8_t> texData;
-
-        // Now create the textures
+        // Now create the compressed textures. The textures might be shared with other models through the texture cache, so they are replaced rather than compressed in place
         for(uint32_t i = 0; i < mpTextures.size(); i++)
         {
-            if(isNormalMap[i] == true)
+            const Texture* pTexture = mpTextures[i].get();
+            assert(pTexture->getType() == Texture::Type::Texture2D);
+            if(isCompressedFormat(pTexture->getFormat()))
             {
-                // Not compressing normal map
                 continue;
             }
 
-            Texture* pTexture = const_cast<Texture*>(mpTextures[i].get());
-            assert(pTexture->getType() == Texture::Type::Texture2D);
-            pTexture->compress2DTexture();            
+            // Models which use the same file the same way share the compressed copy
+            TextureCache::Key key;
+            bool hasKey = pTexture->getSourceFilename().size() && TextureCache::createKey(pTexture->getSourceFilename(), pTexture->getMipLevels() > 1, isSrgbFormat(pTexture->getFormat()), key);
+            key.compression = isNormalMap[i] ? TextureCache::Compression::NormalMap : TextureCache::Compression::Color;
+
+            Texture::SharedPtr pCompressed = hasKey ? TextureCache::find(key) : nullptr;
+            if(pCompressed == nullptr)
+            {
+                pCompressed = pTexture->createCompressed2DTexture(isNormalMap[i]);
+                if(pCompressed == nullptr)
+                {
+                    continue;
+                }
+                if(hasKey)
+                {
+                    TextureCache::add(key, pCompressed);
+                }
+            }
+
+            for(const auto& pMaterial : mpMaterials)
+            {
+                pMaterial->replaceTexture(pTexture, pCompressed);
+                if(isNormalMap[i] && (pMaterial->getNormalValue().texture.pTexture == pCompressed))
+                {
+                    pMaterial->setTwoChannelNormalMap(pCompressed->getFormat() == ResourceFormat::BC5Unorm);
+                }
+            }
+            mpTextures[i] = pCompressed;
         }
+        rebuildMaterialIndex();
     }
 }
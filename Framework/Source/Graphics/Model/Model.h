@@ -28,12 +28,15 @@
 #pragma once
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <set>
 #include "glm/mat4x4.hpp"
 #include "glm/vec3.hpp"
 #include "Graphics/Material/BasicMaterial.h"
 #include "Graphics/Model/Mesh.h"
 #include "Core/Sampler.h"
 #include "Graphics/Model/AnimationController.h"
+#include "Utils/MemoryTracker.h"
 
 namespace Falcor
 {
@@ -60,12 +63,39 @@ namespace Falcor
             FindDegeneratePrimitives    = 4,    ///< Replace degenerate triangles/lines with lines/points. This can create a meshes with topology that wasn't present in the original model.
             AssumeLinearSpaceTextures   = 8,    ///< By default, textures representing colors (diffuse/specular) are interpreted as sRGB data. Use this flag to force linear space for color textures.
             DontMergeMeshes             = 16,   ///< Preserve the original list of meshes in the scene, don't merge meshes with the same material
+            DeduplicateMeshes           = 32,   ///< Create a single mesh for meshes with identical vertex and index data, and draw the copies as instances of it. Implies DontMergeMeshes, since merging joins the copies into larger meshes
+            DeduplicateRigidMeshes      = 64,   ///< Like DeduplicateMeshes, but also finds copies which were rotated and translated. Implies DeduplicateMeshes
+            BatchStaticMeshes           = 128,  ///< Pack meshes without bones into a few shared vertex and index buffers after loading, see batchStaticMeshes()
         };
 
         /** create a new model from file
         */
         static SharedPtr createFromFile(const std::string& filename, uint32_t flags);
 
+        /** create models from a list of files. Files which don't use the binary format are parsed concurrently, graphics resources are created on the calling thread.
+            \param[in] filenames The files to load
+            \param[in] flags Flags controlling model creation
+            \return A vector with an entry per filename, in the same order. Entries of files which failed to load are nullptr
+        */
+        static std::vector<SharedPtr> createFromFiles(const std::vector<std::string>& filenames, uint32_t flags);
+
+        /** The CPU part of loading a model file, see parseFile()
+        */
+        struct ParsedFile;
+
+        /** Do the CPU-only part of loading a model file. This can be called from any thread, so files can be loaded in the background.\n
+            Binary files are read when the model is created.
+            \param[in] filename The file to load
+            \param[in] flags Flags controlling model creation
+            \return An object to pass to createFromParsedFile(), or nullptr if the file couldn't be parsed
+        */
+        static std::shared_ptr<ParsedFile> parseFile(const std::string& filename, uint32_t flags);
+
+        /** Create a model from a file parsed with parseFile(). Must be called on the main thread
+            \return A new model, or nullptr if creating the model failed
+        */
+        static SharedPtr createFromParsedFile(const ParsedFile* pParsed);
+
         static const char* kSupportedFileFormatsStr;
 
         ~Model();
@@ -111,6 +141,11 @@ namespace Falcor
         */
         uint32_t getBufferCount() const { return (uint32_t)mpBuffers.size(); }
 
+        /** Get a report of the memory used by the model's buffers, textures, animations and CPU-side mesh data
+            \param[in,out] pCountedResources Optional. Buffers and textures in this set are skipped, and the model's resources are added to it. Use it to count resources shared between models only once
+        */
+        MemoryTracker::Report getMemoryReport(std::set<const void*>* pCountedResources = nullptr) const;
+
         /** Get a texture by ID
         */
         const Texture::SharedConstPtr& getTexture(uint32_t MeshID) const { return mpTextures[MeshID]; }
@@ -167,6 +202,26 @@ namespace Falcor
         */
         void deleteCulledMeshes(const Camera* pCamera);
 
+        /** Hash table of materials, keyed by Material::getHash()
+        */
+        using MaterialIndex = std::unordered_multimap<uint64_t, Material::SharedPtr>;
+
+        /** Replace the model's materials with equal materials found in an index, and add the rest of the materials to the index. Use this to share materials between models.
+            \param[in,out] materialIndex The materials of the models processed so far
+        */
+        void shareMaterials(MaterialIndex& materialIndex);
+
+        /** Default max size in bytes of the buffers created by batchStaticMeshes()
+        */
+        static const size_t kDefaultMaxBatchBufferSize = 64 * 1024 * 1024;
+
+        /** Pack the static meshes into shared vertex and index buffers, so that consecutive draws don't need to bind a new vertex array object.\n
+            Meshes with bones, meshes without an index buffer and meshes with emissive materials (area lights read the mesh buffers directly) keep their own buffers. Meshes are only packed together if their vertex layouts are identical.
+            Packed meshes are drawn using their base vertex and start index. Code which reads a mesh's buffers directly needs to take them into account, RTContext doesn't support packed meshes.
+            \param[in] maxBufferSize The max size in bytes of each vertex and index buffer. A new set of buffers is created when it's exceeded
+        */
+        void batchStaticMeshes(size_t maxBufferSize = kDefaultMaxBatchBufferSize);
+
         /** Name the model
         */
         void setName(const std::string& Name) { mName = Name; }
@@ -185,6 +240,8 @@ namespace Falcor
         friend class AssimpModelImporter;
         friend class BinaryModelImporter;
         friend class SimpleModelImporter;
+        friend class SceneSnapshot;
+        friend class SceneStreamer;
         Model();
         void setAnimationController(AnimationController::UniquePtr pAnimController);
         void addMesh(Mesh::SharedPtr pMesh);
@@ -203,6 +260,9 @@ namespace Falcor
 		uint32_t mId;
 
         std::vector<Material::SharedPtr> mpMaterials;
+        MaterialIndex mMaterialIndex;   // Used to find duplicates while importing. Materials which change after they were added might not be found
+        static Material::SharedPtr findMaterial(const MaterialIndex& materialIndex, const Material* pMaterial);
+        void rebuildMaterialIndex();
 
         std::vector<Mesh::SharedPtr> mpMeshes;
         AnimationController::UniquePtr mpAnimationController;
@@ -217,5 +277,6 @@ namespace Falcor
         void deleteUnusedMaterials(std::map<const Material*, bool> usedMaterials);
         void deleteUnusedBuffers(std::map<const Buffer*, bool> usedBuffers);
         void compressAllTextures();
+        void finishLoading(uint32_t flags);
     };
 }
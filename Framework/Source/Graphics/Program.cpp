@@ -39,11 +39,51 @@
 #include "Utils/ShaderUtils.h"
 #include "Core/RenderContext.h"
 #include "Utils/StringUtils.h"
+#include "Utils/ShaderPreprocessor.h"
+#include "Utils/ThreadPool.h"
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
 
 namespace Falcor
 {
     std::vector<Program*> Program::sPrograms;
 
+    /** State of a program version which is compiled on a worker thread. Owned jointly by the program and the task, so the program can be destroyed while the task is running.
+    */
+    struct Program::AsyncCompilation
+    {
+        AsyncCompilation() : isReady(false) {}
+
+        // Inputs. For programs created from files, these are resolved by the worker thread
+        DefineSetId defineSet = 0;
+        DefineList defines;
+        std::string shaderStrings[kShaderCount];
+        bool createdFromFile = false;
+
+        // Outputs
+        std::string source[kShaderCount];           // Pre-processed source. Used when shaders can't be created in the background
+        Shader::unordered_string_set includeList[kShaderCount];
+        Shader::SharedPtr pShaders[kShaderCount];
+        std::string errorLog;
+        bool success = false;
+
+        std::atomic<bool> isReady;
+        std::mutex mutex;
+        std::condition_variable condition;
+    };
+
+    static ThreadPool* getCompilationPool()
+    {
+        // Compilation has its own pool, so long compiles don't delay unrelated tasks in the default pool
+        static ThreadPool::SharedPtr spPool;
+        if(spPool == nullptr)
+        {
+            spPool = ThreadPool::create();
+        }
+        return spPool.get();
+    }
+
     Program::Program()
     {
         sPrograms.push_back(this);
@@ -107,32 +147,102 @@ namespace Falcor
         pProgram->mShaderStrings[(uint32_t)ShaderType::Hull] = HS;
         pProgram->mShaderStrings[(uint32_t)ShaderType::Domain] = DS;
         pProgram->mCreatedFromFile = createdFromFile;
-        pProgram->mDefineList = programDefines;
+        pProgram->mActiveDefineSet = pProgram->internDefineList(programDefines);
 
         return pProgram;
     }
 
+    size_t Program::DefineListHash::operator()(const DefineList& defines) const
+    {
+        size_t hash = 0;
+        for(const auto& define : defines)
+        {
+            hashCombine(hash, define.first);
+            hashCombine(hash, define.second);
+        }
+        return hash;
+    }
+
+    Program::DefineSetId Program::internDefineList(const DefineList& defines)
+    {
+        const auto& it = mDefineSetIds.find(defines);
+        if(it != mDefineSetIds.end())
+        {
+            return it->second;
+        }
+
+        DefineSetId id = (DefineSetId)mDefineSets.size();
+        mDefineSets.push_back(defines);
+        mDefineSetIds[defines] = id;
+        return id;
+    }
+
+    Program::DefineSetId Program::applyDefineTransition(bool add, const std::string& name, const std::string& value)
+    {
+        size_t key = 0;
+        hashCombine(key, mActiveDefineSet);
+        hashCombine(key, add);
+        hashCombine(key, name);
+        hashCombine(key, value);
+
+        const auto& it = mDefineTransitions.find(key);
+        if(it != mDefineTransitions.end() && it->second.source == mActiveDefineSet && it->second.add == add && it->second.name == name && it->second.value == value)
+        {
+            return it->second.target;
+        }
+
+        // First time we see this transition. Build the new define list and intern it
+        DefineList defines = mDefineSets[mActiveDefineSet];
+        if(add)
+        {
+            defines.add(name, value);
+        }
+        else
+        {
+            defines.remove(name);
+        }
+        DefineSetId target = internDefineList(defines);
+
+        // In the unlikely case of a hash collision, the first transition keeps the slot and the other one takes the slow path every time
+        if(it == mDefineTransitions.end())
+        {
+            DefineTransition& transition = mDefineTransitions[key];
+            transition.source = mActiveDefineSet;
+            transition.add = add;
+            transition.target = target;
+            transition.name = name;
+            transition.value = value;
+        }
+        return target;
+    }
+
     void Program::addDefine(const std::string& name, const std::string& value)
     {
-        // Make sure that it doesn't exist already
-        if(mDefineList.find(name) != mDefineList.end())
+        DefineSetId defineSet = applyDefineTransition(true, name, value);
+        if(defineSet != mActiveDefineSet)
         {
-            if(mDefineList[name] == value)
-            {
-                // Same define
-                return;
-            }
+            mLinkRequired = true;
+            mActiveDefineSet = defineSet;
         }
-        mLinkRequired = true;
-        mDefineList[name] = value;
     }
 
     void Program::removeDefine(const std::string& name)
     {
-        if(mDefineList.find(name) != mDefineList.end())
+        DefineSetId defineSet = applyDefineTransition(false, name, "");
+        if(defineSet != mActiveDefineSet)
+        {
+            mLinkRequired = true;
+            mActiveDefineSet = defineSet;
+        }
+    }
+
+    void Program::clearDefines()
+    {
+        DefineSetId defineSet = internDefineList(DefineList());
+        if(defineSet != mActiveDefineSet)
         {
             mLinkRequired = true;
-            mDefineList.erase(name);
+            mActiveDefineSet = defineSet;
         }
     }
 
@@ -172,32 +282,264 @@ namespace Falcor
         return false;
     }
 
+    ProgramVersion::SharedConstPtr Program::findProgramVersion(DefineSetId defineSet) const
+    {
+        return (defineSet < mProgramVersions.size()) ? mProgramVersions[defineSet] : nullptr;
+    }
+
     ProgramVersion::SharedConstPtr Program::getActiveProgramVersion() const
     {
         if(mLinkRequired)
         {
-            const auto& it = mProgramVersions.find(mDefineList);
-            ProgramVersion::SharedConstPtr pVersion = nullptr;
-            if(it == mProgramVersions.end())
+            ProgramVersion::SharedConstPtr pExisting = findProgramVersion(mActiveDefineSet);
+            if(pExisting)
             {
-                if(link() == false)
+                mpActiveProgram = pExisting;
+                mLinkRequired = false;
+                return mpActiveProgram;
+            }
+
+            // Check if the version is being compiled in the background
+            const auto& pending = mPendingVersions.find(mActiveDefineSet);
+            if(mCompilationMode == CompilationMode::Asynchronous)
+            {
+                if(mFailedVersions.find(mActiveDefineSet) != mFailedVersions.end())
                 {
-                    return false;
+                    return mpFallbackVersion;
                 }
-                else
+                else if(pending == mPendingVersions.end())
                 {
-                    mProgramVersions[mDefineList] = mpActiveProgram;
+                    startAsyncCompilation(mActiveDefineSet);
+                    return mpFallbackVersion;
+                }
+                else if(pending->second->isReady == false)
+                {
+                    return mpFallbackVersion;
                 }
             }
-            else
+
+            if(pending != mPendingVersions.end())
+            {
+                // In synchronous mode we wait for the task rather than compiling the same version twice
+                ProgramVersion::SharedConstPtr pVersion = finishAsyncCompilation(pending->second);
+                if(pVersion)
+                {
+                    mUboMap.clear();
+                    mpActiveProgram = pVersion;
+                    mLinkRequired = false;
+                    return mpActiveProgram;
+                }
+                else if(mCompilationMode == CompilationMode::Asynchronous)
+                {
+                    // The error was already reported. Don't stall the draw by compiling it again, keep using the fallback until the program is reloaded
+                    return mpFallbackVersion;
+                }
+                // In synchronous mode we compile it again, same as a version which wasn't compiled in the background
+            }
+
+            if(link() == false)
             {
-                mpActiveProgram = mProgramVersions[mDefineList];
+                return nullptr;
             }
+            if(mProgramVersions.size() <= mActiveDefineSet)
+            {
+                mProgramVersions.resize(mActiveDefineSet + 1);
+            }
+            mProgramVersions[mActiveDefineSet] = mpActiveProgram;
+            mLinkRequired = false;
         }
 
         return mpActiveProgram;
     }
 
+    bool Program::isActiveProgramVersionReady() const
+    {
+        return findProgramVersion(mActiveDefineSet) != nullptr;
+    }
+
+    void Program::prewarm(const std::vector<DefineList>& defineLists, bool waitForCompletion)
+    {
+        // Start all the tasks before waiting for any of them, so they compile in parallel
+        std::vector<AsyncCompilationPtr> compilations;
+        for(const auto& defines : defineLists)
+        {
+            DefineSetId defineSet = internDefineList(defines);
+            if((findProgramVersion(defineSet) == nullptr) && (mFailedVersions.find(defineSet) == mFailedVersions.end()))
+            {
+                const auto& pending = mPendingVersions.find(defineSet);
+                compilations.push_back((pending == mPendingVersions.end()) ? startAsyncCompilation(defineSet) : pending->second);
+            }
+        }
+
+        if(waitForCompletion)
+        {
+            for(auto& pCompilation : compilations)
+            {
+                finishAsyncCompilation(pCompilation);
+            }
+        }
+    }
+
+    Program::AsyncCompilationPtr Program::startAsyncCompilation(DefineSetId defineSet) const
+    {
+        AsyncCompilationPtr pCompilation = std::make_shared<AsyncCompilation>();
+        pCompilation->defineSet = defineSet;
+        pCompilation->defines = mDefineSets[defineSet];
+        pCompilation->createdFromFile = mCreatedFromFile;
+        for(uint32_t i = 0; i < kShaderCount; i++)
+        {
+            pCompilation->shaderStrings[i] = mShaderStrings[i];
+        }
+
+        mPendingVersions[defineSet] = pCompilation;
+        getCompilationPool()->enqueue([pCompilation]() { compileInBackground(pCompilation.get()); });
+        return pCompilation;
+    }
+
+    void Program::compileInBackground(AsyncCompilation* pCompilation)
+    {
+        bool success = true;
+        for(uint32_t i = 0; i < kShaderCount && success; i++)
+        {
+            const std::string& shaderString = pCompilation->shaderStrings[i];
+            if(shaderString.empty())
+            {
+                continue;
+            }
+
+            std::string shader;
+            std::string filename;
+            if(pCompilation->createdFromFile)
+            {
+                // The data directories lookup is thread-safe, so the paths are resolved here rather than on the main thread
+                if((findFileInDataDirectories(shaderString, filename) == false) || (readFileToString(filename, shader) == false))
+                {
+                    pCompilation->errorLog += "Can't find shader file " + shaderString + "\n";
+                    success = false;
+                    break;
+                }
+            }
+            else
+            {
+                shader = shaderString;
+            }
+
+            std::string errorMsg;
+            if(ShaderPreprocessor::parseShader(filename, shader, errorMsg, pCompilation->includeList[i], pCompilation->defines) == false)
+            {
+                pCompilation->errorLog += "Error when pre-processing shader " + filename + "\n" + errorMsg;
+                success = false;
+                break;
+            }
+
+#ifdef FALCOR_DX11
+            // The D3D11 device is free-threaded, so we can create the shader here
+            std::string log;
+            pCompilation->pShaders[i] = Shader::create(shader, ShaderType(i), log);
+            if(pCompilation->pShaders[i] == nullptr)
+            {
+                pCompilation->errorLog += "Compilation of " + getShaderNameFromType(ShaderType(i)) + " shader " + filename + " failed.\n" + log;
+                success = false;
+                break;
+            }
+            pCompilation->pShaders[i]->setIncludeList(pCompilation->includeList[i]);
+#else
+            pCompilation->source[i].swap(shader);
+#endif
+        }
+
+        std::lock_guard<std::mutex> lock(pCompilation->mutex);
+        pCompilation->success = success;
+        pCompilation->isReady = true;
+        pCompilation->condition.notify_all();
+    }
+
+    ProgramVersion::SharedConstPtr Program::finishAsyncCompilation(AsyncCompilationPtr pCompilation) const
+    {
+        {
+            std::unique_lock<std::mutex> lock(pCompilation->mutex);
+            pCompilation->condition.wait(lock, [&pCompilation]() { return pCompilation->isReady == true; });
+        }
+
+        mPendingVersions.erase(pCompilation->defineSet);
+
+        // The same compilation might be finished more than once (for example, if it was passed to prewarm() twice)
+        ProgramVersion::SharedConstPtr pExisting = findProgramVersion(pCompilation->defineSet);
+        if(pExisting)
+        {
+            return pExisting;
+        }
+
+        std::string errorLog = pCompilation->errorLog;
+        ProgramVersion::SharedConstPtr pVersion;
+        if(pCompilation->success)
+        {
+            Shader::SharedPtr pShaders[kShaderCount];
+            bool success = true;
+            for(uint32_t i = 0; i < kShaderCount && success; i++)
+            {
+                if(mShaderStrings[i].size())
+                {
+#ifdef FALCOR_DX11
+                    pShaders[i] = pCompilation->pShaders[i];
+#else
+                    std::string log;
+                    pShaders[i] = Shader::create(pCompilation->source[i], ShaderType(i), log);
+                    if(pShaders[i] == nullptr)
+                    {
+                        errorLog += "Compilation of " + getShaderNameFromType(ShaderType(i)) + " shader " + mShaderStrings[i] + " failed.\n" + log;
+                        success = false;
+                        break;
+                    }
+                    pShaders[i]->setIncludeList(pCompilation->includeList[i]);
+#endif
+                    trackShaderFiles(i, pShaders[i].get());
+                }
+            }
+
+            if(success)
+            {
+                pVersion = ProgramVersion::create(pShaders[(uint32_t)ShaderType::Vertex],
+                    pShaders[(uint32_t)ShaderType::Fragment],
+                    pShaders[(uint32_t)ShaderType::Geometry],
+                    pShaders[(uint32_t)ShaderType::Hull],
+                    pShaders[(uint32_t)ShaderType::Domain],
+                    errorLog,
+                    getProgramDescString());
+            }
+        }
+
+        if(pVersion == nullptr)
+        {
+            Logger::log(Logger::Level::Error, "Asynchronous program compilation failed.\n\n" + getProgramDescString() + "\n" + errorLog);
+            mFailedVersions.insert(pCompilation->defineSet);
+            return nullptr;
+        }
+
+        if(mProgramVersions.size() <= pCompilation->defineSet)
+        {
+            mProgramVersions.resize(pCompilation->defineSet + 1);
+        }
+        mProgramVersions[pCompilation->defineSet] = pVersion;
+        return pVersion;
+    }
+
+    void Program::trackShaderFiles(uint32_t shaderIndex, const Shader* pShader) const
+    {
+        // Record the modification time of the shader file and its includes, used by reloadAllPrograms()
+        if(mCreatedFromFile)
+        {
+            std::string fullpath;
+            findFileInDataDirectories(mShaderStrings[shaderIndex], fullpath);
+            mFileTimeMap[fullpath] = getFileModifiedTime(fullpath);
+        }
+
+        for(const auto& include : pShader->getIncludeList())
+        {
+            mFileTimeMap[include] = getFileModifiedTime(include);
+        }
+    }
+
     bool Program::link() const
     {
         mUboMap.clear();
@@ -214,25 +556,16 @@ namespace Falcor
                 {
                     if(mCreatedFromFile)
                     {
-                        pShaders[i] = createShaderFromFile(mShaderStrings[i], ShaderType(i), mDefineList);
-                        if(pShaders[i])
-                        {
-                            std::string fullpath;
-                            findFileInDataDirectories(mShaderStrings[i], fullpath);
-                            mFileTimeMap[fullpath] = getFileModifiedTime(fullpath);
-                        }
+                        pShaders[i] = createShaderFromFile(mShaderStrings[i], ShaderType(i), getActiveDefinesList());
                     }
                     else
                     {
-                        pShaders[i] = createShaderFromString(mShaderStrings[i], ShaderType(i), mDefineList);
+                        pShaders[i] = createShaderFromString(mShaderStrings[i], ShaderType(i), getActiveDefinesList());
                     }
 
                     if(pShaders[i])
                     {
-                        for(const auto& include : pShaders[i]->getIncludeList())
-                        {
-                            mFileTimeMap[include] = getFileModifiedTime(include);
-                        }
+                        trackShaderFiles(i, pShaders[i].get());
                     }
                 }
             }
@@ -271,6 +604,8 @@ namespace Falcor
     {
         mpActiveProgram = nullptr;
         mProgramVersions.clear();
+        mPendingVersions.clear();
+        mFailedVersions.clear();
         mFileTimeMap.clear();
         mLinkRequired = true;
     }
@@ -279,37 +614,51 @@ namespace Falcor
     {
         for(auto& pProgram : sPrograms)
         {
-            if(pProgram->checkIfFilesChanged())
+            // Versions which failed to compile are retried, the error might have been fixed in a file which wasn't tracked yet
+            if(pProgram->checkIfFilesChanged() || (pProgram->mFailedVersions.empty() == false))
             {
                 pProgram->reset();
             }
         }
     }
 
+    // The queries below return an invalid result while the active version is compiled in the background and there's no fallback version
     const Shader* Program::getShader(ShaderType Type) const
     {
-        return getActiveProgramVersion()->getShader(Type);
+        ProgramVersion::SharedConstPtr pVersion = getActiveProgramVersion();
+        return pVersion ? pVersion->getShader(Type) : nullptr;
     }
     
     int32_t Program::getAttributeLocation(const std::string& Attribute) const
     {
-        return getActiveProgramVersion()->getAttributeLocation(Attribute);
+        ProgramVersion::SharedConstPtr pVersion = getActiveProgramVersion();
+        return pVersion ? pVersion->getAttributeLocation(Attribute) : ProgramVersion::kInvalidLocation;
     }
 
     uint32_t Program::getUniformBufferBinding(const std::string& Name) const
     {
-        return getActiveProgramVersion()->getUniformBufferBinding(Name);
+        ProgramVersion::SharedConstPtr pVersion = getActiveProgramVersion();
+        return pVersion ? pVersion->getUniformBufferBinding(Name) : (uint32_t)ProgramVersion::kInvalidLocation;
     }
 
     UniformBuffer::SharedPtr Program::getUniformBuffer(const std::string& bufName)
     {
         // Check to see if this UBO has previously been accessed
-        UniformBuffer::SharedPtr pUbo = mUboMap[bufName];
-        if(pUbo == nullptr)
+        const auto& it = mUboMap.find(bufName);
+        if(it != mUboMap.end() && it->second)
         {
-            pUbo = UniformBuffer::create(getActiveProgramVersion().get(), bufName);
-            mUboMap[bufName] = pUbo;
+            return it->second;
+        }
+
+        ProgramVersion::SharedConstPtr pVersion = getActiveProgramVersion();
+        if(pVersion == nullptr)
+        {
+            // Don't cache anything, the UBO is created once the version is ready
+            return nullptr;
         }
+
+        UniformBuffer::SharedPtr pUbo = UniformBuffer::create(pVersion.get(), bufName);
+        mUboMap[bufName] = pUbo;
         return pUbo;
     }
 
@@ -327,9 +676,16 @@ namespace Falcor
 
     void Program::setUniformBuffersIntoContext(RenderContext* pContext)
     {
+        ProgramVersion::SharedConstPtr pVersion = getActiveProgramVersion();
+        if(pVersion == nullptr)
+        {
+            // Nothing will be drawn with this program until the version is ready
+            return;
+        }
+
         for(auto& i = mUboMap.begin(); i != mUboMap.end(); i++)
         {
-            uint32_t loc = getUniformBufferBinding(i->first);
+            uint32_t loc = pVersion->getUniformBufferBinding(i->first);
             assert(loc != ProgramVersion::kInvalidLocation);
             pContext->setUniformBuffer(loc, i->second);
         }
@@ -30,6 +30,9 @@
 #include <string>
 #include <map>
 #include <vector>
+#include <deque>
+#include <unordered_map>
+#include <unordered_set>
 #include "Core/ProgramVersion.h"
 #include "Core/UniformBuffer.h"
 
@@ -113,14 +116,45 @@ namespace Falcor
         ~Program();
         /** Get a shader object associated with this program
             \param[in] Type The Type of the shader object to fetch.
-            \return The requested shader object, or nullptr if the shader doesn't exist.
+            \return The requested shader object, or nullptr if the shader doesn't exist or the active version is still compiling and there's no fallback version.
         */
         const Shader* getShader(ShaderType type) const;
 
-        /** Get the API handle of the active program
+        /** Get the API handle of the active program.
+            In asynchronous compilation mode, if the active version is still being compiled this returns the fallback version, or nullptr if no fallback was set. The caller should skip the draw in that case.
         */
         ProgramVersion::SharedConstPtr getActiveProgramVersion() const;
 
+        /** Program version compilation mode
+        */
+        enum class CompilationMode
+        {
+            Synchronous,    ///< New versions are compiled and linked inside getActiveProgramVersion(). This is the default.
+            Asynchronous,   ///< New versions are pre-processed and compiled on background threads. getActiveProgramVersion() returns the fallback version until they are ready, and for versions which failed to compile until reloadAllPrograms() is called.
+        };
+
+        /** Set the compilation mode. With the OpenGL backend only pre-processing runs in the background, since GL objects must be created on the thread which owns the context.
+        */
+        void setCompilationMode(CompilationMode mode) { mCompilationMode = mode; }
+
+        /** Get the compilation mode
+        */
+        CompilationMode getCompilationMode() const { return mCompilationMode; }
+
+        /** Set the version getActiveProgramVersion() returns while the requested version is compiled in the background. Pass nullptr to skip draws until the version is ready.
+        */
+        void setFallbackProgramVersion(const ProgramVersion::SharedConstPtr& pFallback) { mpFallbackVersion = pFallback; }
+
+        /** Check if the version matching the current define list was compiled and linked. If this returns false, getActiveProgramVersion() returned the fallback version.
+        */
+        bool isActiveProgramVersionReady() const;
+
+        /** Compile program versions ahead of time, for example during a loading screen. The versions are compiled in parallel on background threads. Versions which already exist are skipped.
+            \param[in] defineLists The define lists to compile. Each list is used as the program's complete define list, it isn't merged with the current one.
+            \param[in] waitForCompletion Optional. If true, blocks until all the versions are ready. Otherwise, getActiveProgramVersion() will pick the versions up once they are ready.
+        */
+        void prewarm(const std::vector<DefineList>& defineLists, bool waitForCompletion = true);
+
         /** Adds a macro definition to the program. If the macro already exists, its will be replaced.
 
             \param[in] name The name of define. Must be valid
@@ -135,34 +169,34 @@ namespace Falcor
 
         /** Clear the macro definition list
         */
-        void clearDefines() { mDefineList.clear(); }
+        void clearDefines();
     
         /** Get the location of an input attribute for the active program version. Note that different versions might return different locations.
             \param[in] Attribute The attribute name in the program
-            \return The index of the attribute if it is found, otherwise CApiProgram#InvalidLocation
+            \return The index of the attribute if it is found, otherwise CApiProgram#InvalidLocation. Also invalid while the active version is still compiling and there's no fallback version
         */
         int32_t getAttributeLocation(const std::string& attribute) const;
 
         /** Get the location of a uniform buffer for the active program version. Note that different versions might return different locations.
             \param[in] Attribute The attribute name in the program
-            \return The index of the attribute if it is found, otherwise CApiProgram#InvalidLocation
+            \return The index of the attribute if it is found, otherwise CApiProgram#InvalidLocation. Also invalid while the active version is still compiling and there's no fallback version
         */
         uint32_t getUniformBufferBinding(const std::string& name) const;
 
         /** Get the macro definition string of the active program version
         */
-        const DefineList& getActiveDefinesList() const { return mDefineList; }
+        const DefineList& getActiveDefinesList() const { return mDefineSets[mActiveDefineSet]; }
 
         std::string getActiveDefinesString() const;
 
-        /** Reload and relink all programs.
+        /** Reload and relink all programs which have modified files or versions which failed to compile.
         */
         static void reloadAllPrograms();
 
         /** Get a uniform-buffer object associated with this program. the function will return one of the following:
             - A new UniformBuffer object if no buffer was associated with bufName
             - An already existing buffer associated with bufName. The existing buffer might have been created using a previous getUniformBuffer() call or bindUniformBuffer() call
-            - nullptr if bufName is not a name of a buffer declared in the program
+            - nullptr if bufName is not a name of a buffer declared in the program, or if the active version is still compiling and there's no fallback version
             Note that setting a new define string will force the creation of a new UniformBuffer object
         */
         UniformBuffer::SharedPtr getUniformBuffer(const std::string& bufName);
@@ -182,13 +216,35 @@ namespace Falcor
         Program();
         static SharedPtr createInternal(const std::string& vs, const std::string& fs, const std::string& gs, const std::string& hs, const std::string& ds, const DefineList& programDefines, bool createdFromFile);
         bool link() const;
+        void trackShaderFiles(uint32_t shaderIndex, const Shader* pShader) const;
         std::string mShaderStrings[kShaderCount]; // Either a filename or a string, depending on the value of mCreatedFromFile
 
-        DefineList mDefineList;
+        // Define lists are interned into define sets, so switching versions is an array lookup instead of a comparison of define lists.
+        // Adding or removing a define is cached as a transition between sets.
+        using DefineSetId = uint32_t;
+        struct DefineListHash
+        {
+            size_t operator()(const DefineList& defines) const;
+        };
+        struct DefineTransition
+        {
+            DefineSetId source;
+            bool add;
+            DefineSetId target;
+            std::string name;
+            std::string value;
+        };
+        std::deque<DefineList> mDefineSets;     // Indexed by DefineSetId. A deque, so that references returned by getActiveDefinesList() stay valid
+        std::unordered_map<DefineList, DefineSetId, DefineListHash> mDefineSetIds;
+        std::unordered_map<size_t, DefineTransition> mDefineTransitions;
+        DefineSetId mActiveDefineSet = 0;
+        DefineSetId internDefineList(const DefineList& defines);
+        DefineSetId applyDefineTransition(bool add, const std::string& name, const std::string& value);
 
         // We are doing lazy compilation, so these are mutable
         mutable bool mLinkRequired = true;
-        mutable std::map<const DefineList, ProgramVersion::SharedConstPtr> mProgramVersions;
+        mutable std::vector<ProgramVersion::SharedConstPtr> mProgramVersions;  // Indexed by DefineSetId
+        ProgramVersion::SharedConstPtr findProgramVersion(DefineSetId defineSet) const;
         mutable ProgramVersion::SharedConstPtr mpActiveProgram = nullptr;
         mutable std::map<const std::string, UniformBuffer::SharedPtr> mUboMap;
 
@@ -199,6 +255,17 @@ namespace Falcor
         using string_time_map = std::unordered_map<std::string, time_t>;
         mutable string_time_map mFileTimeMap;
 
+        CompilationMode mCompilationMode = CompilationMode::Synchronous;
+        ProgramVersion::SharedConstPtr mpFallbackVersion;
+
+        struct AsyncCompilation;
+        using AsyncCompilationPtr = std::shared_ptr<AsyncCompilation>;
+        mutable std::unordered_map<DefineSetId, AsyncCompilationPtr> mPendingVersions;
+        mutable std::unordered_set<DefineSetId> mFailedVersions;   // Not compiled again until the program is reset
+        AsyncCompilationPtr startAsyncCompilation(DefineSetId defineSet) const;
+        ProgramVersion::SharedConstPtr finishAsyncCompilation(AsyncCompilationPtr pCompilation) const;
+        static void compileInBackground(AsyncCompilation* pCompilation);
+
         bool checkIfFilesChanged();
         void reset();
     };
@@ -0,0 +1,226 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ResidencyManager.h"
+#include "TextureCache.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    ResidencyManager::EntryMap ResidencyManager::sEntries;
+    ResidencyTracker ResidencyManager::sTracker;
+    uint64_t ResidencyManager::sBudget = 0;
+    float ResidencyManager::sHysteresis = 0.1f;
+    uint32_t ResidencyManager::sResidentTextures = 0;
+    uint32_t ResidencyManager::sResidentBuffers = 0;
+    ResidencyManager::Stats ResidencyManager::sCurrentStats;
+    ResidencyManager::Stats ResidencyManager::sFrameStats;
+
+    ResidencyManager::Entry& ResidencyManager::getTextureEntry(const Texture* pTexture)
+    {
+        auto it = sEntries.find(pTexture);
+        if(it != sEntries.end() && it->second.pTexture.expired())
+        {
+            // The texture was released and another one was created at the same address
+            removeEntry(it);
+            it = sEntries.end();
+        }
+
+        if(it == sEntries.end())
+        {
+            Entry entry;
+            entry.pTexture = pTexture->shared_from_this();
+            entry.isTexture = true;
+            entry.size = TextureCache::getTextureSize(pTexture);
+            it = sEntries.insert(std::make_pair((const void*)pTexture, entry)).first;
+            sResidentTextures++;
+            sCurrentStats.loadedCount++;
+            sCurrentStats.loadedBytes += entry.size;
+        }
+        return it->second;
+    }
+
+    ResidencyManager::Entry& ResidencyManager::getBufferEntry(const Buffer* pBuffer)
+    {
+        auto it = sEntries.find(pBuffer);
+        if(it != sEntries.end() && it->second.pBuffer.expired())
+        {
+            removeEntry(it);
+            it = sEntries.end();
+        }
+
+        if(it == sEntries.end())
+        {
+            Entry entry;
+            entry.pBuffer = pBuffer->shared_from_this();
+            entry.size = pBuffer->getSize();
+            it = sEntries.insert(std::make_pair((const void*)pBuffer, entry)).first;
+            sResidentBuffers++;
+            sCurrentStats.loadedCount++;
+            sCurrentStats.loadedBytes += entry.size;
+        }
+        return it->second;
+    }
+
+    void ResidencyManager::removeEntry(EntryMap::iterator it)
+    {
+        const Entry& entry = it->second;
+        sTracker.remove(it->first);
+        if(entry.isTexture)
+        {
+            sResidentTextures--;
+        }
+        else
+        {
+            sResidentBuffers--;
+        }
+        sEntries.erase(it);
+    }
+
+    uint64_t ResidencyManager::makeTextureResident(const Texture* pTexture, const Sampler* pSampler, uint32_t priority)
+    {
+        Entry& entry = getTextureEntry(pTexture);
+        sTracker.markUsed(pTexture, entry.size, priority);
+
+        if(pSampler)
+        {
+            auto isSampler = [pSampler](const Sampler::SharedConstPtr& pOther) { return pOther.get() == pSampler; };
+            if(std::find_if(entry.samplers.begin(), entry.samplers.end(), isSampler) == entry.samplers.end())
+            {
+                entry.samplers.push_back(pSampler->shared_from_this());
+            }
+        }
+        else
+        {
+            entry.hasDefaultHandle = true;
+        }
+        return pTexture->makeResident(pSampler);
+    }
+
+    void ResidencyManager::makeTextureNonResident(const Texture* pTexture, const Sampler* pSampler)
+    {
+        pTexture->makeNonResident(pSampler);
+
+        auto it = sEntries.find(pTexture);
+        if(it == sEntries.end())
+        {
+            return;
+        }
+
+        Entry& entry = it->second;
+        if(pSampler)
+        {
+            auto isSampler = [pSampler](const Sampler::SharedConstPtr& pOther) { return pOther.get() == pSampler; };
+            entry.samplers.erase(std::remove_if(entry.samplers.begin(), entry.samplers.end(), isSampler), entry.samplers.end());
+        }
+        else
+        {
+            entry.hasDefaultHandle = false;
+        }
+
+        if(entry.samplers.empty() && entry.hasDefaultHandle == false)
+        {
+            removeEntry(it);
+        }
+    }
+
+    uint64_t ResidencyManager::makeBufferResident(const Buffer* pBuffer, Buffer::GpuAccessFlags flags, uint32_t priority)
+    {
+        const Entry& entry = getBufferEntry(pBuffer);
+        sTracker.markUsed(pBuffer, entry.size, priority);
+        return pBuffer->makeResident(flags);
+    }
+
+    void ResidencyManager::makeBufferNonResident(const Buffer* pBuffer)
+    {
+        pBuffer->makeNonResident();
+
+        auto it = sEntries.find(pBuffer);
+        if(it != sEntries.end())
+        {
+            removeEntry(it);
+        }
+    }
+
+    void ResidencyManager::evict(Entry& entry)
+    {
+        Texture::SharedConstPtr pTexture = entry.pTexture.lock();
+        if(pTexture)
+        {
+            if(entry.hasDefaultHandle)
+            {
+                pTexture->makeNonResident(nullptr);
+            }
+            for(const auto& pSampler : entry.samplers)
+            {
+                pTexture->makeNonResident(pSampler.get());
+            }
+        }
+
+        Buffer::SharedConstPtr pBuffer = entry.pBuffer.lock();
+        if(pBuffer)
+        {
+            pBuffer->makeNonResident();
+        }
+
+        sCurrentStats.evictedCount++;
+        sCurrentStats.evictedBytes += entry.size;
+    }
+
+    void ResidencyManager::endFrame()
+    {
+        // Released resources made their handles non-resident when they were destroyed
+        for(auto it = sEntries.begin(); it != sEntries.end();)
+        {
+            auto next = std::next(it);
+            if(it->second.pTexture.expired() && it->second.pBuffer.expired())
+            {
+                removeEntry(it);
+            }
+            it = next;
+        }
+
+        sCurrentStats.usedBytes = sTracker.getUsedBytes();
+
+        std::vector<const void*> evicted;
+        sTracker.endFrame(sBudget, sHysteresis, evicted);
+        for(const void* pResource : evicted)
+        {
+            auto it = sEntries.find(pResource);
+            evict(it->second);
+            removeEntry(it);
+        }
+
+        sCurrentStats.budget = sBudget;
+        sCurrentStats.residentBytes = sTracker.getResidentBytes();
+        sCurrentStats.residentTextures = sResidentTextures;
+        sCurrentStats.residentBuffers = sResidentBuffers;
+        sFrameStats = sCurrentStats;
+        sCurrentStats = Stats();
+    }
+}
@@ -0,0 +1,131 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <unordered_map>
+#include <vector>
+#include "Core/Texture.h"
+#include "Core/Buffer.h"
+#include "Core/Sampler.h"
+#include "Utils/ResidencyTracker.h"
+
+namespace Falcor
+{
+    /** Keeps the bindless textures and buffers within a GPU memory budget.\n
+        Instead of calling Texture::makeResident() and Buffer::makeResident() directly, code which binds resources through bindless handles can go through the manager. The manager tracks the size of each resource, the last frame it was used in and its priority.\n
+        When the resident resources exceed the budget at the end of a frame, the manager makes resources non-resident until usage drops below the budget minus the hysteresis margin, so that usage hovering around the budget doesn't cause evictions every frame.
+        Lower priority resources are evicted first, then the least-recently-used ones. Resources used in the current frame are never evicted. An evicted resource is made resident again the next time it's requested. The eviction policy is implemented by ResidencyTracker.\n
+        All functions must be called from the main thread.
+    */
+    class ResidencyManager
+    {
+    public:
+        struct Stats
+        {
+            uint64_t budget = 0;            ///< The budget in bytes. 0 means unlimited
+            uint64_t residentBytes = 0;     ///< Memory used by the resident resources at the end of the frame
+            uint32_t residentTextures = 0;
+            uint32_t residentBuffers = 0;
+            uint64_t usedBytes = 0;         ///< Memory used by the resources requested during the frame
+            uint32_t loadedCount = 0;       ///< Number of resources made resident during the frame
+            uint64_t loadedBytes = 0;
+            uint32_t evictedCount = 0;      ///< Number of resources evicted at the end of the frame
+            uint64_t evictedBytes = 0;
+        };
+
+        /** Set the budget.
+            \param[in] bytes The memory budget in bytes. 0 disables eviction
+        */
+        static void setBudget(uint64_t bytes) { sBudget = bytes; }
+        static uint64_t getBudget() { return sBudget; }
+
+        /** Set the hysteresis margin.
+            \param[in] fraction Fraction of the budget. Once over budget, resources are evicted until usage drops below budget * (1 - fraction)
+        */
+        static void setHysteresis(float fraction) { sHysteresis = glm::clamp(fraction, 0.0f, 1.0f); }
+        static float getHysteresis() { return sHysteresis; }
+
+        /** Make a texture resident and mark it as used in the current frame.
+            \param[in] pTexture The texture
+            \param[in] pSampler The sampler to create the handle with. Can be nullptr
+            \param[in] priority Optional. Resources with lower priority are evicted first
+            \return The bindless handle
+        */
+        static uint64_t makeTextureResident(const Texture* pTexture, const Sampler* pSampler, uint32_t priority = 0);
+
+        /** Make a texture's handle non-resident
+        */
+        static void makeTextureNonResident(const Texture* pTexture, const Sampler* pSampler);
+
+        /** Make a buffer resident and mark it as used in the current frame.
+            \param[in] pBuffer The buffer
+            \param[in] flags Optional. The GPU access flags
+            \param[in] priority Optional. Resources with lower priority are evicted first
+            \return The buffer's GPU address
+        */
+        static uint64_t makeBufferResident(const Buffer* pBuffer, Buffer::GpuAccessFlags flags = Buffer::GpuAccessFlags::ReadOnly, uint32_t priority = 0);
+
+        /** Make a buffer non-resident
+        */
+        static void makeBufferNonResident(const Buffer* pBuffer);
+
+        /** Enforce the budget and close the frame. Called by Sample at the end of every frame.
+        */
+        static void endFrame();
+
+        /** Get the statistics of the last completed frame
+        */
+        static const Stats& getFrameStats() { return sFrameStats; }
+
+    private:
+        struct Entry
+        {
+            std::weak_ptr<const Texture> pTexture;
+            std::weak_ptr<const Buffer> pBuffer;
+            std::vector<Sampler::SharedConstPtr> samplers;  ///< The samplers of the texture's resident handles
+            bool hasDefaultHandle = false;                  ///< Whether the texture has a resident handle without a sampler
+            bool isTexture = false;
+            uint64_t size = 0;
+        };
+
+        using EntryMap = std::unordered_map<const void*, Entry>;
+
+        static Entry& getTextureEntry(const Texture* pTexture);
+        static Entry& getBufferEntry(const Buffer* pBuffer);
+        static void removeEntry(EntryMap::iterator it);
+        static void evict(Entry& entry);
+
+        static EntryMap sEntries;
+        static ResidencyTracker sTracker;
+        static uint64_t sBudget;
+        static float sHysteresis;
+        static uint32_t sResidentTextures;
+        static uint32_t sResidentBuffers;
+        static Stats sCurrentStats;
+        static Stats sFrameStats;
+    };
+}
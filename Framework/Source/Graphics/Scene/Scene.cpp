@@ -28,6 +28,7 @@
 #include "Framework.h"
 #include "Scene.h"
 #include "SceneImporter.h"
+#include "SceneSnapshot.h"
 #include "glm/gtx/euler_angles.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 
@@ -44,6 +45,16 @@ namespace Falcor
         return SceneImporter::loadScene(filename, modelLoadFlags, sceneLoadFlags);
     }
 
+    Scene::SharedPtr Scene::loadSnapshot(const std::string& filename, uint32_t modelLoadFlags)
+    {
+        return SceneSnapshot::load(filename, modelLoadFlags);
+    }
+
+    bool Scene::saveSnapshot(const std::string& filename) const
+    {
+        return SceneSnapshot::save(filename, this);
+    }
+
     Scene::SharedPtr Scene::create(float cameraAspectRatio)
     {
         return SharedPtr(new Scene(cameraAspectRatio));
@@ -63,6 +74,23 @@ namespace Falcor
 
     Scene::~Scene() = default;
 
+    MemoryTracker::Report Scene::getMemoryReport() const
+    {
+        MemoryTracker::Report report;
+        report.name = "Scene";
+        std::set<const void*> countedResources;
+        for(uint32_t modelID = 0; modelID < getModelCount(); modelID++)
+        {
+            MemoryTracker::Report modelReport = getModel(modelID)->getMemoryReport(&countedResources);
+            if(modelReport.name.empty())
+            {
+                modelReport.name = getModelFilename(modelID);
+            }
+            report.addChild(modelReport);
+        }
+        return report;
+    }
+
     bool Scene::updateCamera(double currentTime, CameraController* cameraController)
     {
         auto pCamera = getActiveCamera();
@@ -296,6 +324,18 @@ namespace Falcor
 		}
 	}
 
+    void Scene::shareModelMaterials()
+    {
+        Model::MaterialIndex materialIndex;
+        for(auto& model : mModels)
+        {
+            if(model.pModel)
+            {
+                model.pModel->shareMaterials(materialIndex);
+            }
+        }
+    }
+
 	void Scene::deleteAreaLights()
 	{
 		// Clean up the list before adding
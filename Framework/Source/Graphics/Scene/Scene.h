@@ -102,11 +102,26 @@ namespace Falcor
 		{
 			None,
 			GenerateAreaLights = 1,    ///< Create area light(s) for meshes that have emissive material
+			ShareMaterials = 2,        ///< Models share equal materials, see shareModelMaterials()
 		};
 
         static Scene::SharedPtr loadFromFile(const std::string& filename, const uint32_t& modelLoadFlags, uint32_t sceneLoadFlags = 0);
         static Scene::SharedPtr create(float cameraAspectRatio = 1.0f);
 
+        /** Load a scene saved with saveSnapshot()
+            \param[in] filename The snapshot file
+            \param[in] modelLoadFlags Used for the models which are re-imported from their source files (models with bones or animations)
+            \return A new scene, or nullptr if the file is not a valid snapshot
+        */
+        static Scene::SharedPtr loadSnapshot(const std::string& filename, uint32_t modelLoadFlags = 0);
+
+        /** Save the fully resolved scene into a single binary file, which loads much faster than the scene file. See SceneSnapshot for the format.
+            Snapshots are a cache - they are bound to the framework version which created them, and should be recreated from the scene file when loading fails.
+            \param[in] filename The snapshot file
+            \return true on success
+        */
+        bool saveSnapshot(const std::string& filename) const;
+
         ~Scene();
 
         // Models
@@ -117,6 +132,14 @@ namespace Falcor
         const Model::SharedPtr& getModel(uint32_t index) const { return mModels[index].pModel; }
         const std::string& getModelFilename(uint32_t index) const { return mModels[index].Filename; }
 
+        /** Replace a model, keeping its filename and instances. Used to move models in and out of memory, see SceneStreamer
+        */
+        void setModel(uint32_t modelID, const Model::SharedPtr& pModel) { mModels[modelID].pModel = pModel; }
+
+        /** Get a report of the memory used by the scene's models. Buffers and textures shared between models are counted once, in the first model using them
+        */
+        MemoryTracker::Report getMemoryReport() const;
+
         // Model instances
         uint32_t getModelInstanceCount(uint32_t modelID) const { return (uint32_t)mModels[modelID].instances.size(); }
         const ModelInstance& getModelInstance(uint32_t modelID, uint32_t instanceID) const { return mModels[modelID].instances[instanceID]; }
@@ -195,6 +218,10 @@ namespace Falcor
 		*/
 		void createAreaLights();
 
+        /** Replace equal materials in different models with a single material object. Materials are found using their hash, so this is linear in the number of materials
+        */
+        void shareModelMaterials();
+
 		/**
 		    This routine deletes area light(s) from the scene.
 		*/
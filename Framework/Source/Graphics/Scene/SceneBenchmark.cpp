@@ -0,0 +1,415 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneBenchmark.h"
+#include "Utils/OS.h"
+#include "Utils/CpuTimer.h"
+#include "Graphics/TextureCache.h"
+#include "Externals/RapidJson/include/rapidjson/document.h"
+#include "Externals/RapidJson/include/rapidjson/stringbuffer.h"
+#include "Externals/RapidJson/include/rapidjson/prettywriter.h"
+#include <fstream>
+#include <sstream>
+
+namespace Falcor
+{
+    const char* SceneBenchmark::kAnimateStage = "sceneAnimate";
+    const char* SceneBenchmark::kCullStage = "sceneCull";
+    const char* SceneBenchmark::kDrawListStage = "sceneBuildDrawList";
+    const char* SceneBenchmark::kRenderStage = "sceneRender";
+
+    namespace
+    {
+        void writeTimingStats(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, const char* key, const Profiler::TimingStats& stats)
+        {
+            writer.Key(key);
+            writer.StartObject();
+            writer.Key("min");  writer.Double(stats.minMs);
+            writer.Key("mean"); writer.Double(stats.meanMs);
+            writer.Key("p95");  writer.Double(stats.p95Ms);
+            writer.Key("p99");  writer.Double(stats.p99Ms);
+            writer.Key("max");  writer.Double(stats.maxMs);
+            writer.EndObject();
+        }
+
+        bool readTimingStats(const rapidjson::Value& jsonStage, const char* key, Profiler::TimingStats& stats)
+        {
+            if(jsonStage.HasMember(key) == false || jsonStage[key].IsObject() == false)
+            {
+                return false;
+            }
+
+            const rapidjson::Value& jsonStats = jsonStage[key];
+            const char* names[] = {"min", "mean", "p95", "p99", "max"};
+            float* values[] = {&stats.minMs, &stats.meanMs, &stats.p95Ms, &stats.p99Ms, &stats.maxMs};
+            for(uint32_t i = 0; i < arraysize(names); i++)
+            {
+                if(jsonStats.HasMember(names[i]) == false || jsonStats[names[i]].IsNumber() == false)
+                {
+                    return false;
+                }
+                *values[i] = (float)jsonStats[names[i]].GetDouble();
+            }
+            return true;
+        }
+
+        void compareStats(const std::string& stage, const char* metric, float baselineMs, float currentMs, float tolerance, float minDeltaMs, std::vector<SceneBenchmark::Regression>& regressions)
+        {
+            if((currentMs > baselineMs * (1 + tolerance)) && (currentMs - baselineMs > minDeltaMs))
+            {
+                SceneBenchmark::Regression regression = {stage, metric, baselineMs, currentMs};
+                regressions.push_back(regression);
+            }
+        }
+    }
+
+    SceneBenchmark::UniquePtr SceneBenchmark::create(const Scene::SharedPtr& pScene, const Desc& desc)
+    {
+        return UniquePtr(new SceneBenchmark(pScene, desc));
+    }
+
+    SceneBenchmark::SceneBenchmark(const Scene::SharedPtr& pScene, const Desc& desc) : mpScene(pScene), mDesc(desc)
+    {
+        mpSceneRenderer = SceneRenderer::create(pScene);
+        mpSceneRenderer->setObjectCullState(desc.cullEnabled);
+        mpSceneRenderer->setMaxInstanceCount(max(desc.maxInstanceCount, 1u));
+
+        mpAnimateEvent = Profiler::getEvent(HashedString(kAnimateStage));
+        mpCullEvent = Profiler::getEvent(HashedString(kCullStage));
+        mpDrawListEvent = Profiler::getEvent(HashedString(kDrawListStage));
+        mpRenderEvent = Profiler::getEvent(HashedString(kRenderStage));
+    }
+
+    void SceneBenchmark::runFrame(uint32_t frameID, uint32_t& visibleInstances, uint32_t& drawCount)
+    {
+        // The time only depends on the frame index, never on the wall clock
+        double currentTime = mDesc.startTime + frameID * mDesc.timeStep;
+
+        {
+            ProfilerEvent event(mpAnimateEvent);
+            for(uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+            {
+                mpScene->getModel(modelID)->animate(currentTime);
+            }
+            // No camera controller, so user input can't move the camera
+            mpScene->updateCamera(currentTime, nullptr);
+        }
+
+        {
+            ProfilerEvent event(mpCullEvent);
+            mpSceneRenderer->cullScene(mpScene->getActiveCamera().get(), mVisibleInstances);
+        }
+
+        {
+            ProfilerEvent event(mpDrawListEvent);
+            mpSceneRenderer->buildDrawList(mVisibleInstances, mDrawList);
+        }
+
+        if(mRenderFunc)
+        {
+            ProfilerEvent event(mpRenderEvent);
+            mRenderFunc(currentTime, mDrawList);
+        }
+
+        visibleInstances = (uint32_t)mVisibleInstances.size();
+        drawCount = (uint32_t)mDrawList.draws.size();
+    }
+
+    bool SceneBenchmark::run(Results& results)
+    {
+        if(mDesc.measuredFrames == 0 || mDesc.timeStep <= 0)
+        {
+            Logger::log(Logger::Level::Error, "SceneBenchmark::run() - the benchmark needs at least one measured frame and a positive time step");
+            return false;
+        }
+
+        uint32_t prevPathID = mpScene->getActivePathIndex();
+        if(mDesc.pathID != Scene::kFreeCameraMovement)
+        {
+            if(mDesc.pathID >= mpScene->getPathCount())
+            {
+                Logger::log(Logger::Level::Error, "SceneBenchmark::run() - path " + std::to_string(mDesc.pathID) + " doesn't exist. The scene has " + std::to_string(mpScene->getPathCount()) + " paths");
+                return false;
+            }
+            mpScene->setActivePath(mDesc.pathID);
+        }
+        else if(mpScene->getActivePath() == nullptr)
+        {
+            Logger::log(Logger::Level::Warning, "SceneBenchmark::run() - the scene has no active path. The camera will not move");
+        }
+
+        // Take over the profiler for the duration of the run
+        bool prevProfileEnabled = gProfileEnabled;
+        bool prevGpuTiming = Profiler::isGpuTimingEnabled();
+        uint32_t prevHistorySize = Profiler::getHistorySize();
+        gProfileEnabled = true;
+        Profiler::setGpuTimingEnabled(prevGpuTiming && mRenderFunc);
+        Profiler::setHistorySize(mDesc.measuredFrames);
+
+        std::string profileResults;
+        uint32_t visibleInstances;
+        uint32_t drawCount;
+        for(uint32_t frameID = 0; frameID < mDesc.warmupFrames; frameID++)
+        {
+            runFrame(frameID, visibleInstances, drawCount);
+            Profiler::endFrame(profileResults);
+        }
+
+        // Drop the warm-up frames from the history. Note that the GPU times lag by a frame, see Profiler::endFrame()
+        Profiler::clearEvents();
+        results = Results();
+        results.frameCount = mDesc.measuredFrames;
+        results.timeStep = mDesc.timeStep;
+        results.visibleInstances.resize(mDesc.measuredFrames);
+        results.drawCount.resize(mDesc.measuredFrames);
+        for(uint32_t i = 0; i < mDesc.measuredFrames; i++)
+        {
+            runFrame(mDesc.warmupFrames + i, results.visibleInstances[i], results.drawCount[i]);
+            Profiler::endFrame(profileResults);
+        }
+
+        // Collect the stage timings
+        std::vector<Profiler::EventStats> eventStats = Profiler::getEventStats();
+        const Profiler::EventData* stageEvents[] = {mpAnimateEvent, mpCullEvent, mpDrawListEvent, mpRenderEvent};
+        for(const Profiler::EventData* pEvent : stageEvents)
+        {
+            for(const auto& stats : eventStats)
+            {
+                if(stats.name == pEvent->name)
+                {
+                    StageResult stage;
+                    stage.name = stats.name;
+                    stage.cpu = stats.cpu;
+                    stage.gpu = stats.gpu;
+                    stage.hasGpuTime = stats.hasGpuTime;
+                    Profiler::getEventHistory(stats.name, stage.cpuMs, stage.gpuMs);
+                    results.stages.push_back(stage);
+                }
+            }
+        }
+
+        Profiler::setHistorySize(prevHistorySize);
+        Profiler::setGpuTimingEnabled(prevGpuTiming);
+        gProfileEnabled = prevProfileEnabled;
+        mpScene->setActivePath(prevPathID);
+        return true;
+    }
+
+    bool SceneBenchmark::writeCsv(const Results& results, const std::string& filename)
+    {
+        std::ofstream outputStream(filename.c_str());
+        if(outputStream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Can't open benchmark output file " + filename);
+            return false;
+        }
+
+        outputStream << "frame,time,visibleInstances,draws";
+        for(const auto& stage : results.stages)
+        {
+            outputStream << "," << stage.name << "_cpu_ms";
+            if(stage.hasGpuTime)
+            {
+                outputStream << "," << stage.name << "_gpu_ms";
+            }
+        }
+        outputStream << "\n";
+
+        for(uint32_t frameID = 0; frameID < results.frameCount; frameID++)
+        {
+            outputStream << frameID << "," << frameID * results.timeStep << "," << results.visibleInstances[frameID] << "," << results.drawCount[frameID];
+            for(const auto& stage : results.stages)
+            {
+                outputStream << "," << stage.cpuMs[frameID];
+                if(stage.hasGpuTime)
+                {
+                    outputStream << "," << stage.gpuMs[frameID];
+                }
+            }
+            outputStream << "\n";
+        }
+        return true;
+    }
+
+    bool SceneBenchmark::writeJson(const Results& results, const std::string& filename)
+    {
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        writer.SetIndent(' ', 4);
+
+        writer.StartObject();
+        writer.Key("frame_count");
+        writer.Uint(results.frameCount);
+        writer.Key("time_step");
+        writer.Double(results.timeStep);
+        writer.Key("stages");
+        writer.StartArray();
+        for(const auto& stage : results.stages)
+        {
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(stage.name.c_str());
+            writeTimingStats(writer, "cpu", stage.cpu);
+            if(stage.hasGpuTime)
+            {
+                writeTimingStats(writer, "gpu", stage.gpu);
+            }
+            writer.EndObject();
+        }
+        writer.EndArray();
+        writer.EndObject();
+
+        std::ofstream outputStream(filename.c_str());
+        if(outputStream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Can't open benchmark output file " + filename);
+            return false;
+        }
+        outputStream << std::string(buffer.GetString(), buffer.GetSize());
+        return true;
+    }
+
+    bool SceneBenchmark::loadBaseline(const std::string& filename, Results& baseline)
+    {
+        std::ifstream fileStream(filename.c_str());
+        if(fileStream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Can't open benchmark baseline " + filename);
+            return false;
+        }
+        std::stringstream strStream;
+        strStream << fileStream.rdbuf();
+        std::string jsonData = strStream.str();
+
+        rapidjson::Document jdoc;
+        rapidjson::StringStream jStream(jsonData.c_str());
+        jdoc.ParseStream(jStream);
+        if(jdoc.HasParseError() || jdoc.IsObject() == false || jdoc.HasMember("stages") == false || jdoc["stages"].IsArray() == false)
+        {
+            Logger::log(Logger::Level::Error, "Benchmark baseline " + filename + " is not a valid benchmark file");
+            return false;
+        }
+
+        baseline = Results();
+        if(jdoc.HasMember("frame_count") && jdoc["frame_count"].IsUint())
+        {
+            baseline.frameCount = jdoc["frame_count"].GetUint();
+        }
+        if(jdoc.HasMember("time_step") && jdoc["time_step"].IsNumber())
+        {
+            baseline.timeStep = jdoc["time_step"].GetDouble();
+        }
+
+        const rapidjson::Value& jsonStages = jdoc["stages"];
+        for(rapidjson::SizeType i = 0; i < jsonStages.Size(); i++)
+        {
+            const rapidjson::Value& jsonStage = jsonStages[i];
+            StageResult stage;
+            if(jsonStage.IsObject() == false || jsonStage.HasMember("name") == false || jsonStage["name"].IsString() == false || readTimingStats(jsonStage, "cpu", stage.cpu) == false)
+            {
+                Logger::log(Logger::Level::Error, "Benchmark baseline " + filename + " has an invalid stage entry");
+                return false;
+            }
+            stage.name = jsonStage["name"].GetString();
+            stage.hasGpuTime = readTimingStats(jsonStage, "gpu", stage.gpu);
+            baseline.stages.push_back(stage);
+        }
+        return true;
+    }
+
+    std::vector<SceneBenchmark::Regression> SceneBenchmark::compare(const Results& current, const Results& baseline, const Thresholds& thresholds)
+    {
+        std::vector<Regression> regressions;
+        if(current.timeStep != baseline.timeStep)
+        {
+            Logger::log(Logger::Level::Warning, "SceneBenchmark::compare() - the baseline was recorded with a different time step, so the frames don't match");
+        }
+
+        for(const auto& baseStage : baseline.stages)
+        {
+            const StageResult* pStage = nullptr;
+            for(const auto& stage : current.stages)
+            {
+                if(stage.name == baseStage.name)
+                {
+                    pStage = &stage;
+                }
+            }
+
+            if(pStage == nullptr)
+            {
+                Logger::log(Logger::Level::Warning, "SceneBenchmark::compare() - stage " + baseStage.name + " is in the baseline but wasn't measured");
+                continue;
+            }
+
+            compareStats(baseStage.name, "cpu.mean", baseStage.cpu.meanMs, pStage->cpu.meanMs, thresholds.meanTolerance, thresholds.minDeltaMs, regressions);
+            compareStats(baseStage.name, "cpu.p95", baseStage.cpu.p95Ms, pStage->cpu.p95Ms, thresholds.p95Tolerance, thresholds.minDeltaMs, regressions);
+            if(baseStage.hasGpuTime && pStage->hasGpuTime)
+            {
+                compareStats(baseStage.name, "gpu.mean", baseStage.gpu.meanMs, pStage->gpu.meanMs, thresholds.meanTolerance, thresholds.minDeltaMs, regressions);
+                compareStats(baseStage.name, "gpu.p95", baseStage.gpu.p95Ms, pStage->gpu.p95Ms, thresholds.p95Tolerance, thresholds.minDeltaMs, regressions);
+            }
+        }
+        return regressions;
+    }
+
+    bool SceneBenchmark::measureLoadTimes(const std::string& sceneFile, const std::string& snapshotFile, uint32_t modelLoadFlags, uint32_t sceneLoadFlags, uint32_t iterations, LoadTimes& times)
+    {
+        times = LoadTimes();
+        if(doesFileExist(snapshotFile) == false)
+        {
+            Scene::SharedPtr pScene = Scene::loadFromFile(sceneFile, modelLoadFlags, sceneLoadFlags);
+            if(pScene == nullptr || pScene->saveSnapshot(snapshotFile) == false)
+            {
+                return false;
+            }
+        }
+
+        // Alternate between the sources, so both see the same system state
+        for(uint32_t i = 0; i < iterations; i++)
+        {
+            for(uint32_t source = 0; source < 2; source++)
+            {
+                TextureCache::clear();
+                CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+                Scene::SharedPtr pScene = (source == 0) ? Scene::loadFromFile(sceneFile, modelLoadFlags, sceneLoadFlags) : Scene::loadSnapshot(snapshotFile, modelLoadFlags);
+                float durationMs = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+                if(pScene == nullptr)
+                {
+                    return false;
+                }
+                ((source == 0) ? times.sceneFileMs : times.snapshotMs).push_back(durationMs);
+            }
+        }
+
+        times.sceneFile = Profiler::computeTimingStats(times.sceneFileMs);
+        times.snapshot = Profiler::computeTimingStats(times.snapshotMs);
+        Logger::log(Logger::Level::Info, "Load time of " + sceneFile + ": " + std::to_string(times.sceneFile.meanMs) + "ms from the scene file, " + std::to_string(times.snapshot.meanMs) + "ms from the snapshot (mean of " + std::to_string(iterations) + " loads)");
+        return true;
+    }
+}
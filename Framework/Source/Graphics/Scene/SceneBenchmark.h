@@ -0,0 +1,181 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <functional>
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/Scene/SceneRenderer.h"
+#include "Utils/Profiler.h"
+
+namespace Falcor
+{
+    /** Deterministic, headless scene benchmark.
+        Plays a camera path with a fixed time step, so every run processes exactly the same frames, and records the per-frame timings of the CPU stages (animation, culling, draw-list build) through the Profiler.
+        The CPU stages don't touch the graphics device, so the benchmark can run without a window. An optional render callback adds a GPU stage.
+        The results can be written to CSV/JSON, and compared against a stored baseline.
+    */
+    class SceneBenchmark
+    {
+    public:
+        using UniquePtr = std::unique_ptr<SceneBenchmark>;
+
+        /** Called once per frame, after the CPU stages. Use it to render the scene when benchmarking the GPU.
+            \param[in] currentTime The deterministic frame time
+            \param[in] drawList The draws the CPU stages produced for this frame
+        */
+        using RenderFunc = std::function<void(double currentTime, const SceneRenderer::DrawList& drawList)>;
+
+        struct Desc
+        {
+            uint32_t warmupFrames = 30;                     ///< Frames which are executed but not measured
+            uint32_t measuredFrames = 300;
+            double timeStep = 1.0 / 60.0;                   ///< Scene time advanced per frame, in seconds
+            double startTime = 0;
+            uint32_t pathID = Scene::kFreeCameraMovement;   ///< The camera path to play. Scene::kFreeCameraMovement uses the scene's active path
+            bool cullEnabled = true;
+            uint32_t maxInstanceCount = 64;                 ///< Max instances per draw, see SceneRenderer::setMaxInstanceCount()
+        };
+
+        /** Per-frame timings and statistics of a single stage
+        */
+        struct StageResult
+        {
+            std::string name;
+            std::vector<float> cpuMs;
+            std::vector<float> gpuMs;
+            Profiler::TimingStats cpu;
+            Profiler::TimingStats gpu;
+            bool hasGpuTime = false;
+        };
+
+        struct Results
+        {
+            uint32_t frameCount = 0;
+            double timeStep = 0;
+            std::vector<uint32_t> visibleInstances;     ///< Per frame. Identical between runs of the same scene and desc
+            std::vector<uint32_t> drawCount;            ///< Per frame
+            std::vector<StageResult> stages;
+        };
+
+        /** Relative tolerances used by compare()
+        */
+        struct Thresholds
+        {
+            float meanTolerance = 0.05f;    ///< Allowed increase of the mean time, as a fraction of the baseline
+            float p95Tolerance = 0.1f;      ///< Allowed increase of the 95th percentile
+            float minDeltaMs = 0.01f;       ///< Differences smaller than this are timer noise, and never reported
+        };
+
+        struct Regression
+        {
+            std::string stage;
+            std::string metric;     ///< "cpu.mean", "cpu.p95", "gpu.mean" or "gpu.p95"
+            float baselineMs;
+            float currentMs;
+        };
+
+        /** Cold-start load times of a scene, from its scene file and from a snapshot of it
+        */
+        struct LoadTimes
+        {
+            std::vector<float> sceneFileMs;     ///< Per iteration
+            std::vector<float> snapshotMs;      ///< Per iteration
+            Profiler::TimingStats sceneFile;
+            Profiler::TimingStats snapshot;
+        };
+
+        /** Names of the Profiler events of the benchmark stages
+        */
+        static const char* kAnimateStage;
+        static const char* kCullStage;
+        static const char* kDrawListStage;
+        static const char* kRenderStage;
+
+        /** Create a new benchmark.
+            \param[in] pScene The scene to benchmark
+            \param[in] desc The benchmark settings
+        */
+        static UniquePtr create(const Scene::SharedPtr& pScene, const Desc& desc);
+
+        /** Set the callback which renders a frame. Without one, the benchmark only runs the CPU stages and disables GPU timing, so it doesn't require a graphics device.
+        */
+        void setRenderFunc(const RenderFunc& renderFunc) { mRenderFunc = renderFunc; }
+
+        /** Run the warm-up and measured frames.
+            Resets the Profiler's event history. The Profiler settings are restored when the run ends.
+            \param[out] results The timings of the measured frames
+            \return false if the desc is invalid for the scene
+        */
+        bool run(Results& results);
+
+        /** Write the per-frame timings as CSV, one line per frame
+        */
+        static bool writeCsv(const Results& results, const std::string& filename);
+
+        /** Write the per-stage statistics as JSON. The file can be loaded as a baseline with loadBaseline()
+        */
+        static bool writeJson(const Results& results, const std::string& filename);
+
+        /** Load the statistics written by writeJson(). The per-frame timings are not stored in the file, so only the stage statistics are loaded.
+        */
+        static bool loadBaseline(const std::string& filename, Results& baseline);
+
+        /** Compare the mean and 95th percentile of every stage against the baseline.
+            \return The stages which got slower by more than the tolerance. Empty if there are no regressions
+        */
+        static std::vector<Regression> compare(const Results& current, const Results& baseline, const Thresholds& thresholds);
+
+        /** Measure how long loading a scene takes from its scene file and from a snapshot (see Scene::saveSnapshot()).
+            The texture cache is cleared before every load, so loads don't reuse each other's textures. The OS file cache is not flushed, so only the first iteration reads from disk.
+            \param[in] sceneFile The scene file
+            \param[in] snapshotFile The snapshot file. If it doesn't exist, it is created from the scene file
+            \param[in] modelLoadFlags Flags passed to Scene::loadFromFile() and Scene::loadSnapshot()
+            \param[in] sceneLoadFlags Flags passed to Scene::loadFromFile()
+            \param[in] iterations The number of times the scene is loaded from each file
+            \param[out] times The load times
+            \return false if one of the loads failed
+        */
+        static bool measureLoadTimes(const std::string& sceneFile, const std::string& snapshotFile, uint32_t modelLoadFlags, uint32_t sceneLoadFlags, uint32_t iterations, LoadTimes& times);
+
+    private:
+        SceneBenchmark(const Scene::SharedPtr& pScene, const Desc& desc);
+        void runFrame(uint32_t frameID, uint32_t& visibleInstances, uint32_t& drawCount);
+
+        Scene::SharedPtr mpScene;
+        SceneRenderer::UniquePtr mpSceneRenderer;
+        Desc mDesc;
+        RenderFunc mRenderFunc;
+        std::vector<SceneRenderer::VisibleMeshInstance> mVisibleInstances;
+        SceneRenderer::DrawList mDrawList;
+        Profiler::EventData* mpAnimateEvent;
+        Profiler::EventData* mpCullEvent;
+        Profiler::EventData* mpDrawListEvent;
+        Profiler::EventData* mpRenderEvent;
+    };
+}
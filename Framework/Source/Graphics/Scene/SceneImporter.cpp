@@ -35,9 +35,12 @@
 #include "Graphics/TextureHelper.h"
 #include "glm/detail/func_trigonometric.hpp"
 #include "SceneExportImportCommon.h"
+#include <map>
 
 namespace Falcor
 {
+    static const uint32_t kInvalidModelID = uint32_t(-1);
+
     template<uint32_t VecSize>
     bool SceneImporter::getFloatVec(const rapidjson::Value& jsonVal, const std::string& desc, float vec[VecSize])
     {
@@ -149,30 +152,18 @@ namespace Falcor
         return true;
     }
 
-    bool SceneImporter::createModel(const rapidjson::Value& jsonModel)
+    bool SceneImporter::createModel(const rapidjson::Value& jsonModel, const Model::SharedPtr& pModel, uint32_t& modelID)
     {
-        // Model must have at least a filename
-        if(jsonModel.HasMember(SceneKeys::kFilename) == false)
-        {
-            error("Model must have a filename");
-            return false;
-        }
-        const auto& modelFile = jsonModel[SceneKeys::kFilename];
-        if(modelFile.IsString() == false)
-        {
-            error("Model filename must be a string");
-            return false;
-        }
+        const std::string modelFile = jsonModel[SceneKeys::kFilename].GetString();
 
-        // Load the model
-        auto pModel = Model::createFromFile(modelFile.GetString(), mModelLoadFlags);
-        if(pModel == nullptr)
+        // The first entry which references a file adds the model to the scene. Later entries only add instances to it
+        const bool isShared = (modelID != kInvalidModelID);
+        if(isShared == false)
         {
-            return false;
+            pModel->setName(modelFile);
+            modelID = mpScene->addModel(pModel, modelFile, false);
         }
-
-        pModel->setName(modelFile.GetString());
-        uint32_t modelID = mpScene->addModel(pModel, modelFile.GetString(), false);
+        const uint32_t firstInstance = mpScene->getModelInstanceCount(modelID);
 
         // Loop over the other members
         for(auto& jval = jsonModel.MemberBegin(); jval != jsonModel.MemberEnd(); jval++)
@@ -189,7 +180,15 @@ namespace Falcor
                     error("Model name should be a string value.");
                     return false;
                 }
-                pModel->setName(std::string(jval->value.GetString()));
+                std::string name(jval->value.GetString());
+                if(isShared == false)
+                {
+                    pModel->setName(name);
+                }
+                else if(name != pModel->getName())
+                {
+                    Logger::log(Logger::Level::Warning, "Scene file \"" + mFilename + "\" references model file " + modelFile + " more than once. The model is shared and keeps the name " + pModel->getName() + ", ignoring the name " + name);
+                }
             }
             else if(keyName == SceneKeys::kModelInstances)
             {
@@ -212,6 +211,10 @@ namespace Falcor
                     msg += ", but model only has " + std::to_string(pModel->getAnimationsCount()) + " animations. Ignoring field";
                     Logger::log(Logger::Level::Warning, msg);
                 }
+                else if(isShared && (activeAnimation != pModel->getActiveAnimation()))
+                {
+                    Logger::log(Logger::Level::Warning, "Scene file \"" + mFilename + "\" references model file " + modelFile + " more than once with different active animations. The model is shared, ignoring active animation " + std::to_string(activeAnimation));
+                }
                 else
                 {
                     pModel->setActiveAnimation(activeAnimation);
@@ -224,9 +227,10 @@ namespace Falcor
             }
         }
 
-        if(mpScene->getModelInstanceCount(modelID) == 0)
+        if(mpScene->getModelInstanceCount(modelID) == firstInstance)
         {
-            mpScene->addModelInstance(modelID, "Instance 0", glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), glm::vec3(0, 0, 0));
+            std::string name = "Instance " + std::to_string(firstInstance);
+            mpScene->addModelInstance(modelID, name, glm::vec3(0, 0, 0), glm::vec3(1, 1, 1), glm::vec3(0, 0, 0));
         }
         return true;
     }
@@ -239,10 +243,54 @@ namespace Falcor
             return false;
         }
 
-        // Loop over the array
+        // Collect the unique files. Entries which reference the same file share a single model
+        std::vector<std::string> modelFiles;
+        std::vector<uint32_t> entryToFile(jsonVal.Size());
+        std::map<std::string, uint32_t> fullpathToFile;
         for(uint32_t i = 0; i < jsonVal.Size(); i++)
         {
-            if(createModel(jsonVal[i]) == false)
+            const auto& jsonModel = jsonVal[i];
+            // Model must have at least a filename
+            if(jsonModel.IsObject() == false || jsonModel.HasMember(SceneKeys::kFilename) == false)
+            {
+                error("Model must have a filename");
+                return false;
+            }
+            const auto& modelFile = jsonModel[SceneKeys::kFilename];
+            if(modelFile.IsString() == false)
+            {
+                error("Model filename must be a string");
+                return false;
+            }
+
+            // Different relative paths can point to the same file, so compare the resolved paths
+            std::string fullpath;
+            if(findFileInDataDirectories(modelFile.GetString(), fullpath) == false)
+            {
+                fullpath = modelFile.GetString();
+            }
+
+            auto it = fullpathToFile.find(fullpath);
+            if(it == fullpathToFile.end())
+            {
+                it = fullpathToFile.insert(std::make_pair(fullpath, (uint32_t)modelFiles.size())).first;
+                modelFiles.push_back(modelFile.GetString());
+            }
+            entryToFile[i] = it->second;
+        }
+
+        // Load all the files at once, then apply the entries in file order
+        std::vector<Model::SharedPtr> models = Model::createFromFiles(modelFiles, mModelLoadFlags);
+        std::vector<uint32_t> modelIDs(models.size(), kInvalidModelID);
+        for(uint32_t i = 0; i < jsonVal.Size(); i++)
+        {
+            const Model::SharedPtr& pModel = models[entryToFile[i]];
+            if(pModel == nullptr)
+            {
+                return false;
+            }
+
+            if(createModel(jsonVal[i], pModel, modelIDs[entryToFile[i]]) == false)
             {
                 return false;
             }
@@ -1108,12 +1156,15 @@ namespace Falcor
                 return nullptr;
             }
 
-			switch (mSceneLoadFlags)
+            if(mSceneLoadFlags & Scene::ShareMaterials)
+            {
+                mpScene->shareModelMaterials();
+            }
+
+			if(mSceneLoadFlags & Scene::GenerateAreaLights)
 			{
-				case Scene::GenerateAreaLights:
-					// Create area light(s) in the scene
-					mpScene->createAreaLights();
-					break;
+				// Create area light(s) in the scene
+				mpScene->createAreaLights();
 			}
 			
             return mpScene;
@@ -64,7 +64,7 @@ namespace Falcor
 
         bool loadIncludeFile(const std::string& Include);
 
-        bool createModel(const rapidjson::Value& jsonModel);
+        bool createModel(const rapidjson::Value& jsonModel, const Model::SharedPtr& pModel, uint32_t& modelID);
         bool createModelInstances(const rapidjson::Value& jsonVal, uint32_t modelID);
         bool createPointLight(const rapidjson::Value& jsonLight);
         bool createDirLight(const rapidjson::Value& jsonLight);
@@ -37,6 +37,8 @@
 #include "Core/Window.h"
 #include "glm/matrix.hpp"
 #include "Graphics/Material/MaterialSystem.h"
+#include <algorithm>
+#include <unordered_map>
 
 namespace Falcor
 {
@@ -48,6 +50,8 @@ namespace Falcor
     size_t SceneRenderer::sCameraDataOffset = 0;
     size_t SceneRenderer::sWorldMatOffset = 0;
     size_t SceneRenderer::sMeshIdOffset = 0;
+    size_t SceneRenderer::sMaterialOffset = 0;
+    UniformBuffer::VarHandle<uint32_t> SceneRenderer::sMeshIdHandle;
     
 
     static const std::string kPerMaterialCbName = "InternalPerMaterialCB";
@@ -76,9 +80,16 @@ namespace Falcor
             sPerStaticMeshCB = UniformBuffer::create(pProgVer, kPerStaticMeshCbName);
             sPerSkinnedMeshCB = UniformBuffer::create(pProgVer, kPerSkinnedMeshCbName);
 
+            // These buffers change between draws. Each upload goes into a new slice of the frame ring, so the driver doesn't have to wait for or rename the buffer
+            sPerMaterialCB->setTransient(true);
+            sPerStaticMeshCB->setTransient(true);
+            sPerSkinnedMeshCB->setTransient(true);
+
             sBonesOffset = sPerSkinnedMeshCB->getVariableOffset("gBones");
             sWorldMatOffset = sPerStaticMeshCB->getVariableOffset("gWorldMat");
             sMeshIdOffset = sPerStaticMeshCB->getVariableOffset("gMeshId");
+            sMeshIdHandle = sPerStaticMeshCB->getVariableHandle<uint32_t>("gMeshId");
+            sMaterialOffset = Material::getUniformBufferOffset(sPerMaterialCB.get(), "gMaterial");
             sCameraDataOffset = sPerFrameCB->getVariableOffset("gCam.viewMat");
         }
     }
@@ -139,14 +150,14 @@ namespace Falcor
         sPerStaticMeshCB->setBlob(&worldMat, sWorldMatOffset + drawInstanceID*sizeof(glm::mat4), sizeof(glm::mat4));
 
         // Set mesh id
-        sPerStaticMeshCB->setVariable(sMeshIdOffset, currentData.pMesh->getId());
+        sPerStaticMeshCB->setVariable(sMeshIdHandle, currentData.pMesh->getId());
 
 		return true;
     }
 
     bool SceneRenderer::setPerMaterialData(RenderContext* pContext, const CurrentWorkingData& currentData)
     {
-        currentData.pMaterial->setIntoUniformBuffer(sPerMaterialCB.get(), "gMaterial");
+        currentData.pMaterial->setIntoUniformBuffer(sPerMaterialCB.get(), sMaterialOffset);
 		return true;
     }
 
@@ -166,12 +177,18 @@ namespace Falcor
             if(mCompileMaterialWithProgram)
             {
                 ProgramVersion::SharedConstPtr pPatchedProgram = MaterialSystem::patchActiveProgramVersion(currentData.pProgram, mpLastMaterial);
+                if(pPatchedProgram == nullptr)
+                {
+                    // The program is compiling in the background and there's no fallback version
+                    mpLastMaterial = nullptr;
+                    return;
+                }
                 pContext->setProgram(pPatchedProgram);
             }
         }
 
         // Draw
-        pContext->drawIndexedInstanced(pMesh->getIndexCount(), instanceCount, 0, 0, 0);
+        pContext->drawIndexedInstanced(pMesh->getIndexCount(), instanceCount, pMesh->getStartIndex(), pMesh->getBaseVertex(), 0);
         postFlushDraw(pContext, currentData);
     }
 
@@ -180,88 +197,204 @@ namespace Falcor
 
     }
 
-    void SceneRenderer::renderMesh(RenderContext* pContext, const Mesh* pMesh, const glm::mat4& translation, Camera* pCamera, CurrentWorkingData& currentData)
+    bool SceneRenderer::setActiveProgramVersion(RenderContext* pContext, const CurrentWorkingData& currentData)
     {
-		currentData.pMesh = pMesh;
-
-		if (setPerMeshData(pContext, currentData))
-		{
-			// Bind VAO and set topology
-			pContext->setVao(pMesh->getVao());
-			pContext->setTopology(pMesh->getTopology());
-
-			uint32_t InstanceCount = pMesh->getInstanceCount();
-
-			uint32_t activeInstances = 0;
-			//auto pCamera = mpScene->getActiveCamera();
-
-			for (uint32_t instanceID = 0; instanceID < InstanceCount; instanceID++)
-			{
-				BoundingBox box = pMesh->getInstanceBoundingBox(instanceID).transform(translation);
-
-				if ((mCullEnabled == false) || (pCamera->isObjectCulled(box) == false))
-				{
-					if (setPerMeshInstanceData(pContext, translation, instanceID, activeInstances, currentData))
-					{
-						activeInstances++;
-
-						if (activeInstances == mMaxInstanceCount)
-						{
-
-							pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-							flushDraw(pContext, pMesh, activeInstances, currentData);
-							activeInstances = 0;
-						}
-					}
-				}
-			}
-			if(activeInstances != 0)
-			{
-				pContext->setProgram(currentData.pProgram->getActiveProgramVersion());
-				flushDraw(pContext, currentData.pMesh, activeInstances, currentData);
-			}
-		}
+        // The version might be null if it's being compiled asynchronously and the program doesn't have a fallback version. In that case we skip the draw
+        ProgramVersion::SharedConstPtr pVersion = currentData.pProgram->getActiveProgramVersion();
+        if(pVersion == nullptr)
+        {
+            return false;
+        }
+        pContext->setProgram(pVersion);
+        return true;
     }
 
-    void SceneRenderer::renderModel(RenderContext* pContext, Program* pProgram, const Model* pModel, const glm::mat4& instanceMatrix, Camera* pCamera, CurrentWorkingData& currentData)
-    {        
-		currentData.pModel = pModel;
-		if (setPerModelData(pContext, currentData))
-		{
-			// Bind the program
-			if(pModel->hasBones())
-			{
-				pProgram->addDefine("_VERTEX_BLENDING");
-			}
-
-
-			mpLastMaterial = nullptr;
-
-			// Loop over the meshes
-			for (uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
-			{
-				renderMesh(pContext, pModel->getMesh(meshID).get(), instanceMatrix, pCamera, currentData);
-			}
-
-			// Restore the program state
-			if(pModel->hasBones())
-			{
-                pProgram->removeDefine("_VERTEX_BLENDING");
+    void SceneRenderer::renderDrawList(RenderContext* pContext, const DrawList& drawList, CurrentWorkingData& currentData)
+    {
+        Program* pProgram = currentData.pProgram;
+        bool modelActive = false;
+        bool vertexBlending = false;
+        bool programDirty = true;
+        mpLastMaterial = nullptr;
+        mpLastVao = nullptr;
+
+        for(const DrawItem& draw : drawList.draws)
+        {
+            // Draws are sorted by material, so consecutive draws can come from different models
+            if(draw.pModel != currentData.pModel)
+            {
+                currentData.pModel = draw.pModel;
+                modelActive = setPerModelData(pContext, currentData);
+
+                if(draw.pModel->hasBones() != vertexBlending)
+                {
+                    vertexBlending = draw.pModel->hasBones();
+                    if(vertexBlending)
+                    {
+                        pProgram->addDefine("_VERTEX_BLENDING");
+                    }
+                    else
+                    {
+                        pProgram->removeDefine("_VERTEX_BLENDING");
+                    }
+                    // The material has to be patched into the new program version
+                    programDirty = true;
+                }
+            }
+            if(modelActive == false)
+            {
+                continue;
             }
-		}
 
+            currentData.pMesh = draw.pMesh;
+            if(setPerMeshData(pContext, currentData) == false)
+            {
+                continue;
+            }
+
+            uint32_t activeInstances = 0;
+            for(uint32_t i = 0; i < draw.instanceCount; i++)
+            {
+                const VisibleMeshInstance& visible = mVisibleInstances[draw.firstInstance + i];
+                const glm::mat4& translation = mpScene->getModelInstance(visible.modelID, visible.modelInstanceID).transformMatrix;
+                if(setPerMeshInstanceData(pContext, translation, visible.meshInstanceID, activeInstances, currentData))
+                {
+                    activeInstances++;
+                }
+            }
+            if(activeInstances == 0)
+            {
+                continue;
+            }
+
+            if(programDirty)
+            {
+                if(setActiveProgramVersion(pContext, currentData) == false)
+                {
+                    continue;
+                }
+                programDirty = false;
+                mpLastMaterial = nullptr;
+            }
+
+            // Bind VAO and set topology. Meshes packed into shared buffers use the same VAO, see Model::batchStaticMeshes()
+            if(mpLastVao != draw.pVao)
+            {
+                mpLastVao = draw.pVao;
+                pContext->setVao(draw.pMesh->getVao());
+            }
+            pContext->setTopology(draw.pMesh->getTopology());
+
+            flushDraw(pContext, draw.pMesh, activeInstances, currentData);
+        }
+
+        // Restore the program state
+        if(vertexBlending)
+        {
+            pProgram->removeDefine("_VERTEX_BLENDING");
+        }
     }
 
     bool SceneRenderer::update(double currentTime)
     {
+        for(uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            mpScene->getModel(modelID)->animate(currentTime);
+        }
+
         return mpScene->updateCamera(currentTime, mpCameraController.get());
+    }
 
+    void SceneRenderer::cullScene(const Camera* pCamera, std::vector<VisibleMeshInstance>& visibleInstances) const
+    {
+        visibleInstances.clear();
         for(uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
         {
-            mpScene->getModel(modelID)->animate(currentTime);
+            const Model* pModel = mpScene->getModel(modelID).get();
+            for(uint32_t modelInstanceID = 0; modelInstanceID < mpScene->getModelInstanceCount(modelID); modelInstanceID++)
+            {
+                const auto& instance = mpScene->getModelInstance(modelID, modelInstanceID);
+                if(instance.isVisible == false)
+                {
+                    continue;
+                }
+
+                for(uint32_t meshID = 0; meshID < pModel->getMeshCount(); meshID++)
+                {
+                    const Mesh* pMesh = pModel->getMesh(meshID).get();
+                    for(uint32_t meshInstanceID = 0; meshInstanceID < pMesh->getInstanceCount(); meshInstanceID++)
+                    {
+                        BoundingBox box = pMesh->getInstanceBoundingBox(meshInstanceID).transform(instance.transformMatrix);
+                        if(mCullEnabled && pCamera->isObjectCulled(box))
+                        {
+                            continue;
+                        }
+
+                        VisibleMeshInstance visible;
+                        visible.modelID = modelID;
+                        visible.modelInstanceID = modelInstanceID;
+                        visible.meshID = meshID;
+                        visible.meshInstanceID = meshInstanceID;
+                        visible.pMesh = pMesh;
+                        visible.worldMat = instance.transformMatrix;
+                        if(pMesh->hasBones() == false)
+                        {
+                            visible.worldMat = visible.worldMat * pMesh->getInstanceMatrix(meshInstanceID);
+                        }
+                        visibleInstances.push_back(visible);
+                    }
+                }
+            }
         }
     }
 
+    void SceneRenderer::buildDrawList(const std::vector<VisibleMeshInstance>& visibleInstances, DrawList& drawList) const
+    {
+        drawList.draws.clear();
+        drawList.worldMats.resize(visibleInstances.size());
+
+        // Materials and VAOs are ranked by their first appearance in the scene
+        std::unordered_map<const Material*, uint32_t> materialRanks;
+        std::unordered_map<const Vao*, uint32_t> vaoRanks;
+
+        for(size_t i = 0; i < visibleInstances.size(); i++)
+        {
+            const VisibleMeshInstance& visible = visibleInstances[i];
+            drawList.worldMats[i] = visible.worldMat;
+
+            // Instances of the same mesh in the same model instance are consecutive, so they can share a draw
+            if(drawList.draws.empty() == false)
+            {
+                DrawItem& last = drawList.draws.back();
+                const VisibleMeshInstance& prev = visibleInstances[i - 1];
+                bool sameMesh = (prev.pMesh == visible.pMesh) && (prev.modelInstanceID == visible.modelInstanceID) && (prev.modelID == visible.modelID);
+                if(sameMesh && last.instanceCount < mMaxInstanceCount)
+                {
+                    last.instanceCount++;
+                    continue;
+                }
+            }
+
+            DrawItem draw;
+            draw.pModel = mpScene->getModel(visible.modelID).get();
+            draw.pMesh = visible.pMesh;
+            draw.pMaterial = visible.pMesh->getMaterial().get();
+            draw.pVao = visible.pMesh->getVao().get();
+            draw.hasBones = draw.pModel->hasBones();
+            draw.firstInstance = (uint32_t)i;
+            draw.instanceCount = 1;
+
+            // Skinned models use a different program version, so keep them together after the static ones. Then minimize material switches, then VAO switches between draws with the same material
+            uint64_t materialRank = materialRanks.insert(std::make_pair(draw.pMaterial, (uint32_t)materialRanks.size())).first->second;
+            uint64_t vaoRank = vaoRanks.insert(std::make_pair(draw.pVao, (uint32_t)vaoRanks.size())).first->second;
+            draw.sortKey = (uint64_t(draw.hasBones) << 63) | (materialRank << 32) | vaoRank;
+            drawList.draws.push_back(draw);
+        }
+
+        // Stable, so draws with the same state keep the scene order
+        std::stable_sort(drawList.draws.begin(), drawList.draws.end(), [](const DrawItem& a, const DrawItem& b) { return a.sortKey < b.sortKey; });
+    }
+
     void SceneRenderer::renderScene(RenderContext* pContext, Program* pProgram)
     {
         renderScene(pContext, pProgram, mpScene->getActiveCamera().get());
@@ -284,6 +417,12 @@ namespace Falcor
 
     void SceneRenderer::renderScene(RenderContext* pContext, Program* pProgram, Camera* pCamera)
     {
+        if(pProgram->getActiveProgramVersion() == nullptr)
+        {
+            // Still compiling, and there's nothing to fall back to
+            return;
+        }
+
         bindUniformBuffers(pContext, pProgram);
 		CurrentWorkingData currentData;
 		currentData.pProgram = pProgram;
@@ -294,17 +433,10 @@ namespace Falcor
         setupVR();
         setPerFrameData(pContext, currentData);
 
-        for (uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
-        {
-            for (uint32_t InstanceID = 0; InstanceID < mpScene->getModelInstanceCount(modelID); InstanceID++)
-            {
-                auto& Instance = mpScene->getModelInstance(modelID, InstanceID);
-                if (Instance.isVisible)
-                {
-                    renderModel(pContext, pProgram, mpScene->getModel(modelID).get(), Instance.transformMatrix, pCamera, currentData);
-                }
-            }
-        }
+        // Same CPU path as the one measured by SceneBenchmark
+        cullScene(pCamera, mVisibleInstances);
+        buildDrawList(mVisibleInstances, mDrawList);
+        renderDrawList(pContext, mDrawList, currentData);
     }
 
     void SceneRenderer::setCameraControllerType(CameraControllerType type)
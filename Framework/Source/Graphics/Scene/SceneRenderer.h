@@ -73,6 +73,48 @@ namespace Falcor
         */
         bool update(double currentTime);
 
+        /** A mesh instance which passed culling
+        */
+        struct VisibleMeshInstance
+        {
+            uint32_t modelID;
+            uint32_t modelInstanceID;
+            uint32_t meshID;
+            uint32_t meshInstanceID;
+            const Mesh* pMesh;
+            glm::mat4 worldMat;
+        };
+
+        /** A single instanced draw. Covers up to the max instance count consecutive instances of a mesh, see setMaxInstanceCount()
+        */
+        struct DrawItem
+        {
+            const Model* pModel;
+            const Mesh* pMesh;
+            const Material* pMaterial;
+            const Vao* pVao;
+            bool hasBones;              ///< The model is skinned, and is drawn with _VERTEX_BLENDING defined
+            uint32_t firstInstance;     ///< Index into DrawList::worldMats
+            uint32_t instanceCount;
+            uint64_t sortKey;           ///< Skinning, then the order in which the material and the VAO first appear in the scene. Doesn't depend on heap addresses, so the draw order is the same on every run
+        };
+
+        struct DrawList
+        {
+            std::vector<DrawItem> draws;            ///< Skinned models last, then grouped by material and VAO in scene order
+            std::vector<glm::mat4> worldMats;
+        };
+
+        /** Collect the visible mesh instances. This is the first step of renderScene(). CPU only, doesn't need a graphics device.
+            \param[in] pCamera The camera to cull against
+            \param[out] visibleInstances The visible mesh instances, in scene order
+        */
+        void cullScene(const Camera* pCamera, std::vector<VisibleMeshInstance>& visibleInstances) const;
+
+        /** Batch the visible mesh instances into instanced draws and sort them by material. renderScene() draws the resulting list. CPU only, doesn't need a graphics device.
+        */
+        void buildDrawList(const std::vector<VisibleMeshInstance>& visibleInstances, DrawList& drawList) const;
+
         bool onKeyEvent(const KeyboardEvent& keyEvent);
         bool onMouseEvent(const MouseEvent& mouseEvent);
 
@@ -86,6 +128,7 @@ namespace Falcor
 
         /** This setting controls whether to unload textures from GPU memory before binding a new material.\n
         Useful for rendering very large models with many textures that can't fit into GPU memory at once. Setting this to true usually results in performance loss.
+        ResidencyManager::setBudget() is usually a better alternative, since it only evicts textures which weren't used recently, and only when the budget is exceeded.
         */
         void setUnloadTexturesOnMaterialChange(bool unload) { mUnloadTexturesOnMaterialChange = unload; }
 
@@ -125,6 +168,8 @@ namespace Falcor
         static size_t sCameraDataOffset;
         static size_t sWorldMatOffset;
         static size_t sMeshIdOffset;
+        static size_t sMaterialOffset;
+        static UniformBuffer::VarHandle<uint32_t> sMeshIdHandle;
 
     private:
         void createUniformBuffers(Program* pProgram);
@@ -137,9 +182,11 @@ namespace Falcor
         virtual bool setPerMaterialData(RenderContext* pContext, const CurrentWorkingData& currentData);
         virtual void postFlushDraw(RenderContext* pContext, const CurrentWorkingData& currentData);
 
-        void renderModel(RenderContext* pContext, Program* pProgram, const Model* pModel, const glm::mat4& instanceMatrix, Camera* pCamera, CurrentWorkingData& currentData);
-        void renderMesh(RenderContext* pContext, const Mesh* pMesh, const glm::mat4& translation, Camera* pCamera, CurrentWorkingData& currentData);
+        void renderDrawList(RenderContext* pContext, const DrawList& drawList, CurrentWorkingData& currentData);
+        std::vector<VisibleMeshInstance> mVisibleInstances;
+        DrawList mDrawList;
         void flushDraw(RenderContext* pContext, const Mesh* pMesh, uint32_t instanceCount, CurrentWorkingData& currentData);
+        bool setActiveProgramVersion(RenderContext* pContext, const CurrentWorkingData& currentData);
 
     protected:
         void setupVR();
@@ -149,6 +196,7 @@ namespace Falcor
 
         uint32_t mMaxInstanceCount = 64;
         const Material* mpLastMaterial = nullptr;
+        const Vao* mpLastVao = nullptr;
         bool mCullEnabled = true;
         bool mUnloadTexturesOnMaterialChange = false;
         RenderMode mRenderMode = RenderMode::Mono;
@@ -0,0 +1,1155 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneSnapshot.h"
+#include <fstream>
+#include "Core/Buffer.h"
+#include "Core/Texture.h"
+#include "Graphics/TextureHelper.h"
+#include "Graphics/TextureCache.h"
+#include "Utils/StringUtils.h"
+
+namespace Falcor
+{
+    namespace
+    {
+        const char kMagic[8] = {'F', 'S', 'n', 'a', 'p', 's', 'h', 't'};
+        const uint32_t kInvalidIndex = uint32_t(-1);
+
+        struct FileHeader
+        {
+            char magic[8];
+            uint32_t version;
+            uint32_t sectionCount;
+        };
+
+        struct SectionEntry
+        {
+            uint32_t type;
+            uint32_t reserved;
+            uint64_t offset;
+            uint64_t size;
+        };
+
+        uint64_t alignUp(uint64_t value, uint64_t alignment)
+        {
+            return (value + alignment - 1) / alignment * alignment;
+        }
+    }
+
+    class SceneSnapshot::Writer
+    {
+    public:
+        void write(const void* pData, size_t size)
+        {
+            const uint8_t* pBytes = (const uint8_t*)pData;
+            mData.insert(mData.end(), pBytes, pBytes + size);
+        }
+
+        template<typename T>
+        Writer& operator<<(const T& val) { write(&val, sizeof(T)); return *this; }
+
+        void writeString(const std::string& str)
+        {
+            *this << (uint32_t)str.size();
+            write(str.data(), str.size());
+        }
+
+        /** Reserve an aligned block at the end of the section and return its offset
+        */
+        uint64_t allocate(size_t size, size_t alignment)
+        {
+            uint64_t offset = alignUp(mData.size(), alignment);
+            mData.resize(size_t(offset + size), 0);
+            return offset;
+        }
+
+        uint8_t* getData(uint64_t offset) { return mData.data() + offset; }
+        uint64_t getSize() const { return mData.size(); }
+        const std::vector<uint8_t>& getBuffer() const { return mData; }
+
+    private:
+        std::vector<uint8_t> mData;
+    };
+
+    class SceneSnapshot::Reader
+    {
+    public:
+        /** Resize the section and return a pointer to its storage
+        */
+        uint8_t* resize(size_t size)
+        {
+            mData.resize(size);
+            mOffset = 0;
+            mFailed = false;
+            return mData.data();
+        }
+
+        bool read(void* pDst, size_t size)
+        {
+            if(mFailed || (mOffset + size > mData.size()))
+            {
+                mFailed = true;
+                return false;
+            }
+            memcpy(pDst, mData.data() + mOffset, size);
+            mOffset += size;
+            return true;
+        }
+
+        template<typename T>
+        Reader& operator>>(T& val) { read(&val, sizeof(T)); return *this; }
+
+        bool readString(std::string& str)
+        {
+            uint32_t size = 0;
+            *this >> size;
+            if(mFailed || (mOffset + size > mData.size()))
+            {
+                mFailed = true;
+                return false;
+            }
+            str.assign((const char*)mData.data() + mOffset, size);
+            mOffset += size;
+            return true;
+        }
+
+        /** Get a pointer to a block in the section, or nullptr if the block is out of bounds
+        */
+        const uint8_t* getData(uint64_t offset, uint64_t size) const
+        {
+            return (offset + size <= mData.size()) ? mData.data() + offset : nullptr;
+        }
+
+        bool isValid() const { return mFailed == false; }
+
+    private:
+        std::vector<uint8_t> mData;
+        size_t mOffset = 0;
+        bool mFailed = false;
+    };
+
+    bool SceneSnapshot::save(const std::string& filename, const Scene* pScene)
+    {
+        SceneSnapshot snapshot(pScene);
+        return snapshot.writeFile(filename);
+    }
+
+    Scene::SharedPtr SceneSnapshot::load(const std::string& filename, uint32_t modelLoadFlags)
+    {
+        SceneSnapshot snapshot(nullptr);
+        snapshot.mModelLoadFlags = modelLoadFlags;
+        if(snapshot.readFile(filename) == false)
+        {
+            return nullptr;
+        }
+        return snapshot.mpNewScene;
+    }
+
+    bool SceneSnapshot::isModelStored(const Model* pModel)
+    {
+        // Skinning data and animations are not part of the format. These models are re-imported from their source file
+        return (pModel->hasBones() == false) && (pModel->hasAnimations() == false);
+    }
+
+    uint32_t SceneSnapshot::addTexture(const Texture* pTexture)
+    {
+        if(pTexture == nullptr)
+        {
+            return kInvalidIndex;
+        }
+
+        auto it = mTextureIDs.find(pTexture);
+        if(it != mTextureIDs.end())
+        {
+            return it->second;
+        }
+        uint32_t id = (uint32_t)mTextures.size();
+        mTextureIDs[pTexture] = id;
+        mTextures.push_back(pTexture);
+        return id;
+    }
+
+    uint32_t SceneSnapshot::addBuffer(const Buffer* pBuffer)
+    {
+        if(pBuffer == nullptr)
+        {
+            return kInvalidIndex;
+        }
+
+        auto it = mBufferIDs.find(pBuffer);
+        if(it != mBufferIDs.end())
+        {
+            return it->second;
+        }
+        uint32_t id = (uint32_t)mBuffers.size();
+        mBufferIDs[pBuffer] = id;
+        mBuffers.push_back(pBuffer);
+        return id;
+    }
+
+    uint32_t SceneSnapshot::addMaterial(const Material* pMaterial)
+    {
+        if(pMaterial == nullptr)
+        {
+            return kInvalidIndex;
+        }
+
+        auto it = mMaterialIDs.find(pMaterial);
+        if(it != mMaterialIDs.end())
+        {
+            return it->second;
+        }
+        uint32_t id = (uint32_t)mMaterials.size();
+        mMaterialIDs[pMaterial] = id;
+        mMaterials.push_back(pMaterial);
+
+        const MaterialData& data = pMaterial->getData();
+        for(uint32_t i = 0; i < pMaterial->getNumActiveLayers(); i++)
+        {
+            addTexture(data.values.layers[i].albedo.texture.pTexture.get());
+            addTexture(data.values.layers[i].roughness.texture.pTexture.get());
+            addTexture(data.values.layers[i].extraParam.texture.pTexture.get());
+        }
+        addTexture(data.values.alphaMap.texture.pTexture.get());
+        addTexture(data.values.normalMap.texture.pTexture.get());
+        addTexture(data.values.heightMap.texture.pTexture.get());
+        addTexture(data.values.ambientMap.texture.pTexture.get());
+        return id;
+    }
+
+    void SceneSnapshot::collectResources()
+    {
+        // Resources shared between models and meshes are stored once
+        for(uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = mpScene->getModel(modelID).get();
+            if(isModelStored(pModel) == false)
+            {
+                continue;
+            }
+
+            for(const auto& pMaterial : pModel->mpMaterials)
+            {
+                addMaterial(pMaterial.get());
+            }
+            for(const auto& pBuffer : pModel->mpBuffers)
+            {
+                addBuffer(pBuffer.get());
+            }
+            for(const auto& pTexture : pModel->mpTextures)
+            {
+                addTexture(pTexture.get());
+            }
+
+            for(const auto& pMesh : pModel->mpMeshes)
+            {
+                const Vao* pVao = pMesh->getVao().get();
+                for(uint32_t i = 0; i < pVao->getVertexBuffersCount(); i++)
+                {
+                    addBuffer(pVao->getVertexBuffer(i).get());
+                }
+                addBuffer(pVao->getIndexBuffer().get());
+                addMaterial(pMesh->getMaterial().get());
+            }
+        }
+
+        for(uint32_t i = 0; i < mpScene->getMaterialCount(); i++)
+        {
+            addMaterial(mpScene->getMaterial(i).get());
+        }
+    }
+
+    bool SceneSnapshot::writeFile(const std::string& filename)
+    {
+        collectResources();
+
+        std::vector<Writer> sections((size_t)SectionType::Count);
+        Writer& data = sections[(size_t)SectionType::Data];
+        writeGlobals(sections[(size_t)SectionType::Globals]);
+        if(writeTextures(sections[(size_t)SectionType::Textures], data) == false)
+        {
+            return false;
+        }
+        writeBuffers(sections[(size_t)SectionType::Buffers], data);
+        writeMaterials(sections[(size_t)SectionType::Materials]);
+        writeModels(sections[(size_t)SectionType::Models]);
+        writeLights(sections[(size_t)SectionType::Lights]);
+        writeCameras(sections[(size_t)SectionType::Cameras]);
+        writePaths(sections[(size_t)SectionType::Paths]);
+        writeUserVariables(sections[(size_t)SectionType::UserVariables]);
+
+        // Lay out the sections after the header and the section table
+        FileHeader header;
+        memcpy(header.magic, kMagic, sizeof(kMagic));
+        header.version = kVersion;
+        header.sectionCount = (uint32_t)sections.size();
+
+        std::vector<SectionEntry> table(sections.size());
+        uint64_t offset = alignUp(sizeof(FileHeader) + sizeof(SectionEntry) * table.size(), kSectionAlignment);
+        for(size_t i = 0; i < sections.size(); i++)
+        {
+            table[i].type = (uint32_t)i;
+            table[i].reserved = 0;
+            table[i].offset = offset;
+            table[i].size = sections[i].getSize();
+            offset = alignUp(offset + table[i].size, kSectionAlignment);
+        }
+
+        std::ofstream stream(filename, std::ios::binary);
+        if(stream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Can't open scene snapshot file " + filename + " for writing");
+            return false;
+        }
+
+        stream.write((const char*)&header, sizeof(header));
+        stream.write((const char*)table.data(), sizeof(SectionEntry) * table.size());
+        for(size_t i = 0; i < sections.size(); i++)
+        {
+            // Pad to the section offset
+            uint64_t position = (uint64_t)stream.tellp();
+            std::vector<char> padding(size_t(table[i].offset - position), 0);
+            stream.write(padding.data(), padding.size());
+            stream.write((const char*)sections[i].getBuffer().data(), sections[i].getSize());
+        }
+
+        if(stream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Error when writing scene snapshot file " + filename);
+            return false;
+        }
+        return true;
+    }
+
+    void SceneSnapshot::writeGlobals(Writer& section)
+    {
+        bool hasAreaLights = false;
+        for(uint32_t i = 0; i < mpScene->getLightCount(); i++)
+        {
+            hasAreaLights = hasAreaLights || (mpScene->getLight(i)->getType() == LightArea);
+        }
+
+        section << mpScene->getVersion() << mpScene->getAmbientIntensity() << mpScene->getLightingScale() << mpScene->getCameraSpeed();
+        section << mpScene->getActiveCameraIndex() << mpScene->getActivePathIndex() << hasAreaLights;
+    }
+
+    bool SceneSnapshot::writeTextures(Writer& section, Writer& data)
+    {
+        section << (uint32_t)mTextures.size();
+        for(const Texture* pTexture : mTextures)
+        {
+            // Only single-slice 2D textures are stored. Anything else is reloaded from its source file
+            bool isStored = (pTexture->getType() == Texture::Type::Texture2D) && (pTexture->getArraySize() == 1) && (pTexture->isSparse() == false);
+            if(isStored == false && pTexture->getSourceFilename().empty())
+            {
+                Logger::log(Logger::Level::Error, "Can't save scene snapshot. Texture " + pTexture->getName() + " can't be stored in the snapshot, and wasn't loaded from a file");
+                return false;
+            }
+
+            section << isStored << (uint32_t)pTexture->getType() << pTexture->getWidth() << pTexture->getHeight() << pTexture->getMipLevels() << pTexture->getFormat();
+            section.writeString(pTexture->getName());
+            section.writeString(pTexture->getSourceFilename());
+
+            if(isStored)
+            {
+                for(uint32_t mip = 0; mip < pTexture->getMipLevels(); mip++)
+                {
+                    uint32_t size = pTexture->getMipLevelDataSize(mip);
+                    uint64_t offset = data.allocate(size, kDataAlignment);
+                    pTexture->readSubresourceData(data.getData(offset), size, mip, 0);
+                    section << offset << size;
+                }
+            }
+        }
+        return true;
+    }
+
+    void SceneSnapshot::writeBuffers(Writer& section, Writer& data)
+    {
+        section << (uint32_t)mBuffers.size();
+        for(const Buffer* pBuffer : mBuffers)
+        {
+            // Most buffers are created without CPU access. Read them through a staging buffer
+            size_t size = pBuffer->getSize();
+            auto pStaging = Buffer::create(size, Buffer::BindFlags::None, Buffer::AccessFlags::MapRead, nullptr);
+            pBuffer->copy(pStaging.get());
+
+            uint64_t offset = data.allocate(size, kDataAlignment);
+            memcpy(data.getData(offset), pStaging->map(Buffer::MapType::Read), size);
+            pStaging->unmap();
+
+            section << pBuffer->getBindFlags() << (uint64_t)size << offset;
+        }
+    }
+
+    void SceneSnapshot::writeMaterials(Writer& section)
+    {
+        auto writeValue = [this, &section](const MaterialValue& value)
+        {
+            section << value.constantColor << addTexture(value.texture.pTexture.get());
+        };
+
+        section << (uint32_t)mMaterials.size();
+        for(const Material* pMaterial : mMaterials)
+        {
+            const MaterialData& data = pMaterial->getData();
+            section.writeString(pMaterial->getName());
+            section << pMaterial->getId() << pMaterial->isDoubleSided() << (uint32_t)pMaterial->getNumActiveLayers();
+            for(uint32_t i = 0; i < pMaterial->getNumActiveLayers(); i++)
+            {
+                const MaterialLayerDesc& desc = data.desc.layers[i];
+                const MaterialLayerValues& values = data.values.layers[i];
+                section << desc.type << desc.ndf << desc.blending;
+                writeValue(values.albedo);
+                writeValue(values.roughness);
+                writeValue(values.extraParam);
+                section << values.pmf;
+            }
+            writeValue(data.values.alphaMap);
+            writeValue(data.values.normalMap);
+            writeValue(data.values.heightMap);
+            writeValue(data.values.ambientMap);
+        }
+
+        // The scene's material list
+        section << mpScene->getMaterialCount();
+        for(uint32_t i = 0; i < mpScene->getMaterialCount(); i++)
+        {
+            section << addMaterial(mpScene->getMaterial(i).get());
+        }
+    }
+
+    void SceneSnapshot::writeModels(Writer& section)
+    {
+        section << mpScene->getModelCount();
+        for(uint32_t modelID = 0; modelID < mpScene->getModelCount(); modelID++)
+        {
+            const Model* pModel = mpScene->getModel(modelID).get();
+            bool isStored = isModelStored(pModel);
+            section.writeString(mpScene->getModelFilename(modelID));
+            section.writeString(pModel->getName());
+            section << isStored << (pModel->hasAnimations() ? pModel->getActiveAnimation() : kInvalidIndex);
+
+            // Instances
+            section << mpScene->getModelInstanceCount(modelID);
+            for(uint32_t i = 0; i < mpScene->getModelInstanceCount(modelID); i++)
+            {
+                const Scene::ModelInstance& instance = mpScene->getModelInstance(modelID, i);
+                section.writeString(instance.name);
+                section << instance.translation << instance.rotation << instance.scaling << instance.isVisible;
+            }
+
+            if(isStored == false)
+            {
+                continue;
+            }
+
+            section << (uint32_t)pModel->mpMaterials.size();
+            for(const auto& pMaterial : pModel->mpMaterials)
+            {
+                section << mMaterialIDs[pMaterial.get()];
+            }
+            section << (uint32_t)pModel->mpBuffers.size();
+            for(const auto& pBuffer : pModel->mpBuffers)
+            {
+                section << mBufferIDs[pBuffer.get()];
+            }
+            section << (uint32_t)pModel->mpTextures.size();
+            for(const auto& pTexture : pModel->mpTextures)
+            {
+                section << mTextureIDs[pTexture.get()];
+            }
+
+            // Meshes packed into shared buffers share a VAO, see Model::batchStaticMeshes()
+            std::map<const Vao*, uint32_t> vaoIDs;
+            section << (uint32_t)pModel->mpMeshes.size();
+            for(const auto& pMesh : pModel->mpMeshes)
+            {
+                const Vao* pVao = pMesh->getVao().get();
+                uint32_t vaoID = (uint32_t)vaoIDs.size();
+                vaoID = vaoIDs.insert(std::make_pair(pVao, vaoID)).first->second;
+                section << vaoID << pVao->getVertexBuffersCount();
+                for(uint32_t vb = 0; vb < pVao->getVertexBuffersCount(); vb++)
+                {
+                    const VertexLayout* pLayout = pVao->getVertexBufferLayout(vb).get();
+                    section << mBufferIDs[pVao->getVertexBuffer(vb).get()] << pVao->getVertexBufferStride(vb);
+                    section << pLayout->getInputClass() << pLayout->getInstanceStepRate() << pLayout->getElementCount();
+                    for(uint32_t e = 0; e < pLayout->getElementCount(); e++)
+                    {
+                        section.writeString(pLayout->getElementName(e));
+                        section << pLayout->getElementOffset(e) << pLayout->getElementFormat(e) << pLayout->getElementArraySize(e) << pLayout->getElementShaderLocation(e);
+                    }
+                }
+
+                const Buffer* pIB = pVao->getIndexBuffer().get();
+                section << pMesh->getVertexCount() << (pIB ? mBufferIDs[pIB] : kInvalidIndex) << pMesh->getIndexCount() << pMesh->getTopology();
+                section << pMesh->getBaseVertex() << pMesh->getStartIndex();
+                section << mMaterialIDs[pMesh->getMaterial().get()] << pMesh->getObjectSpaceBoundingBox();
+
+                section << pMesh->getInstanceCount();
+                section.write(pMesh->getInstanceMatrices(), sizeof(glm::mat4) * pMesh->getInstanceCount());
+            }
+        }
+    }
+
+    void SceneSnapshot::writeLights(Writer& section)
+    {
+        // Area lights are generated from the meshes when the snapshot is loaded
+        uint32_t lightCount = 0;
+        for(uint32_t i = 0; i < mpScene->getLightCount(); i++)
+        {
+            uint32_t type = mpScene->getLight(i)->getType();
+            lightCount += (type == LightPoint || type == LightDirectional) ? 1 : 0;
+        }
+
+        section << lightCount;
+        for(uint32_t i = 0; i < mpScene->getLightCount(); i++)
+        {
+            const Light* pLight = mpScene->getLight(i).get();
+            switch(pLight->getType())
+            {
+            case LightPoint:
+            {
+                const PointLight* pPoint = (const PointLight*)pLight;
+                section << pLight->getType();
+                section.writeString(pLight->getName());
+                section << pPoint->getIntensity() << pPoint->getWorldPosition() << pPoint->getWorldDirection() << pPoint->getOpeningAngle() << pPoint->getPenumbraAngle();
+                break;
+            }
+            case LightDirectional:
+            {
+                const DirectionalLight* pDir = (const DirectionalLight*)pLight;
+                section << pLight->getType();
+                section.writeString(pLight->getName());
+                section << pDir->getIntensity() << pDir->getWorldDirection();
+                break;
+            }
+            default:
+                break;
+            }
+        }
+    }
+
+    void SceneSnapshot::writeCameras(Writer& section)
+    {
+        section << mpScene->getCameraCount();
+        for(uint32_t i = 0; i < mpScene->getCameraCount(); i++)
+        {
+            const Camera* pCamera = mpScene->getCamera(i).get();
+            section.writeString(pCamera->getName());
+            section << pCamera->getPosition() << pCamera->getTargetPosition() << pCamera->getUpVector();
+            section << pCamera->getFovY() << pCamera->getNearPlane() << pCamera->getFarPlane() << pCamera->getAspectRatio();
+        }
+    }
+
+    void SceneSnapshot::writePaths(Writer& section)
+    {
+        section << mpScene->getPathCount();
+        for(uint32_t pathID = 0; pathID < mpScene->getPathCount(); pathID++)
+        {
+            const ObjectPath* pPath = mpScene->getPath(pathID).get();
+            section.writeString(pPath->getName());
+            section << pPath->isRepeatOn() << pPath->getKeyFrameCount();
+            for(uint32_t frameID = 0; frameID < pPath->getKeyFrameCount(); frameID++)
+            {
+                const ObjectPath::Frame& frame = pPath->getKeyFrame(frameID);
+                section << frame.time << frame.position << frame.target << frame.up;
+            }
+        }
+    }
+
+    void SceneSnapshot::writeUserVariables(Writer& section)
+    {
+        section << mpScene->getUserVariableCount();
+        for(uint32_t varID = 0; varID < mpScene->getUserVariableCount(); varID++)
+        {
+            std::string name;
+            const Scene::UserVariable& var = mpScene->getUserVariable(varID, name);
+            section.writeString(name);
+            section << var.type;
+            switch(var.type)
+            {
+            case Scene::UserVariable::Type::String:
+                section.writeString(var.str);
+                break;
+            case Scene::UserVariable::Type::Vec2:
+                section << var.vec2;
+                break;
+            case Scene::UserVariable::Type::Vec3:
+                section << var.vec3;
+                break;
+            case Scene::UserVariable::Type::Vec4:
+                section << var.vec4;
+                break;
+            default:
+                // All the scalar types share the union
+                section << var.u64;
+                break;
+            }
+        }
+    }
+
+    bool SceneSnapshot::readFile(const std::string& filename)
+    {
+        std::ifstream stream(filename, std::ios::binary | std::ios::ate);
+        if(stream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Can't open scene snapshot file " + filename);
+            return false;
+        }
+        uint64_t fileSize = (uint64_t)stream.tellg();
+        stream.seekg(0);
+
+        FileHeader header;
+        stream.read((char*)&header, sizeof(header));
+        if(stream.fail() || memcmp(header.magic, kMagic, sizeof(kMagic)) != 0)
+        {
+            Logger::log(Logger::Level::Error, "File " + filename + " is not a scene snapshot");
+            return false;
+        }
+        if(header.version != kVersion)
+        {
+            Logger::log(Logger::Level::Error, "Scene snapshot " + filename + " has version " + std::to_string(header.version) + ", expected version " + std::to_string(kVersion) + ". Recreate the snapshot from the scene file");
+            return false;
+        }
+
+        std::vector<SectionEntry> table(header.sectionCount);
+        stream.read((char*)table.data(), sizeof(SectionEntry) * table.size());
+
+        std::vector<Reader> sections((size_t)SectionType::Count);
+        for(const SectionEntry& entry : table)
+        {
+            if(stream.fail() || (entry.offset + entry.size > fileSize))
+            {
+                Logger::log(Logger::Level::Error, "Scene snapshot " + filename + " is corrupted");
+                return false;
+            }
+            // Unknown sections are skipped
+            if(entry.type < (uint32_t)SectionType::Count)
+            {
+                uint8_t* pData = sections[entry.type].resize((size_t)entry.size);
+                stream.seekg(entry.offset);
+                stream.read((char*)pData, entry.size);
+            }
+        }
+
+        if(stream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Error when reading scene snapshot " + filename);
+            return false;
+        }
+
+        // The scene is created with a default camera. The snapshot always contains the cameras, so remove it
+        mpNewScene = Scene::create();
+        mpNewScene->deleteCamera(0);
+
+        const Reader& data = sections[(size_t)SectionType::Data];
+        bool success = readTextures(sections[(size_t)SectionType::Textures], data) &&
+            readBuffers(sections[(size_t)SectionType::Buffers], data) &&
+            readMaterials(sections[(size_t)SectionType::Materials]) &&
+            readModels(sections[(size_t)SectionType::Models]) &&
+            readLights(sections[(size_t)SectionType::Lights]) &&
+            readCameras(sections[(size_t)SectionType::Cameras]) &&
+            readPaths(sections[(size_t)SectionType::Paths]) &&
+            readUserVariables(sections[(size_t)SectionType::UserVariables]) &&
+            readGlobals(sections[(size_t)SectionType::Globals]);
+
+        if(success == false)
+        {
+            Logger::log(Logger::Level::Error, "Error when loading scene snapshot " + filename);
+            mpNewScene = nullptr;
+        }
+        return success;
+    }
+
+    bool SceneSnapshot::readTextures(Reader& section, const Reader& data)
+    {
+        uint32_t textureCount = 0;
+        section >> textureCount;
+        mNewTextures.resize(section.isValid() ? textureCount : 0);
+
+        for(uint32_t i = 0; i < mNewTextures.size(); i++)
+        {
+            bool isStored;
+            uint32_t type, width, height, mipLevels;
+            ResourceFormat format;
+            std::string name, sourceFilename;
+            section >> isStored >> type >> width >> height >> mipLevels >> format;
+            section.readString(name);
+            section.readString(sourceFilename);
+            if(section.isValid() == false)
+            {
+                return false;
+            }
+
+            Texture::SharedPtr pTexture;
+            if(isStored)
+            {
+                pTexture = Texture::create2D(width, height, format, 1, mipLevels, nullptr);
+                for(uint32_t mip = 0; mip < mipLevels; mip++)
+                {
+                    uint64_t offset;
+                    uint32_t size;
+                    section >> offset >> size;
+                    const uint8_t* pData = data.getData(offset, size);
+                    if(pData == nullptr)
+                    {
+                        return false;
+                    }
+                    pTexture->uploadSubresourceData(pData, size, mip, 0);
+                }
+                pTexture->setSourceFilename(sourceFilename);
+
+                // Share the texture with files loaded later. Textures compressed after loading (see Model::CompressTextures) don't match the file's contents, so they aren't shared
+                TextureCache::Key key;
+                bool matchesFile = (isCompressedFormat(format) == false) || hasSuffix(sourceFilename, ".dds", false);
+                if(matchesFile && sourceFilename.size() && TextureCache::createKey(sourceFilename, mipLevels > 1, isSrgbFormat(format), key) && (TextureCache::find(key) == nullptr))
+                {
+                    TextureCache::add(key, pTexture);
+                }
+            }
+            else
+            {
+                pTexture = createTextureFromFile(sourceFilename, mipLevels > 1, isSrgbFormat(format));
+            }
+
+            if(pTexture)
+            {
+                pTexture->setName(name);
+            }
+            mNewTextures[i] = pTexture;
+        }
+        return section.isValid();
+    }
+
+    bool SceneSnapshot::readBuffers(Reader& section, const Reader& data)
+    {
+        uint32_t bufferCount = 0;
+        section >> bufferCount;
+        mNewBuffers.resize(section.isValid() ? bufferCount : 0);
+
+        for(uint32_t i = 0; i < mNewBuffers.size(); i++)
+        {
+            Buffer::BindFlags bindFlags;
+            uint64_t size, offset;
+            section >> bindFlags >> size >> offset;
+            const uint8_t* pData = data.getData(offset, size);
+            if(section.isValid() == false || pData == nullptr)
+            {
+                return false;
+            }
+            mNewBuffers[i] = Buffer::create((size_t)size, bindFlags, Buffer::AccessFlags::None, pData);
+        }
+        return section.isValid();
+    }
+
+    bool SceneSnapshot::readMaterials(Reader& section)
+    {
+        bool validIndices = true;
+        auto readValue = [this, &section, &validIndices](MaterialValue& value)
+        {
+            uint32_t textureID;
+            section >> value.constantColor >> textureID;
+            if(textureID != kInvalidIndex)
+            {
+                validIndices = validIndices && (textureID < mNewTextures.size());
+                value.texture.pTexture = validIndices ? mNewTextures[textureID] : nullptr;
+            }
+        };
+
+        uint32_t materialCount = 0;
+        section >> materialCount;
+        mNewMaterials.resize(section.isValid() ? materialCount : 0);
+
+        for(uint32_t i = 0; i < mNewMaterials.size(); i++)
+        {
+            std::string name;
+            int32_t id;
+            bool doubleSided;
+            uint32_t layerCount;
+            section.readString(name);
+            section >> id >> doubleSided >> layerCount;
+            if(section.isValid() == false || layerCount > MatMaxLayers)
+            {
+                return false;
+            }
+
+            Material::SharedPtr pMaterial = Material::create(name);
+            for(uint32_t l = 0; l < layerCount; l++)
+            {
+                MaterialLayerDesc desc;
+                MaterialLayerValues values;
+                section >> desc.type >> desc.ndf >> desc.blending;
+                readValue(values.albedo);
+                readValue(values.roughness);
+                readValue(values.extraParam);
+                section >> values.pmf;
+                pMaterial->addLayer(desc, values);
+            }
+
+            MaterialValue alpha, normal, height, ambient;
+            readValue(alpha);
+            readValue(normal);
+            readValue(height);
+            readValue(ambient);
+            pMaterial->setAlphaValue(alpha);
+            pMaterial->setNormalValue(normal);
+            pMaterial->setHeightValue(height);
+            pMaterial->setAmbientValue(ambient);
+            pMaterial->setID(id);
+            pMaterial->setDoubleSided(doubleSided);
+            mNewMaterials[i] = pMaterial;
+        }
+
+        uint32_t sceneMaterialCount = 0;
+        section >> sceneMaterialCount;
+        for(uint32_t i = 0; section.isValid() && i < sceneMaterialCount; i++)
+        {
+            uint32_t materialID;
+            section >> materialID;
+            if(materialID >= mNewMaterials.size())
+            {
+                return false;
+            }
+            mpNewScene->addMaterial(mNewMaterials[materialID]);
+        }
+        return section.isValid() && validIndices;
+    }
+
+    bool SceneSnapshot::readModels(Reader& section)
+    {
+        uint32_t modelCount = 0;
+        section >> modelCount;
+        for(uint32_t modelID = 0; section.isValid() && modelID < modelCount; modelID++)
+        {
+            std::string filename, name;
+            bool isStored;
+            uint32_t activeAnimation;
+            section.readString(filename);
+            section.readString(name);
+            section >> isStored >> activeAnimation;
+
+            struct InstanceData
+            {
+                std::string name;
+                glm::vec3 translation, rotation, scaling;
+                bool isVisible;
+            };
+            uint32_t instanceCount = 0;
+            section >> instanceCount;
+            std::vector<InstanceData> instances(section.isValid() ? instanceCount : 0);
+            for(auto& instance : instances)
+            {
+                section.readString(instance.name);
+                section >> instance.translation >> instance.rotation >> instance.scaling >> instance.isVisible;
+            }
+            if(section.isValid() == false)
+            {
+                return false;
+            }
+
+            Model::SharedPtr pModel;
+            if(isStored)
+            {
+                pModel = Model::SharedPtr(new Model);
+                bool validIndices = true;
+                auto readIndices = [&section](std::vector<uint32_t>& indices, size_t resourceCount) -> bool
+                {
+                    uint32_t count = 0;
+                    section >> count;
+                    indices.resize(section.isValid() ? count : 0);
+                    bool valid = section.read(indices.data(), indices.size() * sizeof(uint32_t));
+                    for(uint32_t index : indices)
+                    {
+                        valid = valid && (index < resourceCount);
+                    }
+                    return valid;
+                };
+
+                std::vector<uint32_t> materialIDs, bufferIDs, textureIDs;
+                validIndices = readIndices(materialIDs, mNewMaterials.size()) && readIndices(bufferIDs, mNewBuffers.size()) && readIndices(textureIDs, mNewTextures.size());
+                if(validIndices == false)
+                {
+                    return false;
+                }
+                for(uint32_t id : materialIDs)
+                {
+                    pModel->mpMaterials.push_back(mNewMaterials[id]);
+                }
+                for(uint32_t id : bufferIDs)
+                {
+                    pModel->addBuffer(mNewBuffers[id]);
+                }
+                for(uint32_t id : textureIDs)
+                {
+                    pModel->addTexture(mNewTextures[id]);
+                }
+                pModel->rebuildMaterialIndex();
+
+                uint32_t meshCount = 0;
+                section >> meshCount;
+                std::vector<Vao::SharedPtr> vaos;
+                for(uint32_t meshID = 0; section.isValid() && validIndices && meshID < meshCount; meshID++)
+                {
+                    uint32_t vaoID = 0, vbCount = 0;
+                    section >> vaoID >> vbCount;
+                    Vao::VertexBufferDescVector vbDesc(section.isValid() ? vbCount : 0);
+                    for(auto& desc : vbDesc)
+                    {
+                        uint32_t bufferID, stepRate, elementCount;
+                        VertexLayout::InputClass inputClass;
+                        section >> bufferID >> desc.stride >> inputClass >> stepRate >> elementCount;
+                        validIndices = validIndices && (bufferID < mNewBuffers.size());
+                        desc.pBuffer = validIndices ? mNewBuffers[bufferID] : nullptr;
+                        desc.pLayout->setInputClass(inputClass, stepRate);
+                        for(uint32_t e = 0; section.isValid() && e < elementCount; e++)
+                        {
+                            std::string elementName;
+                            uint32_t offset, arraySize, shaderLocation;
+                            ResourceFormat format;
+                            section.readString(elementName);
+                            section >> offset >> format >> arraySize >> shaderLocation;
+                            desc.pLayout->addElement(elementName, offset, format, arraySize, shaderLocation);
+                        }
+                    }
+
+                    uint32_t vertexCount, indexBufferID, indexCount, baseVertex, startIndex, materialID, meshInstanceCount = 0;
+                    RenderContext::Topology topology;
+                    BoundingBox boundingBox;
+                    section >> vertexCount >> indexBufferID >> indexCount >> topology >> baseVertex >> startIndex >> materialID >> boundingBox >> meshInstanceCount;
+                    std::vector<glm::mat4> matrices(section.isValid() ? meshInstanceCount : 0);
+                    section.read(matrices.data(), sizeof(glm::mat4) * matrices.size());
+
+                    validIndices = validIndices && (materialID < mNewMaterials.size()) && ((indexBufferID == kInvalidIndex) || (indexBufferID < mNewBuffers.size())) && (vaoID <= vaos.size());
+                    if(section.isValid() == false || validIndices == false)
+                    {
+                        break;
+                    }
+
+                    Buffer::SharedPtr pIB = (indexBufferID == kInvalidIndex) ? nullptr : mNewBuffers[indexBufferID];
+                    Mesh::SharedPtr pMesh = Mesh::create(vbDesc, vertexCount, pIB, indexCount, topology, mNewMaterials[materialID], boundingBox, false);
+                    if(vaoID == vaos.size())
+                    {
+                        vaos.push_back(pMesh->getVao());
+                    }
+                    pMesh->setBufferRange(vaos[vaoID], baseVertex, startIndex);
+                    for(const glm::mat4& matrix : matrices)
+                    {
+                        pMesh->addInstance(matrix);
+                    }
+                    pModel->addMesh(pMesh);
+                }
+
+                if(section.isValid() == false || validIndices == false)
+                {
+                    return false;
+                }
+                pModel->calculateModelProperties();
+            }
+            else
+            {
+                pModel = Model::createFromFile(filename, mModelLoadFlags);
+                if(pModel == nullptr)
+                {
+                    return false;
+                }
+                if(activeAnimation != kInvalidIndex && activeAnimation < pModel->getAnimationsCount())
+                {
+                    pModel->setActiveAnimation(activeAnimation);
+                }
+            }
+
+            pModel->setName(name);
+            uint32_t sceneModelID = mpNewScene->addModel(pModel, filename, false);
+            for(uint32_t i = 0; i < instances.size(); i++)
+            {
+                const InstanceData& instance = instances[i];
+                mpNewScene->addModelInstance(sceneModelID, instance.name, instance.rotation, instance.scaling, instance.translation);
+                mpNewScene->setModelInstanceVisible(sceneModelID, i, instance.isVisible);
+            }
+        }
+        return section.isValid();
+    }
+
+    bool SceneSnapshot::readLights(Reader& section)
+    {
+        uint32_t lightCount = 0;
+        section >> lightCount;
+        for(uint32_t i = 0; section.isValid() && i < lightCount; i++)
+        {
+            uint32_t type;
+            std::string name;
+            section >> type;
+            section.readString(name);
+
+            glm::vec3 intensity, direction;
+            if(type == LightPoint)
+            {
+                glm::vec3 position;
+                float openingAngle, penumbraAngle;
+                section >> intensity >> position >> direction >> openingAngle >> penumbraAngle;
+                auto pLight = PointLight::create();
+                pLight->setName(name);
+                pLight->setIntensity(intensity);
+                pLight->setWorldPosition(position);
+                pLight->setWorldDirection(direction);
+                pLight->setOpeningAngle(openingAngle);
+                pLight->setPenumbraAngle(penumbraAngle);
+                mpNewScene->addLight(pLight);
+            }
+            else if(type == LightDirectional)
+            {
+                section >> intensity >> direction;
+                auto pLight = DirectionalLight::create();
+                pLight->setName(name);
+                pLight->setIntensity(intensity);
+                pLight->setWorldDirection(direction);
+                mpNewScene->addLight(pLight);
+            }
+            else
+            {
+                return false;
+            }
+        }
+        return section.isValid();
+    }
+
+    bool SceneSnapshot::readCameras(Reader& section)
+    {
+        uint32_t cameraCount = 0;
+        section >> cameraCount;
+        for(uint32_t i = 0; section.isValid() && i < cameraCount; i++)
+        {
+            std::string name;
+            glm::vec3 position, target, up;
+            float fovY, nearZ, farZ, aspectRatio;
+            section.readString(name);
+            section >> position >> target >> up >> fovY >> nearZ >> farZ >> aspectRatio;
+
+            auto pCamera = Camera::create();
+            pCamera->setName(name);
+            pCamera->setPosition(position);
+            pCamera->setTarget(target);
+            pCamera->setUpVector(up);
+            pCamera->setFovY(fovY);
+            pCamera->setDepthRange(nearZ, farZ);
+            pCamera->setAspectRatio(aspectRatio);
+            mpNewScene->addCamera(pCamera);
+        }
+        return section.isValid() && (mpNewScene->getCameraCount() > 0);
+    }
+
+    bool SceneSnapshot::readPaths(Reader& section)
+    {
+        uint32_t pathCount = 0;
+        section >> pathCount;
+        for(uint32_t pathID = 0; section.isValid() && pathID < pathCount; pathID++)
+        {
+            std::string name;
+            bool repeat;
+            uint32_t frameCount = 0;
+            section.readString(name);
+            section >> repeat >> frameCount;
+
+            auto pPath = ObjectPath::create();
+            pPath->setName(name);
+            pPath->setAnimationRepeat(repeat);
+            for(uint32_t frameID = 0; section.isValid() && frameID < frameCount; frameID++)
+            {
+                float time;
+                glm::vec3 position, target, up;
+                section >> time >> position >> target >> up;
+                pPath->addKeyFrame(time, position, target, up);
+            }
+            mpNewScene->addPath(pPath);
+        }
+        return section.isValid();
+    }
+
+    bool SceneSnapshot::readUserVariables(Reader& section)
+    {
+        uint32_t varCount = 0;
+        section >> varCount;
+        for(uint32_t varID = 0; section.isValid() && varID < varCount; varID++)
+        {
+            std::string name;
+            Scene::UserVariable var;
+            section.readString(name);
+            section >> var.type;
+            switch(var.type)
+            {
+            case Scene::UserVariable::Type::String:
+                section.readString(var.str);
+                break;
+            case Scene::UserVariable::Type::Vec2:
+                section >> var.vec2;
+                break;
+            case Scene::UserVariable::Type::Vec3:
+                section >> var.vec3;
+                break;
+            case Scene::UserVariable::Type::Vec4:
+                section >> var.vec4;
+                break;
+            default:
+                section >> var.u64;
+                break;
+            }
+            mpNewScene->addUserVariable(name, var);
+        }
+        return section.isValid();
+    }
+
+    bool SceneSnapshot::readGlobals(Reader& section)
+    {
+        uint32_t version, activeCamera, activePath;
+        glm::vec3 ambientIntensity;
+        float lightingScale, cameraSpeed;
+        bool hasAreaLights;
+        section >> version >> ambientIntensity >> lightingScale >> cameraSpeed >> activeCamera >> activePath >> hasAreaLights;
+        if(section.isValid() == false)
+        {
+            return false;
+        }
+
+        mpNewScene->setVersion(version);
+        mpNewScene->setAmbientIntensity(ambientIntensity);
+        mpNewScene->setLightingScale(lightingScale);
+        mpNewScene->setCameraSpeed(cameraSpeed);
+        mpNewScene->setActiveCamera(min(activeCamera, mpNewScene->getCameraCount() - 1));
+        if(activePath < mpNewScene->getPathCount())
+        {
+            mpNewScene->setActivePath(activePath);
+        }
+        if(hasAreaLights)
+        {
+            mpNewScene->createAreaLights();
+        }
+        return true;
+    }
+}
@@ -0,0 +1,120 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include "Scene.h"
+
+namespace Falcor
+{
+    /** Binary snapshot of a fully loaded scene.
+        The snapshot stores the resolved scene - vertex and index data, materials, textures in their final GPU format, lights, cameras, paths and user variables - so loading it skips the JSON parsing, model import, texture decoding and compression.
+        The file starts with a header and a section table. Every section starts at a kSectionAlignment-aligned offset, so it can be memory-mapped, and resource payloads in the data section are kDataAlignment-aligned.
+        Models with bones or animations are stored by filename and re-imported when the snapshot is loaded. Area lights are regenerated from the emissive meshes.
+    */
+    class SceneSnapshot
+    {
+    public:
+        static const uint32_t kVersion = 2;
+        static const uint32_t kSectionAlignment = 4096;
+        static const uint32_t kDataAlignment = 256;
+
+        enum class SectionType : uint32_t
+        {
+            Globals,
+            Textures,
+            Buffers,
+            Materials,
+            Models,
+            Lights,
+            Cameras,
+            Paths,
+            UserVariables,
+            Data,           ///< Raw texture and buffer payloads, referenced by the other sections
+
+            Count
+        };
+
+    protected:
+        friend class Scene;
+        static bool save(const std::string& filename, const Scene* pScene);
+        static Scene::SharedPtr load(const std::string& filename, uint32_t modelLoadFlags);
+
+    private:
+        class Writer;
+        class Reader;
+
+        SceneSnapshot(const Scene* pScene) : mpScene(pScene) {}
+
+        // Saving
+        bool writeFile(const std::string& filename);
+        void collectResources();
+        uint32_t addTexture(const Texture* pTexture);
+        uint32_t addBuffer(const Buffer* pBuffer);
+        uint32_t addMaterial(const Material* pMaterial);
+
+        void writeGlobals(Writer& section);
+        bool writeTextures(Writer& section, Writer& data);
+        void writeBuffers(Writer& section, Writer& data);
+        void writeMaterials(Writer& section);
+        void writeModels(Writer& section);
+        void writeLights(Writer& section);
+        void writeCameras(Writer& section);
+        void writePaths(Writer& section);
+        void writeUserVariables(Writer& section);
+
+        static bool isModelStored(const Model* pModel);
+
+        const Scene* mpScene;
+        std::map<const Texture*, uint32_t> mTextureIDs;
+        std::vector<const Texture*> mTextures;
+        std::map<const Buffer*, uint32_t> mBufferIDs;
+        std::vector<const Buffer*> mBuffers;
+        std::map<const Material*, uint32_t> mMaterialIDs;
+        std::vector<const Material*> mMaterials;
+
+        // Loading
+        bool readFile(const std::string& filename);
+        bool readTextures(Reader& section, const Reader& data);
+        bool readBuffers(Reader& section, const Reader& data);
+        bool readMaterials(Reader& section);
+        bool readModels(Reader& section);
+        bool readLights(Reader& section);
+        bool readCameras(Reader& section);
+        bool readPaths(Reader& section);
+        bool readUserVariables(Reader& section);
+        bool readGlobals(Reader& section);
+
+        Scene::SharedPtr mpNewScene;
+        uint32_t mModelLoadFlags = 0;
+        std::vector<Texture::SharedPtr> mNewTextures;
+        std::vector<Buffer::SharedPtr> mNewBuffers;
+        std::vector<Material::SharedPtr> mNewMaterials;
+    };
+}
@@ -0,0 +1,195 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "SceneStreamer.h"
+#include "Utils/ThreadPool.h"
+#include "glm/geometric.hpp"
+
+namespace Falcor
+{
+    SceneStreamer::~SceneStreamer() = default;
+
+    SceneStreamer::UniquePtr SceneStreamer::create(const Scene::SharedPtr& pScene, uint32_t modelLoadFlags, const StreamingScheduler::Settings& settings)
+    {
+        if(pScene == nullptr)
+        {
+            Logger::log(Logger::Level::Error, "SceneStreamer::create() - the scene is null");
+            return nullptr;
+        }
+
+        UniquePtr pStreamer = UniquePtr(new SceneStreamer(pScene, modelLoadFlags));
+
+        const uint32_t modelCount = pScene->getModelCount();
+        std::vector<uint64_t> modelBytes(modelCount, 0);
+        std::vector<StreamingScheduler::Instance> instances;
+        pStreamer->mModels.resize(modelCount);
+
+        for(uint32_t modelID = 0; modelID < modelCount; modelID++)
+        {
+            ModelData& data = pStreamer->mModels[modelID];
+            data.isStreamed = (pScene->getModelFilename(modelID).empty() == false);
+            if(data.isStreamed == false)
+            {
+                continue;
+            }
+
+            const Model* pModel = pScene->getModel(modelID).get();
+            data.name = pModel->getName();
+            data.center = pModel->getCenter();
+            data.radius = pModel->getRadius();
+            data.hasAnimations = pModel->hasAnimations();
+            data.activeAnimation = data.hasAnimations ? pModel->getActiveAnimation() : 0;
+            modelBytes[modelID] = pModel->getMemoryReport().bytes;
+
+            for(uint32_t instanceID = 0; instanceID < pScene->getModelInstanceCount(modelID); instanceID++)
+            {
+                const glm::mat4& transform = pScene->getModelInstance(modelID, instanceID).transformMatrix;
+                float scale = max(glm::length(glm::vec3(transform[0])), max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+
+                StreamingScheduler::Instance instance;
+                instance.modelID = modelID;
+                instance.center = glm::vec3(transform * glm::vec4(data.center, 1));
+                instance.radius = data.radius * scale;
+                instances.push_back(instance);
+            }
+        }
+
+        pStreamer->mpScheduler = StreamingScheduler::create(modelBytes, instances, settings);
+        if(pStreamer->mpScheduler == nullptr)
+        {
+            return nullptr;
+        }
+
+        // The models are already in memory. The first update releases the ones which aren't needed
+        for(uint32_t modelID = 0; modelID < modelCount; modelID++)
+        {
+            if(pStreamer->mModels[modelID].isStreamed)
+            {
+                pStreamer->mpScheduler->setModelResident(modelID);
+            }
+        }
+
+        return pStreamer;
+    }
+
+    void SceneStreamer::update(const Camera* pCamera)
+    {
+        if(mpScene->getModelCount() != mModels.size())
+        {
+            Logger::log(Logger::Level::Error, "SceneStreamer::update() - the scene's models changed after the streamer was created");
+            return;
+        }
+
+        finishLoads();
+
+        mpScheduler->update(pCamera->getPosition(), pCamera->getFovY());
+        for(uint32_t modelID : mpScheduler->getUnloadRequests())
+        {
+            unloadModel(modelID);
+        }
+        for(uint32_t modelID : mpScheduler->getLoadRequests())
+        {
+            startLoad(modelID);
+        }
+    }
+
+    void SceneStreamer::startLoad(uint32_t modelID)
+    {
+        std::shared_ptr<PendingLoad> pLoad = std::make_shared<PendingLoad>();
+        mModels[modelID].pPendingLoad = pLoad;
+
+        const std::string filename = mpScene->getModelFilename(modelID);
+        const uint32_t flags = mModelLoadFlags;
+        ThreadPool::getDefaultPool()->enqueue([pLoad, filename, flags]()
+        {
+            pLoad->pParsed = Model::parseFile(filename, flags);
+            pLoad->isDone = true;
+        });
+    }
+
+    void SceneStreamer::finishLoads()
+    {
+        for(uint32_t modelID = 0; modelID < (uint32_t)mModels.size(); modelID++)
+        {
+            ModelData& data = mModels[modelID];
+            if((data.pPendingLoad == nullptr) || (data.pPendingLoad->isDone == false))
+            {
+                continue;
+            }
+
+            // Resources can only be created on the main thread
+            Model::SharedPtr pModel;
+            if(data.pPendingLoad->pParsed)
+            {
+                pModel = Model::createFromParsedFile(data.pPendingLoad->pParsed.get());
+            }
+            data.pPendingLoad = nullptr;
+
+            if(pModel)
+            {
+                pModel->setName(data.name);
+                if(data.hasAnimations && pModel->hasAnimations())
+                {
+                    pModel->setActiveAnimation(data.activeAnimation);
+                }
+                mpScene->setModel(modelID, pModel);
+            }
+            else
+            {
+                Logger::log(Logger::Level::Error, "SceneStreamer - failed to reload model '" + mpScene->getModelFilename(modelID) + "'. The model will stay unloaded");
+            }
+            mpScheduler->onLoadFinished(modelID, pModel != nullptr);
+        }
+    }
+
+    void SceneStreamer::unloadModel(uint32_t modelID)
+    {
+        // Keep the state the user can change, so the reloaded model looks the same
+        ModelData& data = mModels[modelID];
+        const Model* pModel = mpScene->getModel(modelID).get();
+        data.name = pModel->getName();
+        if(data.hasAnimations)
+        {
+            data.activeAnimation = pModel->getActiveAnimation();
+        }
+
+        mpScene->setModel(modelID, createPlaceholder(data));
+    }
+
+    Model::SharedPtr SceneStreamer::createPlaceholder(const ModelData& data)
+    {
+        Model::SharedPtr pPlaceholder = Model::SharedPtr(new Model);
+        pPlaceholder->setName(data.name);
+        pPlaceholder->mCenter = data.center;
+        pPlaceholder->mRadius = data.radius;
+        pPlaceholder->mVertexCount = 0;
+        pPlaceholder->mPrimitiveCount = 0;
+        pPlaceholder->mInstanceCount = 0;
+        return pPlaceholder;
+    }
+}
@@ -0,0 +1,101 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <vector>
+#include "Graphics/Scene/Scene.h"
+#include "Graphics/Scene/StreamingScheduler.h"
+
+namespace Falcor
+{
+    /** Keeps only the models near the camera in memory, within a memory budget. See StreamingScheduler for the policy.\n
+        The streamer is created for a loaded scene. It records the size and bounds of every model, and releases the models which aren't needed on the first update. Released models are replaced in the scene with empty placeholders which keep their name, so the scene's model and instance IDs don't change and renderers draw nothing for them.\n
+        Files are parsed on the default thread pool, and the models' resources are created on the main thread when the parse is done. Reloaded models are created from their files, so changes made to the models after loading (shared materials, bound samplers, deleted meshes) are lost when they are unloaded.\n
+        Models without a filename are never released. Area lights reference their meshes, which stay in memory after the model is released. Models and instances must not be added or deleted while the streamer is active.
+    */
+    class SceneStreamer
+    {
+    public:
+        using UniquePtr = std::unique_ptr<SceneStreamer>;
+
+        /** Create a streamer.
+            \param[in] pScene The scene. All its models must be loaded
+            \param[in] modelLoadFlags The flags to reload the models with. Use the flags the scene was loaded with
+            \param[in] settings The scheduler settings
+            \return A new object, or nullptr if the settings are invalid
+        */
+        static UniquePtr create(const Scene::SharedPtr& pScene, uint32_t modelLoadFlags, const StreamingScheduler::Settings& settings);
+
+        /** Destroy the streamer. Parses which are still running finish in the background and are discarded. Models keep their current state
+        */
+        ~SceneStreamer();
+
+        /** Create the models which finished parsing, and load and unload models for the camera's position. Call once per frame on the main thread
+        */
+        void update(const Camera* pCamera);
+
+        /** Check whether a model is managed by the streamer
+        */
+        bool isModelStreamed(uint32_t modelID) const { return mModels[modelID].isStreamed; }
+
+        const StreamingScheduler* getScheduler() const { return mpScheduler.get(); }
+
+    private:
+        SceneStreamer(const Scene::SharedPtr& pScene, uint32_t modelLoadFlags) : mpScene(pScene), mModelLoadFlags(modelLoadFlags) {}
+        void startLoad(uint32_t modelID);
+        void finishLoads();
+        void unloadModel(uint32_t modelID);
+
+        /** A file parsed on the thread pool. Shared with the task, so the streamer can be destroyed while the task is running
+        */
+        struct PendingLoad
+        {
+            PendingLoad() : isDone(false) {}
+            std::shared_ptr<Model::ParsedFile> pParsed;
+            std::atomic<bool> isDone;
+        };
+
+        struct ModelData
+        {
+            bool isStreamed = false;
+            std::string name;
+            glm::vec3 center;
+            float radius = 0;
+            bool hasAnimations = false;
+            uint32_t activeAnimation = 0;
+            std::shared_ptr<PendingLoad> pPendingLoad;
+        };
+
+        Scene::SharedPtr mpScene;
+        uint32_t mModelLoadFlags;
+        StreamingScheduler::UniquePtr mpScheduler;
+        static Model::SharedPtr createPlaceholder(const ModelData& data);
+
+        std::vector<ModelData> mModels;
+    };
+}
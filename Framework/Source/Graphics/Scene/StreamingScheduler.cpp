@@ -0,0 +1,341 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "StreamingScheduler.h"
+#include "Graphics/Paths/ObjectPath.h"
+#include "glm/geometric.hpp"
+#include <algorithm>
+#include <map>
+#include <tuple>
+#include <cmath>
+
+namespace Falcor
+{
+    StreamingScheduler::UniquePtr StreamingScheduler::create(const std::vector<uint64_t>& modelBytes, const std::vector<Instance>& instances, const Settings& settings)
+    {
+        if(settings.cellSize <= 0)
+        {
+            Logger::log(Logger::Level::Error, "StreamingScheduler::create() - the cell size must be positive");
+            return nullptr;
+        }
+
+        UniquePtr pScheduler = UniquePtr(new StreamingScheduler(settings));
+        pScheduler->mModels.resize(modelBytes.size());
+        for(size_t i = 0; i < modelBytes.size(); i++)
+        {
+            pScheduler->mModels[i].bytes = modelBytes[i];
+        }
+
+        // Assign every instance to the cell containing its center
+        using CellKey = std::tuple<int32_t, int32_t, int32_t>;
+        std::map<CellKey, uint32_t> cellIndex;
+        std::vector<glm::vec3> cellMin;
+        std::vector<glm::vec3> cellMax;
+
+        for(const auto& instance : instances)
+        {
+            if(instance.modelID >= modelBytes.size())
+            {
+                Logger::log(Logger::Level::Error, "StreamingScheduler::create() - instance references model " + std::to_string(instance.modelID) + ", which doesn't exist");
+                return nullptr;
+            }
+
+            glm::vec3 coords = instance.center / settings.cellSize;
+            CellKey key((int32_t)std::floor(coords.x), (int32_t)std::floor(coords.y), (int32_t)std::floor(coords.z));
+            auto it = cellIndex.find(key);
+            if(it == cellIndex.end())
+            {
+                it = cellIndex.insert(std::make_pair(key, (uint32_t)pScheduler->mCells.size())).first;
+                pScheduler->mCells.push_back(Cell());
+                cellMin.push_back(glm::vec3(1e25f));
+                cellMax.push_back(glm::vec3(-1e25f));
+            }
+
+            uint32_t cellID = it->second;
+            pScheduler->mCells[cellID].instances.push_back((uint32_t)pScheduler->mInstances.size());
+            pScheduler->mInstances.push_back(instance);
+            cellMin[cellID] = glm::min(cellMin[cellID], instance.center - glm::vec3(instance.radius));
+            cellMax[cellID] = glm::max(cellMax[cellID], instance.center + glm::vec3(instance.radius));
+        }
+
+        // The cells' bounds cover the spheres of their instances, which can extend past the cell
+        for(size_t i = 0; i < pScheduler->mCells.size(); i++)
+        {
+            Cell& cell = pScheduler->mCells[i];
+            cell.center = (cellMin[i] + cellMax[i]) * 0.5f;
+            cell.radius = glm::length(cellMax[i] - cellMin[i]) * 0.5f;
+        }
+
+        return pScheduler;
+    }
+
+    void StreamingScheduler::update(const glm::vec3& cameraPosition, float fovY)
+    {
+        mLoadRequests.clear();
+        mUnloadRequests.clear();
+
+        for(auto& model : mModels)
+        {
+            model.priority = 0;
+            model.fits = false;
+        }
+
+        // Request the cells near the camera, and find the largest projected size of every model in them
+        const float invTanHalfFov = (fovY > 0) ? 1.0f / std::tan(fovY * 0.5f) : 1.0f;
+        const float keepDistance = mSettings.loadDistance * (1 + mSettings.hysteresis);
+        mStats.requestedCells = 0;
+
+        for(auto& cell : mCells)
+        {
+            float distance = max(glm::length(cell.center - cameraPosition) - cell.radius, 0.0f);
+            cell.isRequested = (distance <= mSettings.loadDistance) || (cell.isRequested && (distance <= keepDistance));
+            if(cell.isRequested == false)
+            {
+                continue;
+            }
+
+            mStats.requestedCells++;
+            for(uint32_t instanceID : cell.instances)
+            {
+                const Instance& instance = mInstances[instanceID];
+                float instanceDistance = max(glm::length(instance.center - cameraPosition), max(instance.radius, 1e-6f));
+                float projectedSize = instance.radius * invTanHalfFov / instanceDistance;
+                ModelData& model = mModels[instance.modelID];
+                // Instances with zero radius still need their model
+                model.priority = max(model.priority, max(projectedSize, 1e-6f));
+            }
+        }
+
+        // Sort the needed models by priority. Models in memory get a bonus, so they are only replaced by models which are clearly larger on screen
+        mSortedModels.clear();
+        for(uint32_t modelID = 0; modelID < (uint32_t)mModels.size(); modelID++)
+        {
+            const ModelData& model = mModels[modelID];
+            if((model.priority > 0) && (model.state != ModelState::Failed))
+            {
+                mSortedModels.push_back(modelID);
+            }
+        }
+
+        const float residentBonus = 1 + mSettings.hysteresis;
+        auto getEffectivePriority = [this, residentBonus](uint32_t modelID) -> float
+        {
+            const ModelData& model = mModels[modelID];
+            bool inMemory = (model.state == ModelState::Resident) || (model.state == ModelState::Loading);
+            return inMemory ? model.priority * residentBonus : model.priority;
+        };
+
+        std::sort(mSortedModels.begin(), mSortedModels.end(), [&getEffectivePriority](uint32_t a, uint32_t b) -> bool
+        {
+            float priorityA = getEffectivePriority(a);
+            float priorityB = getEffectivePriority(b);
+            return (priorityA != priorityB) ? (priorityA > priorityB) : (a < b);
+        });
+
+        // Pick the models which fit in the budget, highest priority first. A model which doesn't fit doesn't stop smaller models from fitting
+        uint64_t fitBytes = 0;
+        for(uint32_t modelID : mSortedModels)
+        {
+            ModelData& model = mModels[modelID];
+            if((mSettings.budget == 0) || (fitBytes + model.bytes <= mSettings.budget))
+            {
+                model.fits = true;
+                fitBytes += model.bytes;
+            }
+        }
+
+        // Unload the resident models which aren't needed or don't fit. Models which are still loading are unloaded by the update after they finish
+        for(uint32_t modelID = 0; modelID < (uint32_t)mModels.size(); modelID++)
+        {
+            if((mModels[modelID].state == ModelState::Resident) && (mModels[modelID].fits == false))
+            {
+                releaseModel(modelID);
+            }
+        }
+
+        // Start loading the models which fit
+        for(uint32_t modelID : mSortedModels)
+        {
+            if(mStats.loadingModels >= mSettings.maxPendingLoads)
+            {
+                break;
+            }
+
+            ModelData& model = mModels[modelID];
+            if((model.fits == false) || (model.state != ModelState::NotResident))
+            {
+                continue;
+            }
+
+            // Models which are still loading may not fit anymore, and hold memory until they finish. Wait for them instead of going over the budget
+            uint64_t committedBytes = mStats.residentBytes + mStats.loadingBytes;
+            if((mSettings.budget != 0) && (committedBytes + model.bytes > mSettings.budget))
+            {
+                continue;
+            }
+
+            model.state = ModelState::Loading;
+            mStats.loadingModels++;
+            mStats.loadingBytes += model.bytes;
+            mStats.loadCount++;
+            mLoadRequests.push_back(modelID);
+        }
+
+        mStats.peakBytes = max(mStats.peakBytes, mStats.residentBytes + mStats.loadingBytes);
+    }
+
+    void StreamingScheduler::releaseModel(uint32_t modelID)
+    {
+        ModelData& model = mModels[modelID];
+        assert(model.state == ModelState::Resident);
+        model.state = ModelState::NotResident;
+        mStats.residentModels--;
+        mStats.residentBytes -= model.bytes;
+        mStats.unloadCount++;
+        mUnloadRequests.push_back(modelID);
+    }
+
+    void StreamingScheduler::onLoadFinished(uint32_t modelID, bool success)
+    {
+        ModelData& model = mModels[modelID];
+        if(model.state != ModelState::Loading)
+        {
+            Logger::log(Logger::Level::Warning, "StreamingScheduler::onLoadFinished() - model " + std::to_string(modelID) + " wasn't requested");
+            return;
+        }
+
+        mStats.loadingModels--;
+        mStats.loadingBytes -= model.bytes;
+        if(success)
+        {
+            model.state = ModelState::Resident;
+            mStats.residentModels++;
+            mStats.residentBytes += model.bytes;
+        }
+        else
+        {
+            model.state = ModelState::Failed;
+        }
+    }
+
+    void StreamingScheduler::setModelResident(uint32_t modelID)
+    {
+        ModelData& model = mModels[modelID];
+        if(model.state == ModelState::Resident)
+        {
+            return;
+        }
+        if(model.state == ModelState::Loading)
+        {
+            mStats.loadingModels--;
+            mStats.loadingBytes -= model.bytes;
+        }
+
+        model.state = ModelState::Resident;
+        mStats.residentModels++;
+        mStats.residentBytes += model.bytes;
+        mStats.peakBytes = max(mStats.peakBytes, mStats.residentBytes + mStats.loadingBytes);
+    }
+
+    bool StreamingScheduler::isCellResident(uint32_t cellID) const
+    {
+        for(uint32_t instanceID : mCells[cellID].instances)
+        {
+            if(isModelResident(mInstances[instanceID].modelID) == false)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool StreamingScheduler::replayPath(StreamingScheduler* pScheduler, ObjectPath* pPath, const ReplayDesc& desc, ReplayResults& results)
+    {
+        uint32_t keyFrameCount = pPath->getKeyFrameCount();
+        if(keyFrameCount == 0)
+        {
+            Logger::log(Logger::Level::Error, "StreamingScheduler::replayPath() - the path has no key frames");
+            return false;
+        }
+
+        const double startTime = pPath->getKeyFrame(0).time;
+        const double duration = pPath->getKeyFrame(keyFrameCount - 1).time - startTime;
+        const uint32_t modelCount = pScheduler->getModelCount();
+
+        results = ReplayResults();
+        results.frameCount = (uint32_t)std::ceil(duration / desc.timeStep) + 1;
+        results.residentBytes.reserve(results.frameCount);
+        results.residentModels.reserve(results.frameCount);
+        results.residency.reserve(results.frameCount);
+
+        // Loads in flight, with the frame they finish in
+        std::vector<std::pair<uint32_t, uint32_t>> pendingLoads;
+
+        for(uint32_t frame = 0; frame < results.frameCount; frame++)
+        {
+            for(size_t i = 0; i < pendingLoads.size();)
+            {
+                if(pendingLoads[i].second <= frame)
+                {
+                    pScheduler->onLoadFinished(pendingLoads[i].first, true);
+                    pendingLoads[i] = pendingLoads.back();
+                    pendingLoads.pop_back();
+                }
+                else
+                {
+                    i++;
+                }
+            }
+
+            pPath->animate(startTime + frame * desc.timeStep);
+            pScheduler->update(pPath->getCurrentPosition(), desc.fovY);
+            for(uint32_t modelID : pScheduler->getLoadRequests())
+            {
+                pendingLoads.push_back(std::make_pair(modelID, frame + desc.loadLatency));
+            }
+
+            const Stats& stats = pScheduler->getStats();
+            results.residentBytes.push_back(stats.residentBytes);
+            results.residentModels.push_back(stats.residentModels);
+            if((pScheduler->getSettings().budget != 0) && (stats.residentBytes + stats.loadingBytes > pScheduler->getSettings().budget))
+            {
+                results.overBudgetFrames++;
+            }
+
+            std::vector<bool> residency(modelCount);
+            for(uint32_t modelID = 0; modelID < modelCount; modelID++)
+            {
+                residency[modelID] = pScheduler->isModelResident(modelID);
+            }
+            results.residency.push_back(residency);
+        }
+
+        results.stats = pScheduler->getStats();
+        return true;
+    }
+}
@@ -0,0 +1,197 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <memory>
+#include "glm/vec3.hpp"
+
+namespace Falcor
+{
+    class ObjectPath;
+
+    /** Decides which models of a scene should be in memory, based on the camera position and a memory budget. Used by SceneStreamer.\n
+        Model instances are partitioned into a uniform grid of cells using their world bounding spheres. Every update, the cells within the load distance of the camera are requested, and the models with instances in requested cells are loaded, ordered by their largest projected size. Models which don't fit in the budget aren't loaded, and resident models which don't fit anymore are unloaded.\n
+        Two kinds of hysteresis prevent models from being loaded and unloaded repeatedly - cells are released only after the camera moved past the load distance by the hysteresis fraction, and a resident model is evicted only for a model which is larger on screen by that fraction.\n
+        The scheduler doesn't touch any resources. It issues load and unload requests, and is told when a load finished. This allows replaying a camera path without a graphics device, see replayPath().
+    */
+    class StreamingScheduler
+    {
+    public:
+        using UniquePtr = std::unique_ptr<StreamingScheduler>;
+
+        struct Settings
+        {
+            float cellSize = 64;            ///< The edge length of the grid cells, in world units
+            float loadDistance = 256;       ///< Cells closer than this to the camera are requested
+            float hysteresis = 0.25f;       ///< Requested cells are kept until they are further than loadDistance * (1 + hysteresis). Resident models are kept unless a model larger on screen by this fraction needs their memory
+            uint64_t budget = 0;            ///< The memory budget of the streamed models, in bytes. 0 means unlimited
+            uint32_t maxPendingLoads = 4;   ///< The maximum number of models loading at the same time
+        };
+
+        /** The world bounding sphere of a model instance
+        */
+        struct Instance
+        {
+            uint32_t modelID;
+            glm::vec3 center;
+            float radius;
+        };
+
+        enum class ModelState
+        {
+            NotResident,
+            Loading,
+            Resident,
+            Failed,         ///< The model failed to load, and will not be requested again
+        };
+
+        struct Stats
+        {
+            uint32_t requestedCells = 0;
+            uint32_t residentModels = 0;
+            uint32_t loadingModels = 0;
+            uint64_t residentBytes = 0;
+            uint64_t loadingBytes = 0;      ///< Memory reserved for the models being loaded
+            uint64_t peakBytes = 0;         ///< The highest sum of resident and loading bytes since the scheduler was created
+            uint64_t loadCount = 0;         ///< The number of load requests since the scheduler was created
+            uint64_t unloadCount = 0;       ///< The number of unload requests since the scheduler was created
+        };
+
+        /** Settings of replayPath()
+        */
+        struct ReplayDesc
+        {
+            double timeStep = 1.0 / 60.0;   ///< Path time advanced per frame, in seconds
+            uint32_t loadLatency = 4;       ///< The number of frames a load takes to finish
+            float fovY = 0.785398f;         ///< The camera's vertical field of view, in radians
+        };
+
+        struct ReplayResults
+        {
+            uint32_t frameCount = 0;
+            std::vector<uint64_t> residentBytes;        ///< Per frame, after the frame's update
+            std::vector<uint32_t> residentModels;       ///< Per frame
+            std::vector<std::vector<bool>> residency;   ///< Per frame, whether each model was resident
+            uint32_t overBudgetFrames = 0;              ///< Frames in which the resident and loading bytes exceeded the budget
+            Stats stats;                                ///< The scheduler's statistics at the end of the replay
+        };
+
+        /** Create a new scheduler. All models start as not resident.
+            \param[in] modelBytes The memory used by each model when it's loaded. The index in the vector is the model ID
+            \param[in] instances The instances to partition. Models without instances are never loaded
+            \param[in] settings The scheduler settings
+        */
+        static UniquePtr create(const std::vector<uint64_t>& modelBytes, const std::vector<Instance>& instances, const Settings& settings);
+
+        /** Decide which models should be resident, and issue the load and unload requests. Call once per frame.
+            \param[in] cameraPosition The camera's world position
+            \param[in] fovY The camera's vertical field of view, in radians. Used to compute the projected size of instances. For orthographic cameras, pass 0 to prioritize by size over distance
+        */
+        void update(const glm::vec3& cameraPosition, float fovY);
+
+        /** Get the models the last update() requested to load. The caller starts loading them, and calls onLoadFinished() for each when it's done
+        */
+        const std::vector<uint32_t>& getLoadRequests() const { return mLoadRequests; }
+
+        /** Get the models the last update() requested to unload. They are considered not resident from that point on
+        */
+        const std::vector<uint32_t>& getUnloadRequests() const { return mUnloadRequests; }
+
+        /** Report that a model requested by update() finished loading
+            \param[in] modelID The model
+            \param[in] success Whether the load succeeded. Models which failed to load are not requested again
+        */
+        void onLoadFinished(uint32_t modelID, bool success);
+
+        /** Mark a model as resident without requesting it, for models which are already in memory. The next update() unloads it if it's not needed
+        */
+        void setModelResident(uint32_t modelID);
+
+        ModelState getModelState(uint32_t modelID) const { return mModels[modelID].state; }
+        bool isModelResident(uint32_t modelID) const { return mModels[modelID].state == ModelState::Resident; }
+
+        /** Get a model's priority from the last update() - the largest projected size of its instances in requested cells, as a fraction of the screen height. 0 if the model is not needed
+        */
+        float getModelPriority(uint32_t modelID) const { return mModels[modelID].priority; }
+        uint32_t getModelCount() const { return (uint32_t)mModels.size(); }
+
+        uint32_t getCellCount() const { return (uint32_t)mCells.size(); }
+        bool isCellRequested(uint32_t cellID) const { return mCells[cellID].isRequested; }
+
+        /** Check whether all the models with instances in a cell are resident
+        */
+        bool isCellResident(uint32_t cellID) const;
+
+        const Settings& getSettings() const { return mSettings; }
+
+        /** Change the budget. Takes effect on the next update()
+        */
+        void setBudget(uint64_t bytes) { mSettings.budget = bytes; }
+
+        const Stats& getStats() const { return mStats; }
+
+        /** Play a camera path and simulate the loads, without loading anything. Use it to check the scheduling and eviction policy against a budget.
+            The path is sampled at a fixed time step from its first key frame to its last, and objects attached to the path are moved along it. Loads finish after a fixed number of frames.
+            \param[in] pScheduler The scheduler. Use a new scheduler to get reproducible results
+            \param[in] pPath The camera path
+            \param[in] desc The replay settings
+            \param[out] results Per-frame residency and memory usage
+            \return false if the path has no key frames
+        */
+        static bool replayPath(StreamingScheduler* pScheduler, ObjectPath* pPath, const ReplayDesc& desc, ReplayResults& results);
+
+    private:
+        StreamingScheduler(const Settings& settings) : mSettings(settings) {}
+        void releaseModel(uint32_t modelID);
+
+        struct Cell
+        {
+            glm::vec3 center;
+            float radius = 0;
+            std::vector<uint32_t> instances;
+            bool isRequested = false;
+        };
+
+        struct ModelData
+        {
+            uint64_t bytes = 0;
+            ModelState state = ModelState::NotResident;
+            float priority = 0;
+            bool fits = false;
+        };
+
+        Settings mSettings;
+        std::vector<Instance> mInstances;
+        std::vector<Cell> mCells;
+        std::vector<ModelData> mModels;
+        std::vector<uint32_t> mLoadRequests;
+        std::vector<uint32_t> mUnloadRequests;
+        std::vector<uint32_t> mSortedModels;    // Scratch space for update()
+        Stats mStats;
+    };
+}
@@ -0,0 +1,153 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureCache.h"
+#include "Utils/OS.h"
+#include <algorithm>
+#include <cctype>
+
+namespace Falcor
+{
+    // Expired entries are removed every kCleanupInterval insertions
+    static const uint32_t kCleanupInterval = 64;
+
+    std::mutex TextureCache::sMutex;
+    std::map<TextureCache::Key, std::weak_ptr<Texture>> TextureCache::sEntries;
+    TextureCache::Stats TextureCache::sStats;
+    uint32_t TextureCache::sAddsSinceCleanup = 0;
+
+    bool TextureCache::Key::operator<(const Key& other) const
+    {
+        if(fullpath != other.fullpath) return fullpath < other.fullpath;
+        if(isSrgb != other.isSrgb) return isSrgb < other.isSrgb;
+        if(hasMips != other.hasMips) return hasMips < other.hasMips;
+        return compression < other.compression;
+    }
+
+    static bool isAbsolutePath(const std::string& path)
+    {
+        return (path.size() >= 2 && path[1] == ':') || (path.size() >= 2 && path[0] == '\\' && path[1] == '\\');
+    }
+
+    bool TextureCache::createKey(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Key& key)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            return false;
+        }
+
+        if(isAbsolutePath(fullpath) == false)
+        {
+            fullpath = canonicalizeFilename(getWorkingDirectory() + '\\' + fullpath);
+        }
+
+        // The file system is case-insensitive
+        std::transform(fullpath.begin(), fullpath.end(), fullpath.begin(), ::tolower);
+        key.fullpath = fullpath;
+        key.isSrgb = loadAsSrgb;
+        key.hasMips = generateMipLevels;
+        key.compression = Compression::None;
+        return true;
+    }
+
+    Texture::SharedPtr TextureCache::find(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        auto it = sEntries.find(key);
+        if(it == sEntries.end())
+        {
+            return nullptr;
+        }
+
+        Texture::SharedPtr pTexture = it->second.lock();
+        if(pTexture == nullptr)
+        {
+            sEntries.erase(it);
+            return nullptr;
+        }
+
+        sStats.hitCount++;
+        sStats.savedBytes += getTextureSize(pTexture.get());
+        return pTexture;
+    }
+
+    void TextureCache::add(const Key& key, const Texture::SharedPtr& pTexture)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sEntries[key] = pTexture;
+        sStats.loadCount++;
+
+        if(++sAddsSinceCleanup >= kCleanupInterval)
+        {
+            removeExpiredEntries();
+            sAddsSinceCleanup = 0;
+        }
+    }
+
+    void TextureCache::recordHit(const Texture::SharedPtr& pTexture)
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sStats.hitCount++;
+        sStats.savedBytes += getTextureSize(pTexture.get());
+    }
+
+    TextureCache::Stats TextureCache::getStats()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        return sStats;
+    }
+
+    void TextureCache::clear()
+    {
+        std::lock_guard<std::mutex> lock(sMutex);
+        sEntries.clear();
+        sStats = Stats();
+        sAddsSinceCleanup = 0;
+    }
+
+    uint64_t TextureCache::getTextureSize(const Texture* pTexture)
+    {
+        return pTexture->getMemoryUsage();
+    }
+
+    void TextureCache::removeExpiredEntries()
+    {
+        for(auto it = sEntries.begin(); it != sEntries.end();)
+        {
+            if(it->second.expired())
+            {
+                it = sEntries.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+}
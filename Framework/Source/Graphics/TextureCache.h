@@ -0,0 +1,112 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <map>
+#include <mutex>
+#include <string>
+#include "Core/Texture.h"
+
+namespace Falcor
+{
+    /** Process-wide cache of textures loaded from files.
+        Textures are identified by their canonicalized full path, load settings and compression, so the same file reached through different relative paths or by different models is only loaded once.
+        The cache holds weak references. A texture is released once the last model or material using it is destroyed, and loaded again the next time it's requested.
+        Cached textures are shared between models, so they must never be changed in place. Create a new texture instead, for example with Texture::createCompressed2DTexture().
+        All functions are thread-safe.
+    */
+    class TextureCache
+    {
+    public:
+        /** Block-compressed copies of a texture are cached separately from the texture itself, see Model::CompressTextures
+        */
+        enum class Compression
+        {
+            None,
+            Color,          ///< Compressed as a color texture
+            NormalMap,      ///< Compressed as a two-channel normal map
+        };
+
+        struct Key
+        {
+            std::string fullpath;   ///< Canonicalized, lower-case absolute path
+            bool isSrgb;
+            bool hasMips;
+            Compression compression = Compression::None;
+            bool operator<(const Key& other) const;
+        };
+
+        struct Stats
+        {
+            uint32_t loadCount = 0;         ///< Number of textures which were loaded from files
+            uint32_t hitCount = 0;          ///< Number of requests which were served from the cache
+            uint64_t savedBytes = 0;        ///< Texture memory which would have been allocated without the cache
+        };
+
+        /** Create a cache key for a file.
+            \param[in] filename The texture file. Searched for in the data directories
+            \param[in] generateMipLevels Whether the texture has a mip-chain
+            \param[in] loadAsSrgb Whether the texture is loaded in sRGB space
+            \param[out] key The key
+            \return false if the file can't be found, otherwise true
+        */
+        static bool createKey(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, Key& key);
+
+        /** Look for a texture in the cache. A successful lookup is counted as a cache hit.
+            \return The texture if it's cached and still alive, otherwise nullptr
+        */
+        static Texture::SharedPtr find(const Key& key);
+
+        /** Add a texture which was loaded from a file to the cache
+        */
+        static void add(const Key& key, const Texture::SharedPtr& pTexture);
+
+        /** Record a cache hit which didn't go through find(). Used when the same file is requested multiple times in a single batch
+        */
+        static void recordHit(const Texture::SharedPtr& pTexture);
+
+        /** Get the cache statistics
+        */
+        static Stats getStats();
+
+        /** Drop all the cache entries and reset the statistics. Textures which are still in use are not affected.
+        */
+        static void clear();
+
+        /** Get the amount of memory used by a texture, including its mip-chain.
+        */
+        static uint64_t getTextureSize(const Texture* pTexture);
+
+    private:
+        static void removeExpiredEntries();
+
+        static std::mutex sMutex;
+        static std::map<Key, std::weak_ptr<Texture>> sEntries;
+        static Stats sStats;
+        static uint32_t sAddsSinceCleanup;
+    };
+}
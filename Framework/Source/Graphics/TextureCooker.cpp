@@ -0,0 +1,446 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "TextureCooker.h"
+#include "Utils/Bitmap.h"
+#include "Utils/OS.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/PixelConversion.h"
+#include "Utils/BinaryFileStream.h"
+#include "Core/DDSHeader.h"
+#include <cmath>
+#include <algorithm>
+
+#ifdef FALCOR_GL
+static const bool kTopDown = false;
+#elif defined FALCOR_DX11
+static const bool kTopDown = true;
+#endif
+
+namespace Falcor
+{
+    using namespace DdsHelper;
+
+    static const uint32_t kDdsMagicNumber = 0x20534444;
+    static const uint32_t kDx10FourCC = 0x30315844;         // 'DX10'
+
+    // Cooked files are tagged in the reserved area of the DDS header. Compressed blocks can't be flipped on load, so compressed data is stored in the row order of the API it was cooked for
+    static const uint32_t kCookedMarkerIndex = 9;
+    static const uint32_t kCookedFlagsIndex = 10;
+    static const uint32_t kCookedMarker = 0x4B434C46;       // 'FLCK'
+    static const uint32_t kCookedCompressedFlag = 0x1;
+    static const uint32_t kCookedBottomUpFlag = 0x2;
+
+    namespace
+    {
+        struct MipImage
+        {
+            uint32_t width;
+            uint32_t height;
+            std::vector<float> pixels;  // Linear-space RGBA
+        };
+
+        static uint8_t unormFromFloat(float c)
+        {
+            return uint8_t(min(max(c, 0.0f), 1.0f) * 255.0f + 0.5f);
+        }
+
+        void decodeImage(const std::vector<uint8_t>& rgba, uint32_t width, uint32_t height, bool isSrgb, bool isNormalMap, MipImage& image)
+        {
+            image.width = width;
+            image.height = height;
+            image.pixels.resize(size_t(width) * height * 4);
+            ThreadPool::getDefaultPool()->parallelFor(0, height, [&](uint32_t y)
+            {
+                const uint8_t* pSrc = rgba.data() + size_t(y) * width * 4;
+                float* pDst = image.pixels.data() + size_t(y) * width * 4;
+                convertRgba8ToFloat(pSrc, pDst, width, isSrgb && (isNormalMap == false));
+                if(isNormalMap)
+                {
+                    for(uint32_t i = 0; i < width * 4; i++)
+                    {
+                        if((i & 3) != 3)
+                        {
+                            pDst[i] = pDst[i] * 2.0f - 1.0f;
+                        }
+                    }
+                }
+            });
+        }
+
+        void encodeImage(const MipImage& image, bool isSrgb, bool isNormalMap, std::vector<uint8_t>& rgba)
+        {
+            rgba.resize(image.pixels.size());
+            ThreadPool::getDefaultPool()->parallelFor(0, image.height, [&](uint32_t y)
+            {
+                const float* pSrc = image.pixels.data() + size_t(y) * image.width * 4;
+                uint8_t* pDst = rgba.data() + size_t(y) * image.width * 4;
+                if(isNormalMap == false)
+                {
+                    convertFloatToRgba8(pSrc, pDst, image.width, isSrgb);
+                    return;
+                }
+
+                for(uint32_t i = 0; i < image.width * 4; i++)
+                {
+                    bool isColor = (i & 3) != 3;
+                    pDst[i] = unormFromFloat(isColor ? (pSrc[i] * 0.5f + 0.5f) : pSrc[i]);
+                }
+            });
+        }
+
+        struct FilterTap
+        {
+            uint32_t first;
+            std::vector<float> weights;
+        };
+
+        // Box filter with fractional coverage. Every destination pixel averages the source area it covers, which also handles odd dimensions
+        std::vector<FilterTap> createFilterTaps(uint32_t srcSize, uint32_t dstSize)
+        {
+            std::vector<FilterTap> taps(dstSize);
+            float scale = float(srcSize) / float(dstSize);
+            for(uint32_t i = 0; i < dstSize; i++)
+            {
+                float start = float(i) * scale;
+                float end = start + scale;
+                taps[i].first = uint32_t(start);
+                for(uint32_t s = taps[i].first; s < srcSize && float(s) < end; s++)
+                {
+                    float coverage = min(end, float(s + 1)) - max(start, float(s));
+                    taps[i].weights.push_back(coverage / scale);
+                }
+            }
+            return taps;
+        }
+
+        void downsampleImage(const MipImage& src, bool isNormalMap, MipImage& dst)
+        {
+            dst.width = max(1U, src.width / 2);
+            dst.height = max(1U, src.height / 2);
+            dst.pixels.assign(size_t(dst.width) * dst.height * 4, 0.0f);
+
+            const std::vector<FilterTap> xTaps = createFilterTaps(src.width, dst.width);
+            const std::vector<FilterTap> yTaps = createFilterTaps(src.height, dst.height);
+
+            ThreadPool::getDefaultPool()->parallelFor(0, dst.height, [&](uint32_t y)
+            {
+                const FilterTap& yTap = yTaps[y];
+                float* pDstRow = dst.pixels.data() + size_t(y) * dst.width * 4;
+                for(uint32_t x = 0; x < dst.width; x++)
+                {
+                    const FilterTap& xTap = xTaps[x];
+                    float* pDst = pDstRow + x * 4;
+                    for(uint32_t j = 0; j < yTap.weights.size(); j++)
+                    {
+                        const float* pSrcRow = src.pixels.data() + size_t(yTap.first + j) * src.width * 4;
+                        for(uint32_t i = 0; i < xTap.weights.size(); i++)
+                        {
+                            const float* pSrc = pSrcRow + (xTap.first + i) * 4;
+                            float w = yTap.weights[j] * xTap.weights[i];
+                            pDst[0] += pSrc[0] * w;
+                            pDst[1] += pSrc[1] * w;
+                            pDst[2] += pSrc[2] * w;
+                            pDst[3] += pSrc[3] * w;
+                        }
+                    }
+
+                    if(isNormalMap)
+                    {
+                        float length = sqrtf(pDst[0] * pDst[0] + pDst[1] * pDst[1] + pDst[2] * pDst[2]);
+                        if(length > 0)
+                        {
+                            pDst[0] /= length;
+                            pDst[1] /= length;
+                            pDst[2] /= length;
+                        }
+                        else
+                        {
+                            pDst[0] = pDst[1] = 0;
+                            pDst[2] = 1;
+                        }
+                    }
+                }
+            });
+        }
+
+        void packChannels(const std::vector<uint8_t>& rgba, uint32_t channelCount, std::vector<uint8_t>& output)
+        {
+            size_t pixelCount = rgba.size() / 4;
+            size_t offset = output.size();
+            output.resize(offset + pixelCount * channelCount);
+            for(size_t p = 0; p < pixelCount; p++)
+            {
+                for(uint32_t c = 0; c < channelCount; c++)
+                {
+                    output[offset + p * channelCount + c] = rgba[p * 4 + c];
+                }
+            }
+        }
+
+        DXGI_FORMAT getCookedDxgiFormat(ResourceFormat format)
+        {
+            switch(format)
+            {
+            case ResourceFormat::R8Unorm:
+                return DXGI_FORMAT_R8_UNORM;
+            case ResourceFormat::RG8Unorm:
+                return DXGI_FORMAT_R8G8_UNORM;
+            case ResourceFormat::RGBA8Unorm:
+                return DXGI_FORMAT_R8G8B8A8_UNORM;
+            case ResourceFormat::RGBA8UnormSrgb:
+                return DXGI_FORMAT_R8G8B8A8_UNORM_SRGB;
+            case ResourceFormat::BC1Unorm:
+                return DXGI_FORMAT_BC1_UNORM;
+            case ResourceFormat::BC1UnormSrgb:
+                return DXGI_FORMAT_BC1_UNORM_SRGB;
+            case ResourceFormat::BC3Unorm:
+                return DXGI_FORMAT_BC3_UNORM;
+            case ResourceFormat::BC3UnormSrgb:
+                return DXGI_FORMAT_BC3_UNORM_SRGB;
+            case ResourceFormat::BC4Unorm:
+                return DXGI_FORMAT_BC4_UNORM;
+            case ResourceFormat::BC5Unorm:
+                return DXGI_FORMAT_BC5_UNORM;
+            case ResourceFormat::BC7Unorm:
+                return DXGI_FORMAT_BC7_UNORM;
+            case ResourceFormat::BC7UnormSrgb:
+                return DXGI_FORMAT_BC7_UNORM_SRGB;
+            default:
+                should_not_get_here();
+                return DXGI_FORMAT_UNKNOWN;
+            }
+        }
+
+        bool writeDdsFile(const std::string& filename, ResourceFormat format, uint32_t width, uint32_t height, uint32_t mipLevels, bool isBottomUp, const std::vector<uint8_t>& data)
+        {
+            DdsHeader header = {};
+            header.headerSize = sizeof(DdsHeader);
+            header.flags = DdsHeader::kCapsMask | DdsHeader::kHeightMask | DdsHeader::kWidthMask | DdsHeader::kPixelFormatMask | DdsHeader::kMipCountMask | DdsHeader::kLinearSizeMask;
+            header.width = width;
+            header.height = height;
+            header.linearSize = getFormatImageSize(format, width, height);
+            header.mipCount = mipLevels;
+            header.pixelFormat.structSize = sizeof(DdsHeader::PixelFormat);
+            header.pixelFormat.flags = DdsHeader::PixelFormat::kFourCCFlag;
+            header.pixelFormat.fourCC = kDx10FourCC;
+            header.caps[0] = DdsHeader::kCapsTextureMask | ((mipLevels > 1) ? (DdsHeader::kCapsComplexMask | DdsHeader::kCapsMipMapMask) : 0);
+            header.reserved[kCookedMarkerIndex] = kCookedMarker;
+            header.reserved[kCookedFlagsIndex] = (isCompressedFormat(format) ? kCookedCompressedFlag : 0) | (isBottomUp ? kCookedBottomUpFlag : 0);
+
+            DdsHeaderDX10 dx10Header = {};
+            dx10Header.dxgiFormat = getCookedDxgiFormat(format);
+            dx10Header.resourceDimension = D3D10_RESOURCE_DIMENSION_TEXTURE2D;
+            dx10Header.arraySize = 1;
+
+            BinaryFileStream stream(filename, BinaryFileStream::Mode::Write);
+            stream << kDdsMagicNumber << header << dx10Header;
+            stream.write(data.data(), data.size());
+            if(stream.isGood() == false)
+            {
+                Logger::log(Logger::Level::Error, "TextureCooker: Can't write file " + filename);
+                return false;
+            }
+            return true;
+        }
+    }
+
+    bool TextureCooker::cookTexture(const std::string& srcFilename, const std::string& dstFilename, const Desc& desc)
+    {
+        // Compressed data is stored in the API's row order, uncompressed data is stored top-down and flipped by the DDS loader if needed
+        bool loadTopDown = desc.compress ? kTopDown : true;
+        Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(srcFilename, loadTopDown);
+        if(pBitmap == nullptr)
+        {
+            return false;
+        }
+
+        uint32_t width = pBitmap->getWidth();
+        uint32_t height = pBitmap->getHeight();
+        uint32_t channelCount = pBitmap->getBytesPerPixel();
+        if(channelCount > 4)
+        {
+            Logger::log(Logger::Level::Error, "TextureCooker: Can't cook " + srcFilename + ". Only 8-bit per channel images are supported.");
+            return false;
+        }
+
+        bool isSrgb = desc.isSrgb && (desc.isNormalMap == false) && (channelCount >= 3);
+        ResourceFormat srcFormat;
+        switch(channelCount)
+        {
+        case 4:
+            srcFormat = isSrgb ? ResourceFormat::BGRA8UnormSrgb : ResourceFormat::BGRA8Unorm;
+            break;
+        case 3:
+            srcFormat = isSrgb ? ResourceFormat::BGRX8UnormSrgb : ResourceFormat::BGRX8Unorm;
+            break;
+        case 2:
+            srcFormat = ResourceFormat::RG8Unorm;
+            break;
+        default:
+            srcFormat = ResourceFormat::R8Unorm;
+            break;
+        }
+
+        std::vector<uint8_t> rgba;
+        convertToRgba8(srcFormat, pBitmap->getData(), width * height, rgba);
+        pBitmap = nullptr;
+
+        bool hasAlpha = false;
+        for(size_t i = 3; i < rgba.size(); i += 4)
+        {
+            if(rgba[i] != 255)
+            {
+                hasAlpha = true;
+                break;
+            }
+        }
+
+        // Select the output format
+        ResourceFormat dstFormat = desc.compress ? getBlockCompressedFormat(srcFormat, hasAlpha, desc.isNormalMap, desc.quality) : ResourceFormat::Unknown;
+        bool isBottomUp = (loadTopDown == false);
+        if(dstFormat == ResourceFormat::Unknown)
+        {
+            if(isBottomUp)
+            {
+                flipRows(rgba.data(), size_t(width) * 4, height);
+                isBottomUp = false;
+            }
+
+            switch(channelCount)
+            {
+            case 1:
+                dstFormat = ResourceFormat::R8Unorm;
+                break;
+            case 2:
+                dstFormat = ResourceFormat::RG8Unorm;
+                break;
+            default:
+                dstFormat = isSrgb ? ResourceFormat::RGBA8UnormSrgb : ResourceFormat::RGBA8Unorm;
+                break;
+            }
+        }
+
+        uint32_t mipLevels = 1;
+        if(desc.generateMips)
+        {
+            for(uint32_t size = max(width, height); size > 1; size >>= 1)
+            {
+                mipLevels++;
+            }
+        }
+
+        // Encode the mip-chain. Each level is filtered from the previous one in linear space
+        std::vector<uint8_t> data;
+        MipImage image;
+        if(mipLevels > 1)
+        {
+            decodeImage(rgba, width, height, isSrgb, desc.isNormalMap, image);
+        }
+
+        for(uint32_t mip = 0; mip < mipLevels; mip++)
+        {
+            uint32_t mipWidth = max(1U, width >> mip);
+            uint32_t mipHeight = max(1U, height >> mip);
+            if(mip > 0)
+            {
+                MipImage nextImage;
+                downsampleImage(image, desc.isNormalMap, nextImage);
+                image.width = nextImage.width;
+                image.height = nextImage.height;
+                image.pixels.swap(nextImage.pixels);
+                encodeImage(image, isSrgb, desc.isNormalMap, rgba);
+            }
+
+            if(isCompressedFormat(dstFormat))
+            {
+                std::vector<uint8_t> blocks;
+                compressImage(dstFormat, mipWidth, mipHeight, rgba.data(), blocks, desc.quality);
+                data.insert(data.end(), blocks.begin(), blocks.end());
+            }
+            else
+            {
+                packChannels(rgba, getFormatBytesPerBlock(dstFormat), data);
+            }
+        }
+
+        if(writeDdsFile(dstFilename, dstFormat, width, height, mipLevels, isBottomUp, data) == false)
+        {
+            return false;
+        }
+
+        Logger::log(Logger::Level::Info, "TextureCooker: Cooked " + srcFilename + " into " + dstFilename + " (" + to_string(dstFormat) + ", " + std::to_string(mipLevels) + " mip-levels)");
+        return true;
+    }
+
+    bool TextureCooker::cookTexture(const std::string& srcFilename, const Desc& desc)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(srcFilename, fullpath) == false)
+        {
+            Logger::log(Logger::Level::Error, "TextureCooker: Can't find file " + srcFilename);
+            return false;
+        }
+        return cookTexture(fullpath, getCookedFilename(fullpath, desc.isSrgb && (desc.isNormalMap == false)), desc);
+    }
+
+    std::string TextureCooker::getCookedFilename(const std::string& srcFullpath, bool isSrgb)
+    {
+        return srcFullpath + (isSrgb ? ".srgb.dds" : ".dds");
+    }
+
+    bool TextureCooker::findCookedTexture(const std::string& srcFilename, bool isSrgb, std::string& cookedFullpath)
+    {
+        std::string srcFullpath;
+        if(findFileInDataDirectories(srcFilename, srcFullpath) == false)
+        {
+            return false;
+        }
+
+        cookedFullpath = getCookedFilename(srcFullpath, isSrgb);
+        if(doesFileExist(cookedFullpath) == false || getFileModifiedTime(cookedFullpath) < getFileModifiedTime(srcFullpath))
+        {
+            return false;
+        }
+
+        // Make sure the file was cooked for the active API's row order
+        BinaryFileStream stream(cookedFullpath, BinaryFileStream::Mode::Read);
+        uint32_t magic = 0;
+        DdsHeader header;
+        stream >> magic >> header;
+        if(stream.isGood() == false || magic != kDdsMagicNumber || header.reserved[kCookedMarkerIndex] != kCookedMarker)
+        {
+            return false;
+        }
+
+        uint32_t flags = header.reserved[kCookedFlagsIndex];
+        bool isBottomUp = (flags & kCookedBottomUpFlag) != 0;
+        bool expectBottomUp = (flags & kCookedCompressedFlag) && (kTopDown == false);
+        return isBottomUp == expectBottomUp;
+    }
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include "Utils/BlockCompression.h"
+
+namespace Falcor
+{
+    /** Offline texture cooker.
+        Converts source images (anything FreeImage can read) into DDS files containing a full mip-chain and, optionally, block-compressed data. Loading a cooked texture is a plain file read followed by a texture upload, with no image decoding or GPU mip generation.
+        createTextureFromFile() transparently loads the cooked DDS instead of the source image when it exists and is newer than the source (see findCookedTexture()).
+        Only 8-bit per channel images are supported. HDR images should be exported as DDS directly.
+    */
+    class TextureCooker
+    {
+    public:
+        struct Desc
+        {
+            bool generateMips = true;       ///< Generate a full mip-chain. Mips are box-filtered in linear space
+            bool isSrgb = true;             ///< The source image is in sRGB space. Only valid for 3/4 channel images. Ignored for normal maps
+            bool isNormalMap = false;       ///< The image is a tangent-space normal map. Mips are renormalized and the texture is compressed to BC5
+            bool compress = true;           ///< Block-compress the texture. If the image can't be compressed, it is stored uncompressed
+            BlockCompressionQuality quality = BlockCompressionQuality::Normal;
+        };
+
+        /** Cook a texture.
+            \param[in] srcFilename The source image. Searched for in the data directories
+            \param[in] dstFilename The DDS file to write
+            \param[in] desc The cooking options
+            \return true on success, otherwise false. Errors are reported through the Logger
+        */
+        static bool cookTexture(const std::string& srcFilename, const std::string& dstFilename, const Desc& desc);
+
+        /** Cook a texture into the file createTextureFromFile() looks for (see getCookedFilename())
+        */
+        static bool cookTexture(const std::string& srcFilename, const Desc& desc);
+
+        /** Get the name of the cooked file for a source image. The name depends on the color space the texture is loaded in, so the same image can be cooked for both.
+        */
+        static std::string getCookedFilename(const std::string& srcFullpath, bool isSrgb);
+
+        /** Look for an up-to-date cooked version of a source image.
+            \param[in] srcFilename The source image. Searched for in the data directories
+            \param[in] isSrgb The color space the texture is loaded in
+            \param[out] cookedFullpath On success, the full path of the cooked DDS file
+            \return true if a cooked file exists, is newer than the source image and can be used with the active graphics API, otherwise false
+        */
+        static bool findCookedTexture(const std::string& srcFilename, bool isSrgb, std::string& cookedFullpath);
+    };
+}
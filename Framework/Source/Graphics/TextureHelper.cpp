@@ -32,6 +32,9 @@
 #include "Core/DDSHeader.h"
 #include "Utils/BinaryFileStream.h"
 #include "Utils/StringUtils.h"
+#include "Graphics/TextureCooker.h"
+#include "Utils/ThreadPool.h"
+#include "Graphics/TextureCache.h"
 
 #ifdef FALCOR_GL
 static const bool kTopDown = false;
@@ -114,8 +117,6 @@ namespace Falcor
 		case DXGI_FORMAT_BC6H_UF16:
 		case DXGI_FORMAT_BC6H_SF16:
 		case DXGI_FORMAT_BC7_TYPELESS:
-		case DXGI_FORMAT_BC7_UNORM:
-		case DXGI_FORMAT_BC7_UNORM_SRGB:
 			return ResourceFormat::Unknown;
 		case DXGI_FORMAT_R32G32B32A32_FLOAT:
 			return ResourceFormat::RGBA32Float;
@@ -245,6 +246,10 @@ namespace Falcor
 			return ResourceFormat::BC5Unorm;
 		case DXGI_FORMAT_BC5_SNORM:
 			return ResourceFormat::BC5Snorm;
+		case DXGI_FORMAT_BC7_UNORM:
+			return ResourceFormat::BC7Unorm;
+		case DXGI_FORMAT_BC7_UNORM_SRGB:
+			return ResourceFormat::BC7UnormSrgb;
 		default:
 			return ResourceFormat::Unknown;
 		}
@@ -539,14 +544,14 @@ namespace Falcor
 		}
 	}
 
-	void loadDDSDataFromFile(const std::string filename, DdsData& ddsData)
+	bool loadDDSDataFromFile(const std::string filename, DdsData& ddsData)
 	{
         std::string fullpath;
 		if (findFileInDataDirectories(filename, fullpath) == false)
 		{
 			Logger::log(Logger::Level::Error, std::string("Can't find texture file ") + filename);
 			//could not find file
-			return;
+			return false;
 		}
 
 		BinaryFileStream stream(fullpath, BinaryFileStream::Mode::Read);
@@ -558,7 +563,7 @@ namespace Falcor
 		{
 			//not valid dds file apparently
 			Logger::log(Logger::Level::Error, std::string("The dds file ") + filename + std::string(" is not a valid dds file"));
-			return;
+			return false;
 		}
 
         stream >> ddsData.header;
@@ -576,159 +581,319 @@ namespace Falcor
         uint32_t dataSize = stream.getRemainingStreamSize();
         ddsData.data.resize(dataSize);
         stream.read(ddsData.data.data(), dataSize);
+        return true;
 	}
 
-    Texture::SharedPtr createTextureFromDx10Dds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels)
+    bool decodeDx10Dds(DdsData& ddsData, const std::string& filename, DecodedTextureData& decoded)
     {
         uint32_t arraySize = ddsData.dx10Header.arraySize;
         assert(arraySize > 0);
+        uint32_t flipMipLevels = (decoded.mipLevels == Texture::kEntireMipChain) ? 1 : decoded.mipLevels;
+        decoded.width = ddsData.header.width;
+        decoded.height = ddsData.header.height;
+        decoded.arraySize = arraySize;
 
         switch(ddsData.dx10Header.resourceDimension)
         {
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE1D:
-            return Texture::create1D(ddsData.header.width, format, arraySize, mipLevels, ddsData.data.data());
+            decoded.type = Texture::Type::Texture1D;
+            return true;
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE2D:
             if(ddsData.dx10Header.miscFlag & DdsHeaderDX10::kCubeMapMask)
             {
-                flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 6 * arraySize, mipLevels == Texture::kEntireMipChain ? 1 : mipLevels, true);
-                return Texture::createCube(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data());
+                flipData(ddsData, decoded.format, ddsData.header.width, ddsData.header.height, 6 * arraySize, flipMipLevels, true);
+                decoded.type = Texture::Type::TextureCube;
             }
             else
             {
-                flipData(ddsData, format, ddsData.header.width, ddsData.header.height, arraySize, mipLevels == Texture::kEntireMipChain ? 1 : mipLevels);
-                return Texture::create2D(ddsData.header.width, ddsData.header.height, format, arraySize, mipLevels, ddsData.data.data());
+                flipData(ddsData, decoded.format, ddsData.header.width, ddsData.header.height, arraySize, flipMipLevels);
+                decoded.type = Texture::Type::Texture2D;
             }
+            return true;
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_TEXTURE3D:
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kEntireMipChain ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data());
+            flipData(ddsData, decoded.format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, flipMipLevels);
+            decoded.type = Texture::Type::Texture3D;
+            decoded.depth = ddsData.header.depth;
+            decoded.arraySize = 1;
+            return true;
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_BUFFER:
         case D3D10_RESOURCE_DIMENSION::D3D10_RESOURCE_DIMENSION_UNKNOWN:
             //these file formats are not supported 
             Logger::log(Logger::Level::Error, std::string("the resource dimension specified in ") + filename + std::string(" is not supported by Falcor"));
         default:
             should_not_get_here();
-            return nullptr;
+            return false;
         }
     }
 
-    Texture::SharedPtr createTextureFromLegacyDds(DdsData& ddsData, const std::string& filename, ResourceFormat format, uint32_t mipLevels)
+    bool decodeLegacyDds(DdsData& ddsData, DecodedTextureData& decoded)
     {
+        uint32_t flipMipLevels = (decoded.mipLevels == Texture::kEntireMipChain) ? 1 : decoded.mipLevels;
+        decoded.width = ddsData.header.width;
+        decoded.height = ddsData.header.height;
+
         //load the volume or 3D texture
         if(ddsData.header.flags & DdsHeader::kDepthMask)
         {
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, mipLevels == Texture::kEntireMipChain ? 1 : mipLevels);
-            return Texture::create3D(ddsData.header.width, ddsData.header.height, ddsData.header.depth, format, mipLevels, ddsData.data.data());
+            flipData(ddsData, decoded.format, ddsData.header.width, ddsData.header.height, ddsData.header.depth, flipMipLevels);
+            decoded.type = Texture::Type::Texture3D;
+            decoded.depth = ddsData.header.depth;
         }
         //load the cubemap texture
         else if(ddsData.header.caps[1] & DdsHeader::kCaps2CubeMapMask)
         {
             //				flipData(data, fmt, data.header.width, data.header.height, 6, mipLevels == Texture::kEntireMipChain ? 1 : mipLevels, true);
-            return Texture::createCube(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data());
+            decoded.type = Texture::Type::TextureCube;
         }
         //This is a 2D Texture
         else
         {
-            flipData(ddsData, format, ddsData.header.width, ddsData.header.height, 1, mipLevels == Texture::kEntireMipChain ? 1 : mipLevels);
-            return Texture::create2D(ddsData.header.width, ddsData.header.height, format, 1, mipLevels, ddsData.data.data());
+            flipData(ddsData, decoded.format, ddsData.header.width, ddsData.header.height, 1, flipMipLevels);
+            decoded.type = Texture::Type::Texture2D;
         }
-
-        should_not_get_here();
-        return nullptr;
+        return true;
     }
 
-	Texture::SharedPtr createTextureFromDDSFile(const std::string filename, bool generateMips)
+	bool decodeDDSFile(const std::string filename, bool generateMips, DecodedTextureData& decoded)
 	{
 		DdsData ddsData;
-		loadDDSDataFromFile(filename, ddsData);
+		if(loadDDSDataFromFile(filename, ddsData) == false)
+        {
+            return false;
+        }
 		
-		ResourceFormat format = getDdsResourceFormat(ddsData);
+		decoded.format = getDdsResourceFormat(ddsData);
 
         // One reason to hit this assertion is files that use an old header with R10G10B10A2 format.
         // Older exporters used to swap the R and B channels. Newer exporter probably don't do that or they specify the format using the DX10 header.
         // Our loader compiles with the older behavior. If you have an R10G10B10A2 texture, try one of the following:
         //  - Re-export the texture with an exporter that supports DX10 header
         //  - Switch the r and g masks in the 'checkDdsChannelMask()' call
-		assert(format != ResourceFormat::Unknown);
-
-		uint32_t mipLevels;
+		assert(decoded.format != ResourceFormat::Unknown);
 
 		if (generateMips)
 		{
-			mipLevels = Texture::kEntireMipChain;
+			decoded.mipLevels = Texture::kEntireMipChain;
 		} 
 		else
 		{
-			mipLevels = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
+			decoded.mipLevels = (ddsData.header.flags & DdsHeader::kMipCountMask) ? max(ddsData.header.mipCount, 1U) : 1;
 		}
 	
-		if (ddsData.hasDX10Header)
-		{
-            return createTextureFromDx10Dds(ddsData, filename, format, mipLevels);
-		}
-		else
-		{
-            return createTextureFromLegacyDds(ddsData, filename, format, mipLevels);
-		}
-		
-		return nullptr;
+        bool success = ddsData.hasDX10Header ? decodeDx10Dds(ddsData, filename, decoded) : decodeLegacyDds(ddsData, decoded);
+        decoded.data.swap(ddsData.data);
+        return success;
 	}
 
-	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb)
+    bool decodeTextureFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, DecodedTextureData& decoded)
     {
 #define no_srgb()   \
     if(loadAsSrgb)  \
     {               \
         Logger::log(Logger::Level::Warning, "createTexture2DFromFile() warning. " + std::to_string(pBitmap->getBytesPerPixel()) + " channel images doesn't have a matching sRGB format. Loading in linear space.");  \
     }
+
+        decoded = DecodedTextureData();
+        decoded.filename = filename;
 			
 		if (hasSuffix(filename, ".dds"))
 		{
-			return createTextureFromDDSFile(filename, generateMipLevels);
+			return decodeDDSFile(filename, generateMipLevels, decoded);
 		}
 
+        // Use the cooked texture if it's up-to-date. It already contains its mip-chain
+        std::string cookedFilename;
+        if(TextureCooker::findCookedTexture(filename, loadAsSrgb, cookedFilename))
+        {
+            if(decodeDDSFile(cookedFilename, false, decoded))
+            {
+                return true;
+            }
+            decoded = DecodedTextureData();
+            decoded.filename = filename;
+        }
+
         Bitmap::UniqueConstPtr pBitmap = Bitmap::createFromFile(filename, kTopDown);
+        if(pBitmap == nullptr)
+        {
+            return false;
+        }
+
+        ResourceFormat texFormat;
+        switch(pBitmap->getBytesPerPixel())
+        {
+        case 16:
+            texFormat = ResourceFormat::RGBA32Float;
+            break;
+        case 12:
+            texFormat = ResourceFormat::RGB32Float;
+            break;
+        case 8:
+            texFormat = ResourceFormat::RGBA16Float;
+            break;
+        case 6:
+            texFormat = ResourceFormat::RGB16Float;
+            break;
+        case 4:
+            texFormat = loadAsSrgb ? ResourceFormat::BGRA8UnormSrgb : ResourceFormat::BGRA8Unorm;
+            break;
+        case 3:
+            texFormat = loadAsSrgb ? ResourceFormat::BGRX8UnormSrgb : ResourceFormat::BGRX8Unorm;
+            break;
+        case 2:
+            no_srgb();
+            texFormat = ResourceFormat::RG8Unorm;
+            break;
+        case 1:
+            no_srgb();
+            texFormat = ResourceFormat::R8Unorm;
+            break;
+        default:
+            should_not_get_here();
+            return false;
+        }
+
+        decoded.type = Texture::Type::Texture2D;
+        decoded.width = pBitmap->getWidth();
+        decoded.height = pBitmap->getHeight();
+        decoded.format = texFormat;
+        decoded.mipLevels = generateMipLevels ? Texture::kEntireMipChain : 1;
+        decoded.pBitmap = std::move(pBitmap);
+        return true;
+#undef no_srgb
+    }
+
+    Texture::SharedPtr createTextureFromDecodedData(const DecodedTextureData& decoded)
+    {
+        const void* pData = decoded.pBitmap ? decoded.pBitmap->getData() : decoded.data.data();
         Texture::SharedPtr pTex;
+        switch(decoded.type)
+        {
+        case Texture::Type::Texture1D:
+            pTex = Texture::create1D(decoded.width, decoded.format, decoded.arraySize, decoded.mipLevels, pData);
+            break;
+        case Texture::Type::Texture2D:
+            pTex = Texture::create2D(decoded.width, decoded.height, decoded.format, decoded.arraySize, decoded.mipLevels, pData);
+            break;
+        case Texture::Type::Texture3D:
+            pTex = Texture::create3D(decoded.width, decoded.height, decoded.depth, decoded.format, decoded.mipLevels, pData);
+            break;
+        case Texture::Type::TextureCube:
+            pTex = Texture::createCube(decoded.width, decoded.height, decoded.format, decoded.arraySize, decoded.mipLevels, pData);
+            break;
+        default:
+            should_not_get_here();
+            return nullptr;
+        }
+
+        if(pTex)
+        {
+            pTex->setSourceFilename(decoded.filename);
+        }
+        return pTex;
+    }
 
-        if(pBitmap)
+	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb)
+    {
+        TextureCache::Key key;
+        bool hasKey = TextureCache::createKey(filename, generateMipLevels, loadAsSrgb, key);
+        if(hasKey)
         {
-            ResourceFormat texFormat;
-            switch(pBitmap->getBytesPerPixel())
+            Texture::SharedPtr pCached = TextureCache::find(key);
+            if(pCached)
             {
-            case 16:
-                texFormat = ResourceFormat::RGBA32Float;
-                break;
-            case 12:
-                texFormat = ResourceFormat::RGB32Float;
-                break;
-            case 8:
-                texFormat = ResourceFormat::RGBA16Float;
-                break;
-            case 6:
-                texFormat = ResourceFormat::RGB16Float;
-                break;
-            case 4:
-                texFormat = loadAsSrgb ? ResourceFormat::BGRA8UnormSrgb : ResourceFormat::BGRA8Unorm;
-                break;
-            case 3:
-                texFormat = loadAsSrgb ? ResourceFormat::BGRX8UnormSrgb : ResourceFormat::BGRX8Unorm;
-                break;
-            case 2:
-                no_srgb();
-                texFormat = ResourceFormat::RG8Unorm;
-                break;
-            case 1:
-                no_srgb();
-                texFormat = ResourceFormat::R8Unorm;
-                break;
-            default:
-                should_not_get_here();
-                break;
+                return pCached;
             }
+        }
+
+        DecodedTextureData decoded;
+        if(decodeTextureFile(filename, generateMipLevels, loadAsSrgb, decoded) == false)
+        {
+            return nullptr;
+        }
 
-            pTex = Texture::create2D(pBitmap->getWidth(), pBitmap->getHeight(), texFormat, 1, generateMipLevels ? Texture::kEntireMipChain : 1, pBitmap->getData());
-            pTex->setSourceFilename(filename);
+        Texture::SharedPtr pTex = createTextureFromDecodedData(decoded);
+        if(pTex && hasKey)
+        {
+            TextureCache::add(key, pTex);
         }
         return pTex;
     }
-#undef no_srgb
+
+    std::vector<Texture::SharedPtr> createTexturesFromFiles(const std::vector<TextureFileRequest>& requests)
+    {
+        std::vector<Texture::SharedPtr> textures(requests.size());
+
+        // Resolve the requests against the cache. Files requested more than once in the batch are decoded once
+        std::vector<TextureCache::Key> keys(requests.size());
+        std::vector<uint8_t> hasKey(requests.size(), 0);
+        std::vector<uint32_t> decodeList;
+        std::vector<std::pair<uint32_t, uint32_t>> duplicates;
+        std::map<TextureCache::Key, uint32_t> batchEntries;
+        for(uint32_t i = 0; i < (uint32_t)requests.size(); i++)
+        {
+            const TextureFileRequest& request = requests[i];
+            if(TextureCache::createKey(request.filename, request.generateMipLevels, request.loadAsSrgb, keys[i]) == false)
+            {
+                decodeList.push_back(i);
+                continue;
+            }
+            hasKey[i] = 1;
+
+            textures[i] = TextureCache::find(keys[i]);
+            if(textures[i] == nullptr)
+            {
+                auto existing = batchEntries.find(keys[i]);
+                if(existing != batchEntries.end())
+                {
+                    duplicates.push_back(std::make_pair(i, existing->second));
+                }
+                else
+                {
+                    batchEntries[keys[i]] = i;
+                    decodeList.push_back(i);
+                }
+            }
+        }
+
+        // Decode all the files in parallel, then create the textures on the calling thread
+        std::vector<DecodedTextureData> decoded(decodeList.size());
+        std::vector<uint8_t> decodeSuccess(decodeList.size(), 0);
+        ThreadPool::getDefaultPool()->parallelFor(0, (uint32_t)decodeList.size(), [&](uint32_t i)
+        {
+            const TextureFileRequest& request = requests[decodeList[i]];
+            decodeSuccess[i] = decodeTextureFile(request.filename, request.generateMipLevels, request.loadAsSrgb, decoded[i]) ? 1 : 0;
+        });
+
+        for(size_t i = 0; i < decodeList.size(); i++)
+        {
+            if(decodeSuccess[i])
+            {
+                uint32_t requestId = decodeList[i];
+                textures[requestId] = createTextureFromDecodedData(decoded[i]);
+                if(textures[requestId] && hasKey[requestId])
+                {
+                    TextureCache::add(keys[requestId], textures[requestId]);
+                }
+                // Release the CPU copy as soon as it was uploaded
+                decoded[i] = DecodedTextureData();
+            }
+        }
+
+        for(const auto& d : duplicates)
+        {
+            textures[d.first] = textures[d.second];
+            if(textures[d.first])
+            {
+                TextureCache::recordHit(textures[d.first]);
+            }
+        }
+
+        size_t sharedCount = requests.size() - decodeList.size();
+        if(sharedCount > 0)
+        {
+            Logger::log(Logger::Level::Info, "createTexturesFromFiles(): " + std::to_string(sharedCount) + " of " + std::to_string(requests.size()) + " textures were shared with already loaded textures");
+        }
+        return textures;
+    }
 }
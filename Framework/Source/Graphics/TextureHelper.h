@@ -27,7 +27,9 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
 #include "Core/Texture.h"
+#include "Utils/Bitmap.h"
 namespace Falcor
 {
     /*!
@@ -39,8 +41,50 @@ namespace Falcor
         \param[in] Filename Filename
         \param[in] bCreateMipChain true is mip-chain should be generated, otherwise false
         \param[in] bSrgb Load the texture using sRGB format. Only valid for 3/4 component textures.
+        If the file was cooked using TextureCooker and the cooked DDS is newer than the source image, the cooked file is loaded instead, including its mip-chain.
+        Textures are shared through the TextureCache. Requesting a file which is already loaded with the same settings returns the existing texture.
     */
 	Texture::SharedPtr createTextureFromFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb);
+
+    /** CPU-side texture data, decoded from a file and ready to be uploaded.
+    */
+    struct DecodedTextureData
+    {
+        std::string filename;
+        Texture::Type type = Texture::Type::Texture2D;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        uint32_t depth = 1;
+        uint32_t arraySize = 1;
+        uint32_t mipLevels = 1;
+        ResourceFormat format = ResourceFormat::Unknown;
+        std::shared_ptr<const Bitmap> pBitmap;      ///< The decoded image, for files loaded through FreeImage
+        std::vector<uint8_t> data;                  ///< The texture data, for DDS files
+    };
+
+    /** Decode a texture file without creating the texture. The function doesn't use the graphics API, so it can be called from worker threads.
+        The parameters are the same as createTextureFromFile().
+        \param[out] decoded The decoded data. Pass it to createTextureFromDecodedData() to create the texture
+        \return true on success, otherwise false
+    */
+    bool decodeTextureFile(const std::string& filename, bool generateMipLevels, bool loadAsSrgb, DecodedTextureData& decoded);
+
+    /** Create a texture from data decoded by decodeTextureFile(). Must be called from the thread which owns the graphics context.
+    */
+    Texture::SharedPtr createTextureFromDecodedData(const DecodedTextureData& decoded);
+
+    struct TextureFileRequest
+    {
+        std::string filename;
+        bool generateMipLevels = true;
+        bool loadAsSrgb = false;
+    };
+
+    /** Create multiple textures from files. The files are decoded in parallel on the default thread pool, the textures are created on the calling thread.
+        Files which are already in the TextureCache, or which appear multiple times in the list, are only loaded once.
+        \return The textures, in the order of the requests. Entries of files which failed to load are nullptr
+    */
+    std::vector<Texture::SharedPtr> createTexturesFromFiles(const std::vector<TextureFileRequest>& requests);
     
     /*! @} */
 }
\ No newline at end of file
@@ -0,0 +1,152 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VirtualTexture.h"
+
+namespace Falcor
+{
+    VirtualTexture::SharedPtr VirtualTexture::create(const std::string& filename, uint64_t memoryBudget, uint32_t maxPendingLoads)
+    {
+        VirtualTextureFile::SharedPtr pFile = VirtualTextureFile::open(filename);
+        if(pFile == nullptr)
+        {
+            return nullptr;
+        }
+        const VirtualTextureFile::Desc& desc = pFile->getDesc();
+
+        Texture::SharedPtr pTexture = Texture::create2D(desc.width, desc.height, desc.format, 1, desc.mipLevels, nullptr, true);
+        if(pTexture == nullptr)
+        {
+            Logger::log(Logger::Level::Error, "Can't create virtual texture '" + filename + "'. Sparse textures are not supported.");
+            return nullptr;
+        }
+
+        // Pages are committed one at a time, so they must cover whole hardware pages
+        uint32_t hwPageWidth, hwPageHeight, hwPageDepth;
+        pTexture->getSparsePageSize(hwPageWidth, hwPageHeight, hwPageDepth);
+        if(hwPageWidth == 0 || hwPageHeight == 0 || (desc.pageWidth % hwPageWidth) || (desc.pageHeight % hwPageHeight))
+        {
+            Logger::log(Logger::Level::Error, "Can't create virtual texture '" + filename + "'. The page size (" + std::to_string(desc.pageWidth) + "x" + std::to_string(desc.pageHeight) +
+                ") is not a multiple of the sparse page size (" + std::to_string(hwPageWidth) + "x" + std::to_string(hwPageHeight) + ").");
+            return nullptr;
+        }
+
+        SharedPtr pVirtualTexture = SharedPtr(new VirtualTexture);
+        pVirtualTexture->mpFile = pFile;
+        pVirtualTexture->mpTexture = pTexture;
+        pTexture->setSourceFilename(filename);
+
+        VirtualTextureResidencyManager::Desc managerDesc;
+        managerDesc.width = desc.width;
+        managerDesc.height = desc.height;
+        managerDesc.mipLevels = desc.mipLevels;
+        managerDesc.pageWidth = desc.pageWidth;
+        managerDesc.pageHeight = desc.pageHeight;
+        managerDesc.pageSizeInBytes = pFile->getPageSizeInBytes();
+        managerDesc.memoryBudget = memoryBudget;
+        managerDesc.maxPendingLoads = maxPendingLoads;
+        pVirtualTexture->mpManager = std::make_unique<VirtualTextureResidencyManager>(managerDesc);
+        pVirtualTexture->mpLoader = std::make_unique<VirtualTexturePageLoader>(pFile);
+
+        const VirtualTexturePageTable& pageTable = pVirtualTexture->mpManager->getPageTable();
+        pageTable.buildResidencyMap(pVirtualTexture->mResidencyData);
+        pVirtualTexture->mpResidencyMap = Texture::create2D(pageTable.getPageCountX(0), pageTable.getPageCountY(0), ResourceFormat::R8Uint, 1, 1, pVirtualTexture->mResidencyData.data());
+        return pVirtualTexture;
+    }
+
+    void VirtualTexture::setPageResidency(const VirtualTexturePageId& page, bool isResident)
+    {
+        uint32_t x, y, width, height;
+        mpManager->getPageTable().getPageRegion(page, x, y, width, height);
+        mpTexture->setSparseResidencyRegion(isResident, page.mipLevel, x, y, 0, width, height);
+    }
+
+    void VirtualTexture::uploadPage(const VirtualTexturePageId& page, const std::vector<uint8_t>& data)
+    {
+        uint32_t x, y, width, height;
+        mpManager->getPageTable().getPageRegion(page, x, y, width, height);
+
+        const VirtualTextureFile::Desc& desc = mpFile->getDesc();
+        if(width == desc.pageWidth && height == desc.pageHeight)
+        {
+            mpTexture->uploadSubresourceRegion(data.data(), page.mipLevel, x, y, 0, width, height);
+            return;
+        }
+
+        // The page extends past the edge of the mip-level. Drop the padding
+        const uint32_t rowCount = (height + getFormatHeightCompressionRatio(desc.format) - 1) / getFormatHeightCompressionRatio(desc.format);
+        const uint32_t srcRowPitch = getFormatRowPitch(desc.format, desc.pageWidth);
+        const uint32_t dstRowPitch = getFormatRowPitch(desc.format, width);
+        mRegionData.resize(dstRowPitch * rowCount);
+        for(uint32_t row = 0; row < rowCount; row++)
+        {
+            memcpy(mRegionData.data() + row * dstRowPitch, data.data() + row * srcRowPitch, dstRowPitch);
+        }
+        mpTexture->uploadSubresourceRegion(mRegionData.data(), page.mipLevel, x, y, 0, width, height);
+    }
+
+    void VirtualTexture::update(const uint32_t* pFeedback, size_t count)
+    {
+        const VirtualTextureResidencyManager::Update& residencyUpdate = mpManager->processFeedback(pFeedback, count);
+        bool residencyChanged = residencyUpdate.evictions.size() > 0;
+
+        for(const auto& page : residencyUpdate.evictions)
+        {
+            setPageResidency(page, false);
+        }
+
+        for(const auto& page : residencyUpdate.loads)
+        {
+            mpLoader->requestPage(page);
+        }
+
+        mpLoader->getCompletedPages(mCompletedPages);
+        for(const auto& loaded : mCompletedPages)
+        {
+            if(loaded.success)
+            {
+                setPageResidency(loaded.page, true);
+                uploadPage(loaded.page, loaded.data);
+                mpManager->onPageLoaded(loaded.page);
+                residencyChanged = true;
+            }
+            else
+            {
+                Logger::log(Logger::Level::Warning, "VirtualTexture - failed to read page (" + std::to_string(loaded.page.x) + ", " + std::to_string(loaded.page.y) + ") of mip-level " + std::to_string(loaded.page.mipLevel) +
+                    " from '" + mpTexture->getSourceFilename() + "'.");
+                mpManager->onPageLoadFailed(loaded.page);
+            }
+        }
+
+        if(residencyChanged)
+        {
+            mpManager->getPageTable().buildResidencyMap(mResidencyData);
+            mpResidencyMap->uploadSubresourceData(mResidencyData.data(), (uint32_t)mResidencyData.size());
+        }
+    }
+}
@@ -0,0 +1,89 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <memory>
+#include "Core/Texture.h"
+#include "VirtualTextureFile.h"
+#include "VirtualTextureResidencyManager.h"
+#include "VirtualTexturePageLoader.h"
+
+namespace Falcor
+{
+    /** A sparse virtual texture streamed from a pre-tiled file (see VirtualTextureFile).\n
+        The texture is created without physical memory. Each frame, call update() with the pages the renderer needed. The pages are read in the background, and committed and uploaded once they arrive. Pages which weren't used recently are de-committed when the memory budget is exhausted.\n
+        Shaders should clamp the sampled LOD using the residency map (see getResidencyMap()), which holds the finest resident mip-level for each page of mip-level 0.\n
+        Requires GL_ARB_sparse_texture. Not supported in DX11.
+    */
+    class VirtualTexture
+    {
+    public:
+        using SharedPtr = std::shared_ptr<VirtualTexture>;
+        using SharedConstPtr = std::shared_ptr<const VirtualTexture>;
+
+        /** Create a virtual texture
+            \param[in] filename The virtual texture file
+            \param[in] memoryBudget The physical memory budget in bytes. Must be large enough to hold the mip tail
+            \param[in] maxPendingLoads Optional. Maximum number of page reads in flight
+            \return A new object, or nullptr if the file couldn't be opened or sparse textures are not supported
+        */
+        static SharedPtr create(const std::string& filename, uint64_t memoryBudget, uint32_t maxPendingLoads = 64);
+
+        /** Process the page requests of a frame and upload the pages which finished loading. Call once per frame, on the main thread.
+            \param[in] pFeedback Packed page IDs (see VirtualTexturePageId::pack()). Duplicates are allowed
+            \param[in] count Number of requests
+        */
+        void update(const uint32_t* pFeedback, size_t count);
+
+        /** Get the sparse texture
+        */
+        const Texture::SharedPtr& getTexture() const { return mpTexture; }
+
+        /** Get the residency map - an R8Uint texture with a texel per page of mip-level 0, holding the finest resident mip-level covering it
+        */
+        const Texture::SharedPtr& getResidencyMap() const { return mpResidencyMap; }
+
+        const VirtualTextureFile::Desc& getDesc() const { return mpFile->getDesc(); }
+        const VirtualTextureResidencyManager::Stats& getStats() const { return mpManager->getStats(); }
+
+    private:
+        VirtualTexture() = default;
+        void setPageResidency(const VirtualTexturePageId& page, bool isResident);
+        void uploadPage(const VirtualTexturePageId& page, const std::vector<uint8_t>& data);
+
+        VirtualTextureFile::SharedPtr mpFile;
+        std::unique_ptr<VirtualTextureResidencyManager> mpManager;
+        std::unique_ptr<VirtualTexturePageLoader> mpLoader;
+        Texture::SharedPtr mpTexture;
+        Texture::SharedPtr mpResidencyMap;
+        std::vector<VirtualTexturePageLoader::LoadedPage> mCompletedPages;
+        std::vector<uint8_t> mRegionData;
+        std::vector<uint8_t> mResidencyData;
+    };
+}
@@ -0,0 +1,253 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VirtualTextureFile.h"
+#include "Core/Texture.h"
+#include "Utils/OS.h"
+
+namespace Falcor
+{
+    static const uint32_t kVirtualTextureMagic = 0x46545646;    // 'FVTF'
+    static const uint32_t kVirtualTextureVersion = 1;
+
+    struct VirtualTextureFileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t width;
+        uint32_t height;
+        uint32_t mipLevels;
+        uint32_t format;
+        uint32_t pageWidth;
+        uint32_t pageHeight;
+        uint32_t pageCount;
+        uint32_t pageSize;
+    };
+
+    static uint32_t getPageSize(const VirtualTextureFile::Desc& desc)
+    {
+        return getFormatImageSize(desc.format, desc.pageWidth, desc.pageHeight);
+    }
+
+    static bool isValidDesc(const VirtualTextureFile::Desc& desc)
+    {
+        if(desc.width == 0 || desc.height == 0 || desc.mipLevels == 0 || desc.pageWidth == 0 || desc.pageHeight == 0 || desc.format == ResourceFormat::Unknown)
+        {
+            return false;
+        }
+        if((desc.pageWidth % getFormatWidthCompressionRatio(desc.format)) || (desc.pageHeight % getFormatHeightCompressionRatio(desc.format)))
+        {
+            return false;
+        }
+        // Make sure the page coordinates fit in a packed page ID
+        uint32_t pagesX = (desc.width + desc.pageWidth - 1) / desc.pageWidth;
+        uint32_t pagesY = (desc.height + desc.pageHeight - 1) / desc.pageHeight;
+        return pagesX <= VirtualTexturePageId::kMaxPagesPerAxis && pagesY <= VirtualTexturePageId::kMaxPagesPerAxis && desc.mipLevels <= 255;
+    }
+
+    /** Copy a page from a mip-level, repeating the last row and column of elements (texels or blocks) past the edge of the mip-level
+    */
+    static void extractPage(const VirtualTextureFile::Desc& desc, const uint8_t* pMip, uint32_t mipWidth, uint32_t mipHeight, const VirtualTexturePageId& page, uint8_t* pDst)
+    {
+        const uint32_t ratioX = getFormatWidthCompressionRatio(desc.format);
+        const uint32_t ratioY = getFormatHeightCompressionRatio(desc.format);
+        const uint32_t elementSize = getFormatBytesPerBlock(desc.format);
+        const uint32_t mipElementsX = (mipWidth + ratioX - 1) / ratioX;
+        const uint32_t mipElementsY = (mipHeight + ratioY - 1) / ratioY;
+        const uint32_t pageElementsX = desc.pageWidth / ratioX;
+        const uint32_t pageElementsY = desc.pageHeight / ratioY;
+        const uint32_t srcRowPitch = mipElementsX * elementSize;
+
+        uint32_t startX = page.x * pageElementsX;
+        uint32_t startY = page.y * pageElementsY;
+        uint32_t copyX = min(pageElementsX, mipElementsX - startX);
+
+        for(uint32_t y = 0; y < pageElementsY; y++)
+        {
+            uint32_t srcY = min(startY + y, mipElementsY - 1);
+            const uint8_t* pSrcRow = pMip + srcY * srcRowPitch + startX * elementSize;
+            uint8_t* pDstRow = pDst + y * pageElementsX * elementSize;
+            memcpy(pDstRow, pSrcRow, copyX * elementSize);
+            for(uint32_t x = copyX; x < pageElementsX; x++)
+            {
+                memcpy(pDstRow + x * elementSize, pSrcRow + (copyX - 1) * elementSize, elementSize);
+            }
+        }
+    }
+
+    bool VirtualTextureFile::write(const std::string& filename, const Desc& desc, const std::vector<std::vector<uint8_t>>& mipData)
+    {
+        if(isValidDesc(desc) == false)
+        {
+            Logger::log(Logger::Level::Error, "Can't write virtual texture file '" + filename + "'. Invalid texture description.");
+            return false;
+        }
+        if(mipData.size() < desc.mipLevels)
+        {
+            Logger::log(Logger::Level::Error, "Can't write virtual texture file '" + filename + "'. Missing mip-level data.");
+            return false;
+        }
+
+        VirtualTexturePageTable layout(desc.width, desc.height, desc.mipLevels, desc.pageWidth, desc.pageHeight);
+        for(uint32_t mip = 0; mip < desc.mipLevels; mip++)
+        {
+            uint32_t mipWidth = max(1U, desc.width >> mip);
+            uint32_t mipHeight = max(1U, desc.height >> mip);
+            if(mipData[mip].size() < getFormatImageSize(desc.format, mipWidth, mipHeight))
+            {
+                Logger::log(Logger::Level::Error, "Can't write virtual texture file '" + filename + "'. Mip-level " + std::to_string(mip) + " is too small.");
+                return false;
+            }
+        }
+
+        std::ofstream stream(filename, std::ios::binary);
+        if(stream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Can't open virtual texture file '" + filename + "' for writing.");
+            return false;
+        }
+
+        VirtualTextureFileHeader header;
+        header.magic = kVirtualTextureMagic;
+        header.version = kVirtualTextureVersion;
+        header.width = desc.width;
+        header.height = desc.height;
+        header.mipLevels = desc.mipLevels;
+        header.format = (uint32_t)desc.format;
+        header.pageWidth = desc.pageWidth;
+        header.pageHeight = desc.pageHeight;
+        header.pageCount = layout.getTotalPageCount();
+        header.pageSize = getPageSize(desc);
+        stream.write((const char*)&header, sizeof(header));
+
+        std::vector<uint8_t> page(header.pageSize);
+        for(uint32_t i = 0; i < layout.getTotalPageCount(); i++)
+        {
+            VirtualTexturePageId pageId = layout.getPageId(i);
+            uint32_t mipWidth = max(1U, desc.width >> pageId.mipLevel);
+            uint32_t mipHeight = max(1U, desc.height >> pageId.mipLevel);
+            extractPage(desc, mipData[pageId.mipLevel].data(), mipWidth, mipHeight, pageId, page.data());
+            stream.write((const char*)page.data(), page.size());
+        }
+
+        if(stream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Error while writing virtual texture file '" + filename + "'.");
+            return false;
+        }
+        return true;
+    }
+
+    bool VirtualTextureFile::writeFromTexture(const std::string& filename, const Texture* pTexture, uint32_t pageWidth, uint32_t pageHeight)
+    {
+        if(pTexture->getType() != Texture::Type::Texture2D || pTexture->getArraySize() != 1)
+        {
+            Logger::log(Logger::Level::Error, "Can't write virtual texture file '" + filename + "'. Only 2D textures with a single array slice are supported.");
+            return false;
+        }
+
+        Desc desc;
+        desc.width = pTexture->getWidth();
+        desc.height = pTexture->getHeight();
+        desc.mipLevels = pTexture->getMipLevels();
+        desc.format = pTexture->getFormat();
+        desc.pageWidth = pageWidth;
+        desc.pageHeight = pageHeight;
+
+        std::vector<std::vector<uint8_t>> mipData(desc.mipLevels);
+        for(uint32_t mip = 0; mip < desc.mipLevels; mip++)
+        {
+            mipData[mip].resize(pTexture->getMipLevelDataSize(mip));
+            pTexture->readSubresourceData(mipData[mip].data(), (uint32_t)mipData[mip].size(), mip, 0);
+        }
+        return write(filename, desc, mipData);
+    }
+
+    VirtualTextureFile::VirtualTextureFile(const Desc& desc) : mDesc(desc), mLayout(desc.width, desc.height, desc.mipLevels, desc.pageWidth, desc.pageHeight), mPageSize(getPageSize(desc))
+    {
+    }
+
+    VirtualTextureFile::SharedPtr VirtualTextureFile::open(const std::string& filename)
+    {
+        std::string fullpath;
+        if(findFileInDataDirectories(filename, fullpath) == false)
+        {
+            Logger::log(Logger::Level::Error, "Can't find virtual texture file '" + filename + "'.");
+            return nullptr;
+        }
+
+        std::ifstream stream(fullpath, std::ios::binary);
+        VirtualTextureFileHeader header;
+        stream.read((char*)&header, sizeof(header));
+        if(stream.fail() || header.magic != kVirtualTextureMagic || header.version != kVirtualTextureVersion || header.format > (uint32_t)ResourceFormat::BC7UnormSrgb)
+        {
+            Logger::log(Logger::Level::Error, "'" + fullpath + "' is not a valid virtual texture file.");
+            return nullptr;
+        }
+
+        Desc desc;
+        desc.width = header.width;
+        desc.height = header.height;
+        desc.mipLevels = header.mipLevels;
+        desc.format = (ResourceFormat)header.format;
+        desc.pageWidth = header.pageWidth;
+        desc.pageHeight = header.pageHeight;
+        if(isValidDesc(desc) == false || header.pageSize != getPageSize(desc))
+        {
+            Logger::log(Logger::Level::Error, "'" + fullpath + "' is not a valid virtual texture file.");
+            return nullptr;
+        }
+
+        SharedPtr pFile = SharedPtr(new VirtualTextureFile(desc));
+        if(pFile->mLayout.getTotalPageCount() != header.pageCount)
+        {
+            Logger::log(Logger::Level::Error, "'" + fullpath + "' is not a valid virtual texture file.");
+            return nullptr;
+        }
+        pFile->mDataOffset = sizeof(header);
+        pFile->mStream.swap(stream);
+        return pFile;
+    }
+
+    bool VirtualTextureFile::readPage(const VirtualTexturePageId& page, std::vector<uint8_t>& data)
+    {
+        if(mLayout.isValidPage(page) == false)
+        {
+            return false;
+        }
+
+        data.resize(mPageSize);
+        uint64_t offset = mDataOffset + uint64_t(mLayout.getPageIndex(page)) * mPageSize;
+
+        std::lock_guard<std::mutex> lock(mMutex);
+        mStream.clear();
+        mStream.seekg(offset);
+        mStream.read((char*)data.data(), mPageSize);
+        return mStream.fail() == false;
+    }
+}
@@ -0,0 +1,106 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <string>
+#include <vector>
+#include <fstream>
+#include <mutex>
+#include <memory>
+#include "Core/Formats.h"
+#include "VirtualTexturePageTable.h"
+
+namespace Falcor
+{
+    class Texture;
+
+    /** A pre-tiled virtual texture file.\n
+        The file stores the texture's mip-chain as a sequence of fixed-size pages, so that each page can be read with a single seek and read, without decoding the entire image. Pages are ordered like the page table indices (see VirtualTexturePageTable::getPageIndex()).
+        Pages which extend past the edge of their mip-level are padded by repeating the last texel (or block, for compressed formats).\n
+        Reading is thread-safe.
+    */
+    class VirtualTextureFile
+    {
+    public:
+        using SharedPtr = std::shared_ptr<VirtualTextureFile>;
+
+        struct Desc
+        {
+            uint32_t width = 0;
+            uint32_t height = 0;
+            uint32_t mipLevels = 1;
+            ResourceFormat format = ResourceFormat::Unknown;
+            uint32_t pageWidth = 128;     ///< Must be a multiple of the format's block size
+            uint32_t pageHeight = 128;    ///< Must be a multiple of the format's block size
+        };
+
+        /** Write a virtual texture file
+            \param[in] filename The output file
+            \param[in] desc The texture description
+            \param[in] mipData The tightly packed data of each mip-level, in the same layout as Texture::readSubresourceData(). For compressed formats, rows of blocks
+            \return true on success, otherwise false
+        */
+        static bool write(const std::string& filename, const Desc& desc, const std::vector<std::vector<uint8_t>>& mipData);
+
+        /** Write a virtual texture file from the content of a 2D texture
+            \param[in] filename The output file
+            \param[in] pTexture The source texture
+            \param[in] pageWidth The page width in texels
+            \param[in] pageHeight The page height in texels
+            \return true on success, otherwise false
+        */
+        static bool writeFromTexture(const std::string& filename, const Texture* pTexture, uint32_t pageWidth, uint32_t pageHeight);
+
+        /** Open a virtual texture file
+            \return A new object, or nullptr if the file couldn't be opened or is not a valid virtual texture file
+        */
+        static SharedPtr open(const std::string& filename);
+
+        const Desc& getDesc() const { return mDesc; }
+
+        /** Get the size of a single page in bytes
+        */
+        uint32_t getPageSizeInBytes() const { return mPageSize; }
+
+        /** Read a page. Can be called from any thread.
+            \param[in] page The page to read
+            \param[out] data getPageSizeInBytes() bytes of page data, in the same row order as the source mip-levels
+            \return true on success, otherwise false
+        */
+        bool readPage(const VirtualTexturePageId& page, std::vector<uint8_t>& data);
+
+    private:
+        VirtualTextureFile(const Desc& desc);
+
+        Desc mDesc;
+        VirtualTexturePageTable mLayout;
+        uint32_t mPageSize;
+        uint64_t mDataOffset = 0;
+        std::ifstream mStream;
+        std::mutex mMutex;
+    };
+}
@@ -0,0 +1,75 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VirtualTexturePageCache.h"
+
+namespace Falcor
+{
+    void VirtualTexturePageCache::insert(uint32_t pageIndex, uint64_t frame)
+    {
+        assert(isFull() == false && contains(pageIndex) == false);
+        Entry entry;
+        entry.pageIndex = pageIndex;
+        entry.lastUsedFrame = frame;
+        mLruList.push_front(entry);
+        mEntries[pageIndex] = mLruList.begin();
+    }
+
+    void VirtualTexturePageCache::touch(uint32_t pageIndex, uint64_t frame)
+    {
+        auto it = mEntries.find(pageIndex);
+        if(it != mEntries.end())
+        {
+            it->second->lastUsedFrame = frame;
+            mLruList.splice(mLruList.begin(), mLruList, it->second);
+        }
+    }
+
+    void VirtualTexturePageCache::remove(uint32_t pageIndex)
+    {
+        auto it = mEntries.find(pageIndex);
+        if(it != mEntries.end())
+        {
+            mLruList.erase(it->second);
+            mEntries.erase(it);
+        }
+    }
+
+    bool VirtualTexturePageCache::evictLeastRecentlyUsed(uint64_t protectedFrame, uint32_t& pageIndex)
+    {
+        if(mLruList.empty() || mLruList.back().lastUsedFrame >= protectedFrame)
+        {
+            return false;
+        }
+
+        pageIndex = mLruList.back().pageIndex;
+        mEntries.erase(pageIndex);
+        mLruList.pop_back();
+        return true;
+    }
+}
@@ -0,0 +1,83 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <list>
+#include <unordered_map>
+
+namespace Falcor
+{
+    /** LRU bookkeeping of the physical pages of a virtual texture.
+        The cache tracks which pages occupy physical memory and when each of them was last used. It has a fixed capacity, derived from the memory budget, and picks the least-recently-used page when a slot is needed.
+    */
+    class VirtualTexturePageCache
+    {
+    public:
+        /** Create a cache
+            \param[in] capacity The maximum number of pages the cache can hold
+        */
+        VirtualTexturePageCache(uint32_t capacity) : mCapacity(capacity) {}
+
+        /** Add a page. The cache must not be full and the page must not be in the cache
+            \param[in] pageIndex The page's linear index
+            \param[in] frame The frame in which the page was last used
+        */
+        void insert(uint32_t pageIndex, uint64_t frame);
+
+        /** Mark a page as used in a frame. Does nothing if the page is not in the cache
+        */
+        void touch(uint32_t pageIndex, uint64_t frame);
+
+        /** Remove a page from the cache. Does nothing if the page is not in the cache
+        */
+        void remove(uint32_t pageIndex);
+
+        /** Remove the least-recently-used page, unless it was used in or after a given frame.
+            \param[in] protectedFrame Pages used in this frame or later are not evicted
+            \param[out] pageIndex The evicted page
+            \return true if a page was evicted, false if all pages were used recently
+        */
+        bool evictLeastRecentlyUsed(uint64_t protectedFrame, uint32_t& pageIndex);
+
+        bool contains(uint32_t pageIndex) const { return mEntries.find(pageIndex) != mEntries.end(); }
+        uint32_t getSize() const { return (uint32_t)mEntries.size(); }
+        uint32_t getCapacity() const { return mCapacity; }
+        bool isFull() const { return getSize() >= mCapacity; }
+
+    private:
+        struct Entry
+        {
+            uint32_t pageIndex;
+            uint64_t lastUsedFrame;
+        };
+        using EntryList = std::list<Entry>;
+
+        uint32_t mCapacity;
+        EntryList mLruList;     ///< Most recently used pages first
+        std::unordered_map<uint32_t, EntryList::iterator> mEntries;
+    };
+}
@@ -0,0 +1,78 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VirtualTexturePageLoader.h"
+#include "Utils/ThreadPool.h"
+
+namespace Falcor
+{
+    VirtualTexturePageLoader::VirtualTexturePageLoader(const VirtualTextureFile::SharedPtr& pFile, ThreadPool* pThreadPool) : mpThreadPool(pThreadPool ? pThreadPool : ThreadPool::getDefaultPool())
+    {
+        mpState = std::make_shared<SharedState>();
+        mpState->pFile = pFile;
+    }
+
+    VirtualTexturePageLoader::~VirtualTexturePageLoader() = default;
+
+    void VirtualTexturePageLoader::requestPage(const VirtualTexturePageId& page)
+    {
+        std::shared_ptr<SharedState> pState = mpState;
+        {
+            std::lock_guard<std::mutex> lock(pState->mutex);
+            pState->pendingCount++;
+        }
+
+        mpThreadPool->enqueue([pState, page]()
+        {
+            LoadedPage loaded;
+            loaded.page = page;
+            loaded.success = pState->pFile->readPage(page, loaded.data);
+
+            std::lock_guard<std::mutex> lock(pState->mutex);
+            pState->pendingCount--;
+            pState->completed.push_back(LoadedPage());
+            LoadedPage& dst = pState->completed.back();
+            dst.page = loaded.page;
+            dst.success = loaded.success;
+            dst.data.swap(loaded.data);
+        });
+    }
+
+    void VirtualTexturePageLoader::getCompletedPages(std::vector<LoadedPage>& pages)
+    {
+        pages.clear();
+        std::lock_guard<std::mutex> lock(mpState->mutex);
+        pages.swap(mpState->completed);
+    }
+
+    uint32_t VirtualTexturePageLoader::getPendingCount() const
+    {
+        std::lock_guard<std::mutex> lock(mpState->mutex);
+        return mpState->pendingCount;
+    }
+}
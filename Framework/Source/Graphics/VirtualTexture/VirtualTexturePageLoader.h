@@ -0,0 +1,87 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <mutex>
+#include <memory>
+#include "VirtualTextureFile.h"
+
+namespace Falcor
+{
+    class ThreadPool;
+
+    /** Reads virtual texture pages in the background.\n
+        Requests are executed on a thread pool. Completed pages are collected on the main thread with getCompletedPages(), which is where they should be uploaded to the GPU.
+    */
+    class VirtualTexturePageLoader
+    {
+    public:
+        struct LoadedPage
+        {
+            VirtualTexturePageId page;
+            bool success = false;
+            std::vector<uint8_t> data;
+        };
+
+        /** Create a loader
+            \param[in] pFile The file to read pages from
+            \param[in] pThreadPool Optional. The thread pool to execute the requests on. If this is nullptr, will use the default pool
+        */
+        VirtualTexturePageLoader(const VirtualTextureFile::SharedPtr& pFile, ThreadPool* pThreadPool = nullptr);
+
+        /** Destroy the loader. Requests which are still executing will complete in the background and be discarded
+        */
+        ~VirtualTexturePageLoader();
+
+        /** Request a page to be read
+        */
+        void requestPage(const VirtualTexturePageId& page);
+
+        /** Move the pages which finished loading since the last call into a vector. Failed requests are reported with success set to false
+            \param[out] pages The completed pages. The vector is cleared first
+        */
+        void getCompletedPages(std::vector<LoadedPage>& pages);
+
+        /** Get the number of requests which didn't complete yet
+        */
+        uint32_t getPendingCount() const;
+
+    private:
+        // Shared with the tasks, so they can outlive the loader
+        struct SharedState
+        {
+            VirtualTextureFile::SharedPtr pFile;
+            std::mutex mutex;
+            std::vector<LoadedPage> completed;
+            uint32_t pendingCount = 0;
+        };
+
+        std::shared_ptr<SharedState> mpState;
+        ThreadPool* mpThreadPool;
+    };
+}
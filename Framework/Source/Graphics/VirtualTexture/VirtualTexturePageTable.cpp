@@ -0,0 +1,120 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VirtualTexturePageTable.h"
+
+namespace Falcor
+{
+    VirtualTexturePageTable::VirtualTexturePageTable(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t pageWidth, uint32_t pageHeight) : mPageWidth(pageWidth), mPageHeight(pageHeight)
+    {
+        assert(pageWidth > 0 && pageHeight > 0 && mipLevels > 0);
+        mTailMipLevel = mipLevels;
+        uint32_t pageCount = 0;
+        for(uint32_t mip = 0; mip < mipLevels; mip++)
+        {
+            MipInfo info;
+            info.width = max(1U, width >> mip);
+            info.height = max(1U, height >> mip);
+            info.pagesX = (info.width + pageWidth - 1) / pageWidth;
+            info.pagesY = (info.height + pageHeight - 1) / pageHeight;
+            info.firstPage = pageCount;
+            assert(info.pagesX <= VirtualTexturePageId::kMaxPagesPerAxis && info.pagesY <= VirtualTexturePageId::kMaxPagesPerAxis);
+            pageCount += info.pagesX * info.pagesY;
+            mMips.push_back(info);
+
+            if(mTailMipLevel == mipLevels && (info.width < pageWidth || info.height < pageHeight))
+            {
+                mTailMipLevel = mip;
+            }
+        }
+        mStates.assign(pageCount, PageState::NotResident);
+    }
+
+    bool VirtualTexturePageTable::isValidPage(const VirtualTexturePageId& page) const
+    {
+        return (page.mipLevel < mMips.size()) && (page.x < mMips[page.mipLevel].pagesX) && (page.y < mMips[page.mipLevel].pagesY);
+    }
+
+    VirtualTexturePageId VirtualTexturePageTable::getPageId(uint32_t pageIndex) const
+    {
+        assert(pageIndex < mStates.size());
+        uint32_t mip = 0;
+        while(mip + 1 < mMips.size() && mMips[mip + 1].firstPage <= pageIndex)
+        {
+            mip++;
+        }
+        uint32_t localIndex = pageIndex - mMips[mip].firstPage;
+        return VirtualTexturePageId(mip, localIndex % mMips[mip].pagesX, localIndex / mMips[mip].pagesX);
+    }
+
+    VirtualTexturePageId VirtualTexturePageTable::getParentPage(const VirtualTexturePageId& page) const
+    {
+        // Odd mip sizes are rounded down, so the last row or column of pages can map past the parent's last page
+        const MipInfo& parent = mMips[page.mipLevel + 1];
+        return VirtualTexturePageId(page.mipLevel + 1, min(page.x / 2, parent.pagesX - 1), min(page.y / 2, parent.pagesY - 1));
+    }
+
+    void VirtualTexturePageTable::getPageRegion(const VirtualTexturePageId& page, uint32_t& x, uint32_t& y, uint32_t& width, uint32_t& height) const
+    {
+        const MipInfo& mip = mMips[page.mipLevel];
+        x = page.x * mPageWidth;
+        y = page.y * mPageHeight;
+        width = min(mPageWidth, mip.width - x);
+        height = min(mPageHeight, mip.height - y);
+    }
+
+    uint32_t VirtualTexturePageTable::getFinestResidentMip(uint32_t pageX, uint32_t pageY) const
+    {
+        VirtualTexturePageId page(0, pageX, pageY);
+        for(uint32_t mip = 0; mip < mMips.size(); mip++)
+        {
+            if(getPageState(page) == PageState::Resident)
+            {
+                return mip;
+            }
+            if(mip + 1 < mMips.size())
+            {
+                page = getParentPage(page);
+            }
+        }
+        return (uint32_t)mMips.size();
+    }
+
+    void VirtualTexturePageTable::buildResidencyMap(std::vector<uint8_t>& map) const
+    {
+        const MipInfo& mip0 = mMips[0];
+        map.resize(mip0.pagesX * mip0.pagesY);
+        for(uint32_t y = 0; y < mip0.pagesY; y++)
+        {
+            for(uint32_t x = 0; x < mip0.pagesX; x++)
+            {
+                map[y * mip0.pagesX + x] = (uint8_t)min(getFinestResidentMip(x, y), 255U);
+            }
+        }
+    }
+}
@@ -0,0 +1,134 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+
+namespace Falcor
+{
+    /** Identifies a page of a virtual texture
+    */
+    struct VirtualTexturePageId
+    {
+        uint32_t mipLevel = 0;
+        uint32_t x = 0;
+        uint32_t y = 0;
+
+        VirtualTexturePageId() = default;
+        VirtualTexturePageId(uint32_t mip, uint32_t pageX, uint32_t pageY) : mipLevel(mip), x(pageX), y(pageY) {}
+
+        /** Pack the ID into 32 bits - 12 bits for X, 12 bits for Y and 8 bits for the mip-level. This is the format of the page-feedback requests
+        */
+        uint32_t pack() const { return (mipLevel << 24) | (y << 12) | x; }
+        static VirtualTexturePageId unpack(uint32_t packed) { return VirtualTexturePageId(packed >> 24, packed & 0xFFF, (packed >> 12) & 0xFFF); }
+
+        bool operator==(const VirtualTexturePageId& other) const { return mipLevel == other.mipLevel && x == other.x && y == other.y; }
+        bool operator!=(const VirtualTexturePageId& other) const { return !(*this == other); }
+
+        static const uint32_t kMaxPagesPerAxis = 4096;
+    };
+
+    /** CPU-side page table of a virtual texture. Tracks the state of every page in the mip-chain.
+    */
+    class VirtualTexturePageTable
+    {
+    public:
+        enum class PageState : uint8_t
+        {
+            NotResident,    ///< The page has no physical memory
+            Loading,        ///< The page was requested from the loader
+            Resident,       ///< The page is committed and holds valid data
+        };
+
+        /** Create a page table
+            \param[in] width The texture width in texels
+            \param[in] height The texture height in texels
+            \param[in] mipLevels The number of mip-levels
+            \param[in] pageWidth The page width in texels
+            \param[in] pageHeight The page height in texels
+        */
+        VirtualTexturePageTable(uint32_t width, uint32_t height, uint32_t mipLevels, uint32_t pageWidth, uint32_t pageHeight);
+
+        uint32_t getMipLevels() const { return (uint32_t)mMips.size(); }
+        uint32_t getPageCountX(uint32_t mipLevel) const { return mMips[mipLevel].pagesX; }
+        uint32_t getPageCountY(uint32_t mipLevel) const { return mMips[mipLevel].pagesY; }
+        uint32_t getTotalPageCount() const { return (uint32_t)mStates.size(); }
+        uint32_t getPageWidth() const { return mPageWidth; }
+        uint32_t getPageHeight() const { return mPageHeight; }
+
+        /** Get the first mip-level which is smaller than a single page in any dimension. This level and all the coarser ones form the mip tail, which is always resident
+        */
+        uint32_t getTailMipLevel() const { return mTailMipLevel; }
+
+        bool isValidPage(const VirtualTexturePageId& page) const;
+
+        /** Get a linear index of a page, in the range [0, getTotalPageCount()). Pages are ordered by mip-level, then row, then column
+        */
+        uint32_t getPageIndex(const VirtualTexturePageId& page) const { const MipInfo& mip = mMips[page.mipLevel]; return mip.firstPage + page.y * mip.pagesX + page.x; }
+
+        /** Get the page with a given linear index
+        */
+        VirtualTexturePageId getPageId(uint32_t pageIndex) const;
+
+        PageState getPageState(const VirtualTexturePageId& page) const { return mStates[getPageIndex(page)]; }
+        void setPageState(const VirtualTexturePageId& page, PageState state) { mStates[getPageIndex(page)] = state; }
+
+        /** Get the page in the next mip-level which covers a page. The page must not be in the coarsest mip-level
+        */
+        VirtualTexturePageId getParentPage(const VirtualTexturePageId& page) const;
+
+        /** Get the texel region covered by a page, clipped to the size of its mip-level
+        */
+        void getPageRegion(const VirtualTexturePageId& page, uint32_t& x, uint32_t& y, uint32_t& width, uint32_t& height) const;
+
+        /** Get the finest resident mip-level covering a page of mip-level 0
+            \return The mip-level, or getMipLevels() if no level is resident
+        */
+        uint32_t getFinestResidentMip(uint32_t pageX, uint32_t pageY) const;
+
+        /** Build the residency map - the finest resident mip-level for each page of mip-level 0. Shaders can use it to clamp the sampled LOD to resident data.
+            \param[out] map getPageCountX(0) * getPageCountY(0) values, row by row
+        */
+        void buildResidencyMap(std::vector<uint8_t>& map) const;
+
+    private:
+        struct MipInfo
+        {
+            uint32_t width;
+            uint32_t height;
+            uint32_t pagesX;
+            uint32_t pagesY;
+            uint32_t firstPage;
+        };
+
+        std::vector<MipInfo> mMips;
+        std::vector<PageState> mStates;
+        uint32_t mPageWidth;
+        uint32_t mPageHeight;
+        uint32_t mTailMipLevel;
+    };
+}
@@ -0,0 +1,203 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "VirtualTextureResidencyManager.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    static uint32_t calcPageCapacity(const VirtualTextureResidencyManager::Desc& desc, uint32_t tailPageCount)
+    {
+        uint64_t budgetPages = (desc.pageSizeInBytes > 0) ? (desc.memoryBudget / desc.pageSizeInBytes) : 0;
+        if(budgetPages < tailPageCount)
+        {
+            Logger::log(Logger::Level::Warning, "VirtualTextureResidencyManager - the memory budget is smaller than the mip tail. Only the mip tail will be resident.");
+            return 0;
+        }
+        return (uint32_t)min(budgetPages - tailPageCount, uint64_t(UINT32_MAX));
+    }
+
+    static std::vector<VirtualTexturePageId> getTailPages(const VirtualTexturePageTable& pageTable)
+    {
+        std::vector<VirtualTexturePageId> pages;
+        for(uint32_t mip = pageTable.getTailMipLevel(); mip < pageTable.getMipLevels(); mip++)
+        {
+            for(uint32_t y = 0; y < pageTable.getPageCountY(mip); y++)
+            {
+                for(uint32_t x = 0; x < pageTable.getPageCountX(mip); x++)
+                {
+                    pages.push_back(VirtualTexturePageId(mip, x, y));
+                }
+            }
+        }
+        return pages;
+    }
+
+    VirtualTextureResidencyManager::VirtualTextureResidencyManager(const Desc& desc) :
+        mDesc(desc),
+        mPageTable(desc.width, desc.height, desc.mipLevels, desc.pageWidth, desc.pageHeight),
+        mCache(calcPageCapacity(desc, (uint32_t)getTailPages(mPageTable).size())),
+        mTailPages(getTailPages(mPageTable))
+    {
+        mRequestFrame.assign(mPageTable.getTotalPageCount(), 0);
+    }
+
+    void VirtualTextureResidencyManager::requestPageAndAncestors(VirtualTexturePageId page)
+    {
+        while(isTailPage(page) == false)
+        {
+            uint32_t index = mPageTable.getPageIndex(page);
+            if(mRequestFrame[index] == mFrameId)
+            {
+                // Already requested, and so were its ancestors
+                return;
+            }
+            mRequestFrame[index] = mFrameId;
+            mRequested.push_back(page);
+
+            if(page.mipLevel + 1 >= mPageTable.getMipLevels())
+            {
+                return;
+            }
+            page = mPageTable.getParentPage(page);
+        }
+    }
+
+    const VirtualTextureResidencyManager::Update& VirtualTextureResidencyManager::processFeedback(const uint32_t* pRequests, size_t requestCount)
+    {
+        mFrameId++;
+        mUpdate.loads.clear();
+        mUpdate.evictions.clear();
+        mRequested.clear();
+        mMissing.clear();
+
+        // The mip tail is always resident. It doesn't count towards the load limit
+        for(const auto& page : mTailPages)
+        {
+            if(mPageTable.getPageState(page) == VirtualTexturePageTable::PageState::NotResident)
+            {
+                mPageTable.setPageState(page, VirtualTexturePageTable::PageState::Loading);
+                mUpdate.loads.push_back(page);
+            }
+        }
+
+        for(size_t i = 0; i < requestCount; i++)
+        {
+            VirtualTexturePageId page = VirtualTexturePageId::unpack(pRequests[i]);
+            if(mPageTable.isValidPage(page))
+            {
+                requestPageAndAncestors(page);
+            }
+        }
+
+        // Refresh the resident pages first, so they are not evicted to make room for the missing ones
+        for(const auto& page : mRequested)
+        {
+            switch(mPageTable.getPageState(page))
+            {
+            case VirtualTexturePageTable::PageState::Resident:
+                mCache.touch(mPageTable.getPageIndex(page), mFrameId);
+                break;
+            case VirtualTexturePageTable::PageState::NotResident:
+                mMissing.push_back(page);
+                break;
+            default:
+                break;
+            }
+        }
+
+        // Load coarse pages first. They cover more of the screen and are the fallback for the finer pages
+        std::stable_sort(mMissing.begin(), mMissing.end(), [](const VirtualTexturePageId& a, const VirtualTexturePageId& b) { return a.mipLevel > b.mipLevel; });
+
+        uint32_t deferred = 0;
+        for(size_t i = 0; i < mMissing.size(); i++)
+        {
+            if(mPendingPages >= mDesc.maxPendingLoads)
+            {
+                deferred = (uint32_t)(mMissing.size() - i);
+                break;
+            }
+
+            if(mCache.getSize() + mPendingPages >= mCache.getCapacity())
+            {
+                uint32_t evictedIndex;
+                if(mCache.evictLeastRecentlyUsed(mFrameId, evictedIndex) == false)
+                {
+                    // Everything which is resident was requested this frame
+                    deferred = (uint32_t)(mMissing.size() - i);
+                    break;
+                }
+
+                VirtualTexturePageId evicted = mPageTable.getPageId(evictedIndex);
+                mPageTable.setPageState(evicted, VirtualTexturePageTable::PageState::NotResident);
+                mUpdate.evictions.push_back(evicted);
+                mStats.totalEvictions++;
+            }
+
+            const VirtualTexturePageId& page = mMissing[i];
+            mPageTable.setPageState(page, VirtualTexturePageTable::PageState::Loading);
+            mUpdate.loads.push_back(page);
+            mPendingPages++;
+        }
+
+        mStats.requestedPages = (uint32_t)mRequested.size();
+        mStats.deferredPages = deferred;
+        mStats.pendingPages = mPendingPages;
+        mStats.residentPages = mCache.getSize() + mResidentTailPages;
+        return mUpdate;
+    }
+
+    void VirtualTextureResidencyManager::onPageLoaded(const VirtualTexturePageId& page)
+    {
+        assert(mPageTable.getPageState(page) == VirtualTexturePageTable::PageState::Loading);
+        mPageTable.setPageState(page, VirtualTexturePageTable::PageState::Resident);
+        if(isTailPage(page))
+        {
+            mResidentTailPages++;
+        }
+        else
+        {
+            mPendingPages--;
+            mCache.insert(mPageTable.getPageIndex(page), mFrameId);
+        }
+        mStats.totalLoads++;
+        mStats.pendingPages = mPendingPages;
+        mStats.residentPages = mCache.getSize() + mResidentTailPages;
+    }
+
+    void VirtualTextureResidencyManager::onPageLoadFailed(const VirtualTexturePageId& page)
+    {
+        assert(mPageTable.getPageState(page) == VirtualTexturePageTable::PageState::Loading);
+        mPageTable.setPageState(page, VirtualTexturePageTable::PageState::NotResident);
+        if(isTailPage(page) == false)
+        {
+            mPendingPages--;
+        }
+        mStats.pendingPages = mPendingPages;
+    }
+}
@@ -0,0 +1,113 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "VirtualTexturePageTable.h"
+#include "VirtualTexturePageCache.h"
+
+namespace Falcor
+{
+    /** Decides which pages of a virtual texture should be resident.\n
+        Every frame, the manager consumes the pages requested by the renderer (usually read back from a feedback pass) and produces a list of pages to load and a list of pages to evict. Requesting a page also requests all its coarser ancestors, so a filtered fallback is always on its way. Missing pages are loaded coarse-to-fine.\n
+        Physical memory is limited by a budget. When the budget is exhausted, the least-recently-used pages which were not requested in the current frame are evicted. The mip tail is loaded once and never evicted.\n
+        The manager only does bookkeeping - it doesn't touch the GPU or the file system - so it can be driven and tested on its own. VirtualTexture connects it to a sparse texture and a page loader.
+    */
+    class VirtualTextureResidencyManager
+    {
+    public:
+        struct Desc
+        {
+            uint32_t width = 0;             ///< Texture width in texels
+            uint32_t height = 0;            ///< Texture height in texels
+            uint32_t mipLevels = 1;
+            uint32_t pageWidth = 128;       ///< Page width in texels
+            uint32_t pageHeight = 128;      ///< Page height in texels
+            uint32_t pageSizeInBytes = 0;   ///< Physical memory used by a single page
+            uint64_t memoryBudget = 0;      ///< Physical memory budget in bytes, including the mip tail
+            uint32_t maxPendingLoads = 64;  ///< Maximum number of page loads in flight
+        };
+
+        struct Update
+        {
+            std::vector<VirtualTexturePageId> loads;        ///< Pages which should be committed and loaded. Report completion with onPageLoaded() or onPageLoadFailed()
+            std::vector<VirtualTexturePageId> evictions;    ///< Pages which should be de-committed
+        };
+
+        struct Stats
+        {
+            uint32_t residentPages = 0;
+            uint32_t pendingPages = 0;
+            uint32_t requestedPages = 0;        ///< Number of unique pages requested in the last frame, including ancestors
+            uint32_t deferredPages = 0;         ///< Number of requested pages which couldn't be loaded in the last frame, due to the budget or the load limit
+            uint64_t totalLoads = 0;
+            uint64_t totalEvictions = 0;
+        };
+
+        VirtualTextureResidencyManager(const Desc& desc);
+
+        /** Process the page requests of a frame.
+            \param[in] pRequests Packed page IDs (see VirtualTexturePageId::pack()). Duplicates and invalid IDs are allowed
+            \param[in] requestCount Number of requests
+            \return The pages to load and evict. The object is valid until the next call
+        */
+        const Update& processFeedback(const uint32_t* pRequests, size_t requestCount);
+
+        /** Report that a page finished loading and holds valid data
+        */
+        void onPageLoaded(const VirtualTexturePageId& page);
+
+        /** Report that a page couldn't be loaded. The page can be requested again
+        */
+        void onPageLoadFailed(const VirtualTexturePageId& page);
+
+        const VirtualTexturePageTable& getPageTable() const { return mPageTable; }
+        const Stats& getStats() const { return mStats; }
+        uint64_t getFrameId() const { return mFrameId; }
+
+        /** Get the number of pages the budget allows, excluding the mip tail
+        */
+        uint32_t getPageCapacity() const { return mCache.getCapacity(); }
+
+    private:
+        bool isTailPage(const VirtualTexturePageId& page) const { return page.mipLevel >= mPageTable.getTailMipLevel(); }
+        void requestPageAndAncestors(VirtualTexturePageId page);
+
+        Desc mDesc;
+        VirtualTexturePageTable mPageTable;
+        VirtualTexturePageCache mCache;
+        std::vector<VirtualTexturePageId> mTailPages;
+        std::vector<uint64_t> mRequestFrame;        ///< The last frame each page was requested in. Used to de-duplicate requests
+        std::vector<VirtualTexturePageId> mRequested;
+        std::vector<VirtualTexturePageId> mMissing;
+        uint32_t mPendingPages = 0;                 ///< Non-tail pages which are loading. They have reserved cache slots
+        uint32_t mResidentTailPages = 0;
+        uint64_t mFrameId = 0;
+        Update mUpdate;
+        Stats mStats;
+    };
+}
@@ -33,6 +33,7 @@
 #include "Graphics/Program.h"
 #include "Utils/OS.h"
 #include "Core/FBO.h"
+#include "Graphics/ResidencyManager.h"
 #include "VR\OpenVR\VRSystem.h"
 
 namespace Falcor
@@ -247,6 +248,8 @@ namespace Falcor
             captureScreen();
         }
         printProfileData();
+        UniformBuffer::endFrame();
+        ResidencyManager::endFrame();
     }
 
     void Sample::captureScreen()
@@ -434,6 +437,10 @@ namespace Falcor
         if(mVideoCapture.pVideoCapture)
         {
             mVideoCapture.pVideoCapture->endCapture();
+            VideoEncoder::Stats stats = mVideoCapture.pVideoCapture->getStats();
+            std::string msg = "Video capture: " + std::to_string(stats.encodedFrames) + " frames encoded, " + std::to_string(stats.droppedFrames) + " dropped, peak queue depth " + std::to_string(stats.peakQueuedFrames);
+            msg += ", average encode latency " + std::to_string(stats.averageLatencyMs) + "ms, max " + std::to_string(stats.maxLatencyMs) + "ms";
+            Logger::log(Logger::Level::Info, msg);
             mShowUI = true;
         }
         mVideoCapture.pUI = nullptr;
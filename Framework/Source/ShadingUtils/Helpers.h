@@ -246,6 +246,15 @@ vec3 _fn RGBToNormal(in const vec3 rgbval)
     return rgbval * 2.f - v3(1.f);
 }
 
+/** Reconstructs a tangent-space normal from a two-channel (BC5/RG) normal map
+*/
+vec3 _fn RGToNormal(in const vec3 rgbval)
+{
+    vec3 n = rgbval * 2.f - v3(1.f);
+    n.z = sqrt(saturate(1.f - n.x * n.x - n.y * n.y));
+    return n;
+}
+
 vec3 _fn fromLocal(in vec3 v, in vec3 t, in vec3 b, in vec3 n)
 {
     return t * v.x + b * v.y + n * v.z;
@@ -278,7 +287,8 @@ void _fn perturbNormal(in const MaterialData mat, _ref(ShadingAttribs) shAttr, b
 	if(forceSample || mat.desc.hasNormalMap != 0)
 	{
 		vec3 texValue = v3(sampleTexture(mat.values.normalMap.texture.ptr, shAttr));
-        applyNormalMap(RGBToNormal(texValue), shAttr.N, shAttr.T, shAttr.B);
+        vec3 normal = (mat.desc.hasTwoChannelNormalMap != 0) ? RGToNormal(texValue) : RGBToNormal(texValue);
+        applyNormalMap(normal, shAttr.N, shAttr.T, shAttr.B);
 	}
 }
 #endif
@@ -29,6 +29,7 @@
 #include "Bitmap.h"
 #include "FreeImage.h"
 #include "OS.h"
+#include "PixelConversion.h"
 
 namespace Falcor
 {
@@ -84,14 +85,12 @@ namespace Falcor
             return UniqueConstPtr(genError("Invalid image", filename));
         }
 
-        // Convert the image to RGBA image
+        // 24-bit images are expanded to 32-bit while copying the rows out, see below
         uint32_t bpp = FreeImage_GetBPP(pDib);
-        if(bpp == 24)
+        const bool expandRgb = (bpp == 24);
+        if(expandRgb)
         {
             bpp = 32;
-            auto pNew = FreeImage_ConvertTo32Bits(pDib);
-            FreeImage_Unload(pDib);
-            pDib = pNew;
         }
 
         switch(bpp)
@@ -126,7 +125,20 @@ namespace Falcor
         }
 
         pBmp->mpData = new uint8_t[pBmp->mHeight * pBmp->mWidth * pBmp->mBytesPerPixel];
-        FreeImage_ConvertToRawBits(pBmp->mpData, pDib, pBmp->mWidth * pBmp->mBytesPerPixel, bpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, isTopDown);
+        if(expandRgb)
+        {
+            // FreeImage stores the scanlines bottom->top. Expanding straight into the destination saves an intermediate 32-bit DIB.
+            const size_t rowPitch = pBmp->mWidth * pBmp->mBytesPerPixel;
+            for(uint32_t y = 0; y < pBmp->mHeight; y++)
+            {
+                const uint8_t* pSrc = FreeImage_GetScanLine(pDib, isTopDown ? (pBmp->mHeight - 1 - y) : y);
+                expandRgb8ToRgba8(pSrc, pBmp->mpData + y * rowPitch, pBmp->mWidth);
+            }
+        }
+        else
+        {
+            FreeImage_ConvertToRawBits(pBmp->mpData, pDib, pBmp->mWidth * pBmp->mBytesPerPixel, bpp, FI_RGBA_RED_MASK, FI_RGBA_GREEN_MASK, FI_RGBA_BLUE_MASK, isTopDown);
+        }
 
         FreeImage_Unload(pDib);
         return UniqueConstPtr(pBmp);
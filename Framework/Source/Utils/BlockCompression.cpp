@@ -0,0 +1,1086 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "BlockCompression.h"
+#include "Utils/ThreadPool.h"
+#include "Utils/PixelConversion.h"
+#include <emmintrin.h>
+#include <cfloat>
+#include <cstring>
+#include <cmath>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kAllPixels = 0xFFFF;
+
+        // A 4x4 block of pixels in SoA layout, with values in [0, 255]. quads[channel][i] holds pixels [4i, 4i+3] of a channel
+        struct Block
+        {
+            union
+            {
+                __m128 quads[4][4];
+                float values[4][16];
+            };
+            uint32_t opaqueMask;    ///< Bit i is set if pixel i has alpha >= 128
+        };
+
+        void loadBlock(const uint8_t* pRgba8, uint32_t width, uint32_t height, uint32_t blockX, uint32_t blockY, Block& block)
+        {
+            block.opaqueMask = 0;
+            for(uint32_t y = 0; y < 4; y++)
+            {
+                // Blocks which extend past the image replicate the edge pixels
+                uint32_t srcY = min(blockY * 4 + y, height - 1);
+                for(uint32_t x = 0; x < 4; x++)
+                {
+                    uint32_t srcX = min(blockX * 4 + x, width - 1);
+                    const uint8_t* pPixel = pRgba8 + (size_t(srcY) * width + srcX) * 4;
+                    uint32_t p = y * 4 + x;
+                    for(uint32_t c = 0; c < 4; c++)
+                    {
+                        block.values[c][p] = pPixel[c];
+                    }
+                    block.opaqueMask |= (pPixel[3] >= 128) ? (1 << p) : 0;
+                }
+            }
+        }
+
+        /** Assign every pixel to the closest palette entry, considering the channels [firstChannel, firstChannel + channelCount).
+            Evaluates 4 pixels at a time. Palette entries are indexed by the absolute channel index.
+            \return The total squared error
+        */
+        float fitIndices(const Block& block, uint32_t firstChannel, uint32_t channelCount, const float palette[][4], uint32_t paletteSize, uint8_t indices[16])
+        {
+            __m128 totalError = _mm_setzero_ps();
+            for(uint32_t q = 0; q < 4; q++)
+            {
+                __m128 bestError = _mm_set1_ps(FLT_MAX);
+                __m128i bestIndex = _mm_setzero_si128();
+                for(uint32_t i = 0; i < paletteSize; i++)
+                {
+                    __m128 error = _mm_setzero_ps();
+                    for(uint32_t c = firstChannel; c < firstChannel + channelCount; c++)
+                    {
+                        __m128 diff = _mm_sub_ps(block.quads[c][q], _mm_set1_ps(palette[i][c]));
+                        error = _mm_add_ps(error, _mm_mul_ps(diff, diff));
+                    }
+                    __m128i isBetter = _mm_castps_si128(_mm_cmplt_ps(error, bestError));
+                    bestError = _mm_min_ps(error, bestError);
+                    bestIndex = _mm_or_si128(_mm_and_si128(isBetter, _mm_set1_epi32(i)), _mm_andnot_si128(isBetter, bestIndex));
+                }
+                totalError = _mm_add_ps(totalError, bestError);
+
+                int32_t blockIndices[4];
+                _mm_storeu_si128((__m128i*)blockIndices, bestIndex);
+                for(uint32_t i = 0; i < 4; i++)
+                {
+                    indices[q * 4 + i] = (uint8_t)blockIndices[i];
+                }
+            }
+
+            float errors[4];
+            _mm_storeu_ps(errors, totalError);
+            return errors[0] + errors[1] + errors[2] + errors[3];
+        }
+
+        float clampChannel(float value)
+        {
+            return min(255.0f, max(0.0f, value));
+        }
+
+        /** Find the principal axis of the pixels selected by pixelMask and return the extreme points of the pixels' projections on it
+        */
+        void fitPrincipalAxis(const Block& block, uint32_t firstChannel, uint32_t channelCount, uint32_t pixelMask, float endpoint0[4], float endpoint1[4])
+        {
+            const uint32_t lastChannel = firstChannel + channelCount;
+            float mean[4] = {0, 0, 0, 0};
+            float pixelCount = 0;
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                if(pixelMask & (1 << p))
+                {
+                    for(uint32_t c = firstChannel; c < lastChannel; c++)
+                    {
+                        mean[c] += block.values[c][p];
+                    }
+                    pixelCount++;
+                }
+            }
+            for(uint32_t c = firstChannel; c < lastChannel; c++)
+            {
+                mean[c] /= pixelCount;
+            }
+
+            float covariance[4][4] = {};
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                if(pixelMask & (1 << p))
+                {
+                    for(uint32_t i = firstChannel; i < lastChannel; i++)
+                    {
+                        for(uint32_t j = firstChannel; j < lastChannel; j++)
+                        {
+                            covariance[i][j] += (block.values[i][p] - mean[i]) * (block.values[j][p] - mean[j]);
+                        }
+                    }
+                }
+            }
+
+            // Power iteration, starting from the covariance column of the channel with the largest variance
+            uint32_t maxChannel = firstChannel;
+            for(uint32_t c = firstChannel; c < lastChannel; c++)
+            {
+                maxChannel = (covariance[c][c] > covariance[maxChannel][maxChannel]) ? c : maxChannel;
+            }
+            float axis[4] = {0, 0, 0, 0};
+            for(uint32_t c = firstChannel; c < lastChannel; c++)
+            {
+                axis[c] = covariance[c][maxChannel];
+            }
+            for(uint32_t iteration = 0; iteration < 8; iteration++)
+            {
+                float next[4] = {0, 0, 0, 0};
+                float length = 0;
+                for(uint32_t i = firstChannel; i < lastChannel; i++)
+                {
+                    for(uint32_t j = firstChannel; j < lastChannel; j++)
+                    {
+                        next[i] += covariance[i][j] * axis[j];
+                    }
+                    length = max(length, std::abs(next[i]));
+                }
+                if(length < 1e-6f)
+                {
+                    break;
+                }
+                for(uint32_t c = firstChannel; c < lastChannel; c++)
+                {
+                    axis[c] = next[c] / length;
+                }
+            }
+
+            float length = 0;
+            for(uint32_t c = firstChannel; c < lastChannel; c++)
+            {
+                length += axis[c] * axis[c];
+            }
+            length = std::sqrt(length);
+
+            float minT = 0;
+            float maxT = 0;
+            if(length > 1e-6f)
+            {
+                minT = FLT_MAX;
+                maxT = -FLT_MAX;
+                for(uint32_t c = firstChannel; c < lastChannel; c++)
+                {
+                    axis[c] /= length;
+                }
+                for(uint32_t p = 0; p < 16; p++)
+                {
+                    if(pixelMask & (1 << p))
+                    {
+                        float t = 0;
+                        for(uint32_t c = firstChannel; c < lastChannel; c++)
+                        {
+                            t += (block.values[c][p] - mean[c]) * axis[c];
+                        }
+                        minT = min(minT, t);
+                        maxT = max(maxT, t);
+                    }
+                }
+            }
+
+            for(uint32_t c = firstChannel; c < lastChannel; c++)
+            {
+                endpoint0[c] = clampChannel(mean[c] + axis[c] * minT);
+                endpoint1[c] = clampChannel(mean[c] + axis[c] * maxT);
+            }
+        }
+
+        /** Solve for the endpoints which minimize the squared error, given the interpolation weight of each pixel's palette index.
+            \return false if the system is degenerate (all the pixels use the same weight)
+        */
+        bool refineEndpoints(const Block& block, uint32_t firstChannel, uint32_t channelCount, uint32_t pixelMask, const uint8_t indices[16], const float* weights, float endpoint0[4], float endpoint1[4])
+        {
+            const uint32_t lastChannel = firstChannel + channelCount;
+            float a = 0, b = 0, c = 0;
+            float x0[4] = {0, 0, 0, 0};
+            float x1[4] = {0, 0, 0, 0};
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                if(pixelMask & (1 << p))
+                {
+                    float w = weights[indices[p]];
+                    a += (1 - w) * (1 - w);
+                    b += (1 - w) * w;
+                    c += w * w;
+                    for(uint32_t ch = firstChannel; ch < lastChannel; ch++)
+                    {
+                        x0[ch] += (1 - w) * block.values[ch][p];
+                        x1[ch] += w * block.values[ch][p];
+                    }
+                }
+            }
+
+            float det = a * c - b * b;
+            if(std::abs(det) < 1e-6f)
+            {
+                return false;
+            }
+            for(uint32_t ch = firstChannel; ch < lastChannel; ch++)
+            {
+                endpoint0[ch] = clampChannel((c * x0[ch] - b * x1[ch]) / det);
+                endpoint1[ch] = clampChannel((a * x1[ch] - b * x0[ch]) / det);
+            }
+            return true;
+        }
+
+        uint32_t getRefinementIterations(BlockCompressionQuality quality)
+        {
+            switch(quality)
+            {
+            case BlockCompressionQuality::Fast:
+                return 0;
+            case BlockCompressionQuality::Normal:
+                return 1;
+            default:
+                return 4;
+            }
+        }
+
+        /************************************************************************/
+        /* BC1 color blocks                                                     */
+        /************************************************************************/
+        uint16_t packRgb565(const float color[4])
+        {
+            uint32_t r = (uint32_t)(color[0] * 31.0f / 255.0f + 0.5f);
+            uint32_t g = (uint32_t)(color[1] * 63.0f / 255.0f + 0.5f);
+            uint32_t b = (uint32_t)(color[2] * 31.0f / 255.0f + 0.5f);
+            return (uint16_t)((r << 11) | (g << 5) | b);
+        }
+
+        void unpackRgb565(uint16_t packed, float color[4])
+        {
+            uint32_t r = (packed >> 11) & 0x1F;
+            uint32_t g = (packed >> 5) & 0x3F;
+            uint32_t b = packed & 0x1F;
+            color[0] = (float)((r << 3) | (r >> 2));
+            color[1] = (float)((g << 2) | (g >> 4));
+            color[2] = (float)((b << 3) | (b >> 2));
+            color[3] = 255;
+        }
+
+        struct ColorBlock
+        {
+            uint16_t color0;
+            uint16_t color1;
+            uint8_t indices[16];
+            float error;
+        };
+
+        const float kBc1FourColorWeights[] = {0, 1, 1.0f / 3.0f, 2.0f / 3.0f};
+        const float kBc1ThreeColorWeights[] = {0, 1, 0.5f, 0};
+
+        /** Quantize the endpoints and find the best indices. In 3-color mode, pixels outside pixelMask use the transparent index
+        */
+        void evaluateColorBlock(const Block& block, const float endpoint0[4], const float endpoint1[4], bool threeColorMode, uint32_t pixelMask, ColorBlock& result)
+        {
+            uint16_t c0 = packRgb565(endpoint0);
+            uint16_t c1 = packRgb565(endpoint1);
+
+            // The decoder selects the mode by comparing the endpoints. 4-color mode requires color0 > color1
+            if((c0 < c1) != threeColorMode)
+            {
+                std::swap(c0, c1);
+            }
+
+            float palette[4][4];
+            unpackRgb565(c0, palette[0]);
+            unpackRgb565(c1, palette[1]);
+            uint32_t paletteSize;
+            if(threeColorMode)
+            {
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    palette[2][c] = (palette[0][c] + palette[1][c]) / 2;
+                }
+                paletteSize = 3;
+            }
+            else if(c0 == c1)
+            {
+                // Can't encode 4-color mode, but all the pixels are represented by the first endpoint
+                paletteSize = 1;
+            }
+            else
+            {
+                for(uint32_t c = 0; c < 3; c++)
+                {
+                    palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                    palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+                }
+                paletteSize = 4;
+            }
+
+            result.color0 = c0;
+            result.color1 = c1;
+            result.error = fitIndices(block, 0, 3, palette, paletteSize, result.indices);
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                if((pixelMask & (1 << p)) == 0)
+                {
+                    result.indices[p] = 3;
+                }
+            }
+        }
+
+        void fitColorBlock(const Block& block, BlockCompressionQuality quality, bool threeColorMode, uint32_t pixelMask, ColorBlock& best)
+        {
+            float endpoint0[4], endpoint1[4];
+            fitPrincipalAxis(block, 0, 3, pixelMask, endpoint0, endpoint1);
+            evaluateColorBlock(block, endpoint0, endpoint1, threeColorMode, pixelMask, best);
+
+            const float* weights = threeColorMode ? kBc1ThreeColorWeights : kBc1FourColorWeights;
+            uint32_t iterations = getRefinementIterations(quality);
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                // Refine using the weights of the quantized palette. The endpoints might have been swapped, so recover their order from the packed colors
+                float q0[4], q1[4];
+                unpackRgb565(best.color0, q0);
+                unpackRgb565(best.color1, q1);
+                if(refineEndpoints(block, 0, 3, pixelMask, best.indices, weights, q0, q1) == false)
+                {
+                    break;
+                }
+
+                ColorBlock candidate;
+                evaluateColorBlock(block, q0, q1, threeColorMode, pixelMask, candidate);
+                if(candidate.error >= best.error)
+                {
+                    break;
+                }
+                best = candidate;
+            }
+        }
+
+        void writeColorBlock(const ColorBlock& block, uint8_t* pDst)
+        {
+            uint32_t indices = 0;
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                indices |= uint32_t(block.indices[p]) << (p * 2);
+            }
+            pDst[0] = (uint8_t)(block.color0 & 0xFF);
+            pDst[1] = (uint8_t)(block.color0 >> 8);
+            pDst[2] = (uint8_t)(block.color1 & 0xFF);
+            pDst[3] = (uint8_t)(block.color1 >> 8);
+            for(uint32_t i = 0; i < 4; i++)
+            {
+                pDst[4 + i] = (uint8_t)(indices >> (i * 8));
+            }
+        }
+
+        /** Encode the color part of a block.
+            \param[in] isBc1 BC1 blocks can use the 3-color mode with transparent pixels. BC2/BC3 color blocks are always decoded in 4-color mode
+        */
+        void encodeColorBlock(const Block& block, BlockCompressionQuality quality, bool isBc1, uint8_t* pDst)
+        {
+            ColorBlock best;
+            if(isBc1 && (block.opaqueMask != kAllPixels))
+            {
+                if(block.opaqueMask == 0)
+                {
+                    // Fully transparent
+                    best.color0 = 0;
+                    best.color1 = 0;
+                    memset(best.indices, 3, sizeof(best.indices));
+                }
+                else
+                {
+                    fitColorBlock(block, quality, true, block.opaqueMask, best);
+                }
+            }
+            else
+            {
+                fitColorBlock(block, quality, false, kAllPixels, best);
+                if(isBc1 && (quality == BlockCompressionQuality::High))
+                {
+                    ColorBlock threeColor;
+                    fitColorBlock(block, quality, true, kAllPixels, threeColor);
+                    if(threeColor.error < best.error)
+                    {
+                        best = threeColor;
+                    }
+                }
+            }
+            writeColorBlock(best, pDst);
+        }
+
+        /************************************************************************/
+        /* BC4 single channel blocks (also used for BC3 alpha and BC5)          */
+        /************************************************************************/
+        struct ChannelBlock
+        {
+            uint8_t endpoint0;
+            uint8_t endpoint1;
+            uint8_t indices[16];
+            float error;
+        };
+
+        const float kBc4EightValueWeights[] = {0, 1, 1.0f / 7, 2.0f / 7, 3.0f / 7, 4.0f / 7, 5.0f / 7, 6.0f / 7};
+
+        void evaluateChannelBlock(const Block& block, uint32_t channel, uint8_t endpoint0, uint8_t endpoint1, ChannelBlock& result)
+        {
+            float palette[8][4];
+            palette[0][channel] = endpoint0;
+            palette[1][channel] = endpoint1;
+            if(endpoint0 > endpoint1)
+            {
+                for(uint32_t i = 1; i < 7; i++)
+                {
+                    palette[i + 1][channel] = ((7 - i) * (float)endpoint0 + i * (float)endpoint1) / 7;
+                }
+            }
+            else
+            {
+                for(uint32_t i = 1; i < 5; i++)
+                {
+                    palette[i + 1][channel] = ((5 - i) * (float)endpoint0 + i * (float)endpoint1) / 5;
+                }
+                palette[6][channel] = 0;
+                palette[7][channel] = 255;
+            }
+
+            result.endpoint0 = endpoint0;
+            result.endpoint1 = endpoint1;
+            result.error = fitIndices(block, channel, 1, palette, 8, result.indices);
+        }
+
+        uint8_t quantizeChannel(float value)
+        {
+            return (uint8_t)(clampChannel(value) + 0.5f);
+        }
+
+        void encodeChannelBlock(const Block& block, uint32_t channel, BlockCompressionQuality quality, uint8_t* pDst)
+        {
+            float minValue = 255;
+            float maxValue = 0;
+            float innerMin = 255;   // Range of the values, excluding 0 and 255
+            float innerMax = 0;
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                float v = block.values[channel][p];
+                minValue = min(minValue, v);
+                maxValue = max(maxValue, v);
+                if(v > 0 && v < 255)
+                {
+                    innerMin = min(innerMin, v);
+                    innerMax = max(innerMax, v);
+                }
+            }
+
+            // 8-value mode. When the endpoints are equal the decoder uses 6-value mode, but every pixel matches the first endpoint anyway
+            ChannelBlock best;
+            evaluateChannelBlock(block, channel, (uint8_t)maxValue, (uint8_t)minValue, best);
+
+            uint32_t iterations = getRefinementIterations(quality);
+            for(uint32_t i = 0; (i < iterations) && (best.endpoint0 > best.endpoint1); i++)
+            {
+                float e0[4], e1[4];
+                e0[channel] = best.endpoint0;
+                e1[channel] = best.endpoint1;
+                if(refineEndpoints(block, channel, 1, kAllPixels, best.indices, kBc4EightValueWeights, e0, e1) == false)
+                {
+                    break;
+                }
+                uint8_t q0 = quantizeChannel(e0[channel]);
+                uint8_t q1 = quantizeChannel(e1[channel]);
+                if(q0 <= q1)
+                {
+                    break;
+                }
+                ChannelBlock candidate;
+                evaluateChannelBlock(block, channel, q0, q1, candidate);
+                if(candidate.error >= best.error)
+                {
+                    break;
+                }
+                best = candidate;
+            }
+
+            if(quality != BlockCompressionQuality::Fast)
+            {
+                // 6-value mode represents 0 and 255 exactly, so the interpolated values only need to cover the rest of the range
+                if((minValue == 0 || maxValue == 255) && (innerMin <= innerMax))
+                {
+                    ChannelBlock candidate;
+                    evaluateChannelBlock(block, channel, (uint8_t)innerMin, (uint8_t)innerMax, candidate);
+                    if(candidate.error < best.error)
+                    {
+                        best = candidate;
+                    }
+                }
+            }
+
+            if(quality == BlockCompressionQuality::High)
+            {
+                // Search the neighborhood of the best endpoints. This keeps the current mode, since the endpoints' order is preserved
+                const int32_t kRadius = 2;
+                ChannelBlock center = best;
+                for(int32_t d0 = -kRadius; d0 <= kRadius; d0++)
+                {
+                    for(int32_t d1 = -kRadius; d1 <= kRadius; d1++)
+                    {
+                        int32_t e0 = (int32_t)center.endpoint0 + d0;
+                        int32_t e1 = (int32_t)center.endpoint1 + d1;
+                        if(e0 < 0 || e0 > 255 || e1 < 0 || e1 > 255 || ((e0 > e1) != (center.endpoint0 > center.endpoint1)))
+                        {
+                            continue;
+                        }
+                        ChannelBlock candidate;
+                        evaluateChannelBlock(block, channel, (uint8_t)e0, (uint8_t)e1, candidate);
+                        if(candidate.error < best.error)
+                        {
+                            best = candidate;
+                        }
+                    }
+                }
+            }
+
+            uint64_t indices = 0;
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                indices |= uint64_t(best.indices[p]) << (p * 3);
+            }
+            pDst[0] = best.endpoint0;
+            pDst[1] = best.endpoint1;
+            for(uint32_t i = 0; i < 6; i++)
+            {
+                pDst[2 + i] = (uint8_t)(indices >> (i * 8));
+            }
+        }
+
+        /************************************************************************/
+        /* BC7 blocks                                                           */
+        /************************************************************************/
+        // Blocks are encoded in mode 6: a single subset with 7.7.7.7 endpoints, a unique P-bit per endpoint and 4-bit indices.
+        // Blocks with varying alpha are also encoded in mode 5, which has separate color and alpha indices, and the encoding with the lower error is selected.
+        const uint32_t kBc7Weights[] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+        const float kBc7FloatWeights[] = {0, 4 / 64.0f, 9 / 64.0f, 13 / 64.0f, 17 / 64.0f, 21 / 64.0f, 26 / 64.0f, 30 / 64.0f, 34 / 64.0f, 38 / 64.0f, 43 / 64.0f, 47 / 64.0f, 51 / 64.0f, 55 / 64.0f, 60 / 64.0f, 1};
+
+        struct Bc7Block
+        {
+            uint8_t endpoints[2][4];    ///< 7-bit values
+            uint8_t pBits[2];
+            uint8_t indices[16];
+            float error;
+        };
+
+        void quantizeBc7Endpoint(const float endpoint[4], uint8_t pBit, uint8_t quantized[4])
+        {
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                int32_t q = (int32_t)std::floor((endpoint[c] - pBit) / 2 + 0.5f);
+                quantized[c] = (uint8_t)min(127, max(0, q));
+            }
+        }
+
+        float getBc7QuantizationError(const float endpoint[4], uint8_t pBit)
+        {
+            uint8_t quantized[4];
+            quantizeBc7Endpoint(endpoint, pBit, quantized);
+            float error = 0;
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                float diff = endpoint[c] - ((quantized[c] << 1) | pBit);
+                error += diff * diff;
+            }
+            return error;
+        }
+
+        void evaluateBc7Block(const Block& block, const float endpoint0[4], const float endpoint1[4], uint8_t pBit0, uint8_t pBit1, Bc7Block& result)
+        {
+            quantizeBc7Endpoint(endpoint0, pBit0, result.endpoints[0]);
+            quantizeBc7Endpoint(endpoint1, pBit1, result.endpoints[1]);
+            result.pBits[0] = pBit0;
+            result.pBits[1] = pBit1;
+
+            float palette[16][4];
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                uint32_t e0 = (result.endpoints[0][c] << 1) | pBit0;
+                uint32_t e1 = (result.endpoints[1][c] << 1) | pBit1;
+                for(uint32_t i = 0; i < 16; i++)
+                {
+                    palette[i][c] = (float)(((64 - kBc7Weights[i]) * e0 + kBc7Weights[i] * e1 + 32) >> 6);
+                }
+            }
+            result.error = fitIndices(block, 0, 4, palette, 16, result.indices);
+        }
+
+        /** Select the P-bits and quantize the endpoints.
+            \param[in] isOpaque If true, all pixels have alpha 255. The alpha endpoints are pinned to 255 and both P-bits set, since a 0 P-bit can only decode to 254
+        */
+        void fitBc7Endpoints(const Block& block, const float endpoint0[4], const float endpoint1[4], BlockCompressionQuality quality, bool isOpaque, Bc7Block& best)
+        {
+            if(isOpaque)
+            {
+                float opaque0[4] = {endpoint0[0], endpoint0[1], endpoint0[2], 255};
+                float opaque1[4] = {endpoint1[0], endpoint1[1], endpoint1[2], 255};
+                evaluateBc7Block(block, opaque0, opaque1, 1, 1, best);
+            }
+            else if(quality == BlockCompressionQuality::High)
+            {
+                best.error = FLT_MAX;
+                for(uint8_t pBits = 0; pBits < 4; pBits++)
+                {
+                    Bc7Block candidate;
+                    evaluateBc7Block(block, endpoint0, endpoint1, pBits & 1, pBits >> 1, candidate);
+                    if(candidate.error < best.error)
+                    {
+                        best = candidate;
+                    }
+                }
+            }
+            else
+            {
+                // Select each P-bit by the endpoint's quantization error
+                uint8_t pBit0 = (getBc7QuantizationError(endpoint0, 1) < getBc7QuantizationError(endpoint0, 0)) ? 1 : 0;
+                uint8_t pBit1 = (getBc7QuantizationError(endpoint1, 1) < getBc7QuantizationError(endpoint1, 0)) ? 1 : 0;
+                evaluateBc7Block(block, endpoint0, endpoint1, pBit0, pBit1, best);
+            }
+        }
+
+        class BitWriter
+        {
+        public:
+            BitWriter(uint8_t* pDst, uint32_t byteCount) : mpDst(pDst)
+            {
+                memset(pDst, 0, byteCount);
+            }
+
+            void write(uint32_t value, uint32_t bitCount)
+            {
+                for(uint32_t i = 0; i < bitCount; i++)
+                {
+                    mpDst[mPosition >> 3] |= ((value >> i) & 1) << (mPosition & 7);
+                    mPosition++;
+                }
+            }
+        private:
+            uint8_t* mpDst;
+            uint32_t mPosition = 0;
+        };
+
+        const uint32_t kBc7Mode5Weights[] = {0, 21, 43, 64};
+        const float kBc7Mode5FloatWeights[] = {0, 21 / 64.0f, 43 / 64.0f, 1};
+
+        struct Bc7Mode5Block
+        {
+            uint8_t colorEndpoints[2][3];   ///< 7-bit values
+            uint8_t alphaEndpoints[2];
+            uint8_t colorIndices[16];
+            uint8_t alphaIndices[16];
+            float colorError;
+            float alphaError;
+        };
+
+        void evaluateBc7Mode5Color(const Block& block, const float endpoint0[4], const float endpoint1[4], Bc7Mode5Block& result)
+        {
+            float palette[4][4];
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                result.colorEndpoints[0][c] = (uint8_t)(endpoint0[c] * 127.0f / 255.0f + 0.5f);
+                result.colorEndpoints[1][c] = (uint8_t)(endpoint1[c] * 127.0f / 255.0f + 0.5f);
+                uint32_t e0 = (result.colorEndpoints[0][c] << 1) | (result.colorEndpoints[0][c] >> 6);
+                uint32_t e1 = (result.colorEndpoints[1][c] << 1) | (result.colorEndpoints[1][c] >> 6);
+                for(uint32_t i = 0; i < 4; i++)
+                {
+                    palette[i][c] = (float)(((64 - kBc7Mode5Weights[i]) * e0 + kBc7Mode5Weights[i] * e1 + 32) >> 6);
+                }
+            }
+            result.colorError = fitIndices(block, 0, 3, palette, 4, result.colorIndices);
+        }
+
+        void evaluateBc7Mode5Alpha(const Block& block, uint8_t endpoint0, uint8_t endpoint1, Bc7Mode5Block& result)
+        {
+            float palette[4][4];
+            for(uint32_t i = 0; i < 4; i++)
+            {
+                palette[i][3] = (float)(((64 - kBc7Mode5Weights[i]) * endpoint0 + kBc7Mode5Weights[i] * endpoint1 + 32) >> 6);
+            }
+            result.alphaEndpoints[0] = endpoint0;
+            result.alphaEndpoints[1] = endpoint1;
+            result.alphaError = fitIndices(block, 3, 1, palette, 4, result.alphaIndices);
+        }
+
+        void fitBc7Mode5Block(const Block& block, BlockCompressionQuality quality, Bc7Mode5Block& best)
+        {
+            uint32_t iterations = getRefinementIterations(quality);
+
+            // Color
+            float endpoint0[4], endpoint1[4];
+            fitPrincipalAxis(block, 0, 3, kAllPixels, endpoint0, endpoint1);
+            evaluateBc7Mode5Color(block, endpoint0, endpoint1, best);
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                if(refineEndpoints(block, 0, 3, kAllPixels, best.colorIndices, kBc7Mode5FloatWeights, endpoint0, endpoint1) == false)
+                {
+                    break;
+                }
+                Bc7Mode5Block candidate = best;
+                evaluateBc7Mode5Color(block, endpoint0, endpoint1, candidate);
+                if(candidate.colorError >= best.colorError)
+                {
+                    break;
+                }
+                best = candidate;
+            }
+
+            // Alpha
+            float minAlpha = 255;
+            float maxAlpha = 0;
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                minAlpha = min(minAlpha, block.values[3][p]);
+                maxAlpha = max(maxAlpha, block.values[3][p]);
+            }
+            evaluateBc7Mode5Alpha(block, (uint8_t)minAlpha, (uint8_t)maxAlpha, best);
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                endpoint0[3] = best.alphaEndpoints[0];
+                endpoint1[3] = best.alphaEndpoints[1];
+                if(refineEndpoints(block, 3, 1, kAllPixels, best.alphaIndices, kBc7Mode5FloatWeights, endpoint0, endpoint1) == false)
+                {
+                    break;
+                }
+                Bc7Mode5Block candidate = best;
+                evaluateBc7Mode5Alpha(block, quantizeChannel(endpoint0[3]), quantizeChannel(endpoint1[3]), candidate);
+                if(candidate.alphaError >= best.alphaError)
+                {
+                    break;
+                }
+                best = candidate;
+            }
+        }
+
+        void writeBc7Mode5Block(Bc7Mode5Block& block, uint8_t* pDst)
+        {
+            // The MSB of the first pixel's indices is implicitly 0
+            if(block.colorIndices[0] & 2)
+            {
+                std::swap(block.colorEndpoints[0], block.colorEndpoints[1]);
+                for(uint32_t p = 0; p < 16; p++)
+                {
+                    block.colorIndices[p] = 3 - block.colorIndices[p];
+                }
+            }
+            if(block.alphaIndices[0] & 2)
+            {
+                std::swap(block.alphaEndpoints[0], block.alphaEndpoints[1]);
+                for(uint32_t p = 0; p < 16; p++)
+                {
+                    block.alphaIndices[p] = 3 - block.alphaIndices[p];
+                }
+            }
+
+            BitWriter writer(pDst, 16);
+            writer.write(1 << 5, 6);    // Mode 5
+            writer.write(0, 2);         // No channel rotation
+            for(uint32_t c = 0; c < 3; c++)
+            {
+                writer.write(block.colorEndpoints[0][c], 7);
+                writer.write(block.colorEndpoints[1][c], 7);
+            }
+            writer.write(block.alphaEndpoints[0], 8);
+            writer.write(block.alphaEndpoints[1], 8);
+            writer.write(block.colorIndices[0], 1);
+            for(uint32_t p = 1; p < 16; p++)
+            {
+                writer.write(block.colorIndices[p], 2);
+            }
+            writer.write(block.alphaIndices[0], 1);
+            for(uint32_t p = 1; p < 16; p++)
+            {
+                writer.write(block.alphaIndices[p], 2);
+            }
+        }
+
+        void encodeBc7Block(const Block& block, BlockCompressionQuality quality, uint8_t* pDst)
+        {
+            float endpoint0[4], endpoint1[4];
+            fitPrincipalAxis(block, 0, 4, kAllPixels, endpoint0, endpoint1);
+
+            bool isOpaque = true;
+            for(uint32_t p = 0; p < 16; p++)
+            {
+                isOpaque = isOpaque && (block.values[3][p] == 255);
+            }
+
+            Bc7Block best;
+            fitBc7Endpoints(block, endpoint0, endpoint1, quality, isOpaque, best);
+
+            uint32_t iterations = getRefinementIterations(quality);
+            for(uint32_t i = 0; i < iterations; i++)
+            {
+                if(refineEndpoints(block, 0, 4, kAllPixels, best.indices, kBc7FloatWeights, endpoint0, endpoint1) == false)
+                {
+                    break;
+                }
+                Bc7Block candidate;
+                fitBc7Endpoints(block, endpoint0, endpoint1, quality, isOpaque, candidate);
+                if(candidate.error >= best.error)
+                {
+                    break;
+                }
+                best = candidate;
+            }
+
+            bool hasVaryingAlpha = false;
+            for(uint32_t p = 1; p < 16; p++)
+            {
+                hasVaryingAlpha = hasVaryingAlpha || (block.values[3][p] != block.values[3][0]);
+            }
+            if(hasVaryingAlpha)
+            {
+                Bc7Mode5Block mode5;
+                fitBc7Mode5Block(block, quality, mode5);
+                if(mode5.colorError + mode5.alphaError < best.error)
+                {
+                    writeBc7Mode5Block(mode5, pDst);
+                    return;
+                }
+            }
+
+            // The MSB of the first pixel's index is implicitly 0. Swap the endpoints if it isn't
+            if(best.indices[0] & 8)
+            {
+                std::swap(best.endpoints[0], best.endpoints[1]);
+                std::swap(best.pBits[0], best.pBits[1]);
+                for(uint32_t p = 0; p < 16; p++)
+                {
+                    best.indices[p] = 15 - best.indices[p];
+                }
+            }
+
+            BitWriter writer(pDst, 16);
+            writer.write(1 << 6, 7);    // Mode 6
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                writer.write(best.endpoints[0][c], 7);
+                writer.write(best.endpoints[1][c], 7);
+            }
+            writer.write(best.pBits[0], 1);
+            writer.write(best.pBits[1], 1);
+            writer.write(best.indices[0], 3);
+            for(uint32_t p = 1; p < 16; p++)
+            {
+                writer.write(best.indices[p], 4);
+            }
+        }
+
+        void encodeBlock(ResourceFormat format, const Block& block, BlockCompressionQuality quality, uint8_t* pDst)
+        {
+            switch(format)
+            {
+            case ResourceFormat::BC1Unorm:
+            case ResourceFormat::BC1UnormSrgb:
+                encodeColorBlock(block, quality, true, pDst);
+                break;
+            case ResourceFormat::BC3Unorm:
+            case ResourceFormat::BC3UnormSrgb:
+                encodeChannelBlock(block, 3, quality, pDst);
+                encodeColorBlock(block, quality, false, pDst + 8);
+                break;
+            case ResourceFormat::BC4Unorm:
+                encodeChannelBlock(block, 0, quality, pDst);
+                break;
+            case ResourceFormat::BC5Unorm:
+                encodeChannelBlock(block, 0, quality, pDst);
+                encodeChannelBlock(block, 1, quality, pDst + 8);
+                break;
+            case ResourceFormat::BC7Unorm:
+            case ResourceFormat::BC7UnormSrgb:
+                encodeBc7Block(block, quality, pDst);
+                break;
+            default:
+                should_not_get_here();
+            }
+        }
+    }
+
+    bool isBlockCompressionSupported(ResourceFormat format)
+    {
+        switch(format)
+        {
+        case ResourceFormat::BC1Unorm:
+        case ResourceFormat::BC1UnormSrgb:
+        case ResourceFormat::BC3Unorm:
+        case ResourceFormat::BC3UnormSrgb:
+        case ResourceFormat::BC4Unorm:
+        case ResourceFormat::BC5Unorm:
+        case ResourceFormat::BC7Unorm:
+        case ResourceFormat::BC7UnormSrgb:
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    ResourceFormat getBlockCompressedFormat(ResourceFormat srcFormat, bool hasAlpha, bool isNormalMap, BlockCompressionQuality quality)
+    {
+        std::vector<uint8_t> dummy;
+        if(convertToRgba8(srcFormat, nullptr, 0, dummy) == false || srcFormat == ResourceFormat::Alpha8Unorm)
+        {
+            return ResourceFormat::Unknown;
+        }
+
+        uint32_t channelCount = getFormatChannelCount(srcFormat);
+        if(isNormalMap && channelCount >= 2)
+        {
+            return ResourceFormat::BC5Unorm;
+        }
+
+        bool isSrgb = isSrgbFormat(srcFormat);
+        switch(channelCount)
+        {
+        case 1:
+            return ResourceFormat::BC4Unorm;
+        case 2:
+            return ResourceFormat::BC5Unorm;
+        default:
+            if(quality == BlockCompressionQuality::High)
+            {
+                return isSrgb ? ResourceFormat::BC7UnormSrgb : ResourceFormat::BC7Unorm;
+            }
+            if(hasAlpha)
+            {
+                return isSrgb ? ResourceFormat::BC3UnormSrgb : ResourceFormat::BC3Unorm;
+            }
+            return isSrgb ? ResourceFormat::BC1UnormSrgb : ResourceFormat::BC1Unorm;
+        }
+    }
+
+    bool convertToRgba8(ResourceFormat srcFormat, const void* pSrc, uint32_t pixelCount, std::vector<uint8_t>& rgba)
+    {
+        // 4-channel formats have vectorized conversions
+        switch(srcFormat)
+        {
+        case ResourceFormat::RGBA8Unorm:
+        case ResourceFormat::RGBA8UnormSrgb:
+            rgba.assign((const uint8_t*)pSrc, (const uint8_t*)pSrc + size_t(pixelCount) * 4);
+            return true;
+        case ResourceFormat::RGBX8Unorm:
+        case ResourceFormat::RGBX8UnormSrgb:
+            rgba.assign((const uint8_t*)pSrc, (const uint8_t*)pSrc + size_t(pixelCount) * 4);
+            fillAlpha8(rgba.data(), pixelCount);
+            return true;
+        case ResourceFormat::BGRA8Unorm:
+        case ResourceFormat::BGRA8UnormSrgb:
+            rgba.resize(size_t(pixelCount) * 4);
+            swapRedBlue8((const uint8_t*)pSrc, rgba.data(), pixelCount);
+            return true;
+        case ResourceFormat::BGRX8Unorm:
+        case ResourceFormat::BGRX8UnormSrgb:
+            rgba.resize(size_t(pixelCount) * 4);
+            swapRedBlue8((const uint8_t*)pSrc, rgba.data(), pixelCount);
+            fillAlpha8(rgba.data(), pixelCount);
+            return true;
+        default:
+            break;
+        }
+
+        // Source channel for each of R, G, B, A. -1 means the channel is missing
+        int32_t swizzle[4];
+        uint32_t srcStride;
+        switch(srcFormat)
+        {
+        case ResourceFormat::R8Unorm:
+            swizzle[0] = 0; swizzle[1] = -1; swizzle[2] = -1; swizzle[3] = -1;
+            srcStride = 1;
+            break;
+        case ResourceFormat::Alpha8Unorm:
+            swizzle[0] = -1; swizzle[1] = -1; swizzle[2] = -1; swizzle[3] = 0;
+            srcStride = 1;
+            break;
+        case ResourceFormat::RG8Unorm:
+            swizzle[0] = 0; swizzle[1] = 1; swizzle[2] = -1; swizzle[3] = -1;
+            srcStride = 2;
+            break;
+        default:
+            return false;
+        }
+
+        rgba.resize(size_t(pixelCount) * 4);
+        const uint8_t* pSrcPixel = (const uint8_t*)pSrc;
+        for(uint32_t i = 0; i < pixelCount; i++)
+        {
+            for(uint32_t c = 0; c < 4; c++)
+            {
+                uint8_t missing = (c == 3) ? 255 : 0;
+                rgba[i * 4 + c] = (swizzle[c] >= 0) ? pSrcPixel[swizzle[c]] : missing;
+            }
+            pSrcPixel += srcStride;
+        }
+        return true;
+    }
+
+    bool compressImage(ResourceFormat format, uint32_t width, uint32_t height, const uint8_t* pRgba8, std::vector<uint8_t>& output, BlockCompressionQuality quality)
+    {
+        if(isBlockCompressionSupported(format) == false)
+        {
+            Logger::log(Logger::Level::Error, "compressImage() - can't compress into format " + to_string(format) + ".");
+            return false;
+        }
+
+        const uint32_t blockSize = getFormatBytesPerBlock(format);
+        const uint32_t blocksX = (width + 3) / 4;
+        const uint32_t blocksY = (height + 3) / 4;
+        output.resize(size_t(blocksX) * blocksY * blockSize);
+        if(output.empty())
+        {
+            return true;
+        }
+
+        uint8_t* pOutput = output.data();
+        ThreadPool::getDefaultPool()->parallelFor(0, blocksY, [=](uint32_t blockY)
+        {
+            Block block;
+            uint8_t* pDst = pOutput + size_t(blockY) * blocksX * blockSize;
+            for(uint32_t blockX = 0; blockX < blocksX; blockX++)
+            {
+                loadBlock(pRgba8, width, height, blockX, blockY, block);
+                encodeBlock(format, block, quality, pDst);
+                pDst += blockSize;
+            }
+        });
+        return true;
+    }
+}
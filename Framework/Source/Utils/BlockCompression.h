@@ -0,0 +1,78 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include "Core/Formats.h"
+
+namespace Falcor
+{
+    /** Block compression quality presets. Higher quality presets search more endpoint candidates per block
+    */
+    enum class BlockCompressionQuality
+    {
+        Fast,       ///< Endpoints are fitted once to the block's bounding range or principal axis
+        Normal,     ///< Endpoints are refined with a least-squares fit
+        High,       ///< Endpoints are refined iteratively and alternate encodings are evaluated for each block
+    };
+
+    /** Check if the CPU block compressor can encode a format. BC1, BC3, BC4, BC5 and BC7 (unorm and sRGB variants) are supported
+    */
+    bool isBlockCompressionSupported(ResourceFormat format);
+
+    /** Select the block compressed format a texture should be compressed into.
+        \param[in] srcFormat The uncompressed texture format
+        \param[in] hasAlpha Whether the texture has non-opaque alpha values
+        \param[in] isNormalMap Whether the texture is a tangent-space normal map. Normal maps are compressed to BC5, which only stores the X and Y components. Shaders reconstruct Z
+        \param[in] quality The quality preset. The High preset selects BC7 for color textures
+        \return The compressed format, or ResourceFormat::Unknown if the format can't be compressed
+    */
+    ResourceFormat getBlockCompressedFormat(ResourceFormat srcFormat, bool hasAlpha, bool isNormalMap, BlockCompressionQuality quality);
+
+    /** Expand 8-bit per channel pixels into RGBA8, which is the input format of compressImage().
+        Supported source formats are the 8-bit unorm formats (R8, RG8, RGBA8, BGRA8, RGBX8, BGRX8 and their sRGB variants) and Alpha8. Missing color channels are set to zero and missing alpha is set to 255.
+        \param[in] srcFormat The source format
+        \param[in] pSrc The source pixels
+        \param[in] pixelCount Number of pixels to convert
+        \param[out] rgba The converted pixels
+        \return false if the source format is not supported, otherwise true
+    */
+    bool convertToRgba8(ResourceFormat srcFormat, const void* pSrc, uint32_t pixelCount, std::vector<uint8_t>& rgba);
+
+    /** Compress an image into a block compressed format on the CPU.
+        The image is split into rows of blocks which are encoded in parallel on the default thread pool. The result depends only on the input and the quality preset, so repeated runs produce identical output.
+        For BC4 only the R channel is encoded, for BC5 the R and G channels. sRGB formats are encoded the same way as their unorm counterparts.
+        \param[in] format The destination format. See isBlockCompressionSupported()
+        \param[in] width The image width in pixels. Doesn't need to be a multiple of 4
+        \param[in] height The image height in pixels. Doesn't need to be a multiple of 4
+        \param[in] pRgba8 The source pixels, 4 bytes per pixel, rows are tightly packed
+        \param[out] output The compressed blocks. The buffer can be passed as-is to Texture::create2D()
+        \param[in] quality The quality preset
+        \return false if the format is not supported, otherwise true
+    */
+    bool compressImage(ResourceFormat format, uint32_t width, uint32_t height, const uint8_t* pRgba8, std::vector<uint8_t>& output, BlockCompressionQuality quality = BlockCompressionQuality::Normal);
+}
@@ -0,0 +1,112 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "FrameRingAllocator.h"
+
+namespace Falcor
+{
+    FrameRingAllocator::FrameRingAllocator(size_t capacity) : mCapacity(capacity)
+    {
+    }
+
+    size_t FrameRingAllocator::allocate(size_t size, size_t alignment)
+    {
+        assert(alignment && ((alignment & (alignment - 1)) == 0));
+        if(size == 0 || size > mCapacity)
+        {
+            return kInvalidOffset;
+        }
+
+        if(mUsedBytes == 0)
+        {
+            // The ring is empty. Restart from the beginning to get the largest contiguous block
+            mHead = 0;
+            mTail = 0;
+        }
+
+        size_t offset = (mHead + alignment - 1) & ~(alignment - 1);
+        size_t padding = offset - mHead;
+        if((mHead > mTail) || (mUsedBytes == 0))
+        {
+            // The free space is [mHead, mCapacity) and [0, mTail)
+            if(offset + size > mCapacity)
+            {
+                // Skip the end of the range and wrap around. Offset 0 satisfies any alignment
+                if(size > mTail)
+                {
+                    return kInvalidOffset;
+                }
+                padding = mCapacity - mHead;
+                offset = 0;
+            }
+        }
+        else
+        {
+            // The free space is [mHead, mTail). When the head caught up with the tail the ring is full
+            if((mUsedBytes == mCapacity) || (offset + size > mTail))
+            {
+                return kInvalidOffset;
+            }
+        }
+
+        mHead = offset + size;
+        if(mHead == mCapacity)
+        {
+            mHead = 0;
+        }
+        mUsedBytes += padding + size;
+        mCurrentFrameBytes += padding + size;
+        return offset;
+    }
+
+    void FrameRingAllocator::endFrame(uint64_t fenceValue)
+    {
+        assert(mFrames.empty() || mFrames.back().fenceValue <= fenceValue);
+        Frame frame;
+        frame.fenceValue = fenceValue;
+        frame.endOffset = mHead;
+        frame.size = mCurrentFrameBytes;
+        mFrames.push_back(frame);
+        mCurrentFrameBytes = 0;
+    }
+
+    void FrameRingAllocator::releaseCompletedFrames(uint64_t completedFenceValue)
+    {
+        while(mFrames.size() && mFrames.front().fenceValue <= completedFenceValue)
+        {
+            const Frame& frame = mFrames.front();
+            // Frames without allocations may hold an offset from before the ring was rewound
+            if(frame.size)
+            {
+                mTail = frame.endOffset;
+            }
+            mUsedBytes -= frame.size;
+            mFrames.pop_front();
+        }
+    }
+}
@@ -0,0 +1,97 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <deque>
+
+namespace Falcor
+{
+    /** Bookkeeping for a linear ring allocator partitioned into frames.\n
+        Allocations are carved linearly out of a fixed-size range of bytes, wrapping around to the start of the range when reaching its end. All the allocations made between 2 endFrame() calls belong to the same frame. A frame is tagged with a fence value when it's closed, and its memory is recycled as a whole once releaseCompletedFrames() is called with a value greater or equal to the frame's fence value.\n
+        The class only hands out offsets and doesn't own any memory, so it can manage a GPU buffer as well as a plain CPU array.
+    */
+    class FrameRingAllocator
+    {
+    public:
+        /** Create a new allocator
+            \param[in] capacity The size in bytes of the managed range
+        */
+        FrameRingAllocator(size_t capacity);
+
+        /** Allocate a block from the current frame.
+            \param[in] size The block size in bytes
+            \param[in] alignment The block offset alignment. Must be a power of 2
+            \return The offset of the block, or kInvalidOffset if there's not enough free space. In that case the caller can wait for an in-flight frame to complete and try again.
+        */
+        size_t allocate(size_t size, size_t alignment);
+
+        /** Close the current frame. Allocations made after this call belong to the next frame.
+            \param[in] fenceValue The fence value which will signal that the GPU is done with the frame's allocations. Must increase monotonically between calls
+        */
+        void endFrame(uint64_t fenceValue);
+
+        /** Recycle the memory of all the closed frames which were tagged with a fence value less or equal to completedFenceValue
+        */
+        void releaseCompletedFrames(uint64_t completedFenceValue);
+
+        /** Get the fence value of the oldest in-flight frame. If no frames are in flight, returns 0
+        */
+        uint64_t getOldestFrameFenceValue() const { return mFrames.empty() ? 0 : mFrames.front().fenceValue; }
+
+        /** Get the number of closed frames whose memory wasn't recycled yet
+        */
+        size_t getInFlightFrameCount() const { return mFrames.size(); }
+
+        /** Get the number of bytes used by the current frame and the in-flight frames. This includes bytes lost to alignment and wrap-around
+        */
+        size_t getUsedBytes() const { return mUsedBytes; }
+
+        /** Get the number of bytes allocated by the current frame, including alignment padding
+        */
+        size_t getCurrentFrameBytes() const { return mCurrentFrameBytes; }
+
+        /** Get the size of the managed range
+        */
+        size_t getCapacity() const { return mCapacity; }
+
+        static const size_t kInvalidOffset = (size_t)-1;
+    private:
+        struct Frame
+        {
+            uint64_t fenceValue;
+            size_t endOffset;   ///< The head position when the frame was closed. Everything before it, up to the previous frame's end, belongs to the frame
+            size_t size;        ///< Number of bytes used by the frame, including padding
+        };
+
+        size_t mCapacity;
+        size_t mHead = 0;       ///< The next free byte
+        size_t mTail = 0;       ///< The first byte in use by the oldest frame
+        size_t mUsedBytes = 0;
+        size_t mCurrentFrameBytes = 0;
+        std::deque<Frame> mFrames;
+    };
+}
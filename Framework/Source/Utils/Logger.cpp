@@ -28,6 +28,11 @@
 #include "Framework.h"
 #include "Logger.h"
 #include "Utils/OS.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
 
 namespace Falcor
 {
@@ -36,10 +41,57 @@ namespace Falcor
 #else
     bool Logger::sShowErrorBox = false;
 #endif
+    Logger::Level Logger::sVerbosity = Logger::Level::Info;
 
-    // FIXME: global variables...
-    static bool gInit = false;
-    static FILE* gLogFile = nullptr;
+    namespace
+    {
+        // Bounded multi-producer queue. Each slot's sequence number tells whether it's free for the producer with the matching position, or holds a message for the consumer
+        const uint32_t kQueueSize = 4096;
+        struct LogSlot
+        {
+            std::atomic<uint64_t> sequence;
+            Logger::Level level;
+            std::string msg;
+            uint32_t suppressedCount;
+        };
+        LogSlot gQueue[kQueueSize];
+        std::atomic<uint64_t> gEnqueuePos;
+        uint64_t gDequeuePos = 0;                   // Protected by gDrainMutex
+        std::atomic<uint32_t> gDroppedCount;
+
+        // Rate limiting. A small hash table of recent messages. Collisions just reset the slot, which only makes the limit less strict
+        const uint32_t kRateSlotCount = 256;
+        struct RateSlot
+        {
+            std::atomic<size_t> hash;
+            std::atomic<uint64_t> windowStart;
+            std::atomic<uint32_t> count;
+            std::atomic<uint32_t> suppressed;
+        };
+        RateSlot gRateSlots[kRateSlotCount];
+        std::atomic<uint32_t> gMaxRepeats(10);
+        std::atomic<uint32_t> gRateWindowMs(1000);
+        std::atomic<uint32_t> gOrphanedSuppressedCount;  // Suppressed copies of messages whose slot was taken over before they were reported
+
+        // The writer. gDrainMutex makes sure there's only one consumer, either the writer thread or a thread calling flush()
+        bool gInit = false;
+        FILE* gLogFile = nullptr;
+        std::string gLogFilename;
+        uint64_t gFileSize = 0;
+        uint64_t gMaxFileSize = 0;
+        uint32_t gMaxRotatedFiles = 4;
+        std::mutex gDrainMutex;
+        std::thread gWriterThread;
+        std::mutex gWakeMutex;
+        std::condition_variable gWakeCond;
+        bool gWakeWriter = false;
+        bool gStopWriter = false;
+
+        uint64_t getTimeMs()
+        {
+            return (uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+    }
 
     static FILE* openLogFile()
     {
@@ -57,6 +109,7 @@ namespace Falcor
             if(fopen_s(&pFile, logFile.c_str(), "w") == 0)
             {
                 // Success
+                gLogFilename = logFile;
                 return pFile;
             }
         }
@@ -65,6 +118,215 @@ namespace Falcor
         return pFile;
     }
 
+    const char* getLogLevelString(Logger::Level L)
+    {
+        const char* c = nullptr;
+#define create_level_case(_l) case _l: c = "(" #_l ")" ;break;
+        switch(L)
+        {
+            create_level_case(Logger::Level::Info);
+            create_level_case(Logger::Level::Warning);
+            create_level_case(Logger::Level::Fatal);
+            create_level_case(Logger::Level::Error);
+        default:
+            should_not_get_here();
+        }
+#undef create_level_case
+        return c;
+    }
+
+    static void rotateLogFile()
+    {
+        fclose(gLogFile);
+        gLogFile = nullptr;
+
+        // <log>.N-1 -> <log>.N, ..., <log> -> <log>.1. The oldest file is overwritten
+        if(gMaxRotatedFiles > 0)
+        {
+            for(uint32_t i = gMaxRotatedFiles; i > 0; i--)
+            {
+                std::string dst = gLogFilename + "." + std::to_string(i);
+                std::string src = (i == 1) ? gLogFilename : gLogFilename + "." + std::to_string(i - 1);
+                std::remove(dst.c_str());
+                std::rename(src.c_str(), dst.c_str());
+            }
+        }
+
+        if(fopen_s(&gLogFile, gLogFilename.c_str(), "w") != 0)
+        {
+            gLogFile = nullptr;
+        }
+        gFileSize = 0;
+    }
+
+    static void writeLine(const char* level, const std::string& msg)
+    {
+        if(gLogFile == nullptr)
+        {
+            return;
+        }
+
+        int written = fprintf_s(gLogFile, "%-12s%s\n", level, msg.c_str());
+        gFileSize += (written > 0) ? written : 0;
+        if(gMaxFileSize && gFileSize >= gMaxFileSize)
+        {
+            rotateLogFile();
+        }
+    }
+
+    // Write all the published messages to the file. Must be called with gDrainMutex locked
+    static void drainQueue()
+    {
+        uint32_t dropped = gDroppedCount.exchange(0);
+        if(dropped)
+        {
+            writeLine(getLogLevelString(Logger::Level::Warning), std::to_string(dropped) + " log messages were dropped, since the log queue was full");
+        }
+        uint32_t suppressed = gOrphanedSuppressedCount.exchange(0);
+        if(suppressed)
+        {
+            writeLine(getLogLevelString(Logger::Level::Warning), std::to_string(suppressed) + " repeated log messages were suppressed");
+        }
+
+        while(true)
+        {
+            LogSlot& slot = gQueue[gDequeuePos % kQueueSize];
+            if(slot.sequence.load(std::memory_order_acquire) != gDequeuePos + 1)
+            {
+                // Empty, or the producer which owns the next position didn't finish writing yet
+                break;
+            }
+
+            std::string msg = std::move(slot.msg);
+            Logger::Level level = slot.level;
+            uint32_t suppressed = slot.suppressedCount;
+            slot.sequence.store(gDequeuePos + kQueueSize, std::memory_order_release);
+            gDequeuePos++;
+
+            if(suppressed)
+            {
+                msg += " (" + std::to_string(suppressed) + " repeats of this message were suppressed)";
+            }
+            writeLine(getLogLevelString(level), msg);
+        }
+
+        if(gLogFile)
+        {
+            fflush(gLogFile);
+        }
+    }
+
+    static void writerLoop()
+    {
+        std::unique_lock<std::mutex> wakeLock(gWakeMutex);
+        while(gStopWriter == false)
+        {
+            wakeLock.unlock();
+            {
+                std::lock_guard<std::mutex> drainLock(gDrainMutex);
+                drainQueue();
+            }
+            wakeLock.lock();
+
+            // Producers only wake the writer when the queue fills up. Otherwise messages are written in batches
+            gWakeCond.wait_for(wakeLock, std::chrono::milliseconds(20), [] { return gWakeWriter || gStopWriter; });
+            gWakeWriter = false;
+        }
+    }
+
+    static void wakeWriter()
+    {
+        std::lock_guard<std::mutex> lock(gWakeMutex);
+        gWakeWriter = true;
+        gWakeCond.notify_one();
+    }
+
+    static bool tryEnqueue(Logger::Level level, const std::string& msg, uint32_t suppressedCount)
+    {
+        uint64_t pos = gEnqueuePos.load(std::memory_order_relaxed);
+        LogSlot* pSlot;
+        while(true)
+        {
+            pSlot = &gQueue[pos % kQueueSize];
+            int64_t diff = (int64_t)pSlot->sequence.load(std::memory_order_acquire) - (int64_t)pos;
+            if(diff == 0)
+            {
+                if(gEnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if(diff < 0)
+            {
+                // The consumer didn't free the slot yet
+                return false;
+            }
+            else
+            {
+                pos = gEnqueuePos.load(std::memory_order_relaxed);
+            }
+        }
+
+        pSlot->level = level;
+        pSlot->msg = msg;
+        pSlot->suppressedCount = suppressedCount;
+        pSlot->sequence.store(pos + 1, std::memory_order_release);
+
+        // Wake the writer early when a burst of messages fills a quarter of the queue
+        if(((pos + 1) % (kQueueSize / 4)) == 0)
+        {
+            wakeWriter();
+        }
+        return true;
+    }
+
+    // Returns false if the message should be suppressed. Otherwise, suppressedCount is the number of copies suppressed since the last one which got through
+    static bool checkRateLimit(Logger::Level level, const std::string& msg, uint32_t& suppressedCount)
+    {
+        suppressedCount = 0;
+        uint32_t maxRepeats = gMaxRepeats.load(std::memory_order_relaxed);
+        if(maxRepeats == 0)
+        {
+            return true;
+        }
+
+        size_t hash = std::hash<std::string>()(msg) ^ (size_t)level;
+        RateSlot& slot = gRateSlots[hash % kRateSlotCount];
+        uint64_t now = getTimeMs();
+        bool isSameMessage = (slot.hash.load(std::memory_order_relaxed) == hash);
+        bool isWindowOver = (now - slot.windowStart.load(std::memory_order_relaxed) >= gRateWindowMs.load(std::memory_order_relaxed));
+        if(isSameMessage == false && isWindowOver == false)
+        {
+            // The slot tracks a different message. Don't take it over, so a flood of unique messages can't reset the limit of a repeating one
+            return true;
+        }
+
+        if(isWindowOver)
+        {
+            // New window
+            uint32_t suppressed = slot.suppressed.exchange(0, std::memory_order_relaxed);
+            if(isSameMessage)
+            {
+                suppressedCount = suppressed;
+            }
+            else
+            {
+                gOrphanedSuppressedCount += suppressed;
+            }
+            slot.hash.store(hash, std::memory_order_relaxed);
+            slot.windowStart.store(now, std::memory_order_relaxed);
+            slot.count.store(1, std::memory_order_relaxed);
+            return true;
+        }
+
+        if(slot.count.fetch_add(1, std::memory_order_relaxed) < maxRepeats)
+        {
+            return true;
+        }
+        slot.suppressed.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
     void Logger::init()
     {
 #if _LOG_ENABLED
@@ -73,6 +335,25 @@ namespace Falcor
             gLogFile = openLogFile();
             gInit = gLogFile != nullptr;
             assert(gInit);
+
+            for(uint32_t i = 0; i < kQueueSize; i++)
+            {
+                gQueue[i].sequence.store(i, std::memory_order_relaxed);
+            }
+            gEnqueuePos.store(0);
+            gDequeuePos = 0;
+            gFileSize = 0;
+
+            gStopWriter = false;
+            gWriterThread = std::thread(writerLoop);
+
+            // Make sure the writer is joined even if shutdown() isn't called. The thread object was constructed before this registration, so this runs before its destructor
+            static bool sRegisteredAtExit = false;
+            if(sRegisteredAtExit == false)
+            {
+                atexit(Logger::shutdown);
+                sRegisteredAtExit = true;
+            }
         }
 #endif
     }
@@ -80,41 +361,80 @@ namespace Falcor
     void Logger::shutdown()
     {
 #if _LOG_ENABLED
+        if(gWriterThread.joinable())
+        {
+            {
+                std::lock_guard<std::mutex> lock(gWakeMutex);
+                gStopWriter = true;
+                gWakeCond.notify_one();
+            }
+            gWriterThread.join();
+        }
+
         if(gLogFile)
         {
+            // Report the copies which were suppressed since the last one got through
+            for(auto& slot : gRateSlots)
+            {
+                gOrphanedSuppressedCount += slot.suppressed.exchange(0);
+            }
+
+            std::lock_guard<std::mutex> lock(gDrainMutex);
+            gInit = false;
+            drainQueue();
             fclose(gLogFile);
             gLogFile = nullptr;
-            gInit = false;
         }
 #endif
     }
 
-    const char* getLogLevelString(Logger::Level L)
+    void Logger::setRateLimit(uint32_t maxRepeats, uint32_t windowMs)
     {
-        const char* c = nullptr;
-#define create_level_case(_l) case _l: c = "(" #_l ")" ;break;
-        switch(L)
-        {
-            create_level_case(Logger::Level::Info);
-            create_level_case(Logger::Level::Warning);
-            create_level_case(Logger::Level::Fatal);
-            create_level_case(Logger::Level::Error);
-        default:
-            should_not_get_here();
-        }
-#undef create_level_case
-        return c;
+        gMaxRepeats = maxRepeats;
+        gRateWindowMs = windowMs;
+    }
+
+    void Logger::setFileRotation(uint64_t maxFileSize, uint32_t maxFiles)
+    {
+        std::lock_guard<std::mutex> lock(gDrainMutex);
+        gMaxFileSize = maxFileSize;
+        gMaxRotatedFiles = maxFiles;
+    }
+
+    void Logger::flush()
+    {
+#if _LOG_ENABLED
+        std::lock_guard<std::mutex> lock(gDrainMutex);
+        drainQueue();
+#endif
     }
 
     void Logger::log(Level L, const std::string& msg, const bool forceMsgBox /* = false*/)
     {
+        uint32_t suppressedCount = 0;
+        if(checkRateLimit(L, msg, suppressedCount) == false)
+        {
+            return;
+        }
+
 #if _LOG_ENABLED
-        if(gInit)
+        if(gInit && isEnabled(L))
         {
-            fprintf_s(gLogFile, "%-12s", getLogLevelString(L));
-            fprintf_s(gLogFile, msg.c_str());
-            fprintf_s(gLogFile, "\n");
-            fflush(gLogFile);   // Slows down execution, but ensures that the message will be printed in case of a crash
+            if(L >= Level::Error)
+            {
+                // Never drop errors. Wait for the writer to make room, and write the message before returning, so it's in the file even if the application crashes next
+                while(tryEnqueue(L, msg, suppressedCount) == false)
+                {
+                    wakeWriter();
+                    std::this_thread::yield();
+                }
+                flush();
+            }
+            else if(tryEnqueue(L, msg, suppressedCount) == false)
+            {
+                gDroppedCount++;
+                wakeWriter();
+            }
         }
 #endif
 
@@ -131,4 +451,4 @@ namespace Falcor
             }
         }
     }
-}
\ No newline at end of file
+}
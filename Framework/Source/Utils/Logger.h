@@ -34,6 +34,9 @@ namespace Falcor
     /** Container class for logging messages. 
     *   To enable log messages, make sure _LOG_ENABLED is set to true in FalcorConfig.h.
     *   Messages are printed to a log file in the application directory. Using Logger#ShowBoxOnError() you can control if a message box will be shown as well.
+    *   log() is thread-safe and doesn't block on file IO. Messages go into a bounded lock-free queue, in a single order across all threads, and a background thread formats and writes them.
+    *   Error and Fatal messages are flushed to the file before log() returns. When the queue is full, Info and Warning messages are dropped, and the number of dropped messages is written to the log.
+    *   Messages which repeat faster than the rate limit are suppressed (see setRateLimit()). The next copy which gets through reports how many were suppressed.
     */
     class Logger
     {
@@ -72,8 +75,35 @@ namespace Falcor
         */
         static void log(Level L, const std::string& msg, const bool forceMsgBox = false);
 
+        /** Set the lowest level which is written to the log. Messages below it are discarded before they are queued or formatted.
+            \param[in] level The lowest level to write. Level::Disabled disables the log file.
+        */
+        static void setVerbosity(Level level) { sVerbosity = level; }
+        static Level getVerbosity() { return sVerbosity; }
+
+        /** Check if messages of a level are written. Use it to skip building expensive messages.
+        */
+        static bool isEnabled(Level L) { return (sVerbosity != Level::Disabled) && (L >= sVerbosity); }
+
+        /** Limit how often the same message is logged. Useful for messages which are issued every frame or every draw.
+            \param[in] maxRepeats The number of copies of a message which are logged per time window. 0 disables rate limiting
+            \param[in] windowMs The time window in milliseconds
+        */
+        static void setRateLimit(uint32_t maxRepeats, uint32_t windowMs);
+
+        /** Rotate the log file once it grows past a size. The full file is renamed to <log>.1, the previous <log>.1 to <log>.2 and so on.
+            \param[in] maxFileSize The size in bytes which triggers rotation. 0 disables rotation
+            \param[in] maxFiles The number of rotated files to keep. Older files are deleted
+        */
+        static void setFileRotation(uint64_t maxFileSize, uint32_t maxFiles);
+
+        /** Block until all the messages queued so far were written to the log file
+        */
+        static void flush();
+
     private:
         Logger() = delete;
         static bool sShowErrorBox;
+        static Level sVerbosity;
     };
 }
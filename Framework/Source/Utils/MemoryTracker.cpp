@@ -0,0 +1,247 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "MemoryTracker.h"
+#include "Externals/RapidJson/include/rapidjson/stringbuffer.h"
+#include "Externals/RapidJson/include/rapidjson/prettywriter.h"
+#include <fstream>
+
+namespace Falcor
+{
+    namespace
+    {
+        const uint32_t kCategoryCount = (uint32_t)MemoryTracker::Category::Count;
+
+        std::atomic<uint64_t> gCurrentBytes[kCategoryCount];
+        std::atomic<uint64_t> gPeakBytes[kCategoryCount];
+        std::atomic<uint64_t> gAllocationCount[kCategoryCount];
+        std::atomic<uint64_t> gBudgets[kCategoryCount];
+        std::atomic<bool> gOverBudget[kCategoryCount];
+
+        std::atomic<uint64_t> gGpuBytes;
+        std::atomic<uint64_t> gGpuBudget;
+        std::atomic<bool> gGpuOverBudget;
+
+        std::string toMegabytes(uint64_t bytes)
+        {
+            uint64_t tenths = (bytes * 10 + 512 * 1024) / (1024 * 1024);
+            return std::to_string(tenths / 10) + "." + std::to_string(tenths % 10) + " MB";
+        }
+
+        void updateBudgetState(std::atomic<bool>& overBudget, uint64_t bytes, uint64_t budget, const std::string& name)
+        {
+            bool isOver = (budget != 0) && (bytes > budget);
+            // Only warn when crossing the budget, not on every allocation while over it
+            if(overBudget.exchange(isOver) == false && isOver)
+            {
+                Logger::log(Logger::Level::Warning, name + " memory is over budget. Using " + toMegabytes(bytes) + ", the budget is " + toMegabytes(budget));
+            }
+        }
+
+        void writeReport(rapidjson::PrettyWriter<rapidjson::StringBuffer>& writer, const MemoryTracker::Report& report)
+        {
+            writer.StartObject();
+            writer.Key("name");
+            writer.String(report.name.c_str());
+            writer.Key("bytes");
+            writer.Uint64(report.bytes);
+            writer.Key("children");
+            writer.StartArray();
+            for(const auto& child : report.children)
+            {
+                writeReport(writer, child);
+            }
+            writer.EndArray();
+            writer.EndObject();
+        }
+    }
+
+    void MemoryTracker::allocate(Category category, uint64_t bytes)
+    {
+        uint32_t c = (uint32_t)category;
+        uint64_t current = gCurrentBytes[c].fetch_add(bytes) + bytes;
+        gAllocationCount[c]++;
+
+        uint64_t peak = gPeakBytes[c].load();
+        while(current > peak && gPeakBytes[c].compare_exchange_weak(peak, current) == false);
+
+        checkBudget(category, current);
+    }
+
+    void MemoryTracker::release(Category category, uint64_t bytes)
+    {
+        uint32_t c = (uint32_t)category;
+        uint64_t current = gCurrentBytes[c].fetch_sub(bytes) - bytes;
+        gAllocationCount[c]--;
+        checkBudget(category, current);
+    }
+
+    void MemoryTracker::checkBudget(Category category, uint64_t bytes)
+    {
+        uint32_t c = (uint32_t)category;
+        updateBudgetState(gOverBudget[c], bytes, gBudgets[c].load(), getCategoryName(category));
+
+        if(isGpuCategory(category))
+        {
+            updateBudgetState(gGpuOverBudget, getGpuBytes(), gGpuBudget.load(), "GPU");
+        }
+    }
+
+    MemoryTracker::Stats MemoryTracker::getStats(Category category)
+    {
+        uint32_t c = (uint32_t)category;
+        Stats stats;
+        stats.currentBytes = gCurrentBytes[c].load();
+        stats.peakBytes = gPeakBytes[c].load();
+        stats.allocationCount = gAllocationCount[c].load();
+        return stats;
+    }
+
+    uint64_t MemoryTracker::getGpuBytes()
+    {
+        uint64_t bytes = 0;
+        for(uint32_t c = 0; c < kCategoryCount; c++)
+        {
+            bytes += isGpuCategory(Category(c)) ? gCurrentBytes[c].load() : 0;
+        }
+        return bytes;
+    }
+
+    uint64_t MemoryTracker::getCpuBytes()
+    {
+        uint64_t bytes = 0;
+        for(uint32_t c = 0; c < kCategoryCount; c++)
+        {
+            bytes += isGpuCategory(Category(c)) ? 0 : gCurrentBytes[c].load();
+        }
+        return bytes;
+    }
+
+    void MemoryTracker::setBudget(Category category, uint64_t bytes)
+    {
+        gBudgets[(uint32_t)category] = bytes;
+        checkBudget(category, gCurrentBytes[(uint32_t)category].load());
+    }
+
+    uint64_t MemoryTracker::getBudget(Category category)
+    {
+        return gBudgets[(uint32_t)category].load();
+    }
+
+    void MemoryTracker::setGpuBudget(uint64_t bytes)
+    {
+        gGpuBudget = bytes;
+        updateBudgetState(gGpuOverBudget, getGpuBytes(), bytes, "GPU");
+    }
+
+    uint64_t MemoryTracker::getGpuBudget()
+    {
+        return gGpuBudget.load();
+    }
+
+    bool MemoryTracker::isOverBudget()
+    {
+        for(uint32_t c = 0; c < kCategoryCount; c++)
+        {
+            uint64_t budget = gBudgets[c].load();
+            if(budget && gCurrentBytes[c].load() > budget)
+            {
+                return true;
+            }
+        }
+        uint64_t gpuBudget = gGpuBudget.load();
+        return gpuBudget && (getGpuBytes() > gpuBudget);
+    }
+
+    const char* MemoryTracker::getCategoryName(Category category)
+    {
+        switch(category)
+        {
+        case Category::VertexBuffer:
+            return "Vertex buffers";
+        case Category::IndexBuffer:
+            return "Index buffers";
+        case Category::UniformBuffer:
+            return "Uniform buffers";
+        case Category::OtherBuffer:
+            return "Other buffers";
+        case Category::Texture:
+            return "Textures";
+        case Category::AnimationData:
+            return "Animation data";
+        default:
+            should_not_get_here();
+            return "";
+        }
+    }
+
+    MemoryTracker::Report MemoryTracker::getReport()
+    {
+        Report gpu;
+        gpu.name = "GPU";
+        Report cpu;
+        cpu.name = "CPU";
+        for(uint32_t c = 0; c < kCategoryCount; c++)
+        {
+            Report node;
+            node.name = getCategoryName(Category(c));
+            node.bytes = gCurrentBytes[c].load();
+            if(isGpuCategory(Category(c)))
+            {
+                gpu.addChild(node);
+            }
+            else
+            {
+                cpu.addChild(node);
+            }
+        }
+
+        Report report;
+        report.name = "Total";
+        report.addChild(gpu);
+        report.addChild(cpu);
+        return report;
+    }
+
+    bool MemoryTracker::exportJson(const Report& report, const std::string& filename)
+    {
+        rapidjson::StringBuffer buffer;
+        rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
+        writer.SetIndent(' ', 4);
+        writeReport(writer, report);
+
+        std::ofstream outputStream(filename.c_str());
+        if(outputStream.fail())
+        {
+            Logger::log(Logger::Level::Error, "Can't open memory report file " + filename);
+            return false;
+        }
+        outputStream << std::string(buffer.GetString(), buffer.GetSize());
+        return true;
+    }
+}
@@ -0,0 +1,124 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+
+namespace Falcor
+{
+    /** Process-wide accounting of the memory allocated by Falcor's resources.
+        Buffers, textures and animation data report their allocations when they are created and destroyed, so the current and peak usage of each category is always available.
+        Budgets can be set per category and for the total GPU memory. A warning is logged when an allocation crosses a budget, and again after usage dropped below it and crosses it another time.
+        All functions are thread-safe.
+    */
+    class MemoryTracker
+    {
+    public:
+        enum class Category
+        {
+            VertexBuffer,
+            IndexBuffer,
+            UniformBuffer,
+            OtherBuffer,
+            Texture,
+            AnimationData,      ///< CPU memory of animation keys, bones and bone matrices
+
+            Count
+        };
+
+        struct Stats
+        {
+            uint64_t currentBytes = 0;
+            uint64_t peakBytes = 0;
+            uint64_t allocationCount = 0;   ///< Number of live allocations
+        };
+
+        /** A node in a hierarchical memory report. The size of a node includes the size of its children
+        */
+        struct Report
+        {
+            std::string name;
+            uint64_t bytes = 0;
+            std::vector<Report> children;
+
+            /** Add a child node and its size to this node
+            */
+            void addChild(const Report& child) { children.push_back(child); bytes += child.bytes; }
+        };
+
+        /** Record an allocation
+        */
+        static void allocate(Category category, uint64_t bytes);
+
+        /** Record the release of an allocation previously recorded with allocate()
+        */
+        static void release(Category category, uint64_t bytes);
+
+        /** Get the usage of a category
+        */
+        static Stats getStats(Category category);
+
+        /** Get the current usage of the GPU categories (buffers and textures)
+        */
+        static uint64_t getGpuBytes();
+
+        /** Get the current usage of the CPU categories
+        */
+        static uint64_t getCpuBytes();
+
+        /** Set the budget of a category. 0 disables the budget
+        */
+        static void setBudget(Category category, uint64_t bytes);
+        static uint64_t getBudget(Category category);
+
+        /** Set the budget of the GPU categories combined. 0 disables the budget
+        */
+        static void setGpuBudget(uint64_t bytes);
+        static uint64_t getGpuBudget();
+
+        /** Check whether any budget is currently exceeded
+        */
+        static bool isOverBudget();
+
+        static const char* getCategoryName(Category category);
+
+        /** Create a report of the current usage, grouped into GPU and CPU memory
+        */
+        static Report getReport();
+
+        /** Write a report as JSON. Each node is an object with "name", "bytes" and "children" fields
+            \return true if the file was written
+        */
+        static bool exportJson(const Report& report, const std::string& filename);
+
+    private:
+        static bool isGpuCategory(Category category) { return category != Category::AnimationData; }
+        static void checkBudget(Category category, uint64_t bytes);
+    };
+}
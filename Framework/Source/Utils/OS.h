@@ -70,7 +70,7 @@ namespace Falcor
     */
     MsgBoxButton msgBox(const std::string& msg, MsgBoxType mbType = MsgBoxType::Ok);
 
-    /** Finds a file in one of the media directories.  The arguments must not alias.
+    /** Finds a file in one of the media directories.  The arguments must not alias. Thread-safe.
         \param[in] filename The file to look for
         \param[in] fullPath If the file was found, the full path to the file. If the file wasn't found, this is invalid.
         \return true if the file was found, otherwise false
@@ -122,7 +122,7 @@ namespace Falcor
     */
     bool getEnvironemntVariable(const std::string& VarName, std::string& Value);
 
-	/** Get the set containing all recorded data directories.
+	/** Get the set containing all recorded data directories. Not thread-safe, the list can change while the reference is used. Call it on the main thread only.
 	*/
 	const std::vector<std::string>& getDataDirectoriesList();
 
@@ -133,7 +133,7 @@ namespace Falcor
     */
     bool readFileToString(const std::string& fullpath, std::string& str);
 
-    /** Adds a folder into the search directory. Once added, calls to FindFileInCommonDirs() will seach that directory as well
+    /** Adds a folder into the search directory. Once added, calls to FindFileInCommonDirs() will seach that directory as well. Thread-safe.
         \param[in] dir The new directory to add to the common directories.
     */
     void addDataDirectory(const std::string& dir);
@@ -0,0 +1,464 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "PixelConversion.h"
+#include <emmintrin.h>
+#include <tmmintrin.h>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+namespace Falcor
+{
+    namespace
+    {
+        bool checkSsse3Support()
+        {
+#ifdef _MSC_VER
+            int info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 9)) != 0;
+#else
+            return __builtin_cpu_supports("ssse3") != 0;
+#endif
+        }
+
+        double srgbToLinear(double c)
+        {
+            return (c <= 0.04045) ? (c / 12.92) : pow((c + 0.055) / 1.055, 2.4);
+        }
+
+        // linearToSrgb8() finds a first candidate in a table indexed by the float bits, then steps over the few remaining thresholds.
+        // The table covers [2^-14, 1). Smaller values are below the first threshold
+        const uint32_t kSrgbBucketBase = (127 - 14) << 23;
+        const uint32_t kSrgbBucketShift = 15;
+        const uint32_t kSrgbBucketCount = ((127 << 23) - kSrgbBucketBase) >> kSrgbBucketShift;
+
+        struct SrgbTables
+        {
+            SrgbTables()
+            {
+                for(uint32_t i = 0; i < 256; i++)
+                {
+                    toLinear[i] = float(srgbToLinear(double(i) / 255.0));
+                }
+
+                // thresholds[k] is the smallest linear value which rounds to the sRGB value k + 1
+                for(uint32_t i = 0; i < 255; i++)
+                {
+                    thresholds[i] = float(srgbToLinear((double(i) + 0.5) / 255.0));
+                }
+
+                // bucketStart[b] is the sRGB value of the smallest float in bucket b
+                for(uint32_t b = 0; b < kSrgbBucketCount; b++)
+                {
+                    uint32_t bits = kSrgbBucketBase + (b << kSrgbBucketShift);
+                    float linear;
+                    memcpy(&linear, &bits, sizeof(linear));
+                    bucketStart[b] = uint8_t(std::upper_bound(thresholds, thresholds + 255, linear) - thresholds);
+                }
+            }
+
+            float toLinear[256];
+            float thresholds[255];
+            uint8_t bucketStart[kSrgbBucketCount];
+        };
+
+        const SrgbTables gSrgbTables;
+        const bool gHasSsse3 = checkSsse3Support();
+
+        // Clamps to [0, 1]. NaNs become 0, which matches _mm_max_ps(x, 0) followed by _mm_min_ps(x, 1)
+        float saturate(float c)
+        {
+            c = (c > 0.0f) ? c : 0.0f;
+            return (c < 1.0f) ? c : 1.0f;
+        }
+
+        uint8_t unormFromFloat(float c)
+        {
+            return uint8_t(saturate(c) * 255.0f + 0.5f);
+        }
+    }
+
+    void expandRgb8ToRgba8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, uint8_t alpha)
+    {
+        // The pixels are converted back to front, so that an in-place conversion doesn't overwrite source pixels before they are read.
+        // A vector iteration reads 16 bytes, so the last few pixels are converted with scalar code
+        size_t vectorCount = 0;
+        if(gHasSsse3 && pixelCount >= 6)
+        {
+            vectorCount = ((pixelCount * 3 - 16) / 12 + 1) * 4;
+        }
+
+        for(size_t i = pixelCount; i > vectorCount; i--)
+        {
+            const uint8_t* pSrcPixel = pSrc + (i - 1) * 3;
+            uint8_t r = pSrcPixel[0];
+            uint8_t g = pSrcPixel[1];
+            uint8_t b = pSrcPixel[2];
+            uint8_t* pDstPixel = pDst + (i - 1) * 4;
+            pDstPixel[0] = r;
+            pDstPixel[1] = g;
+            pDstPixel[2] = b;
+            pDstPixel[3] = alpha;
+        }
+
+        if(vectorCount)
+        {
+            const __m128i shuffle = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+            const __m128i alphaMask = _mm_set1_epi32(int32_t(uint32_t(alpha) << 24));
+            for(size_t i = vectorCount; i > 0; i -= 4)
+            {
+                __m128i rgb = _mm_loadu_si128((const __m128i*)(pSrc + (i - 4) * 3));
+                __m128i rgba = _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alphaMask);
+                _mm_storeu_si128((__m128i*)(pDst + (i - 4) * 4), rgba);
+            }
+        }
+    }
+
+    void swapRedBlue8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount)
+    {
+        const __m128i agMask = _mm_set1_epi32(0xFF00FF00);
+        const __m128i rbMask = _mm_set1_epi32(0x00FF00FF);
+        size_t i = 0;
+        for(; i + 4 <= pixelCount; i += 4)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(pSrc + i * 4));
+            __m128i ag = _mm_and_si128(pixels, agMask);
+            __m128i rb = _mm_and_si128(pixels, rbMask);
+            __m128i br = _mm_or_si128(_mm_slli_epi32(rb, 16), _mm_srli_epi32(rb, 16));
+            _mm_storeu_si128((__m128i*)(pDst + i * 4), _mm_or_si128(ag, br));
+        }
+
+        for(; i < pixelCount; i++)
+        {
+            uint8_t r = pSrc[i * 4 + 0];
+            uint8_t g = pSrc[i * 4 + 1];
+            uint8_t b = pSrc[i * 4 + 2];
+            uint8_t a = pSrc[i * 4 + 3];
+            pDst[i * 4 + 0] = b;
+            pDst[i * 4 + 1] = g;
+            pDst[i * 4 + 2] = r;
+            pDst[i * 4 + 3] = a;
+        }
+    }
+
+    void fillAlpha8(uint8_t* pData, size_t pixelCount, uint8_t alpha)
+    {
+        const __m128i colorMask = _mm_set1_epi32(0x00FFFFFF);
+        const __m128i alphaMask = _mm_set1_epi32(int32_t(uint32_t(alpha) << 24));
+        size_t i = 0;
+        for(; i + 4 <= pixelCount; i += 4)
+        {
+            __m128i pixels = _mm_loadu_si128((const __m128i*)(pData + i * 4));
+            _mm_storeu_si128((__m128i*)(pData + i * 4), _mm_or_si128(_mm_and_si128(pixels, colorMask), alphaMask));
+        }
+
+        for(; i < pixelCount; i++)
+        {
+            pData[i * 4 + 3] = alpha;
+        }
+    }
+
+    const float* getSrgbToLinearTable()
+    {
+        return gSrgbTables.toLinear;
+    }
+
+    uint8_t linearToSrgb8(float linear)
+    {
+        // Returns the number of thresholds which are less than or equal to the value. A binary search over all the thresholds mispredicts most of its branches
+        linear = saturate(linear);
+        uint32_t bits;
+        memcpy(&bits, &linear, sizeof(bits));
+        if(bits < kSrgbBucketBase)
+        {
+            return 0;
+        }
+        if(bits >= (127 << 23))
+        {
+            return 255;
+        }
+
+        const float* pThresholds = gSrgbTables.thresholds;
+        uint32_t value = gSrgbTables.bucketStart[(bits - kSrgbBucketBase) >> kSrgbBucketShift];
+        while((value < 255) && (linear >= pThresholds[value]))
+        {
+            value++;
+        }
+        return uint8_t(value);
+    }
+
+    void convertRgba8ToFloat(const uint8_t* pSrc, float* pDst, size_t pixelCount, bool isSrgb)
+    {
+        const float kScale = 1.0f / 255.0f;
+        if(isSrgb)
+        {
+            const float* pTable = gSrgbTables.toLinear;
+            for(size_t i = 0; i < pixelCount; i++)
+            {
+                pDst[i * 4 + 0] = pTable[pSrc[i * 4 + 0]];
+                pDst[i * 4 + 1] = pTable[pSrc[i * 4 + 1]];
+                pDst[i * 4 + 2] = pTable[pSrc[i * 4 + 2]];
+                pDst[i * 4 + 3] = float(pSrc[i * 4 + 3]) * kScale;
+            }
+            return;
+        }
+
+        const __m128i zero = _mm_setzero_si128();
+        const __m128 scale = _mm_set1_ps(kScale);
+        size_t i = 0;
+        for(; i + 4 <= pixelCount; i += 4)
+        {
+            __m128i bytes = _mm_loadu_si128((const __m128i*)(pSrc + i * 4));
+            __m128i lo = _mm_unpacklo_epi8(bytes, zero);
+            __m128i hi = _mm_unpackhi_epi8(bytes, zero);
+            float* pDstPixels = pDst + i * 4;
+            _mm_storeu_ps(pDstPixels + 0, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(lo, zero)), scale));
+            _mm_storeu_ps(pDstPixels + 4, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(lo, zero)), scale));
+            _mm_storeu_ps(pDstPixels + 8, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpacklo_epi16(hi, zero)), scale));
+            _mm_storeu_ps(pDstPixels + 12, _mm_mul_ps(_mm_cvtepi32_ps(_mm_unpackhi_epi16(hi, zero)), scale));
+        }
+
+        for(i *= 4; i < pixelCount * 4; i++)
+        {
+            pDst[i] = float(pSrc[i]) * kScale;
+        }
+    }
+
+    void convertFloatToRgba8(const float* pSrc, uint8_t* pDst, size_t pixelCount, bool isSrgb)
+    {
+        if(isSrgb)
+        {
+            for(size_t i = 0; i < pixelCount; i++)
+            {
+                pDst[i * 4 + 0] = linearToSrgb8(pSrc[i * 4 + 0]);
+                pDst[i * 4 + 1] = linearToSrgb8(pSrc[i * 4 + 1]);
+                pDst[i * 4 + 2] = linearToSrgb8(pSrc[i * 4 + 2]);
+                pDst[i * 4 + 3] = unormFromFloat(pSrc[i * 4 + 3]);
+            }
+            return;
+        }
+
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 scale = _mm_set1_ps(255.0f);
+        const __m128 half = _mm_set1_ps(0.5f);
+        size_t i = 0;
+        for(; i + 4 <= pixelCount; i += 4)
+        {
+            __m128i values[4];
+            for(uint32_t j = 0; j < 4; j++)
+            {
+                __m128 v = _mm_loadu_ps(pSrc + i * 4 + j * 4);
+                v = _mm_min_ps(_mm_max_ps(v, zero), one);
+                values[j] = _mm_cvttps_epi32(_mm_add_ps(_mm_mul_ps(v, scale), half));
+            }
+            __m128i lo = _mm_packs_epi32(values[0], values[1]);
+            __m128i hi = _mm_packs_epi32(values[2], values[3]);
+            _mm_storeu_si128((__m128i*)(pDst + i * 4), _mm_packus_epi16(lo, hi));
+        }
+
+        for(i *= 4; i < pixelCount * 4; i++)
+        {
+            pDst[i] = unormFromFloat(pSrc[i]);
+        }
+    }
+
+    // The half-precision conversions are based on the branchless algorithms by Fabian Giesen
+    uint16_t floatToHalf(float value)
+    {
+        uint32_t f;
+        memcpy(&f, &value, sizeof(f));
+        uint32_t sign = f & 0x80000000;
+        f ^= sign;
+
+        uint32_t h;
+        if(f >= ((127 + 16) << 23))
+        {
+            // Infinity or NaN. NaNs are made quiet
+            h = (f > (255 << 23)) ? 0x7E00 : 0x7C00;
+        }
+        else if(f < (113 << 23))
+        {
+            // The result is a denormal or zero. Adding the magic value shifts the mantissa into place and rounds it
+            const uint32_t kDenormMagic = ((127 - 15) + (23 - 10) + 1) << 23;
+            float magic;
+            memcpy(&magic, &kDenormMagic, sizeof(magic));
+            float denorm;
+            memcpy(&denorm, &f, sizeof(denorm));
+            denorm += magic;
+            memcpy(&h, &denorm, sizeof(h));
+            h -= kDenormMagic;
+        }
+        else
+        {
+            // Rebias the exponent and round the mantissa to nearest even
+            uint32_t mantissaOdd = (f >> 13) & 1;
+            f -= (127 - 15) << 23;
+            f += 0xFFF + mantissaOdd;
+            h = f >> 13;
+        }
+        return uint16_t(h | (sign >> 16));
+    }
+
+    float halfToFloat(uint16_t value)
+    {
+        const uint32_t kMagic = (254 - 15) << 23;
+        const uint32_t kWasInfNan = (127 + 16) << 23;
+        float magic;
+        memcpy(&magic, &kMagic, sizeof(magic));
+
+        uint32_t f = uint32_t(value & 0x7FFF) << 13;
+        float result;
+        memcpy(&result, &f, sizeof(result));
+        result *= magic;
+        memcpy(&f, &result, sizeof(f));
+        if(f >= kWasInfNan)
+        {
+            f |= 255 << 23;
+        }
+        f |= uint32_t(value & 0x8000) << 16;
+        memcpy(&result, &f, sizeof(result));
+        return result;
+    }
+
+    static __m128i floatToHalf4(__m128 value)
+    {
+        const __m128i f16Max = _mm_set1_epi32((127 + 16) << 23);
+        const __m128i minNormal = _mm_set1_epi32(113 << 23);
+        const __m128i denormMagic = _mm_set1_epi32(((127 - 15) + (23 - 10) + 1) << 23);
+        const __m128i normalBias = _mm_set1_epi32(0xFFF - ((127 - 15) << 23));
+        const __m128i infinity = _mm_set1_epi32(0x7C00);
+        const __m128i nanBit = _mm_set1_epi32(0x200);
+
+        __m128 sign = _mm_and_ps(value, _mm_castsi128_ps(_mm_set1_epi32(0x80000000)));
+        __m128 absValue = _mm_xor_ps(value, sign);
+        __m128i absBits = _mm_castps_si128(absValue);
+
+        // Infinity and NaN
+        __m128i isNan = _mm_castps_si128(_mm_cmpunord_ps(absValue, absValue));
+        __m128i isRegular = _mm_cmpgt_epi32(f16Max, absBits);
+        __m128i special = _mm_or_si128(infinity, _mm_and_si128(isNan, nanBit));
+
+        // Denormals
+        __m128i isDenorm = _mm_cmpgt_epi32(minNormal, absBits);
+        __m128i denorm = _mm_sub_epi32(_mm_castps_si128(_mm_add_ps(absValue, _mm_castsi128_ps(denormMagic))), denormMagic);
+
+        // Normals
+        __m128i mantissaOdd = _mm_srai_epi32(_mm_slli_epi32(absBits, 31 - 13), 31);
+        __m128i normal = _mm_srli_epi32(_mm_sub_epi32(_mm_add_epi32(absBits, normalBias), mantissaOdd), 13);
+
+        __m128i result = _mm_or_si128(_mm_and_si128(isDenorm, denorm), _mm_andnot_si128(isDenorm, normal));
+        result = _mm_or_si128(_mm_and_si128(isRegular, result), _mm_andnot_si128(isRegular, special));
+        result = _mm_or_si128(result, _mm_srli_epi32(_mm_castps_si128(sign), 16));
+
+        // Sign-extend the low 16 bits, so that packing to 16 bits doesn't saturate
+        return _mm_srai_epi32(_mm_slli_epi32(result, 16), 16);
+    }
+
+    static __m128 halfToFloat4(__m128i value)
+    {
+        const __m128i exponentMantissaMask = _mm_set1_epi32(0x7FFF);
+        const __m128 magic = _mm_castsi128_ps(_mm_set1_epi32((254 - 15) << 23));
+        const __m128i maxFinite = _mm_set1_epi32(0x7BFF);
+        const __m128 infNanExponent = _mm_castsi128_ps(_mm_set1_epi32(255 << 23));
+
+        __m128i exponentMantissa = _mm_and_si128(value, exponentMantissaMask);
+        __m128i sign = _mm_slli_epi32(_mm_xor_si128(value, exponentMantissa), 16);
+        __m128 scaled = _mm_mul_ps(_mm_castsi128_ps(_mm_slli_epi32(exponentMantissa, 13)), magic);
+        __m128 wasInfNan = _mm_castsi128_ps(_mm_cmpgt_epi32(exponentMantissa, maxFinite));
+        __m128 specialBits = _mm_or_ps(_mm_castsi128_ps(sign), _mm_and_ps(wasInfNan, infNanExponent));
+        return _mm_or_ps(scaled, specialBits);
+    }
+
+    void convertFloatToHalf(const float* pSrc, uint16_t* pDst, size_t count)
+    {
+        size_t i = 0;
+        for(; i + 8 <= count; i += 8)
+        {
+            __m128i lo = floatToHalf4(_mm_loadu_ps(pSrc + i));
+            __m128i hi = floatToHalf4(_mm_loadu_ps(pSrc + i + 4));
+            _mm_storeu_si128((__m128i*)(pDst + i), _mm_packs_epi32(lo, hi));
+        }
+
+        for(; i < count; i++)
+        {
+            pDst[i] = floatToHalf(pSrc[i]);
+        }
+    }
+
+    void convertHalfToFloat(const uint16_t* pSrc, float* pDst, size_t count)
+    {
+        const __m128i zero = _mm_setzero_si128();
+        size_t i = 0;
+        for(; i + 8 <= count; i += 8)
+        {
+            __m128i halves = _mm_loadu_si128((const __m128i*)(pSrc + i));
+            _mm_storeu_ps(pDst + i, halfToFloat4(_mm_unpacklo_epi16(halves, zero)));
+            _mm_storeu_ps(pDst + i + 4, halfToFloat4(_mm_unpackhi_epi16(halves, zero)));
+        }
+
+        for(; i < count; i++)
+        {
+            pDst[i] = halfToFloat(pSrc[i]);
+        }
+    }
+
+    void flipRows(void* pData, size_t rowPitch, uint32_t rowCount)
+    {
+        // Swap the rows in chunks through a stack buffer
+        uint8_t temp[4096];
+        uint8_t* pBytes = (uint8_t*)pData;
+        for(uint32_t y = 0; y < rowCount / 2; y++)
+        {
+            uint8_t* pTop = pBytes + y * rowPitch;
+            uint8_t* pBottom = pBytes + (rowCount - 1 - y) * rowPitch;
+            for(size_t offset = 0; offset < rowPitch; offset += sizeof(temp))
+            {
+                size_t size = min(sizeof(temp), rowPitch - offset);
+                memcpy(temp, pTop + offset, size);
+                memcpy(pTop + offset, pBottom + offset, size);
+                memcpy(pBottom + offset, temp, size);
+            }
+        }
+    }
+
+    void copyRowsFlipped(const void* pSrc, void* pDst, size_t rowPitch, uint32_t rowCount)
+    {
+        const uint8_t* pSrcBytes = (const uint8_t*)pSrc;
+        uint8_t* pDstBytes = (uint8_t*)pDst;
+        for(uint32_t y = 0; y < rowCount; y++)
+        {
+            memcpy(pDstBytes + (rowCount - 1 - y) * rowPitch, pSrcBytes + y * rowPitch, rowPitch);
+        }
+    }
+}
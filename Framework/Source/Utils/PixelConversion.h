@@ -0,0 +1,121 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <stdint.h>
+#include <cstddef>
+
+namespace Falcor
+{
+    /*!
+    *  \addtogroup Falcor
+    *  @{
+    */
+
+    /*  Pixel-format conversion kernels shared by the image, texture and video code.
+        The kernels process 4 pixels (or 8 values) per iteration with SSE2, and use SSSE3 byte shuffles when the CPU supports them. Leftover pixels are converted with scalar code which produces identical results.
+        None of the functions allocate memory or use threads. Callers converting large images in parallel should split the work by rows.
+    */
+
+    /** Expand 3-channel 8-bit pixels to 4 channels, setting the 4th channel to a constant. The channel order is preserved, so this works for both RGB->RGBA and BGR->BGRA.
+        \param[in] pSrc The source pixels, 3 bytes per pixel
+        \param[out] pDst The destination pixels, 4 bytes per pixel. Can be the same as pSrc for an in-place conversion
+        \param[in] pixelCount Number of pixels to convert
+        \param[in] alpha Optional. The value of the 4th channel
+    */
+    void expandRgb8ToRgba8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, uint8_t alpha = 0xFF);
+
+    /** Swap the 1st and 3rd channels of 4-channel 8-bit pixels, converting RGBA to BGRA and vice versa.
+        \param[in] pSrc The source pixels
+        \param[out] pDst The destination pixels. Can be the same as pSrc
+        \param[in] pixelCount Number of pixels to convert
+    */
+    void swapRedBlue8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount);
+
+    /** Set the 4th channel of 4-channel 8-bit pixels to a constant
+        \param[in,out] pData The pixels
+        \param[in] pixelCount Number of pixels
+        \param[in] alpha The new value
+    */
+    void fillAlpha8(uint8_t* pData, size_t pixelCount, uint8_t alpha = 0xFF);
+
+    /** Get a 256-entry table which maps 8-bit sRGB values to linear values in [0, 1]
+    */
+    const float* getSrgbToLinearTable();
+
+    /** Convert a linear value to the nearest 8-bit sRGB value. The value is clamped to [0, 1]
+    */
+    uint8_t linearToSrgb8(float linear);
+
+    /** Convert RGBA8 pixels to RGBA32 floats in [0, 1]
+        \param[in] pSrc The source pixels, 4 bytes per pixel
+        \param[out] pDst The destination pixels, 4 floats per pixel
+        \param[in] pixelCount Number of pixels to convert
+        \param[in] isSrgb If true, the color channels are converted from sRGB to linear space. Alpha is always linear
+    */
+    void convertRgba8ToFloat(const uint8_t* pSrc, float* pDst, size_t pixelCount, bool isSrgb);
+
+    /** Convert RGBA32 floats to RGBA8 pixels. Values are clamped to [0, 1] and rounded to the nearest 8-bit value
+        \param[in] pSrc The source pixels, 4 floats per pixel
+        \param[out] pDst The destination pixels, 4 bytes per pixel
+        \param[in] pixelCount Number of pixels to convert
+        \param[in] isSrgb If true, the color channels are converted from linear to sRGB space. Alpha is always linear
+    */
+    void convertFloatToRgba8(const float* pSrc, uint8_t* pDst, size_t pixelCount, bool isSrgb);
+
+    /** Convert a float to a half-precision float, rounding to nearest even. Values too large for a half become infinity, NaNs stay NaNs
+    */
+    uint16_t floatToHalf(float value);
+
+    /** Convert a half-precision float to a float. The conversion is exact
+    */
+    float halfToFloat(uint16_t value);
+
+    /** Convert an array of floats to half-precision floats. Produces the same results as floatToHalf()
+    */
+    void convertFloatToHalf(const float* pSrc, uint16_t* pDst, size_t count);
+
+    /** Convert an array of half-precision floats to floats. Produces the same results as halfToFloat()
+    */
+    void convertHalfToFloat(const uint16_t* pSrc, float* pDst, size_t count);
+
+    /** Flip an image vertically in place
+        \param[in,out] pData The image
+        \param[in] rowPitch The size of a row in bytes
+        \param[in] rowCount Number of rows
+    */
+    void flipRows(void* pData, size_t rowPitch, uint32_t rowCount);
+
+    /** Copy an image, flipping it vertically
+        \param[in] pSrc The source image
+        \param[out] pDst The destination image. Must not overlap the source
+        \param[in] rowPitch The size of a row in bytes
+        \param[in] rowCount Number of rows
+    */
+    void copyRowsFlipped(const void* pSrc, void* pDst, size_t rowPitch, uint32_t rowCount);
+    /*! @} */
+}
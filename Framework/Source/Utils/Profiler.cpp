@@ -32,28 +32,169 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <memory>
+#include <algorithm>
+
+#ifdef _MSC_VER
+#define PROFILER_THREAD_LOCAL __declspec(thread)
+#else
+#define PROFILER_THREAD_LOCAL __thread
+#endif
 
 namespace Falcor
 {
     bool gProfileEnabled = false;
 
     std::map<size_t, Profiler::EventData*> Profiler::sProfilerEvents;
-    uint32_t Profiler::sCurrentLevel = 0;
     uint32_t Profiler::sGpuTimerIndex = 0;
     std::vector<Profiler::EventData*> Profiler::sProfilerVector;
     
     std::hash<std::string> HashedString::hashFunc;
 
+    namespace
+    {
+        const uint32_t kRingSize = 4096;        // Records per thread, must be a power of 2
+        const uint32_t kMaxDepth = 64;
+
+        struct EventRecord
+        {
+            Profiler::EventData* pEvent;
+            CpuTimer::TimePoint start;
+            CpuTimer::TimePoint end;
+            uint32_t depth;
+        };
+
+        /** Per-thread event storage. The owning thread is the only producer, endFrame() is the only consumer
+        */
+        struct ThreadBuffer
+        {
+            uint32_t threadIndex = 0;
+            bool isGpuThread = false;
+
+            // Only accessed by the owning thread
+            struct OpenEvent
+            {
+                Profiler::EventData* pEvent;
+                CpuTimer::TimePoint start;
+                bool gpuStarted;
+            };
+            OpenEvent openEvents[kMaxDepth];
+            uint32_t depth = 0;
+
+            EventRecord records[kRingSize];
+            std::atomic<uint32_t> writeIndex;
+            std::atomic<uint32_t> readIndex;
+            std::atomic<uint32_t> droppedRecords;
+
+            ThreadBuffer() : writeIndex(0), readIndex(0), droppedRecords(0) {}
+        };
+
+        struct TraceEvent
+        {
+            Profiler::EventData* pEvent;
+            uint32_t threadIndex;
+            CpuTimer::TimePoint start;
+            CpuTimer::TimePoint end;
+        };
+
+        struct TraceCounter
+        {
+            Profiler::EventData* pEvent;
+            CpuTimer::TimePoint time;
+            float gpuMs;
+        };
+
+        // Dynamic initialization runs on the main thread, which owns the graphics context
+        const std::thread::id gGpuThreadId = std::this_thread::get_id();
+        bool gGpuTimingEnabled = true;
+        uint32_t gHistorySize = 300;
+
+        std::recursive_mutex gRegistryMutex;    // Protects the event registry and the thread buffer list. Recursive, since getEvent() calls initNewEvent()
+        std::vector<std::unique_ptr<ThreadBuffer>> gThreadBuffers;
+        PROFILER_THREAD_LOCAL ThreadBuffer* tpThreadBuffer = nullptr;
+
+        // Trace capture. Only touched by the thread calling endFrame()
+        bool gTraceCapturing = false;
+        uint32_t gTraceMaxEvents = 0;
+        CpuTimer::TimePoint gTraceStart;
+        std::vector<TraceEvent> gTraceEvents;
+        std::vector<TraceCounter> gTraceCounters;
+
+        ThreadBuffer* getThreadBuffer()
+        {
+            if(tpThreadBuffer == nullptr)
+            {
+                std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+                gThreadBuffers.push_back(std::make_unique<ThreadBuffer>());
+                tpThreadBuffer = gThreadBuffers.back().get();
+                tpThreadBuffer->threadIndex = (uint32_t)gThreadBuffers.size() - 1;
+                tpThreadBuffer->isGpuThread = (std::this_thread::get_id() == gGpuThreadId);
+            }
+            return tpThreadBuffer;
+        }
+
+        void initHistory(Profiler::EventData* pEvent)
+        {
+            pEvent->cpuHistory.assign(gHistorySize, 0.0f);
+            pEvent->gpuHistory.assign(gHistorySize, 0.0f);
+            pEvent->historyCount = 0;
+            pEvent->historyIndex = 0;
+        }
+
+        Profiler::TimingStats calcTimingStats(const std::vector<float>& history, uint32_t count)
+        {
+            Profiler::TimingStats stats;
+            if(count == 0)
+            {
+                return stats;
+            }
+
+            std::vector<float> sorted(history.begin(), history.begin() + count);
+            std::sort(sorted.begin(), sorted.end());
+            double sum = 0;
+            for(float f : sorted)
+            {
+                sum += f;
+            }
+
+            // Nearest-rank percentiles
+            auto percentile = [&sorted](float p)
+            {
+                size_t rank = (size_t)ceil(p * sorted.size());
+                return sorted[min(max(rank, size_t(1)), sorted.size()) - 1];
+            };
+
+            stats.minMs = sorted.front();
+            stats.maxMs = sorted.back();
+            stats.meanMs = float(sum / sorted.size());
+            stats.p95Ms = percentile(0.95f);
+            stats.p99Ms = percentile(0.99f);
+            return stats;
+        }
+
+        std::string escapeJson(const std::string& s)
+        {
+            std::string result;
+            for(char c : s)
+            {
+                if(c == '"' || c == '\\')
+                {
+                    result += '\\';
+                }
+                result += c;
+            }
+            return result;
+        }
+    }
+
 	void Profiler::initNewEvent(EventData *pEvent, const HashedString& name)
     {
+        std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
 	    pEvent->name = name.str;
-        pEvent->level = sCurrentLevel;
-        pEvent->pGpuTimer[0] = GpuTimer::create();
-        pEvent->pGpuTimer[1] = GpuTimer::create();
-
-        // Call begin/end for the next-frame GPU timer to fool it, otherwise it will report an error when calling GetData() (double-buffering issue).
-        pEvent->pGpuTimer[1 - sGpuTimerIndex]->begin();
-        pEvent->pGpuTimer[1 - sGpuTimerIndex]->end();
+        initHistory(pEvent);
 
 		sProfilerEvents[name.hash] = pEvent;
         sProfilerVector.push_back(pEvent);
@@ -68,7 +209,8 @@ namespace Falcor
 
     Profiler::EventData* Profiler::isEventRegistered(const HashedString& name)
 	{
-        auto& event = sProfilerEvents.find(name.hash);
+        std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+        auto event = sProfilerEvents.find(name.hash);
         if(event == sProfilerEvents.end())
 		{
 			return nullptr;
@@ -81,10 +223,11 @@ namespace Falcor
 
     Profiler::EventData* Profiler::getEvent(const HashedString& name)
     {
-        auto event = isEventRegistered(name);
-        if(event)
+        std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+        auto event = sProfilerEvents.find(name.hash);
+        if(event != sProfilerEvents.end())
 		{
-			return event;
+			return event->second;
 		}
 		else
         {
@@ -92,32 +235,130 @@ namespace Falcor
         }
     }
 
-    void Profiler::startEvent(const HashedString& name, EventData* pData)
+    void Profiler::startEvent(EventData* pData)
     {
-        pData->cpuStart = CpuTimer::getCurrentTimePoint();
-        pData->pGpuTimer[sGpuTimerIndex]->begin();
+        ThreadBuffer* pBuffer = getThreadBuffer();
+        if(pBuffer->depth >= kMaxDepth)
+        {
+            pBuffer->depth++;   // Keep the nesting balanced, the event isn't recorded
+            return;
+        }
 
-        sCurrentLevel++;
+        ThreadBuffer::OpenEvent& open = pBuffer->openEvents[pBuffer->depth++];
+        open.pEvent = pData;
+        open.gpuStarted = false;
+        if(pBuffer->isGpuThread && gGpuTimingEnabled)
+        {
+            if(pData->pGpuTimer[0] == nullptr)
+            {
+                pData->pGpuTimer[0] = GpuTimer::create();
+                pData->pGpuTimer[1] = GpuTimer::create();
+
+                // Call begin/end for the next-frame GPU timer to fool it, otherwise it will report an error when calling GetData() (double-buffering issue).
+                pData->pGpuTimer[1 - sGpuTimerIndex]->begin();
+                pData->pGpuTimer[1 - sGpuTimerIndex]->end();
+            }
+            pData->pGpuTimer[sGpuTimerIndex]->begin();
+            open.gpuStarted = true;
+        }
+        open.start = CpuTimer::getCurrentTimePoint();
     }
 
-	void Profiler::endEvent(const HashedString& name, EventData* pData)
+	void Profiler::endEvent(EventData* pData)
     {
-        pData->cpuEnd = CpuTimer::getCurrentTimePoint();
-        pData->cpuTotal += CpuTimer::calcDuration(pData->cpuStart, pData->cpuEnd);
+        CpuTimer::TimePoint end = CpuTimer::getCurrentTimePoint();
+        ThreadBuffer* pBuffer = getThreadBuffer();
+        assert(pBuffer->depth > 0);
+        pBuffer->depth--;
+        if(pBuffer->depth >= kMaxDepth)
+        {
+            return;
+        }
+
+        const ThreadBuffer::OpenEvent& open = pBuffer->openEvents[pBuffer->depth];
+        assert(open.pEvent == pData);
+        if(open.gpuStarted)
+        {
+            pData->pGpuTimer[sGpuTimerIndex]->end();
+        }
 
-        pData->pGpuTimer[sGpuTimerIndex]->end();
+        // Single-producer/single-consumer ring. Drop the record if endFrame() didn't drain the ring in time
+        uint32_t writeIndex = pBuffer->writeIndex.load(std::memory_order_relaxed);
+        if(writeIndex - pBuffer->readIndex.load(std::memory_order_acquire) >= kRingSize)
+        {
+            pBuffer->droppedRecords.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
 
-        sCurrentLevel--;
+        EventRecord& record = pBuffer->records[writeIndex & (kRingSize - 1)];
+        record.pEvent = pData;
+        record.start = open.start;
+        record.end = end;
+        record.depth = pBuffer->depth;
+        pBuffer->writeIndex.store(writeIndex + 1, std::memory_order_release);
     }
 
     void Profiler::endFrame(std::string& profileResults)
     {
+        std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+
+        // Drain the per-thread rings
+        uint32_t droppedRecords = 0;
+        for(auto& pBuffer : gThreadBuffers)
+        {
+            droppedRecords += pBuffer->droppedRecords.exchange(0, std::memory_order_relaxed);
+            uint32_t readIndex = pBuffer->readIndex.load(std::memory_order_relaxed);
+            uint32_t writeIndex = pBuffer->writeIndex.load(std::memory_order_acquire);
+            for(; readIndex != writeIndex; readIndex++)
+            {
+                const EventRecord& record = pBuffer->records[readIndex & (kRingSize - 1)];
+                EventData* pData = record.pEvent;
+                pData->cpuTotal += CpuTimer::calcDuration(record.start, record.end);
+                pData->isActive = true;
+                if(pData->isLevelKnown == false)
+                {
+                    pData->level = record.depth;
+                    pData->isLevelKnown = true;
+                }
+
+                if(gTraceCapturing && gTraceEvents.size() < gTraceMaxEvents)
+                {
+                    TraceEvent traceEvent = {pData, pBuffer->threadIndex, record.start, record.end};
+                    gTraceEvents.push_back(traceEvent);
+                }
+            }
+            pBuffer->readIndex.store(writeIndex, std::memory_order_release);
+        }
+
+        CpuTimer::TimePoint frameEnd = CpuTimer::getCurrentTimePoint();
         profileResults = "Name\t\t\tCPU time(ms)\t\t\tGPU time(ms)\n";
 
 		for (EventData* pData : sProfilerVector)
 		{
+            if(pData->isActive == false)
+            {
+                continue;
+            }
+
 			float gpuTime = pData->gpuTotal;
-			pData->pGpuTimer[1 - sGpuTimerIndex]->getElapsedTime(true, gpuTime);
+            if(pData->pGpuTimer[0])
+            {
+			    pData->pGpuTimer[1 - sGpuTimerIndex]->getElapsedTime(true, gpuTime);
+            }
+            pData->hasGpuTime = pData->hasGpuTime || pData->pGpuTimer[0] || (pData->gpuTotal > 0);
+
+            // Update the history
+            uint32_t historySize = (uint32_t)pData->cpuHistory.size();
+            pData->cpuHistory[pData->historyIndex] = pData->cpuTotal;
+            pData->gpuHistory[pData->historyIndex] = gpuTime;
+            pData->historyIndex = (pData->historyIndex + 1) % historySize;
+            pData->historyCount = min(pData->historyCount + 1, historySize);
+
+            if(gTraceCapturing && pData->hasGpuTime)
+            {
+                TraceCounter counter = {pData, frameEnd, gpuTime};
+                gTraceCounters.push_back(counter);
+            }
 
 			char event[1000];
 			uint32_t nameIndent = pData->level * 2 + 1;
@@ -146,6 +387,11 @@ namespace Falcor
             profileResults += event;
         }
 
+        if(droppedRecords)
+        {
+            profileResults += std::to_string(droppedRecords) + " events were dropped, since a thread's event buffer was full\n";
+        }
+
         sGpuTimerIndex = 1 - sGpuTimerIndex;
     }
 
@@ -169,13 +415,173 @@ namespace Falcor
 
     void Profiler::clearEvents()
     {
+        std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+
+        // Discard the records which weren't drained yet
+        for(auto& pBuffer : gThreadBuffers)
+        {
+            pBuffer->readIndex.store(pBuffer->writeIndex.load(std::memory_order_acquire), std::memory_order_release);
+        }
+
         for (EventData* pData : sProfilerVector)
         {
-            delete pData;
+            pData->cpuTotal = 0;
+            pData->gpuTotal = 0;
+            pData->isActive = false;
+            pData->isLevelKnown = false;
+            pData->hasGpuTime = false;
+            initHistory(pData);
+        }
+        gTraceEvents.clear();
+        gTraceCounters.clear();
+    }
+
+    void Profiler::setGpuTimingEnabled(bool enabled)
+    {
+        gGpuTimingEnabled = enabled;
+    }
+
+    bool Profiler::isGpuTimingEnabled()
+    {
+        return gGpuTimingEnabled;
+    }
+
+    void Profiler::setHistorySize(uint32_t frameCount)
+    {
+        std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+        gHistorySize = max(frameCount, 1u);
+        for(EventData* pData : sProfilerVector)
+        {
+            initHistory(pData);
+        }
+    }
+
+    uint32_t Profiler::getHistorySize()
+    {
+        return gHistorySize;
+    }
+
+    std::vector<Profiler::EventStats> Profiler::getEventStats()
+    {
+        std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+        std::vector<EventStats> result;
+        for(const EventData* pData : sProfilerVector)
+        {
+            if(pData->isActive == false)
+            {
+                continue;
+            }
+
+            EventStats stats;
+            stats.name = pData->name;
+            stats.level = pData->level;
+            stats.frameCount = pData->historyCount;
+            stats.cpu = calcTimingStats(pData->cpuHistory, pData->historyCount);
+            stats.hasGpuTime = pData->hasGpuTime;
+            if(pData->hasGpuTime)
+            {
+                stats.gpu = calcTimingStats(pData->gpuHistory, pData->historyCount);
+            }
+            result.push_back(stats);
+        }
+        return result;
+    }
+
+    Profiler::TimingStats Profiler::computeTimingStats(const std::vector<float>& timesMs)
+    {
+        return calcTimingStats(timesMs, (uint32_t)timesMs.size());
+    }
+
+    bool Profiler::getEventHistory(const std::string& name, std::vector<float>& cpuMs, std::vector<float>& gpuMs)
+    {
+        std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+        const EventData* pData = isEventRegistered(HashedString(name));
+        if(pData == nullptr)
+        {
+            return false;
+        }
+
+        // Once the ring is full, historyIndex points at the oldest frame
+        uint32_t historySize = (uint32_t)pData->cpuHistory.size();
+        uint32_t first = (pData->historyCount == historySize) ? pData->historyIndex : 0;
+        cpuMs.resize(pData->historyCount);
+        gpuMs.resize(pData->historyCount);
+        for(uint32_t i = 0; i < pData->historyCount; i++)
+        {
+            uint32_t index = (first + i) % historySize;
+            cpuMs[i] = pData->cpuHistory[index];
+            gpuMs[i] = pData->gpuHistory[index];
+        }
+        return true;
+    }
+
+    void Profiler::startTraceCapture(uint32_t maxEvents)
+    {
+        gTraceEvents.clear();
+        gTraceCounters.clear();
+        gTraceMaxEvents = maxEvents;
+        gTraceStart = CpuTimer::getCurrentTimePoint();
+        gTraceCapturing = true;
+    }
+
+    void Profiler::endTraceCapture()
+    {
+        gTraceCapturing = false;
+    }
+
+    bool Profiler::exportChromeTrace(const std::string& filename)
+    {
+        std::ofstream out(filename);
+        if(out.fail())
+        {
+            Logger::log(Logger::Level::Error, "Profiler::exportChromeTrace() - can't open " + filename);
+            return false;
+        }
+
+        auto toUs = [](CpuTimer::TimePoint t)
+        {
+            return std::chrono::duration<double, std::micro>(t - gTraceStart).count();
+        };
+
+        out << "{\"traceEvents\":[\n";
+        out.precision(3);
+        out << std::fixed;
+        bool first = true;
+        auto separator = [&first, &out]()
+        {
+            if(first == false)
+            {
+                out << ",\n";
+            }
+            first = false;
+        };
+
+        // Thread names
+        {
+            std::lock_guard<std::recursive_mutex> lock(gRegistryMutex);
+            for(const auto& pBuffer : gThreadBuffers)
+            {
+                std::string name = pBuffer->isGpuThread ? "Main thread" : "Thread " + std::to_string(pBuffer->threadIndex);
+                separator();
+                out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":0,\"tid\":" << pBuffer->threadIndex << ",\"args\":{\"name\":\"" << name << "\"}}";
+            }
         }
-        sProfilerEvents.clear();
-        sProfilerVector.clear();
-        sCurrentLevel = 0;
-        sGpuTimerIndex = 0;
+
+        for(const TraceEvent& event : gTraceEvents)
+        {
+            separator();
+            out << "{\"name\":\"" << escapeJson(event.pEvent->name) << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":0,\"tid\":" << event.threadIndex;
+            out << ",\"ts\":" << toUs(event.start) << ",\"dur\":" << std::chrono::duration<double, std::micro>(event.end - event.start).count() << "}";
+        }
+
+        for(const TraceCounter& counter : gTraceCounters)
+        {
+            separator();
+            out << "{\"name\":\"GPU " << escapeJson(counter.pEvent->name) << " (ms)\",\"cat\":\"gpu\",\"ph\":\"C\",\"pid\":0,\"ts\":" << toUs(counter.time);
+            out << ",\"args\":{\"ms\":" << counter.gpuMs << "}}";
+        }
+
+        out << "\n]}\n";
+        return out.good();
     }
 }
\ No newline at end of file
@@ -53,8 +53,10 @@ namespace Falcor
 
     /** Container class for CPU/GPU profiling.
         This class uses the most accurately available CPU and GPU timers to profile given events. It automatically creates event hierarchies based on the order of the calls made.
-        This class uses a double-buffering scheme for GPU profiling to avoid GPU stalls.
-        CProfilerEvent is a wrapper class which together with scoping can simplify event profiling.
+        Events can be recorded from any thread. Each thread writes its CPU timings into its own lock-free ring buffer, which endFrame() drains.
+        GPU timing is only done for events recorded on the thread which owns the graphics context (the thread which initialized the profiler's globals, usually the main thread). It uses a double-buffering scheme to avoid GPU stalls, and can be disabled for headless use.
+        Every event keeps a history of the last N frames, which is used to compute min/mean/percentile statistics.
+        ProfilerEvent is a wrapper class which together with scoping can simplify event profiling.
     */
     class Profiler
     {
@@ -68,12 +70,17 @@ namespace Falcor
         {
 			virtual ~EventData() {}
             std::string name;
-            GpuTimer::SharedPtr pGpuTimer[2];    // Double-buffering, to avoid GPU flushes
-            CpuTimer::TimePoint cpuStart;
-            CpuTimer::TimePoint cpuEnd;
+            GpuTimer::SharedPtr pGpuTimer[2];    // Double-buffering, to avoid GPU flushes. Created when the event is first recorded on the GPU thread
             float cpuTotal = 0;
 			float gpuTotal = 0;
-            uint32_t level;
+            uint32_t level = 0;
+            bool isLevelKnown = false;
+            bool isActive = false;              // Recorded since the last clearEvents()
+            bool hasGpuTime = false;
+            std::vector<float> cpuHistory;      // Per-frame totals, ring buffer
+            std::vector<float> gpuHistory;
+            uint32_t historyCount = 0;
+            uint32_t historyIndex = 0;
 #if _PROFILING_LOG == 1
 			int stepNr = 0;
 			int filesWritten = 0;
@@ -82,6 +89,29 @@ namespace Falcor
 #endif
         };
 
+        /** Timing statistics over the frame history, in milliseconds
+        */
+        struct TimingStats
+        {
+            float minMs = 0;
+            float meanMs = 0;
+            float p95Ms = 0;
+            float p99Ms = 0;
+            float maxMs = 0;
+        };
+
+        /** Statistics of a single event
+        */
+        struct EventStats
+        {
+            std::string name;
+            uint32_t level = 0;
+            uint32_t frameCount = 0;    ///< Number of frames in the history
+            TimingStats cpu;
+            TimingStats gpu;
+            bool hasGpuTime = false;
+        };
+
         /** Start profiling a new event and update the events hierarchies.
             \param[in] Name The event name.
         */
@@ -92,7 +122,11 @@ namespace Falcor
 			\param[in] Event The event if previously looked up.
 			\note This version supports dropping the event-lookup if the event is already available.
         */
-		static void startEvent(const HashedString& name, EventData *pEvent);
+		static void startEvent(const HashedString& name, EventData *pEvent) { startEvent(pEvent); }
+
+        /** Start profiling an event which was previously looked up. This is the fast path used by PROFILE(). Lock-free, can be called from any thread.
+        */
+        static void startEvent(EventData* pEvent);
 
 		/** Finish profiling a new event and update the events hierarchies.
             \param[in] Name The event name.
@@ -103,10 +137,14 @@ namespace Falcor
 			\param[in] Event The event if previously looked up.
 			\note This version supports dropping the event-lookup if the event is already available.
 		*/
-        static void endEvent(const HashedString& name, EventData *pEvent);
+        static void endEvent(const HashedString& name, EventData *pEvent) { endEvent(pEvent); }
+
+        /** Finish profiling an event which was previously looked up. Must be called on the thread which started it.
+        */
+        static void endEvent(EventData* pEvent);
 
-        /** Finish profiling for the entire frame.
-            Due to the double-buffering nature of the profiler, the results returned are for the previous frame.
+        /** Finish profiling for the entire frame. Must be called from the GPU thread.
+            Due to the double-buffering nature of the profiler, the GPU results returned are for the previous frame.
             \param[out] ProfileResults A string containing the the profiling results.
         */
         static void endFrame(std::string& profileResults);
@@ -120,7 +158,7 @@ namespace Falcor
 		*/
         static void       initNewEvent(EventData *pEvent, const HashedString& name);
 
-		/** Get the event, or create a new one if the event does not yet exist.
+		/** Get the event, or create a new one if the event does not yet exist. Thread-safe.
 		    This is a public interface to facilitate more complicated construction of event names and finegrained control over the profiled region.
 		*/
         static EventData* getEvent(const HashedString& name);
@@ -130,15 +168,55 @@ namespace Falcor
 		*/
 		static EventData* isEventRegistered(const HashedString& name);
 
-        /** Clears all the events. 
-            Useful if you want to start profiling a different technique with different events.
+        /** Clears the history and statistics of all the events. Events stay registered, since PROFILE() call sites hold on to them.
+            Useful if you want to start profiling a different technique with different events. Must not be called while events are open.
         */
         static void clearEvents();
 
+        /** Enable or disable GPU timing. Disable it when running without a graphics device. Enabled by default.
+        */
+        static void setGpuTimingEnabled(bool enabled);
+        static bool isGpuTimingEnabled();
+
+        /** Set the number of frames kept in each event's history. Clears the existing history.
+        */
+        static void setHistorySize(uint32_t frameCount);
+        static uint32_t getHistorySize();
+
+        /** Get min/mean/p95/p99/max statistics over the frame history of every active event
+        */
+        static std::vector<EventStats> getEventStats();
+
+        /** Get the per-frame times in the history of an event, oldest frame first
+            \param[in] name The event name
+            \param[out] cpuMs The CPU time of each frame
+            \param[out] gpuMs The GPU time of each frame. Zeros if the event has no GPU time
+            \return false if the event isn't registered
+        */
+        static bool getEventHistory(const std::string& name, std::vector<float>& cpuMs, std::vector<float>& gpuMs);
+
+        /** Calculate min/mean/p95/p99/max statistics over a list of timings
+        */
+        static TimingStats computeTimingStats(const std::vector<float>& timesMs);
+
+        /** Start recording every event instance for export with exportChromeTrace(). Clears previously captured events.
+            \param[in] maxEvents Recording stops after this many events, to bound the memory usage
+        */
+        static void startTraceCapture(uint32_t maxEvents = 1000000);
+
+        /** Stop recording events for the trace
+        */
+        static void endTraceCapture();
+
+        /** Write the captured events as a Chrome trace_event JSON file, which can be loaded in chrome://tracing.
+            CPU events appear per thread. GPU times are written as per-frame counters, since the GPU timers only measure durations.
+            \return true if the file was written
+        */
+        static bool exportChromeTrace(const std::string& filename);
+
     private:
         static std::map<size_t, EventData*> sProfilerEvents;
         static std::vector<EventData*> sProfilerVector;
-        static uint32_t sCurrentLevel;
         static uint32_t sGpuTimerIndex;
     };
 
@@ -151,18 +229,25 @@ namespace Falcor
     public:
         /** C'tor
         */
-        ProfilerEvent(const HashedString& name) : mName(name) { if(gProfileEnabled) { Profiler::startEvent(name); } }
+        ProfilerEvent(const HashedString& name) : mpEvent(Profiler::getEvent(name)) { start(); }
+
+        /** C'tor. Use a previously looked-up event, avoiding the lookup
+        */
+        ProfilerEvent(Profiler::EventData* pEvent) : mpEvent(pEvent) { start(); }
+
         /** D'tor
         */
-        ~ProfilerEvent() { if(gProfileEnabled) {Profiler::endEvent(mName); }}
+        ~ProfilerEvent() { if(mStarted) { Profiler::endEvent(mpEvent); } }
 
     private:
-        const HashedString mName;
+        void start() { mStarted = gProfileEnabled; if(mStarted) { Profiler::startEvent(mpEvent); } }
+        Profiler::EventData* mpEvent;
+        bool mStarted = false;
     };
 
 #if _PROFILING_ENABLED
-#define PROFILE(_name) static const Falcor::HashedString hashed ## _name(#_name); Falcor::ProfilerEvent _profileEvent(hashed ## _name);
+#define PROFILE(_name) static Falcor::Profiler::EventData* const profileEvent ## _name = Falcor::Profiler::getEvent(Falcor::HashedString(#_name)); Falcor::ProfilerEvent _profileEvent(profileEvent ## _name);
 #else
 #define PROFILE(_name)
 #endif
-}
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ResidencyTracker.h"
+#include <algorithm>
+
+namespace Falcor
+{
+    bool ResidencyTracker::markUsed(const void* pResource, uint64_t size, uint32_t priority)
+    {
+        auto it = mEntries.find(pResource);
+        bool isNew = (it == mEntries.end());
+        if(isNew)
+        {
+            Entry entry;
+            entry.size = size;
+            entry.residentOrder = mNextResidentOrder++;
+            it = mEntries.insert(std::make_pair(pResource, entry)).first;
+            mResidentBytes += size;
+        }
+
+        Entry& entry = it->second;
+        if(entry.lastUsedFrame != mFrameId)
+        {
+            entry.lastUsedFrame = mFrameId;
+            mUsedBytes += entry.size;
+        }
+        entry.priority = priority;
+        return isNew;
+    }
+
+    void ResidencyTracker::remove(const void* pResource)
+    {
+        auto it = mEntries.find(pResource);
+        if(it != mEntries.end())
+        {
+            mResidentBytes -= it->second.size;
+            mEntries.erase(it);
+        }
+    }
+
+    void ResidencyTracker::endFrame(uint64_t budget, float hysteresis, std::vector<const void*>& evicted)
+    {
+        evicted.clear();
+        if(budget > 0 && mResidentBytes > budget)
+        {
+            // Round the margin rather than the target, otherwise float hysteresis values like 0.1 evict one resource too many
+            uint64_t target = budget - min(budget, (uint64_t)(double(budget) * double(hysteresis) + 0.5));
+
+            using Candidate = std::pair<const void*, const Entry*>;
+            std::vector<Candidate> candidates;
+            for(const auto& e : mEntries)
+            {
+                if(e.second.lastUsedFrame != mFrameId)
+                {
+                    candidates.push_back(Candidate(e.first, &e.second));
+                }
+            }
+
+            auto evictFirst = [](const Candidate& a, const Candidate& b) -> bool
+            {
+                if(a.second->priority != b.second->priority)
+                {
+                    return a.second->priority < b.second->priority;
+                }
+                if(a.second->lastUsedFrame != b.second->lastUsedFrame)
+                {
+                    return a.second->lastUsedFrame < b.second->lastUsedFrame;
+                }
+                return a.second->residentOrder < b.second->residentOrder;
+            };
+            std::sort(candidates.begin(), candidates.end(), evictFirst);
+
+            uint64_t residentBytes = mResidentBytes;
+            for(size_t i = 0; i < candidates.size() && residentBytes > target; i++)
+            {
+                evicted.push_back(candidates[i].first);
+                residentBytes -= candidates[i].second->size;
+            }
+
+            // The candidates point into the map, so only erase the entries once the selection is done
+            for(const void* pResource : evicted)
+            {
+                remove(pResource);
+            }
+        }
+
+        mUsedBytes = 0;
+        mFrameId++;
+    }
+}
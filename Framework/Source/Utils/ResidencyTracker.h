@@ -0,0 +1,88 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <unordered_map>
+#include <vector>
+
+namespace Falcor
+{
+    /** Bookkeeping for keeping a set of resources within a memory budget.\n
+        Tracks the size, priority and last-used frame of each resident resource, and picks the resources to evict at the end of a frame which exceeded the budget. Eviction continues until usage drops below the budget minus the hysteresis margin.
+        Resources used in the current frame are never evicted. Lower priority resources are evicted first, then the least-recently-used ones, then the ones which became resident first.\n
+        The class doesn't touch the resources themselves - they are identified by an opaque pointer, and the caller makes them resident and non-resident. ResidencyManager uses it for the bindless textures and buffers.
+    */
+    class ResidencyTracker
+    {
+    public:
+        /** Mark a resource as used in the current frame. Starts tracking it if it isn't tracked.
+            \param[in] pResource The resource
+            \param[in] size The resource size in bytes. Only used when the resource isn't tracked yet
+            \param[in] priority Resources with lower priority are evicted first
+            \return true if the resource wasn't tracked before the call
+        */
+        bool markUsed(const void* pResource, uint64_t size, uint32_t priority);
+
+        /** Stop tracking a resource. Does nothing if the resource isn't tracked
+        */
+        void remove(const void* pResource);
+
+        bool isTracked(const void* pResource) const { return mEntries.find(pResource) != mEntries.end(); }
+
+        /** Pick the resources to evict and close the frame.
+            \param[in] budget The budget in bytes. 0 disables eviction
+            \param[in] hysteresis Fraction of the budget. Once over budget, resources are evicted until usage drops below budget * (1 - hysteresis)
+            \param[out] evicted The evicted resources, in eviction order. They are not tracked anymore
+        */
+        void endFrame(uint64_t budget, float hysteresis, std::vector<const void*>& evicted);
+
+        /** Get the total size of the tracked resources
+        */
+        uint64_t getResidentBytes() const { return mResidentBytes; }
+
+        /** Get the total size of the resources used in the current frame
+        */
+        uint64_t getUsedBytes() const { return mUsedBytes; }
+
+        size_t getResidentCount() const { return mEntries.size(); }
+
+    private:
+        struct Entry
+        {
+            uint64_t size = 0;
+            uint64_t lastUsedFrame = 0;
+            uint64_t residentOrder = 0;     ///< Breaks ties between resources last used in the same frame, so the eviction order doesn't depend on the addresses
+            uint32_t priority = 0;
+        };
+
+        std::unordered_map<const void*, Entry> mEntries;
+        uint64_t mFrameId = 1;
+        uint64_t mNextResidentOrder = 0;
+        uint64_t mResidentBytes = 0;
+        uint64_t mUsedBytes = 0;
+    };
+}
@@ -32,32 +32,13 @@
 #include "Utils/StringUtils.h"
 #include <cctype>
 #include <set>
+#include <mutex>
+#include <unordered_map>
 
 namespace Falcor
 {
     size_t npos = std::string::npos;
 
-    bool isInComment(const std::string& str, size_t offset)
-    {
-        // Check for /* */ style
-        size_t prevCommentStart = str.rfind("/*", offset);
-        size_t prevCommentEnd = str.rfind("*/", offset);
-        if((prevCommentStart > prevCommentEnd) && (prevCommentStart != npos))
-        {
-            return true;
-        }
-        
-        // Check for '//'
-        size_t prevNewLine = str.rfind("\n", offset);
-        size_t prevComment = str.rfind("//", offset);
-        if((prevComment > prevNewLine) && (prevComment != npos))
-        {
-            return true;
-        }
-
-        return false;
-    }
-
     /*  Valid tokens are:
         +;,=()
         Strings (Whitespaces are ignored)
@@ -94,275 +75,6 @@ namespace Falcor
         return endTokenOffset;
     }
 
-    size_t getLine(const std::string& str, size_t offset, std::string& subStr)
-    {
-        size_t end = str.find('\n', offset);
-        subStr = (end == npos) ? str.substr(offset) : str.substr(offset, end - offset);
-        return end;
-    }
-
-    size_t getIncludedFileName(const std::string& str, size_t offset, std::string& filename)
-    {
-        size_t filenameStart = str.find_first_of("<\"\n", offset);
-        if(filenameStart == npos || str[filenameStart] == '\n')
-        {
-            return npos;
-        }
-        char token = str[filenameStart];
-        filenameStart += 1;
-
-        std::string endToken = std::string("\n") + token;
-        size_t filenameEnd = str.find_first_of(endToken, filenameStart);
-        if(filenameEnd == npos || str[filenameEnd] == '\n')
-        {
-            return npos;
-        }
-
-        size_t length = filenameEnd - filenameStart;
-        filename = canonicalizeFilename(str.substr(filenameStart, length));
-        return filenameEnd;
-    }
-
-    template<bool bReverse>
-    size_t findShaderDirective(const std::string& code, size_t offset, const std::string directive)
-    {
-        while(offset != npos)
-        {
-            offset = bReverse ? code.rfind(directive, offset) : code.find(directive, offset);
-            if(offset != npos)
-            {
-                if(isInComment(code, offset) == false)
-                {
-                    return offset;
-                }
-
-                if(bReverse)
-                {
-                    offset -= directive.size();
-                }
-                else
-                {
-                    offset += directive.size();
-
-                }
-            }
-        }
-        return offset;
-    }
-
-    void findDirectivePair(const std::string& startPragma, const std::string& endPragma, const std::string& str, size_t& startOffset, size_t& endOffset)
-    {
-        // In case of nesting, this code will return the outer pair
-        startOffset = findShaderDirective<false>(str, 0, startPragma);
-        if(startOffset == npos)
-        {
-            // Nothing to do
-            endOffset = findShaderDirective<false>(str, 0, endPragma);
-            return;
-        }
-
-        uint32_t startCount = 1;
-        size_t offset = startOffset + startPragma.size();
-        while(startCount != 0)
-        {
-            size_t nextStart = findShaderDirective<false>(str, offset, startPragma);
-            endOffset = findShaderDirective<false>(str, offset, endPragma);
-
-            if(endOffset == npos)
-            {
-                // Didn't find an end pragma
-                return;
-            }
-
-            if(nextStart == npos || endOffset < nextStart)
-            {
-                startCount--;
-                offset = endOffset + endPragma.size();
-            }
-            else
-            {
-                startCount++;
-                offset = nextStart + startPragma.size();
-            }
-        }
-    }
-
-    size_t countNewLines(const std::string& str, size_t start, size_t offset)
-    {
-        const auto& end = (offset == npos) ? str.end() : str.begin() + offset;
-        size_t line = std::count(str.begin() + start, end, '\n');
-        return line;
-    }
-
-    void getLineInformation(const std::string& code, size_t offset, size_t& line, std::string& filename, const std::string& rootFileName)
-    {
-        // Find the previous line pragma
-        const std::string lineDirective("#line");
-
-        size_t precedingLinePragmaOffset = findShaderDirective<true>(code, offset, "#line");
-        if(precedingLinePragmaOffset == npos)
-        {
-            // No preceding line directive; this must be the root file
-            filename = rootFileName;
-            line = countNewLines(code, 0, offset) + 1; // Count new lines is zero based, so we add 1 for index offset
-        }
-        else
-        {
-            // Assuming a well defined line pragma
-            // Find the next newline after the preceding line pragma
-            size_t endLine = code.find_first_of("\n", precedingLinePragmaOffset);
-            std::string pragmaLine = (endLine == npos) ? code.substr(precedingLinePragmaOffset) : code.substr(precedingLinePragmaOffset, endLine - precedingLinePragmaOffset);
-
-            std::vector<std::string> tokens = splitString(pragmaLine, " \t");
-            assert(tokens.size() == 2 || tokens.size() == 3);
-
-            // Get the line information
-            assert(std::isdigit(tokens[1][0]));
-            line = atoi(tokens[1].c_str()) - 1; // #line actually tells where the next line is, so we subtract one to compensate for that
-            line += countNewLines(code, precedingLinePragmaOffset, offset);
-
-            if(tokens.size() == 3)
-            {
-                // Pragma of the form "#line N \"filename\"".
-                const auto& f = tokens[2];
-                assert(f[0] == '"');
-                assert(f[f.length() - 1] == '"');
-                filename = f.substr(1, f.length() - 2);
-                filename = replaceSubstring(filename,"/","\\");
-            }
-            else
-            {
-                // Pragma of the form "#line N", meaning that the file is the root file.
-                filename = rootFileName;
-            }
-        }
-    }
-
-    inline std::string getLinePragma(size_t line, const std::string& filename)
-    {
-        // Note replacing backslashes with forward slashes; otherwise GLSL interprets as escape characters.
-        std::string p = std::string("#line ") + std::to_string(line) + " \"" + replaceSubstring(filename,"\\","/") + "\"\n";
-        return p;
-    }
-
-    inline std::string getLinePragmaFromOffset(const std::string& code, size_t offset, const std::string& rootFileName)
-    {
-        size_t line;
-        std::string filename;
-        getLineInformation(code, offset, line, filename, rootFileName);
-        return getLinePragma(line, filename);
-    }
-
-    bool ShaderPreprocessor::addIncludes(std::string& code, Shader::unordered_string_set& includeFileList)
-    {
-        auto getDirAbs = [](const std::string& path) -> std::string 
-        {
-            auto last = path.find_last_of("/\\");
-            return path.substr(0, last);
-        };
-
-        // Map of a file's absolute path onto the absolute directory that contains it.
-        std::map<std::string,std::string> pathsAbsToDirsAbs;
-        pathsAbsToDirsAbs[mShaderPathAbs] = getDirAbs(mShaderPathAbs);
-
-        // Set of all included files' absolute paths
-        std::set<std::string> includedPathsAbs;
-
-        // Loop over every found include in the file
-        const std::string includeMacro = "#include";
-        const std::string pragmaStatement = "#pragma once";
-        while(true) 
-        {
-            size_t offset = findShaderDirective<false>(code, 0, includeMacro);
-            if(offset == npos) 
-            {
-                break; //Completed
-            }
-
-            // Get absolute path to the including file.  Note that it is absolute because we only ever write absolute paths in #line directives.
-            std::string includingPathAbs;
-            size_t line;
-            getLineInformation(code, offset, line, includingPathAbs, mShaderPathAbs);
-
-            // Get raw path to the include (may be relative to the including file or absolute)
-            std::string includedPathRaw;
-            size_t postFilenameOffset = getIncludedFileName(code, offset, includedPathRaw);
-            if(postFilenameOffset == npos)
-            {
-                mErrorStr += mShaderPathAbs + "(" + std::to_string(line) + "):Missing included filename";
-                return false;
-            }
-
-            // Resolve absolute path of included file.  Error if cannot be found.
-            std::string includedPathAbs;
-            if(doesFileExist(includedPathRaw))
-            {
-                // Path was absolute.
-                includedPathAbs = includedPathRaw;
-            }
-            else
-            {
-                // Path is relative to including file, and may include Falcor builtins.
-
-                // Search for Falcor builtin
-                if(findFileInDataDirectories(includedPathRaw, includedPathAbs)) goto SUCCESS;
-
-                // Search relative to the including file.
-                // Note canonicalization is necessary because the relative path might contain "..\\".
-                includedPathAbs = canonicalizeFilename( pathsAbsToDirsAbs.at(includingPathAbs) + "\\" + includedPathRaw );
-                if(doesFileExist(includedPathAbs)) goto SUCCESS;
-
-                // Could not find file!
-                mErrorStr += includingPathAbs + "(" + std::to_string(line) + "):Cannot find apparent relative include file \"" + includedPathRaw + "\".";
-                return false;
-
-                SUCCESS:;
-            }
-
-            // Add the file to the include list
-            includeFileList.insert(includedPathAbs);
-
-            // Read the included file.
-            std::string includedContent;
-            readFileToString(includedPathAbs, includedContent);
-
-            // Add a trailing newline as required.  TODO: emit a warning while doing this.
-            if(!includedContent.empty() && includedContent.back() != '\n')
-            {
-                includedContent += '\n';
-            }
-
-            // If the included file contains "#pragma once", and we already included it, ignore it.  TODO: need to check that the pragma is valid.
-            bool shouldInclude = true;
-            if(findShaderDirective<false>(includedContent, 0, pragmaStatement) != npos)
-            {
-                if(includedPathsAbs.find(includedPathAbs) != includedPathsAbs.end())
-                {
-                    shouldInclude = false;
-                }
-            }
-
-            std::string prologue = code.substr(0, offset);
-            std::string epilogue = code.substr(postFilenameOffset + 2);
-            if(shouldInclude)
-            {
-                includedPathsAbs.insert(includedPathAbs);
-                pathsAbsToDirsAbs[includedPathAbs] = getDirAbs(includedPathAbs);
-
-                std::string preIncludeLine = getLinePragma(1, includedPathAbs);
-                std::string replacedIncludeLine = getLinePragma(line+1, includingPathAbs);
-                code = prologue + preIncludeLine + includedContent + replacedIncludeLine + epilogue;
-            }
-            else
-            {
-                code = prologue + epilogue;
-            }
-
-        }
-
-        return true;
-    }
-
     using string_tuple = std::vector < std::string >;
     using string_tuple_vector = std::vector < string_tuple >;
 
@@ -653,64 +365,6 @@ namespace Falcor
         return true;
     }
 
-    bool generateForEachBody(const std::string& bodyTemplate, const std::string& foreachLine, std::string& body, std::string& error)
-    {
-        string_tuple keyTable;
-        string_tuple_vector valueTable;
-        if(parseForEachLine(foreachLine, keyTable, valueTable, error) == false)
-        {
-            return false;
-        }
-
-        const std::string valueIndex = "$(_valIndex)";
-        const std::string keyIndex = "$(_keyIndex)";
-
-        for(size_t value = 0; value < valueTable.size(); value++)
-        {
-            const auto& valueList = valueTable[value];
-            std::string valBody = bodyTemplate;
-            for(size_t key = 0; key < keyTable.size(); key++)
-            {
-                const std::string& decoratedKey = "$(" + keyTable[key] + ")";
-                if(decoratedKey == valueIndex || decoratedKey == keyIndex)
-                {
-                    error = "Key '" + keyTable[key] + "' is reserved for the " + ((decoratedKey == valueIndex) ? "value" : "key") + " index.";
-                    return false;
-                }
-
-                const std::string& V = valueList[key];
-                valBody = replaceSubstring(valBody, decoratedKey, V);
-                valBody = replaceSubstring(valBody, keyIndex, std::to_string(key));
-            }
-            valBody = replaceSubstring(valBody, valueIndex, std::to_string(value));
-
-            body += valBody;
-        }
-
-        return true;
-    }
-
-    bool generateForLoopBody(const std::string& bodyTemplate, const std::string& forLine, std::string& body, std::string& error)
-    {
-        std::string iteratorName;
-        int32_t startRange = 0;
-        int32_t endRange = 0;
-        int32_t delta = 0;
-
-        if(parseForLine(forLine, iteratorName, startRange, endRange, delta, error) == false)
-        {
-            return false;
-        }
-
-        iteratorName = "$(" + iteratorName + ")";
-        for(int32_t i = startRange; i < endRange; i += delta)
-        {
-            body += replaceSubstring(bodyTemplate, iteratorName, std::to_string(i));
-        }
-
-        return true;
-    }
-
     std::string expandMacros(const std::string& line, const std::map<std::string, std::string>& defines)
     {
         std::string S = line;
@@ -748,156 +402,472 @@ namespace Falcor
         return S;
     }
 
-    bool ShaderPreprocessor::parsePragmaBlock(std::string& shader, const std::string& startDirective, const std::string& endDirective, pragma_block_generate_body pfnGenerateBody)
+
+    inline std::string getLinePragma(size_t line, const std::string& filename)
+    {
+        // Note replacing backslashes with forward slashes; otherwise GLSL interprets as escape characters.
+        std::string p = std::string("#line ") + std::to_string(line) + " \"" + replaceSubstring(filename,"\\","/") + "\"\n";
+        return p;
+    }
+
+    inline std::string getErrorPrefix(const std::string& filename, uint32_t line)
+    {
+        return filename + "(" + std::to_string(line) + "): ";
+    }
+
+    /** A tokenized source line/line-range. Consecutive regular code lines are merged into a single text node, so emitting unmodified code is a simple append.
+    */
+    struct ShaderPreprocessor::SourceNode
+    {
+        enum class Type
+        {
+            Text,       ///< Regular code. Passed as-is into the output (after applying block substitutions)
+            Include,    ///< #include. 'arg' holds the raw include path
+            Expect,     ///< #expect. 'arg' holds the rest of the line
+            Version,    ///< #version. 'arg' holds the entire line
+            ForEach,    ///< #foreach block. 'arg' holds the entire directive line
+            For,        ///< #for block. 'arg' holds the entire directive line
+        };
+
+        Type type = Type::Text;
+        uint32_t line = 0;                  ///< The line of the directive, or the first line of a text node
+        uint32_t endLine = 0;               ///< For blocks, the line of the closing directive
+        std::string arg;
+        std::vector<SourceNode> children;   ///< For blocks, the block's body
+    };
+
+    struct ShaderPreprocessor::SourceFile
+    {
+        std::string path;
+        std::vector<SourceNode> nodes;
+        bool hasPragmaOnce = false;
+        bool hasVersion = false;
+    };
+
+    struct ShaderPreprocessor::IncludeCache
+    {
+        struct Entry
+        {
+            time_t modifiedTime;
+            SourceFilePtr pFile;
+        };
+        std::mutex mutex;
+        std::unordered_map<std::string, Entry> files;
+    };
+
+    ShaderPreprocessor::IncludeCache ShaderPreprocessor::sIncludeCache;
+
+    bool ShaderPreprocessor::tokenizeSource(const std::string& source, const std::string& path, SourceFile& file, std::string& errorMsg)
     {
-        size_t startDirectiveOffset, endDirectiveOffset;
-        findDirectivePair(startDirective, endDirective, shader, startDirectiveOffset, endDirectiveOffset);
+        file.path = path;
+        file.nodes.clear();
 
-        while(startDirectiveOffset != npos)
+        // The stack of currently open blocks. Nodes are only ever added to the innermost block, so the pointers stay valid.
+        std::vector<SourceNode*> openBlocks;
+        auto getCurrentNodes = [&]() -> std::vector<SourceNode>& { return openBlocks.empty() ? file.nodes : openBlocks.back()->children; };
+
+        auto appendText = [&](const char* pText, size_t length, uint32_t line)
         {
-            // Error checks
-            if(endDirectiveOffset == npos)
+            auto& nodes = getCurrentNodes();
+            if(nodes.empty() || nodes.back().type != SourceNode::Type::Text)
             {
-                size_t line;
-                std::string filename;
-                getLineInformation(shader, startDirectiveOffset, line, filename, mShaderPathAbs);
-                mErrorStr += filename + "(" + std::to_string(line) + "): Found " + startDirective + " directive with no matching " + endDirective + ".";
-                return false;
+                nodes.push_back(SourceNode());
+                nodes.back().line = line;
             }
+            nodes.back().arg.append(pText, length);
+            nodes.back().arg += '\n';
+        };
 
-            // Get the for start pragma line
-            std::string startDirectiveLine;
-            size_t startDirectiveLineOffset = getLine(shader, startDirectiveOffset, startDirectiveLine);
+        bool inBlockComment = false;
+        uint32_t line = 1;
+        size_t lineStart = 0;
+        const char* pSource = source.c_str();
 
-            // expand macro definitions
-            startDirectiveLine = expandMacros(startDirectiveLine, mDefineMap);
+        // Skip the UTF-8 byte-order mark, otherwise we'll miss a directive in the first line
+        if(source.compare(0, 3, "\xEF\xBB\xBF") == 0)
+        {
+            lineStart = 3;
+        }
 
+        while(lineStart < source.size())
+        {
+            size_t lineEnd = source.find('\n', lineStart);
+            size_t nextLine = (lineEnd == npos) ? source.size() : lineEnd + 1;
+            lineEnd = (lineEnd == npos) ? source.size() : lineEnd;
 
-            // Generate the block body
-            std::string bodyTemplate = getLinePragmaFromOffset(shader, startDirectiveLineOffset, mShaderPathAbs) + shader.substr(startDirectiveLineOffset, endDirectiveOffset - startDirectiveLineOffset);
-            std::string body;
-            if(pfnGenerateBody(bodyTemplate, startDirectiveLine, body, mErrorStr) == false)
+            // Directives are recognized only when they are the first token of a line which doesn't start inside a comment
+            std::string directive;
+            size_t c = lineStart;
+            while(c < lineEnd && (source[c] == ' ' || source[c] == '\t' || source[c] == '\r'))
             {
-                size_t line;
-                std::string filename;
-                getLineInformation(shader, startDirectiveOffset, line, filename, mShaderPathAbs);
-                mErrorStr = filename + "(" + std::to_string(line) + "): " + mErrorStr;
-                return false;
+                c++;
+            }
+            if(inBlockComment == false && c < lineEnd && source[c] == '#')
+            {
+                size_t wordEnd = c + 1;
+                while(wordEnd < lineEnd && std::isalpha((unsigned char)source[wordEnd]))
+                {
+                    wordEnd++;
+                }
+                directive = source.substr(c + 1, wordEnd - c - 1);
             }
 
+            // Update the comment state. This is the only place we scan the characters of the line
+            for(size_t i = c; i + 1 < lineEnd; i++)
+            {
+                if(inBlockComment)
+                {
+                    if(source[i] == '*' && source[i + 1] == '/')
+                    {
+                        inBlockComment = false;
+                        i++;
+                    }
+                }
+                else if(source[i] == '/')
+                {
+                    if(source[i + 1] == '/')
+                    {
+                        break;
+                    }
+                    else if(source[i + 1] == '*')
+                    {
+                        inBlockComment = true;
+                        i++;
+                    }
+                }
+            }
 
-            // Find all the pieces of the puzzle
-            std::string prolog = shader.substr(0, startDirectiveOffset);
-            std::string epilogue;
-            size_t endOfEndOffset = shader.find('\n', endDirectiveOffset);
-            if(endOfEndOffset != npos)
+            // The rest of the line, after the directive name
+            std::string directiveArgs;
+            if(directive.size())
             {
-                epilogue = getLinePragmaFromOffset(shader, endOfEndOffset, mShaderPathAbs) + shader.substr(endOfEndOffset);
+                size_t argsStart = c + 1 + directive.size();
+                directiveArgs = removeLeadingTrailingWhitespaces(source.substr(argsStart, lineEnd - argsStart));
             }
 
-            shader = prolog + body + epilogue;
+            if(directive == "include")
+            {
+                // Get the filename. Can be either "filename" or <filename>
+                size_t filenameEnd = npos;
+                char openToken = directiveArgs.size() ? directiveArgs[0] : 0;
+                if(openToken == '"' || openToken == '<')
+                {
+                    filenameEnd = directiveArgs.find((openToken == '"') ? '"' : '>', 1);
+                }
+                if(filenameEnd == npos)
+                {
+                    errorMsg += getErrorPrefix(path, line) + "Missing included filename";
+                    return false;
+                }
 
-            // Get the next directive
-            findDirectivePair(startDirective, endDirective, shader, startDirectiveOffset, endDirectiveOffset);
+                SourceNode node;
+                node.type = SourceNode::Type::Include;
+                node.line = line;
+                node.arg = canonicalizeFilename(directiveArgs.substr(1, filenameEnd - 1));
+                getCurrentNodes().push_back(node);
+            }
+            else if(directive == "pragma" && directiveArgs == "once")
+            {
+                // Handled by the includer. Replace it with an empty line to keep the line numbers in sync
+                file.hasPragmaOnce = true;
+                appendText(pSource, 0, line);
+            }
+            else if(directive == "expect" || directive == "version")
+            {
+                SourceNode node;
+                node.type = (directive == "expect") ? SourceNode::Type::Expect : SourceNode::Type::Version;
+                node.line = line;
+                node.arg = (directive == "expect") ? directiveArgs : source.substr(lineStart, lineEnd - lineStart);
+                file.hasVersion = file.hasVersion || (node.type == SourceNode::Type::Version);
+                getCurrentNodes().push_back(node);
+            }
+            else if(directive == "foreach" || directive == "for")
+            {
+                SourceNode node;
+                node.type = (directive == "foreach") ? SourceNode::Type::ForEach : SourceNode::Type::For;
+                node.line = line;
+                node.arg = source.substr(c, lineEnd - c);
+                auto& nodes = getCurrentNodes();
+                nodes.push_back(node);
+                openBlocks.push_back(&nodes.back());
+            }
+            else if(directive == "endforeach" || directive == "endfor")
+            {
+                SourceNode::Type blockType = (directive == "endforeach") ? SourceNode::Type::ForEach : SourceNode::Type::For;
+                if(openBlocks.empty() || openBlocks.back()->type != blockType)
+                {
+                    std::string startDirective = (blockType == SourceNode::Type::ForEach) ? "#foreach" : "#for";
+                    errorMsg += getErrorPrefix(path, line) + "Found #" + directive + " directive with no matching " + startDirective + ".";
+                    return false;
+                }
+                openBlocks.back()->endLine = line;
+                openBlocks.pop_back();
+            }
+            else
+            {
+                appendText(pSource + lineStart, lineEnd - lineStart, line);
+            }
+
+            lineStart = nextLine;
+            line++;
         }
 
-        // Error checks
-        if(endDirectiveOffset != npos)
+        if(openBlocks.size())
         {
-            size_t line;
-            std::string filename;
-            getLineInformation(shader, endDirectiveOffset, line, filename, mShaderPathAbs);
-            mErrorStr += filename + "(" + std::to_string(line) + "): Found " + endDirective + " directive with no matching " + startDirective + ".";
+            const SourceNode* pBlock = openBlocks.back();
+            bool isForEach = (pBlock->type == SourceNode::Type::ForEach);
+            errorMsg += getErrorPrefix(path, pBlock->line) + "Found " + (isForEach ? "#foreach" : "#for") + " directive with no matching " + (isForEach ? "#endforeach" : "#endfor") + ".";
             return false;
         }
         return true;
     }
 
-    bool ShaderPreprocessor::parseExpect(std::string& shader)
+    ShaderPreprocessor::SourceFilePtr ShaderPreprocessor::loadIncludeFile(const std::string& path, std::string& errorMsg)
     {
-        const std::string expect("#expect");
-        size_t expectOffset = findShaderDirective<false>(shader, 0, expect);
+        time_t modifiedTime = getFileModifiedTime(path);
+        {
+            std::lock_guard<std::mutex> lock(sIncludeCache.mutex);
+            auto it = sIncludeCache.files.find(path);
+            if(it != sIncludeCache.files.end() && it->second.modifiedTime == modifiedTime)
+            {
+                return it->second.pFile;
+            }
+        }
 
-        while(expectOffset != npos)
+        // Not in the cache, or the file changed since we last read it. We read and tokenize outside the lock, other threads are free to use the rest of the cache meanwhile
+        std::string content;
+        readFileToString(path, content);
+        auto pFile = std::make_shared<SourceFile>();
+        if(tokenizeSource(content, path, *pFile, errorMsg) == false)
         {
-            // Store the current line information for error messages
-            size_t line;
-            std::string file;
-            getLineInformation(shader, expectOffset, line, file, mShaderPathAbs);
+            return nullptr;
+        }
 
-            // Get the expect line
-            std::string expectLine;
-            size_t endLine = getLine(shader, expectOffset + expect.size(), expectLine);
-            expectLine = removeLeadingTrailingWhitespaces(expectLine);
+        std::lock_guard<std::mutex> lock(sIncludeCache.mutex);
+        IncludeCache::Entry& entry = sIncludeCache.files[path];
+        entry.modifiedTime = modifiedTime;
+        entry.pFile = pFile;
+        return pFile;
+    }
 
-            // Get the macro
-            std::string macro;
-            size_t macroOffset = getNextToken(expectLine, 0, macro);
+    void ShaderPreprocessor::clearIncludeCache()
+    {
+        std::lock_guard<std::mutex> lock(sIncludeCache.mutex);
+        sIncludeCache.files.clear();
+    }
 
-            if(macro.size() == 0)
+    static std::string applySubstitutions(const std::string& str, const std::vector<std::pair<std::string, std::string>>& substitutions)
+    {
+        // Substitutions always start with a '$('. Most code lines don't use them, so check that first
+        if(substitutions.empty() || str.find("$(") == npos)
+        {
+            return str;
+        }
+
+        std::string result = str;
+        for(const auto& s : substitutions)
+        {
+            result = replaceSubstring(result, s.first, s.second);
+        }
+        return result;
+    }
+
+    bool ShaderPreprocessor::emitNodes(const SourceFile& file, const std::vector<SourceNode>& nodes, const SubstitutionList& substitutions, bool isRootFile, std::string& shader)
+    {
+        for(const auto& node : nodes)
+        {
+            switch(node.type)
             {
-                mErrorStr += file + "(" + std::to_string(line) + "): Incorrect #expect syntax. Should be '#expect <macro name> <optional macro description>'";
-                return false;
+            case SourceNode::Type::Text:
+                if(substitutions.empty())
+                {
+                    shader += node.arg;
+                }
+                else
+                {
+                    shader += applySubstitutions(node.arg, substitutions);
+                }
+                break;
+            case SourceNode::Type::Include:
+                if(emitInclude(file, node, substitutions, shader) == false)
+                {
+                    return false;
+                }
+                break;
+            case SourceNode::Type::Expect:
+            {
+                std::string macro;
+                size_t descOffset = getNextToken(node.arg, 0, macro);
+                if(macro.size() == 0)
+                {
+                    mErrorStr += getErrorPrefix(file.path, node.line) + "Incorrect #expect syntax. Should be '#expect <macro name> <optional macro description>'";
+                    return false;
+                }
+
+                if(mDefineMap.find(macro) == mDefineMap.end())
+                {
+                    std::string desc = (descOffset == npos) ? std::string() : removeLeadingWhitespaces(node.arg.substr(descOffset));
+                    mErrorStr += getErrorPrefix(file.path, node.line) + "Expected " + macro + " macro definition. " + desc;
+                    return false;
+                }
+
+                // Keep the line numbers in sync
+                shader += '\n';
+                break;
             }
+            case SourceNode::Type::Version:
+                if(isRootFile && mpShaderDefines)
+                {
+                    // The macro definitions go right after the version directive. DX doesn't know the version directive, so we drop it
+#ifndef FALCOR_DX11
+                    shader += node.arg + '\n';
+#endif
+                    emitDefines(shader, *mpShaderDefines);
+                    shader += getLinePragma(node.line + 1, file.path);
+                    mpShaderDefines = nullptr;
+                }
+                else
+                {
+                    shader += node.arg + '\n';
+                }
+                break;
+            case SourceNode::Type::ForEach:
+            case SourceNode::Type::For:
+                if(emitBlock(file, node, substitutions, shader) == false)
+                {
+                    return false;
+                }
+                break;
+            default:
+                should_not_get_here();
+            }
+        }
+        return true;
+    }
 
-            // Check if there is a description
-            std::string desc = expectLine.substr(macro.size()); 
-            desc = removeLeadingWhitespaces(desc);
+    bool ShaderPreprocessor::emitInclude(const SourceFile& file, const SourceNode& node, const SubstitutionList& substitutions, std::string& shader)
+    {
+        const std::string& includedPathRaw = node.arg;
 
-            const auto& def = mDefineMap.find(macro);
-            if(def == mDefineMap.end())
+        // Resolve absolute path of included file.  Error if cannot be found.
+        std::string includedPathAbs;
+        if(doesFileExist(includedPathRaw))
+        {
+            // Path was absolute.
+            includedPathAbs = includedPathRaw;
+        }
+        else if(findFileInDataDirectories(includedPathRaw, includedPathAbs) == false)
+        {
+            // Search relative to the including file.
+            // Note canonicalization is necessary because the relative path might contain "..\\".
+            includedPathAbs = canonicalizeFilename(getDirectoryFromFile(file.path) + "\\" + includedPathRaw);
+            if(doesFileExist(includedPathAbs) == false)
             {
-                mErrorStr += file + "(" + std::to_string(line) + "): Expected " + macro + " macro definition. " + desc;
+                mErrorStr += getErrorPrefix(file.path, node.line) + "Cannot find apparent relative include file \"" + includedPathRaw + "\".";
                 return false;
             }
+        }
 
-            // Get line directives so that the error will appear in the correct location
-            std::string linePragma = getLinePragma(line, file);
-
-            std::string prolog = shader.substr(0, expectOffset);
-            std::string epilogue = (endLine == npos) ? std::string() : shader.substr(endLine);
+        // Add the file to the include list
+        mpIncludeFileList->insert(includedPathAbs);
 
-            shader = prolog + linePragma + epilogue;
+        SourceFilePtr pIncluded = loadIncludeFile(includedPathAbs, mErrorStr);
+        if(pIncluded == nullptr)
+        {
+            return false;
+        }
 
-            // Get the next directive
-            expectOffset = findShaderDirective<false>(shader, endLine, expect);
+        // If the included file contains "#pragma once", and we already included it, ignore it.
+        if(pIncluded->hasPragmaOnce && mIncludedPathsAbs.find(includedPathAbs) != mIncludedPathsAbs.end())
+        {
+            shader += '\n';
+            return true;
         }
+        mIncludedPathsAbs.insert(includedPathAbs);
 
+        shader += getLinePragma(1, includedPathAbs);
+        if(emitNodes(*pIncluded, pIncluded->nodes, substitutions, false, shader) == false)
+        {
+            return false;
+        }
+        shader += getLinePragma(node.line + 1, file.path);
         return true;
     }
 
-    bool ShaderPreprocessor::addDefines(std::string& code, const Program::DefineList& shaderDefines)
+    bool ShaderPreprocessor::emitBlock(const SourceFile& file, const SourceNode& node, const SubstitutionList& substitutions, std::string& shader)
     {
-        // Adding the defines right after the version string
-        size_t verStart = 0;
-        size_t verEnd = 0;
+        // Substitutions of enclosing blocks apply to the directive line as well, then we expand the C++ macros
+        std::string directiveLine = expandMacros(applySubstitutions(node.arg, substitutions), mDefineMap);
+        std::vector<SubstitutionList> iterations;
+        std::string error;
 
-        verStart = code.find("#version");
-        if(verStart == npos)
+        if(node.type == SourceNode::Type::ForEach)
         {
-#ifdef FALCOR_GL
-            mErrorStr += "Can't find version directive\n";
-            return false;
-#endif
-            verStart = 0;
+            string_tuple keyTable;
+            string_tuple_vector valueTable;
+            if(parseForEachLine(directiveLine, keyTable, valueTable, error))
+            {
+                const std::string valueIndex = "$(_valIndex)";
+                const std::string keyIndex = "$(_keyIndex)";
+
+                for(size_t value = 0; value < valueTable.size() && error.empty(); value++)
+                {
+                    // The order of substitutions matches the order in which the body was patched when the block was expanded in-place
+                    SubstitutionList iteration = substitutions;
+                    for(size_t key = 0; key < keyTable.size(); key++)
+                    {
+                        const std::string decoratedKey = "$(" + keyTable[key] + ")";
+                        if(decoratedKey == valueIndex || decoratedKey == keyIndex)
+                        {
+                            error = "Key '" + keyTable[key] + "' is reserved for the " + ((decoratedKey == valueIndex) ? "value" : "key") + " index.";
+                            break;
+                        }
+                        iteration.push_back(std::make_pair(decoratedKey, valueTable[value][key]));
+                        iteration.push_back(std::make_pair(keyIndex, std::to_string(key)));
+                    }
+                    iteration.push_back(std::make_pair(valueIndex, std::to_string(value)));
+                    iterations.push_back(iteration);
+                }
+            }
         }
         else
         {
-            // Skip the version pragma line
-            verEnd = code.find("\n", verStart);
-            if(verEnd == npos)
+            std::string iteratorName;
+            int32_t startRange = 0;
+            int32_t endRange = 0;
+            int32_t delta = 0;
+            if(parseForLine(directiveLine, iteratorName, startRange, endRange, delta, error))
             {
-                code += "\n";
-                verEnd = code.length() - 1;
+                iteratorName = "$(" + iteratorName + ")";
+                for(int32_t i = startRange; i < endRange; i += delta)
+                {
+                    SubstitutionList iteration = substitutions;
+                    iteration.push_back(std::make_pair(iteratorName, std::to_string(i)));
+                    iterations.push_back(iteration);
+                }
             }
-            verEnd++;
         }
-        // Store the current line number
-        size_t line;
-        std::string currentFile;
-        getLineInformation(code, verStart, line, currentFile, mShaderPathAbs);
 
+        if(error.size())
+        {
+            mErrorStr += getErrorPrefix(file.path, node.line) + error;
+            return false;
+        }
+
+        for(const auto& iteration : iterations)
+        {
+            shader += getLinePragma(node.line + 1, file.path);
+            if(emitNodes(file, node.children, iteration, false, shader) == false)
+            {
+                return false;
+            }
+        }
+        shader += getLinePragma(node.endLine + 1, file.path);
+        return true;
+    }
 
+    void ShaderPreprocessor::emitDefines(std::string& shader, const Program::DefineList& shaderDefines)
+    {
 #ifdef FALCOR_DX11
         static const std::string api = "FALCOR_HLSL";
         static const std::string extensions;
@@ -906,31 +876,17 @@ namespace Falcor
         static const std::string extensions("#extension GL_ARB_bindless_texture : enable");
 #endif
 
-        std::string allDefines = "#ifndef " + api + "\n#define " + api + "\n#endif\n" + extensions + "\n";
+        shader += "#ifndef " + api + "\n#define " + api + "\n#endif\n" + extensions + "\n";
 
         for(const auto& defDcl : shaderDefines)
         {
-            std::string def = defDcl.first;
+            shader += "#define " + defDcl.first;
             if(defDcl.second.size())
             {
-                def += ' ' + defDcl.second;
+                shader += ' ' + defDcl.second;
             }
-            addMacroDefinitionToMap(def);
-            allDefines += "#define " + def + "\n";;
+            shader += '\n';
         }
-
-        // Patch the code
-        allDefines += getLinePragma(verEnd == 0 ? 0 : line, currentFile) + "\n";
-        code.insert(verEnd, allDefines);
-
-#ifdef FALCOR_DX11
-        if(verEnd != verStart)
-        {
-            // Remove the version pragma
-            code.erase(verStart, verEnd - verStart);
-        }
-#endif
-        return true;
     }
 
     bool ShaderPreprocessor::addMacroDefinitionToMap(const std::string& defineString)
@@ -971,16 +927,49 @@ namespace Falcor
         ShaderPreprocessor preProc(errorMsg);
 
         preProc.mShaderPathAbs = canonicalizeFilename(filename);
+        preProc.mpIncludeFileList = &includeFileList;
 
-        // First, add include files as the rest of the directive might rely on their content
-        if(preProc.addIncludes(shader, includeFileList) &&
-            preProc.addDefines(shader, shaderDefines) &&
-            preProc.parseExpect(shader) &&
-            preProc.parsePragmaBlock(shader, "#foreach", "#endforeach", generateForEachBody) &&
-            preProc.parsePragmaBlock(shader, "#for", "#endfor", generateForLoopBody))
+        // The root file is tokenized directly from the source string. Included files go through the cache
+        SourceFile root;
+        if(tokenizeSource(shader, preProc.mShaderPathAbs, root, errorMsg) == false)
         {
-            return true;
+            return false;
         }
-        return false;
+
+        for(const auto& defDcl : shaderDefines)
+        {
+            std::string def = defDcl.first;
+            if(defDcl.second.size())
+            {
+                def += ' ' + defDcl.second;
+            }
+            preProc.addMacroDefinitionToMap(def);
+        }
+
+        // Generate the output in a single pass over the token tree.
+        std::string output;
+        output.reserve(shader.size() * 2);
+        if(root.hasVersion)
+        {
+            // The defines will be emitted when we reach the version directive
+            preProc.mpShaderDefines = &shaderDefines;
+        }
+        else
+        {
+#ifdef FALCOR_GL
+            errorMsg += "Can't find version directive\n";
+            return false;
+#endif
+            preProc.emitDefines(output, shaderDefines);
+            output += getLinePragma(1, preProc.mShaderPathAbs);
+        }
+
+        if(preProc.emitNodes(root, root.nodes, SubstitutionList(), true, output) == false)
+        {
+            return false;
+        }
+
+        shader.swap(output);
+        return true;
     }
 }
@@ -29,6 +29,8 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <set>
+#include <memory>
 #include "Graphics/Program.h"
 #include <unordered_set>
 
@@ -50,6 +52,8 @@ namespace Falcor
         \endcode
         see the descriptions of the different directives to understand what this code is doing.
         \n\nThe pre-processor can also embed macro-definitions into the shader string. The macro definitions will be embedded right after the #version directive.
+        \n\nThe source is tokenized line by line in a single pass. A directive is recognized only if it's the first token in a line which doesn't begin inside a comment, and a #foreach/#for block must be closed in the file that opened it.
+        Included files are tokenized once and cached for the lifetime of the process (see clearIncludeCache()).
 
         <h4>#include</h4>
         Similar to C/C++, will add the included file into the source. '#pragma once' can be used inside an header so that it's included only once.
@@ -165,20 +169,36 @@ namespace Falcor
         */
         static bool parseShader(const std::string& filename, std::string& shader, std::string& errorMsg, Shader::unordered_string_set& includeFileList, const Program::DefineList& shaderDefines = Program::DefineList());
 
+        /** Release all the included files cached by the pre-processor.
+            Included files are tokenized once and shared between all the shaders which include them. A cached file is re-read when its modification time changes, so there's no need to call this function after editing a shader.
+        */
+        static void clearIncludeCache();
+
     private:
         ShaderPreprocessor(std::string& errorStr);
 
         std::string& mErrorStr;
 
-        using pragma_block_generate_body = bool(*)(const std::string& bodyTemplate, const std::string& linePragma, std::string& body, std::string& error);
+        struct SourceNode;
+        struct SourceFile;
+        struct IncludeCache;
+        using SubstitutionList = std::vector<std::pair<std::string, std::string>>;
+        using SourceFilePtr = std::shared_ptr<const SourceFile>;
+
+        static IncludeCache sIncludeCache;
+        static bool tokenizeSource(const std::string& source, const std::string& path, SourceFile& file, std::string& errorMsg);
+        static SourceFilePtr loadIncludeFile(const std::string& path, std::string& errorMsg);
 
-        bool addDefines(std::string& shader, const Program::DefineList& shaderDefines);
-        bool addIncludes(std::string& shader, Shader::unordered_string_set& includeFileList);
-        bool parsePragmaBlock(std::string& shader, const std::string& startPragma, const std::string& endPragma, pragma_block_generate_body pfnGenerateBody);
-        bool parseExpect(std::string& shader);
+        bool emitNodes(const SourceFile& file, const std::vector<SourceNode>& nodes, const SubstitutionList& substitutions, bool isRootFile, std::string& shader);
+        bool emitInclude(const SourceFile& file, const SourceNode& node, const SubstitutionList& substitutions, std::string& shader);
+        bool emitBlock(const SourceFile& file, const SourceNode& node, const SubstitutionList& substitutions, std::string& shader);
+        void emitDefines(std::string& shader, const Program::DefineList& shaderDefines);
         bool addMacroDefinitionToMap(const std::string& defineString);
 
         std::map<std::string, std::string> mDefineMap;
         std::string mShaderPathAbs;
+        const Program::DefineList* mpShaderDefines = nullptr;
+        Shader::unordered_string_set* mpIncludeFileList = nullptr;
+        std::set<std::string> mIncludedPathsAbs;
     };
 }
@@ -52,4 +52,8 @@ namespace Falcor
     \return A pointer to a new object if compilation was successful, otherwise nullptr.
     */
     const Shader::SharedPtr createShaderFromString(const std::string& shaderString, ShaderType type, const Program::DefineList& shaderDefines = Program::DefineList());
+
+    /** Get a user-friendly name of a shader stage
+    */
+    const std::string getShaderNameFromType(ShaderType type);
 }
\ No newline at end of file
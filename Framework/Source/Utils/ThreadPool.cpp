@@ -0,0 +1,169 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "Framework.h"
+#include "ThreadPool.h"
+#include <atomic>
+
+namespace Falcor
+{
+    ThreadPool::SharedPtr ThreadPool::create(uint32_t threadCount)
+    {
+        if(threadCount == 0)
+        {
+            uint32_t hwThreads = std::thread::hardware_concurrency();
+            threadCount = (hwThreads > 1) ? hwThreads - 1 : 1;
+        }
+        return SharedPtr(new ThreadPool(threadCount));
+    }
+
+    ThreadPool* ThreadPool::getDefaultPool()
+    {
+        static SharedPtr spDefaultPool;
+        if(spDefaultPool == nullptr)
+        {
+            spDefaultPool = create();
+        }
+        return spDefaultPool.get();
+    }
+
+    ThreadPool::ThreadPool(uint32_t threadCount)
+    {
+        for(uint32_t i = 0; i < threadCount; i++)
+        {
+            mThreads.push_back(std::thread(&ThreadPool::workerLoop, this));
+        }
+    }
+
+    ThreadPool::~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTerminate = true;
+            mTasks.clear();
+        }
+        mTaskCondition.notify_all();
+
+        for(auto& t : mThreads)
+        {
+            t.join();
+        }
+    }
+
+    void ThreadPool::workerLoop()
+    {
+        while(true)
+        {
+            Task task;
+            {
+                std::unique_lock<std::mutex> lock(mMutex);
+                mTaskCondition.wait(lock, [this]() { return mTerminate || mTasks.size(); });
+                if(mTerminate)
+                {
+                    return;
+                }
+                task = mTasks.front();
+                mTasks.pop_front();
+                mRunningTasks++;
+            }
+
+            task();
+
+            {
+                std::lock_guard<std::mutex> lock(mMutex);
+                mRunningTasks--;
+                if(mTasks.empty() && mRunningTasks == 0)
+                {
+                    mIdleCondition.notify_all();
+                }
+            }
+        }
+    }
+
+    void ThreadPool::enqueue(const Task& task)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mMutex);
+            mTasks.push_back(task);
+        }
+        mTaskCondition.notify_one();
+    }
+
+    void ThreadPool::waitForAll()
+    {
+        std::unique_lock<std::mutex> lock(mMutex);
+        mIdleCondition.wait(lock, [this]() { return mTasks.empty() && mRunningTasks == 0; });
+    }
+
+    void ThreadPool::parallelFor(uint32_t begin, uint32_t end, const std::function<void(uint32_t)>& func)
+    {
+        if(begin >= end)
+        {
+            return;
+        }
+
+        // Helper tasks may start after the range was already consumed (for example, when the pool is busy), so the state is shared and we wait on the number of processed items rather than on the tasks
+        struct SharedState
+        {
+            std::atomic<uint32_t> next;
+            std::atomic<uint32_t> completed;
+            std::mutex mutex;
+            std::condition_variable condition;
+        };
+        auto pState = std::make_shared<SharedState>();
+        pState->next = begin;
+        pState->completed = 0;
+        const uint32_t count = end - begin;
+        const std::function<void(uint32_t)>* pFunc = &func;
+
+        auto worker = [pState, pFunc, end, count]()
+        {
+            uint32_t processed = 0;
+            for(uint32_t i = pState->next++; i < end; i = pState->next++)
+            {
+                (*pFunc)(i);
+                processed++;
+            }
+
+            if(processed && (pState->completed += processed) == count)
+            {
+                std::lock_guard<std::mutex> lock(pState->mutex);
+                pState->condition.notify_all();
+            }
+        };
+
+        uint32_t helperCount = min(getThreadCount(), count - 1);
+        for(uint32_t i = 0; i < helperCount; i++)
+        {
+            enqueue(worker);
+        }
+        worker();
+
+        std::unique_lock<std::mutex> lock(pState->mutex);
+        pState->condition.wait(lock, [pState, count]() { return pState->completed == count; });
+    }
+}
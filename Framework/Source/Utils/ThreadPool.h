@@ -0,0 +1,90 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include <vector>
+#include <deque>
+#include <functional>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+namespace Falcor
+{
+    /** A fixed-size pool of worker threads executing tasks in FIFO order.
+        Tasks must not touch the graphics API, unless the API allows it from any thread (D3D11 device calls are free-threaded, GL calls are not).
+    */
+    class ThreadPool
+    {
+    public:
+        using SharedPtr = std::shared_ptr<ThreadPool>;
+        using Task = std::function<void()>;
+
+        /** Create a new thread pool.
+            \param[in] threadCount Optional. The number of worker threads. If this is 0, will create one thread per hardware thread, minus one for the calling thread.
+            \return A new object
+        */
+        static SharedPtr create(uint32_t threadCount = 0);
+
+        /** Get the process-wide pool. The pool is created on the first call, which should happen on the main thread.
+        */
+        static ThreadPool* getDefaultPool();
+
+        /** Destroy the pool. Tasks which didn't start yet are discarded, running tasks are waited for.
+        */
+        ~ThreadPool();
+
+        /** Add a task to the queue
+        */
+        void enqueue(const Task& task);
+
+        /** Block until the queue is empty and all the tasks finished executing
+        */
+        void waitForAll();
+
+        /** Call func(i) for every i in [begin, end) and block until all calls returned. The calling thread participates in the work.
+            The function can be called from inside a task.
+        */
+        void parallelFor(uint32_t begin, uint32_t end, const std::function<void(uint32_t)>& func);
+
+        /** Get the number of worker threads
+        */
+        uint32_t getThreadCount() const { return (uint32_t)mThreads.size(); }
+
+    private:
+        ThreadPool(uint32_t threadCount);
+        void workerLoop();
+
+        std::vector<std::thread> mThreads;
+        std::deque<Task> mTasks;
+        std::mutex mMutex;
+        std::condition_variable mTaskCondition;
+        std::condition_variable mIdleCondition;
+        uint32_t mRunningTasks = 0;
+        bool mTerminate = false;
+    };
+}
@@ -29,6 +29,7 @@
 #include "VideoDecoder.h"
 #include "Utils/OS.h"
 #include "Utils/BinaryFileStream.h"
+#include "Utils/PixelConversion.h"
 extern "C"
 {
 #include "libavcodec/avcodec.h"
@@ -37,9 +38,60 @@ extern "C"
 }
 
 #include <cstdio>
+#include <cmath>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 namespace Falcor
 {
+    struct VideoDecoder::StreamingState
+    {
+        enum class SlotState
+        {
+            Free,
+            Decoding,   // Owned by the decode thread
+            Ready,      // Queued ahead of the playhead
+            Presented,  // Returned to the user
+        };
+
+        struct Slot
+        {
+            Slot(AVCodecContext* pCodecCtx) : frame(pCodecCtx) {}
+            Frame frame;
+            SlotState state = SlotState::Free;
+            double time = 0;
+            uint64_t id = 0;
+        };
+
+        StreamingDesc desc;
+        std::vector<std::unique_ptr<Slot>> slots;
+        Slot* pPresented = nullptr;
+        SwsContext* pSwsCtx = nullptr;
+        uint32_t width = 0;
+        uint32_t height = 0;
+        double frameDuration = 0;
+        double duration = 0;        // 0 if unknown
+        double timeBase = 0;
+        int64_t startPts = 0;
+
+        std::thread thread;
+        mutable std::mutex mutex;
+        std::condition_variable slotFreedCondition;
+        std::condition_variable frameReadyCondition;
+
+        // Everything below is protected by the mutex
+        uint64_t seekGeneration = 0;
+        double seekTime = 0;
+        double playheadTime = 0;
+        double windowStart = 0;     // Time of the presented frame, or the seek target if nothing was presented since the last seek
+        double lastDecodedTime = 0;
+        uint64_t nextFrameId = 1;
+        bool endOfStream = false;
+        bool stop = false;
+        StreamingStats stats;
+    };
+
     float VideoDecoder::rationalToFloat(const AVRational& r)
     {
         return ((float)r.num / (float)r.den);
@@ -83,6 +135,24 @@ namespace Falcor
             mAsyncDecoding->get();
         }
 
+        if(mpStream)
+        {
+            if(mpStream->thread.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(mpStream->mutex);
+                    mpStream->stop = true;
+                }
+                mpStream->slotFreedCondition.notify_one();
+                mpStream->thread.join();
+            }
+            if(mpStream->pSwsCtx)
+            {
+                sws_freeContext(mpStream->pSwsCtx);
+            }
+            mpStream = nullptr;
+        }
+
         av_free(mpFrame);
 
         // Close the codec
@@ -90,37 +160,20 @@ namespace Falcor
         // Close the video file
         avformat_close_input(&mpFormatCtx);
 
-        for(auto& tex : (*mFrameTextures))
-            if(tex) tex->makeNonResident(nullptr);
+        if(mFrameTextures)
+        {
+            for(auto& tex : (*mFrameTextures))
+                if(tex) tex->makeNonResident(nullptr);
+        }
     }
 
     void FlipRGBFrame(AVFrame* pFrame, int H)
     {
-        uint8_t* templine = new uint8_t[pFrame->linesize[0]];
-
-        int hby2 = H / 2;
-
-        for(int line = 0; line < hby2; line++)
-        {
-            auto* line1 = pFrame->data[0] + (line)* pFrame->linesize[0];
-            auto* line2 = pFrame->data[0] + (H - 1 - line) * pFrame->linesize[0];
-
-            memcpy(templine, line1, pFrame->linesize[0]);
-            memcpy(line1, line2, pFrame->linesize[0]);
-            memcpy(line2, templine, pFrame->linesize[0]);
-        }
-
-        delete[] templine;
+        flipRows(pFrame->data[0], pFrame->linesize[0], H);
     }
 
-    void VideoDecoder::bufferFrames()
+    bool VideoDecoder::openFile()
     {
-        if(mAsyncDecoding)
-        {
-            setThreadPriority(getCurrentThread(), ThreadPriorityType::Low);
-            setThreadAffinity(getCurrentThread(), (1<<5)|(1<<6)|(1<<7)|(1<<8));
-        }
-
         if(mpFrame)
         {
             av_free(mpFrame);
@@ -147,13 +200,13 @@ namespace Falcor
         if(avformat_open_input(&mpFormatCtx, mFilename.c_str(), NULL, NULL) != 0)
         {
             printf("Cannot open file\n");
-            return;
+            return false;
         }
 
         if(avformat_find_stream_info(mpFormatCtx, NULL) < 0)
         {
             printf("Couldn't find stream information.\n");
-            return;
+            return false;
         }
 
         for(uint32_t i = 0; i < mpFormatCtx->nb_streams; i++)
@@ -168,7 +221,7 @@ namespace Falcor
 
         if(mVideoStream == -1)
         {
-            return;
+            return false;
         }
 
         auto& stream = mpFormatCtx->streams[mVideoStream];
@@ -184,7 +237,7 @@ namespace Falcor
         if(mpCodec == NULL)
         {
             printf("Unsupported codec!\n");
-            return; // Codec not found
+            return false; // Codec not found
         }
 
         // Copy context
@@ -192,17 +245,39 @@ namespace Falcor
         if(avcodec_copy_context(mpCodecCtx, mpCodecCtxOrig) != 0)
         {
             printf("Couldn't copy codec context\n");
-            return; // Error copying codec context
+            return false; // Error copying codec context
+        }
+
+        // The streaming decoder drains the delayed frames at the end of the file, so it can use frame threading
+        if(mpStream)
+        {
+            mpCodecCtx->thread_count = 0;
+            mpCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
         }
 
         // Open codec
         if(avcodec_open2(mpCodecCtx, mpCodec, nullptr) < 0)
         {
-            return; // Could not open codec
+            return false; // Could not open codec
         }
 
         // Allocate video frame
         mpFrame = av_frame_alloc();
+        return mpFrame != nullptr;
+    }
+
+    void VideoDecoder::bufferFrames()
+    {
+        if(mAsyncDecoding)
+        {
+            setThreadPriority(getCurrentThread(), ThreadPriorityType::Low);
+            setThreadAffinity(getCurrentThread(), (1<<5)|(1<<6)|(1<<7)|(1<<8));
+        }
+
+        if(openFile() == false)
+        {
+            return;
+        }
 
 
         mFrames.clear();
@@ -273,6 +348,30 @@ namespace Falcor
 
     Texture::SharedPtr VideoDecoder::getTextureForNextFrame(float curTime)
     {
+        if(mpStream)
+        {
+            const uint8_t* pData = getFrameDataForTime(curTime);
+            if(pData)
+            {
+                uint64_t frameId;
+                {
+                    std::lock_guard<std::mutex> lock(mpStream->mutex);
+                    frameId = mpStream->pPresented->id;
+                }
+
+                if(mpStreamTexture == nullptr)
+                {
+                    mpStreamTexture = Texture::create2D(mpStream->width, mpStream->height, ResourceFormat::RGBA8UnormSrgb, 1, 1, pData);
+                }
+                else if(frameId != mStreamTextureFrameId)
+                {
+                    mpStreamTexture->uploadSubresourceData(pData, mpStream->width * mpStream->height * 4);
+                }
+                mStreamTextureFrameId = frameId;
+            }
+            return mpStreamTexture;
+        }
+
         // Flush the async operation, upload everything to video memory
         if(mAsyncDecoding)
         {
@@ -288,6 +387,11 @@ namespace Falcor
 
     float VideoDecoder::getDuration()
     {
+        if(mpStream)
+        {
+            return (float)mpStream->duration;
+        }
+
         // Flush the async operation, upload everything to video memory
         if(mAsyncDecoding)
         {
@@ -309,6 +413,399 @@ namespace Falcor
         mFrameTextures = texturePool;
     }
 
+    uint32_t VideoDecoder::getWidth() const
+    {
+        return mpCodecCtx ? mpCodecCtx->width : 0;
+    }
+
+    uint32_t VideoDecoder::getHeight() const
+    {
+        return mpCodecCtx ? mpCodecCtx->height : 0;
+    }
+
+    VideoDecoder::UniquePtr VideoDecoder::createStreaming(const std::string& filename, const StreamingDesc& desc)
+    {
+        auto pVideo = UniquePtr(new VideoDecoder());
+        pVideo->mFilename = filename;
+        pVideo->mpStream = std::make_unique<StreamingState>();
+        if(pVideo->openFile() == false)
+        {
+            Logger::log(Logger::Level::Error, "Can't open video file " + filename);
+            return nullptr;
+        }
+
+        StreamingState& stream = *pVideo->mpStream;
+        AVCodecContext* pCodecCtx = pVideo->mpCodecCtx;
+        AVStream* pAvStream = pVideo->mpFormatCtx->streams[pVideo->mVideoStream];
+        stream.desc = desc;
+        stream.width = pCodecCtx->width;
+        stream.height = pCodecCtx->height;
+        stream.timeBase = av_q2d(pAvStream->time_base);
+        stream.startPts = (pAvStream->start_time != AV_NOPTS_VALUE) ? pAvStream->start_time : 0;
+        stream.frameDuration = (pVideo->mFPS > 0) ? 1.0 / pVideo->mFPS : 1.0 / 30.0;
+        if(pAvStream->duration != AV_NOPTS_VALUE)
+        {
+            stream.duration = pAvStream->duration * stream.timeBase;
+        }
+        else if(pVideo->mpFormatCtx->duration != AV_NOPTS_VALUE)
+        {
+            stream.duration = double(pVideo->mpFormatCtx->duration) / AV_TIME_BASE;
+        }
+
+        stream.pSwsCtx = sws_getContext(pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt, pCodecCtx->width, pCodecCtx->height, PIX_FMT_RGBA, SWS_BILINEAR, NULL, NULL, NULL);
+        if(stream.pSwsCtx == nullptr)
+        {
+            Logger::log(Logger::Level::Error, "Can't create the color conversion context for video file " + filename);
+            return nullptr;
+        }
+
+        // One slot is presented and one is being decoded, the rest are queued ahead of the playhead
+        uint32_t ringSize = max(desc.ringFrameCount, 1u);
+        for(uint32_t i = 0; i < ringSize + 2; i++)
+        {
+            stream.slots.push_back(std::make_unique<StreamingState::Slot>(pCodecCtx));
+        }
+        stream.stats.ringSize = ringSize;
+
+        stream.thread = std::thread(&VideoDecoder::streamingLoop, pVideo.get());
+        return pVideo;
+    }
+
+    double VideoDecoder::getFrameTime()
+    {
+        int64_t pts = av_frame_get_best_effort_timestamp(mpFrame);
+        if(pts == AV_NOPTS_VALUE)
+        {
+            // Assume a constant frame rate
+            std::lock_guard<std::mutex> lock(mpStream->mutex);
+            return mpStream->lastDecodedTime + mpStream->frameDuration;
+        }
+        return double(pts - mpStream->startPts) * mpStream->timeBase;
+    }
+
+    bool VideoDecoder::decodeNextFrame()
+    {
+        while(true)
+        {
+            AVPacket packet;
+            if(av_read_frame(mpFormatCtx, &packet) < 0)
+            {
+                // End of file. Drain the frames the decoder delayed, one per call
+                AVPacket flushPacket;
+                av_init_packet(&flushPacket);
+                flushPacket.data = nullptr;
+                flushPacket.size = 0;
+                int32_t isFrameDone = 0;
+                avcodec_decode_video2(mpCodecCtx, mpFrame, &isFrameDone, &flushPacket);
+                return isFrameDone != 0;
+            }
+
+            int32_t isFrameDone = 0;
+            if(packet.stream_index == mVideoStream)
+            {
+                avcodec_decode_video2(mpCodecCtx, mpFrame, &isFrameDone, &packet);
+            }
+            av_free_packet(&packet);
+
+            if(isFrameDone)
+            {
+                return true;
+            }
+        }
+    }
+
+    void VideoDecoder::seekFile(double time)
+    {
+        int64_t timestamp = mpStream->startPts + int64_t(time / mpStream->timeBase);
+        if(av_seek_frame(mpFormatCtx, mVideoStream, timestamp, AVSEEK_FLAG_BACKWARD) < 0)
+        {
+            Logger::log(Logger::Level::Warning, "Seeking failed in video file " + mFilename);
+        }
+        avcodec_flush_buffers(mpCodecCtx);
+    }
+
+    void VideoDecoder::streamingLoop()
+    {
+        setThreadPriority(getCurrentThread(), ThreadPriorityType::Low);
+
+        StreamingState& stream = *mpStream;
+        const double kEpsilon = 1e-4;
+        uint64_t generation = 0;
+        double skipUntil = 0;   // Frames which end before this time are skipped without counting them as dropped. Used when seeking
+        bool endOfStream = false;
+
+        while(true)
+        {
+            // Wait for a free slot or a request
+            bool seekRequested = false;
+            double seekTime = 0;
+            double playheadTime = 0;
+            {
+                std::unique_lock<std::mutex> lock(stream.mutex);
+                stream.slotFreedCondition.wait(lock, [&]
+                {
+                    if(stream.stop || stream.seekGeneration != generation)
+                    {
+                        return true;
+                    }
+                    if(endOfStream)
+                    {
+                        return false;
+                    }
+                    for(const auto& pSlot : stream.slots)
+                    {
+                        if(pSlot->state == StreamingState::SlotState::Free)
+                        {
+                            return true;
+                        }
+                    }
+                    return false;
+                });
+
+                if(stream.stop)
+                {
+                    return;
+                }
+
+                if(stream.seekGeneration != generation)
+                {
+                    generation = stream.seekGeneration;
+                    seekRequested = true;
+                    seekTime = stream.seekTime;
+                }
+                playheadTime = stream.playheadTime;
+            }
+
+            if(seekRequested)
+            {
+                seekFile(seekTime);
+                skipUntil = seekTime;
+                endOfStream = false;
+                continue;
+            }
+
+            if(decodeNextFrame() == false)
+            {
+                endOfStream = true;
+                {
+                    std::lock_guard<std::mutex> lock(stream.mutex);
+                    stream.endOfStream = (stream.seekGeneration == generation);
+                    stream.stats.endOfStream = stream.endOfStream;
+                }
+                stream.frameReadyCondition.notify_all();
+                continue;
+            }
+
+            double time = getFrameTime();
+            StreamingState::Slot* pSlot = nullptr;
+            {
+                std::lock_guard<std::mutex> lock(stream.mutex);
+                stream.lastDecodedTime = time;
+                stream.stats.decodedFrames++;
+
+                if(time + stream.frameDuration <= skipUntil + kEpsilon)
+                {
+                    // Decoding through to the seek target
+                    continue;
+                }
+
+                if(time + stream.frameDuration <= playheadTime + kEpsilon)
+                {
+                    // Playback outran the decoder. Skip the conversion of frames which will never be shown
+                    stream.stats.droppedFrames++;
+                    continue;
+                }
+
+                for(const auto& p : stream.slots)
+                {
+                    if(p->state == StreamingState::SlotState::Free)
+                    {
+                        pSlot = p.get();
+                        break;
+                    }
+                }
+                assert(pSlot);
+                pSlot->state = StreamingState::SlotState::Decoding;
+            }
+
+            // Convert to RGBA. Flipping is done by writing the rows bottom->top with a negative stride
+            AVFrame* pRGB = pSlot->frame.mpFrameRGB;
+            uint8_t* pDst = pRGB->data[0];
+            int32_t dstStride = pRGB->linesize[0];
+            if(stream.desc.flipY)
+            {
+                pDst += size_t(stream.height - 1) * dstStride;
+                dstStride = -dstStride;
+            }
+            sws_scale(stream.pSwsCtx, (uint8_t const * const *)mpFrame->data, mpFrame->linesize, 0, stream.height, &pDst, &dstStride);
+
+            {
+                std::lock_guard<std::mutex> lock(stream.mutex);
+                if(stream.seekGeneration == generation)
+                {
+                    pSlot->state = StreamingState::SlotState::Ready;
+                    pSlot->time = time;
+                    pSlot->id = stream.nextFrameId++;
+                }
+                else
+                {
+                    // A seek was requested while converting
+                    pSlot->state = StreamingState::SlotState::Free;
+                }
+            }
+            stream.frameReadyCondition.notify_all();
+        }
+    }
+
+    void VideoDecoder::requestSeek(double time)
+    {
+        // The caller holds the lock
+        StreamingState& stream = *mpStream;
+        for(auto& pSlot : stream.slots)
+        {
+            if(pSlot->state == StreamingState::SlotState::Ready)
+            {
+                pSlot->state = StreamingState::SlotState::Free;
+            }
+        }
+        stream.seekGeneration++;
+        stream.seekTime = time;
+        stream.windowStart = time;
+        stream.lastDecodedTime = time;
+        stream.endOfStream = false;
+        stream.stats.endOfStream = false;
+        stream.stats.seekCount++;
+    }
+
+    void VideoDecoder::seek(float time)
+    {
+        if(mpStream == nullptr)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mpStream->mutex);
+            mpStream->playheadTime = time;
+            requestSeek(time);
+        }
+        mpStream->slotFreedCondition.notify_one();
+    }
+
+    const uint8_t* VideoDecoder::getFrameDataForTime(float time, bool wait)
+    {
+        if(mpStream == nullptr)
+        {
+            return nullptr;
+        }
+
+        StreamingState& stream = *mpStream;
+        const double kEpsilon = 1e-4;
+        double t = max((double)time, 0.0);
+        if(stream.duration > 0)
+        {
+            // Either wrap around, or hold the last frame
+            t = stream.desc.loop ? fmod(t, stream.duration) : min(t, max(stream.duration - stream.frameDuration, 0.0));
+        }
+
+        std::unique_lock<std::mutex> lock(stream.mutex);
+        stream.playheadTime = t;
+
+        // Moving backwards, or too far ahead of the decoder
+        if((t < stream.windowStart - kEpsilon) || (t > max(stream.lastDecodedTime, stream.windowStart) + stream.desc.seekThreshold))
+        {
+            requestSeek(t);
+            stream.slotFreedCondition.notify_one();
+        }
+
+        StreamingState::Slot* pInitialFrame = stream.pPresented;
+        while(true)
+        {
+            // Find the latest queued frame which starts before the playhead
+            StreamingState::Slot* pBest = nullptr;
+            for(const auto& pSlot : stream.slots)
+            {
+                if(pSlot->state == StreamingState::SlotState::Ready && (pSlot->time <= t + kEpsilon) && (pBest == nullptr || pSlot->time > pBest->time))
+                {
+                    pBest = pSlot.get();
+                }
+            }
+
+            bool hasQueuedFrames = false;
+            if(pBest)
+            {
+                // Everything older than the new frame was skipped
+                for(auto& pSlot : stream.slots)
+                {
+                    if(pSlot->state == StreamingState::SlotState::Ready && pSlot->time < pBest->time)
+                    {
+                        pSlot->state = StreamingState::SlotState::Free;
+                        stream.stats.droppedFrames++;
+                    }
+                }
+
+                if(stream.pPresented)
+                {
+                    stream.pPresented->state = StreamingState::SlotState::Free;
+                    if(stream.pPresented != pInitialFrame)
+                    {
+                        // Presented while waiting in this call, but never returned
+                        stream.stats.droppedFrames++;
+                    }
+                }
+                pBest->state = StreamingState::SlotState::Presented;
+                stream.pPresented = pBest;
+                stream.windowStart = pBest->time;
+                stream.slotFreedCondition.notify_one();
+            }
+
+            for(const auto& pSlot : stream.slots)
+            {
+                hasQueuedFrames = hasQueuedFrames || (pSlot->state == StreamingState::SlotState::Ready);
+            }
+
+            // Check if the presented frame covers the playhead. It doesn't after seeking. If there are queued frames after it, there's a gap in the stream and the presented frame stays up
+            bool isDue = (stream.pPresented == nullptr) || (t < stream.pPresented->time - kEpsilon) || (t >= stream.pPresented->time + stream.frameDuration - kEpsilon);
+            if(isDue == false || hasQueuedFrames || stream.endOfStream)
+            {
+                break;
+            }
+
+            if(wait == false)
+            {
+                stream.stats.lateFrames++;
+                break;
+            }
+            stream.frameReadyCondition.wait(lock);
+        }
+
+        if(stream.pPresented != pInitialFrame)
+        {
+            stream.stats.presentedFrames++;
+        }
+
+        return stream.pPresented ? stream.pPresented->frame.mpFrameRGB->data[0] : nullptr;
+    }
+
+    VideoDecoder::StreamingStats VideoDecoder::getStreamingStats() const
+    {
+        StreamingStats stats;
+        if(mpStream)
+        {
+            std::lock_guard<std::mutex> lock(mpStream->mutex);
+            stats = mpStream->stats;
+            stats.queuedFrames = 0;
+            for(const auto& pSlot : mpStream->slots)
+            {
+                if(pSlot->state == StreamingState::SlotState::Ready)
+                {
+                    stats.queuedFrames++;
+                }
+            }
+        }
+        return stats;
+    }
+
     VideoDecoder::Frame::Frame(AVCodecContext* codec)
     {
         mFrameSize = avpicture_get_size(PIX_FMT_RGBA, codec->width, codec->height);
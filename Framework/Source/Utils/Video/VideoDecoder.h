@@ -42,8 +42,9 @@ struct AVRational;
 namespace Falcor
 {        
     /** Simple video decoder for high-framerate and high-resolution
-    playback of rendered videos. Currently decodes the first N frames
-    as textures before playing.
+    playback of rendered videos. Has two modes:
+    - Buffered (create()). Decodes the first N frames as textures before playing.
+    - Streaming (createStreaming()). A decode thread keeps a fixed-size ring of CPU frames filled ahead of the playhead, so memory doesn't depend on the clip length.
     */
     class VideoDecoder
     {
@@ -54,14 +55,69 @@ namespace Falcor
         typedef std::vector<Texture::SharedPtr> TexturePool;
         typedef std::shared_ptr<TexturePool> TexturePoolPtr;
 
+        /** Streaming mode settings
+        */
+        struct StreamingDesc
+        {
+            uint32_t ringFrameCount = 8;    ///< Number of frames decoded ahead of the playhead
+            float seekThreshold = 1.0f;     ///< If the playhead is more than this many seconds ahead of the decoder, seek instead of decoding through
+            bool loop = true;               ///< Wrap the playback time around the video duration
+            bool flipY = true;              ///< Store the rows bottom->top, the way GL textures expect them
+        };
+
+        /** Streaming mode statistics
+        */
+        struct StreamingStats
+        {
+            uint32_t ringSize = 0;          ///< Number of frames which can be queued ahead of the playhead
+            uint32_t queuedFrames = 0;      ///< Number of frames currently queued ahead of the playhead
+            uint64_t decodedFrames = 0;     ///< Frames decoded, including frames skipped while seeking
+            uint64_t presentedFrames = 0;   ///< Frames returned to the user
+            uint64_t droppedFrames = 0;     ///< Frames discarded because the playhead already passed them
+            uint64_t lateFrames = 0;        ///< Number of times a newer frame was due, but the decoder didn't have it ready
+            uint64_t seekCount = 0;
+            bool endOfStream = false;       ///< The decoder reached the end of the file
+        };
+
         /** create a new videoplay object
             \param[in] filename Input video file (with path)
             \param[in] bufferFrames The maximum number of input frames to buffer as Texture objects. Default is 300.
         */
         static UniquePtr create(const std::string& filename, uint32_t bufferedFrames = 300, bool async = false);
+
+        /** Create a streaming decoder. The file is opened immediately, decoding starts on a background thread.
+            \param[in] filename Input video file (with path)
+            \param[in] desc Streaming settings
+            \return A new object, or nullptr if the file couldn't be opened
+        */
+        static UniquePtr createStreaming(const std::string& filename, const StreamingDesc& desc);
         ~VideoDecoder();
 
-        /** Get a texture object for the frame at current time
+        /** Streaming mode only. Get the RGBA8 data of the frame which should be displayed at the given time. Doesn't touch the GPU.
+            Frames the playhead passed are dropped. Moving backwards or jumping far ahead seeks.
+            \param[in] time Playback time in seconds
+            \param[in] wait If true and the decoder is behind, blocks until the frame is decoded. Otherwise returns the last frame
+            \return The frame data, with a row pitch of getWidth()*4. Valid until the next call. nullptr if no frame was decoded yet
+        */
+        const uint8_t* getFrameDataForTime(float time, bool wait = false);
+
+        /** Streaming mode only. Restart decoding from the frame which covers the given time.
+        */
+        void seek(float time);
+
+        /** Streaming mode only. Get the ring occupancy and frame statistics
+        */
+        StreamingStats getStreamingStats() const;
+
+        /** Get the frame width
+        */
+        uint32_t getWidth() const;
+
+        /** Get the frame height
+        */
+        uint32_t getHeight() const;
+
+        /** Get a texture object for the frame at current time. In streaming mode, the frame is uploaded into a texture which is reused between calls
             \param[in] curTime Time for which frame is sought
             \return Texture pointer to texture object
         */
@@ -99,6 +155,15 @@ namespace Falcor
         VideoDecoder();
 
         void uploadToGPU(int frameStart = 0);
+        bool openFile();
+
+        // Streaming mode
+        struct StreamingState;
+        void streamingLoop();
+        bool decodeNextFrame();
+        void seekFile(double time);
+        void requestSeek(double time);
+        double getFrameTime();
 
         std::string mFilename;
 
@@ -119,6 +184,10 @@ namespace Falcor
 
         TexturePoolPtr                          mFrameTextures;
 
+        std::unique_ptr<StreamingState>         mpStream;
+        Texture::SharedPtr                      mpStreamTexture;
+        uint64_t                                mStreamTextureFrameId = 0;
+
         // helper routines
         void  bufferFrames();
         float rationalToFloat(const AVRational& r);
@@ -108,7 +108,7 @@ namespace Falcor
         return false;
     }
 
-    AVStream* createVideoStream(AVFormatContext* pCtx, uint32_t width, uint32_t height, uint32_t fps, float bitrateMbps, uint32_t gopSize, AVCodecID codecID, const std::string& filename, AVCodec** ppCodec)
+    AVStream* createVideoStream(AVFormatContext* pCtx, uint32_t width, uint32_t height, uint32_t fps, float bitrateMbps, uint32_t gopSize, uint32_t threadCount, AVCodecID codecID, const std::string& filename, AVCodec** ppCodec)
     {
         // Get the encoder
         *ppCodec = avcodec_find_encoder(codecID);
@@ -137,6 +137,10 @@ namespace Falcor
         pCodecCtx->gop_size = gopSize;
         pCodecCtx->pix_fmt = getPictureFormatFromCodec(codecID);
 
+        // Let the codec encode using multiple threads. Frame threading delays the output, so the codec has to be flushed at the end
+        pCodecCtx->thread_count = threadCount;
+        pCodecCtx->thread_type = FF_THREAD_FRAME | FF_THREAD_SLICE;
+
         // Some formats want stream headers to be separate.
         if(pCtx->oformat->flags & AVFMT_GLOBALHEADER)
         {
@@ -249,7 +253,7 @@ namespace Falcor
 
         // create the video codec
         AVCodec* pVideoCodec;
-        mpOutputStream = createVideoStream(mpOutputContext, desc.width, desc.height, desc.fps, desc.bitrateMbps, desc.gopSize, pOutputFormat->video_codec, mFilename, &pVideoCodec);
+        mpOutputStream = createVideoStream(mpOutputContext, desc.width, desc.height, desc.fps, desc.bitrateMbps, desc.gopSize, desc.codecThreadCount, pOutputFormat->video_codec, mFilename, &pVideoCodec);
         if(mpOutputStream == nullptr)
         {
             return false;
@@ -293,10 +297,7 @@ namespace Falcor
 
         mForamt = desc.format;
         mRowPitch = getInputFormatBytesPerPixel(desc.format) * desc.width;
-        if(desc.flipY)
-        {
-            mpFlippedImage = new uint8_t[desc.height * mRowPitch];
-        }
+        mFlipY = desc.flipY;
 
         AVPixelFormat pixFormat = getPictureFormatFromCodec(pOutputFormat->video_codec);
 
@@ -305,11 +306,36 @@ namespace Falcor
         {
             return error(mFilename, "Failed to allocate SWScale context");
         }
+
+        // Allocate the frame queue. There's one more buffer than the queue size, for the frame being encoded
+        mMaxQueuedFrames = max(desc.maxQueuedFrames, 1u);
+        mQueuePolicy = desc.queuePolicy;
+        for(uint32_t i = 0; i < mMaxQueuedFrames + 1; i++)
+        {
+            mFramePool.push_back(std::make_unique<QueuedFrame>());
+            mFramePool.back()->data.resize(size_t(desc.height) * mRowPitch);
+            mFreeFrames.push_back(mFramePool.back().get());
+        }
+        mStats.allocatedFrames = (uint32_t)mFramePool.size();
+
+        mEncoderThread = std::thread(&VideoEncoder::encoderLoop, this);
         return true;
     }
 
     void VideoEncoder::endCapture()
     {
+        if(mEncoderThread.joinable())
+        {
+            // Let the encoder thread drain the queue, then push out the frames the codec is still holding on to
+            {
+                std::lock_guard<std::mutex> lock(mQueueMutex);
+                mStopEncoder = true;
+            }
+            mFrameQueuedCondition.notify_one();
+            mEncoderThread.join();
+            flushCodec();
+        }
+
         if(mpOutputStream)
         {
             avcodec_close(mpOutputStream->codec);
@@ -337,26 +363,103 @@ namespace Falcor
             sws_freeContext(mpSwsContext);
             mpSwsContext = nullptr;
         }
-        safe_delete(mpFlippedImage)
     }
 
-    void VideoEncoder::appendFrame(const void* pData)
+    bool VideoEncoder::appendFrame(const void* pData)
+    {
+        if(mEncoderThread.joinable() == false)
+        {
+            return false;
+        }
+
+        QueuedFrame* pFrame = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(mQueueMutex);
+            mStats.submittedFrames++;
+            if(mFreeFrames.empty())
+            {
+                switch(mQueuePolicy)
+                {
+                case QueuePolicy::Block:
+                    mFrameFreedCondition.wait(lock, [this] { return mFreeFrames.empty() == false; });
+                    break;
+                case QueuePolicy::DropFrame:
+                    mStats.droppedFrames++;
+                    return false;
+                case QueuePolicy::Grow:
+                    mFramePool.push_back(std::make_unique<QueuedFrame>());
+                    mFramePool.back()->data.resize(mFramePool.front()->data.size());
+                    mFreeFrames.push_back(mFramePool.back().get());
+                    mStats.allocatedFrames = (uint32_t)mFramePool.size();
+                    break;
+                default:
+                    should_not_get_here();
+                }
+            }
+            pFrame = mFreeFrames.back();
+            mFreeFrames.pop_back();
+        }
+
+        // The buffer is owned by this thread until it's queued, so copy outside the lock
+        memcpy(pFrame->data.data(), pData, pFrame->data.size());
+        pFrame->submitTime = Clock::now();
+
+        {
+            std::lock_guard<std::mutex> lock(mQueueMutex);
+            mQueuedFrames.push_back(pFrame);
+            mStats.queuedFrames = (uint32_t)mQueuedFrames.size();
+            mStats.peakQueuedFrames = max(mStats.peakQueuedFrames, mStats.queuedFrames);
+        }
+        mFrameQueuedCondition.notify_one();
+        return true;
+    }
+
+    void VideoEncoder::encoderLoop()
     {
-        if(mpFlippedImage)
+        while(true)
         {
-            // Flip the image
-            for(int32_t h = 0; h < mpOutputStream->codec->height; h++)
+            QueuedFrame* pFrame = nullptr;
+            {
+                std::unique_lock<std::mutex> lock(mQueueMutex);
+                mFrameQueuedCondition.wait(lock, [this] { return mStopEncoder || (mQueuedFrames.empty() == false); });
+                if(mQueuedFrames.empty())
+                {
+                    // Stop was requested and all the frames were encoded
+                    return;
+                }
+                pFrame = mQueuedFrames.front();
+                mQueuedFrames.pop_front();
+                mStats.queuedFrames = (uint32_t)mQueuedFrames.size();
+            }
+
+            encodeFrame(pFrame->data.data());
+            double latencyMs = std::chrono::duration<double, std::milli>(Clock::now() - pFrame->submitTime).count();
+
             {
-                const uint8_t* pSrc = (uint8_t*)pData + h * mRowPitch;
-                uint8_t* pDst = mpFlippedImage + (mpOutputStream->codec->height - 1 - h) * mRowPitch;
-                memcpy(pDst, pSrc, mRowPitch);
+                std::lock_guard<std::mutex> lock(mQueueMutex);
+                mFreeFrames.push_back(pFrame);
+                mStats.encodedFrames++;
+                mTotalLatencyMs += latencyMs;
+                mStats.averageLatencyMs = mTotalLatencyMs / double(mStats.encodedFrames);
+                mStats.maxLatencyMs = max(mStats.maxLatencyMs, latencyMs);
             }
+            mFrameFreedCondition.notify_one();
+        }
+    }
 
-            pData = mpFlippedImage;
+    void VideoEncoder::encodeFrame(const uint8_t* pData)
+    {
+        const uint8_t* pSrc = pData;
+        int32_t srcStride = (int32_t)mRowPitch;
+        if(mFlipY)
+        {
+            // Flip for free by walking the rows bottom->top with a negative stride
+            pSrc += size_t(mpOutputStream->codec->height - 1) * mRowPitch;
+            srcStride = -srcStride;
         }
 
         // Convert input data to YUV
-        sws_scale(mpSwsContext, (uint8_t**)&pData, (int32_t*)&mRowPitch, 0, mpOutputStream->codec->height, mpYUVPicture->data, mpYUVPicture->linesize);
+        sws_scale(mpSwsContext, &pSrc, &srcStride, 0, mpOutputStream->codec->height, mpYUVPicture->data, mpYUVPicture->linesize);
 
         // Initialize the packet
         AVPacket packet = {0};
@@ -373,18 +476,60 @@ namespace Falcor
         // If the size of the frame is zero, the frame was buffered
         if(gotPacket && (packet.size > 0))
         {
-            // Write the frame to the file
-            packet.stream_index = mpOutputStream->index;
-            if(av_interleaved_write_frame(mpOutputContext, &packet) < 0)
-            {
-                error(mFilename, "Failed when writing encoded frame to file");
-            }
+            writePacket(packet);
         }
 
         mFrameCount++;
         mpFrame->pts += av_rescale_q(1, mpOutputStream->codec->time_base, mpOutputStream->time_base);
     }
 
+    void VideoEncoder::flushCodec()
+    {
+        if((mpOutputStream->codec->codec->capabilities & CODEC_CAP_DELAY) == 0)
+        {
+            return;
+        }
+
+        // Passing a null frame returns the delayed packets, one at a time
+        while(true)
+        {
+            AVPacket packet = {0};
+            av_init_packet(&packet);
+            int32_t gotPacket = 0;
+            if(avcodec_encode_video2(mpOutputStream->codec, &packet, nullptr, &gotPacket) < 0)
+            {
+                error(mFilename, "Can't flush the video encoder");
+                return;
+            }
+
+            if(gotPacket == 0)
+            {
+                return;
+            }
+
+            if(writePacket(packet) == false)
+            {
+                return;
+            }
+        }
+    }
+
+    bool VideoEncoder::writePacket(AVPacket& packet)
+    {
+        packet.stream_index = mpOutputStream->index;
+        if(av_interleaved_write_frame(mpOutputContext, &packet) < 0)
+        {
+            return error(mFilename, "Failed when writing encoded frame to file");
+        }
+        return true;
+    }
+
+    VideoEncoder::Stats VideoEncoder::getStats() const
+    {
+        std::lock_guard<std::mutex> lock(mQueueMutex);
+        return mStats;
+    }
+
     const std::string VideoEncoder::getSupportedContainerForCodec(CodecID codec)
     {
         const std::string AVI = std::string("AVI (Audio Video Interleaved)") + '\0' + "*.avi" + '\0';
@@ -27,12 +27,19 @@
 ***************************************************************************/
 #pragma once
 #include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
 
 struct AVFormatContext;
 struct AVStream;
 struct AVFrame;
 struct AVPicture;
 struct SwsContext;
+struct AVPacket;
 
 namespace Falcor
 {        
@@ -56,6 +63,15 @@ namespace Falcor
             R8G8B8A8,
         };
 
+        /** What appendFrame() does when the encoder thread falls behind and the frame queue is full
+        */
+        enum class QueuePolicy
+        {
+            Block,      ///< Wait until the encoder thread frees a slot. No frames are lost, but the render thread stalls
+            DropFrame,  ///< Discard the new frame. The video will skip frames
+            Grow,       ///< Allocate another frame buffer. Memory usage is unbounded
+        };
+
         struct Desc
         {
             uint32_t fps = 60;
@@ -67,18 +83,58 @@ namespace Falcor
             InputFormat format = InputFormat::R8G8B8A8;
             bool flipY = false;
             std::string filename;
+            uint32_t maxQueuedFrames = 4;                   ///< Number of frames which can wait for the encoder thread
+            QueuePolicy queuePolicy = QueuePolicy::Block;   ///< What to do when the queue is full
+            uint32_t codecThreadCount = 0;                  ///< Number of threads the codec uses internally. 0 lets the codec decide
+        };
+
+        /** Encoding statistics. Latency is measured from appendFrame() until the encoder thread finished encoding the frame
+        */
+        struct Stats
+        {
+            uint32_t queuedFrames = 0;          ///< Frames currently waiting for the encoder thread
+            uint32_t peakQueuedFrames = 0;      ///< Highest number of frames waiting at once
+            uint32_t allocatedFrames = 0;       ///< Number of frame buffers, queued or free
+            uint64_t submittedFrames = 0;
+            uint64_t encodedFrames = 0;
+            uint64_t droppedFrames = 0;
+            double averageLatencyMs = 0;
+            double maxLatencyMs = 0;
         };
 
         ~VideoEncoder();
 
         static UniquePtr create(const Desc& desc);
-        void appendFrame(const void* pData);
+
+        /** Queue a frame for encoding. The data is copied, so the buffer can be reused as soon as the function returns.
+            eturn false if the frame was dropped, otherwise true
+        */
+        bool appendFrame(const void* pData);
+
+        /** Encode all the queued frames, flush the codec and close the file. Blocks until done
+        */
         void endCapture();
 
+        /** Get the encoding statistics. Can be called from any thread
+        */
+        Stats getStats() const;
+
         static const std::string getSupportedContainerForCodec(CodecID codec);
     private:
         VideoEncoder(const std::string& filename);
         bool init(const Desc& desc);
+        void encoderLoop();
+        void encodeFrame(const uint8_t* pData);
+        void flushCodec();
+        bool writePacket(AVPacket& packet);
+
+        using Clock = std::chrono::high_resolution_clock;
+
+        struct QueuedFrame
+        {
+            std::vector<uint8_t> data;
+            Clock::time_point submitTime;
+        };
 
         AVFormatContext* mpOutputContext = nullptr;
         AVStream*        mpOutputStream  = nullptr;
@@ -90,6 +146,20 @@ namespace Falcor
         InputFormat mForamt;
         uint32_t mRowPitch = 0;
         uint32_t mFrameCount = 0;
-        uint8_t* mpFlippedImage = nullptr; // Used in case the image memory layout if bottom->top
+        bool mFlipY = false;    // The image memory layout is bottom->top
+
+        // The render thread fills frames from the free list and pushes them into the queue. The encoder thread encodes them and returns them to the free list
+        std::thread mEncoderThread;
+        mutable std::mutex mQueueMutex;
+        std::condition_variable mFrameQueuedCondition;
+        std::condition_variable mFrameFreedCondition;
+        std::deque<QueuedFrame*> mQueuedFrames;
+        std::vector<QueuedFrame*> mFreeFrames;
+        std::vector<std::unique_ptr<QueuedFrame>> mFramePool;
+        uint32_t mMaxQueuedFrames = 0;
+        QueuePolicy mQueuePolicy = QueuePolicy::Block;
+        bool mStopEncoder = false;
+        Stats mStats;
+        double mTotalLatencyMs = 0;
     };
 }
\ No newline at end of file
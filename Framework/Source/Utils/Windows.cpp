@@ -36,6 +36,7 @@
 #include <shlobj.h>   
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <mutex>
 
 // Always run in Optimus mode on laptops
 extern "C"
@@ -153,6 +154,26 @@ namespace Falcor
         std::string(getExecutableDirectory() + "\\..\\..\\..\\Media"),
     };
 
+    // Shaders are pre-processed on worker threads, so the lookups can run concurrently with each other and with addDataDirectory()
+    static std::mutex gDataDirectoriesMutex;
+
+    static std::vector<std::string> copyDataDirectories()
+    {
+        std::lock_guard<std::mutex> lock(gDataDirectoriesMutex);
+        static bool bInit = false;
+        if(bInit == false)
+        {
+            std::string dataDirs;
+            if(getEnvironemntVariable("FALCOR_MEDIA_FOLDERS", dataDirs))
+            {
+                auto folders = splitString(dataDirs, ";");
+                gDataDirectories.insert(gDataDirectories.end(), folders.begin(), folders.end());
+            }
+            bInit = true;
+        }
+        return gDataDirectories;
+    }
+
     const std::vector<std::string>& getDataDirectoriesList()
     {
         return gDataDirectories;
@@ -161,6 +182,7 @@ namespace Falcor
     void addDataDirectory(const std::string& dataDir)
     {
         //Insert unique elements
+        std::lock_guard<std::mutex> lock(gDataDirectoriesMutex);
         if (std::find(gDataDirectories.begin(), gDataDirectories.end(), dataDir) == gDataDirectories.end()) 
         {
             gDataDirectories.push_back(dataDir);
@@ -178,17 +200,8 @@ namespace Falcor
 
     bool findFileInDataDirectories(const std::string& filename, std::string& fullpath)
     {
-        static bool bInit = false;
-        if(bInit == false)
-        {
-            std::string dataDirs;
-            if(getEnvironemntVariable("FALCOR_MEDIA_FOLDERS", dataDirs))
-            {
-                auto folders = splitString(dataDirs, ";");
-                gDataDirectories.insert(gDataDirectories.end(), folders.begin(), folders.end());
-            }
-            bInit = true;
-        }
+        // Search a copy of the list, so the file system isn't accessed while holding the lock
+        const std::vector<std::string> dataDirectories = copyDataDirectories();
 
         // Check if this is an absolute path
         if(doesFileExist(filename))
@@ -197,7 +210,7 @@ namespace Falcor
             return true;
         }
 
-        for(const auto& Dir : gDataDirectories)
+        for(const auto& Dir : dataDirectories)
         {
             fullpath = canonicalizeFilename(Dir + '\\' + filename);
             if(doesFileExist(fullpath))
@@ -320,7 +333,7 @@ namespace Falcor
     {
         std::string stripped = filename;
         std::string canonFile = canonicalizeFilename(filename);
-        for(const auto& dir : gDataDirectories)
+        for(const auto& dir : copyDataDirectories())
         {
             std::string canonDir = canonicalizeFilename(dir);
             if(hasPrefix(canonFile, canonDir, false))
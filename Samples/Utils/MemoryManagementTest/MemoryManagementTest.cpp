@@ -0,0 +1,550 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "MemoryManagementTest.h"
+#include "Utils/FrameRingAllocator.h"
+#include "Utils/ResidencyTracker.h"
+#include "Graphics/Paths/ObjectPath.h"
+#include <algorithm>
+
+namespace
+{
+    void check(bool condition, const std::string& desc, uint32_t& errors)
+    {
+        if(condition == false)
+        {
+            printf("    %s\n", desc.c_str());
+            errors++;
+        }
+    }
+
+    bool reportTest(const char* name, uint32_t errors)
+    {
+        if(errors)
+        {
+            printf("%-32s FAILED, %u errors\n", name, errors);
+        }
+        else
+        {
+            printf("%-32s passed\n", name);
+        }
+        return errors == 0;
+    }
+
+    // xorshift32. The tests must be reproducible, so they don't use rand()
+    class Random
+    {
+    public:
+        Random(uint32_t seed) : mState(seed * 2654435761u + 1) {}
+
+        uint32_t next()
+        {
+            mState ^= mState << 13;
+            mState ^= mState >> 17;
+            mState ^= mState << 5;
+            return mState;
+        }
+
+        // Returns a value in [minValue, maxValue]
+        uint32_t range(uint32_t minValue, uint32_t maxValue)
+        {
+            return minValue + next() % (maxValue - minValue + 1);
+        }
+
+    private:
+        uint32_t mState;
+    };
+
+    // The tracker only uses the resource pointers as keys, so the resources are just names
+    const char* kResources[] = {"A", "B", "C", "D", "E", "F"};
+
+    std::string getEvictedString(const std::vector<const void*>& evicted)
+    {
+        std::string s;
+        for(const void* pResource : evicted)
+        {
+            s += (const char*)pResource;
+        }
+        return s;
+    }
+
+    void checkEvicted(const std::vector<const void*>& evicted, const std::string& expected, const std::string& desc, uint32_t& errors)
+    {
+        std::string result = getEvictedString(evicted);
+        check(result == expected, desc + ": evicted '" + result + "', expected '" + expected + "'", errors);
+    }
+
+    // The streaming tests use a row of 1MB models along the X axis, 20 units apart, and a camera moving along the row
+    const uint32_t kRowModelCount = 100;
+    const uint64_t kRowModelBytes = 1 << 20;
+    const float kRowSpacing = 20;
+
+    StreamingScheduler::UniquePtr createRowScheduler(uint64_t budget, uint32_t maxPendingLoads, std::vector<uint64_t>& modelBytes)
+    {
+        std::vector<StreamingScheduler::Instance> instances;
+        for(uint32_t i = 0; i < kRowModelCount; i++)
+        {
+            StreamingScheduler::Instance instance;
+            instance.modelID = i;
+            instance.center = glm::vec3(i * kRowSpacing, 0, 0);
+            instance.radius = 5;
+            instances.push_back(instance);
+        }
+        modelBytes.assign(kRowModelCount, kRowModelBytes);
+
+        StreamingScheduler::Settings settings;
+        settings.cellSize = 50;
+        settings.loadDistance = 100;
+        settings.budget = budget;
+        settings.maxPendingLoads = maxPendingLoads;
+        return StreamingScheduler::create(modelBytes, instances, settings);
+    }
+
+    ObjectPath::SharedPtr createPath(const std::vector<float>& positions, float secondsPerKeyFrame)
+    {
+        ObjectPath::SharedPtr pPath = ObjectPath::create();
+        pPath->setInterpolationMode(ObjectPath::Interpolation::Linear);
+        for(size_t i = 0; i < positions.size(); i++)
+        {
+            pPath->addKeyFrame(float(i) * secondsPerKeyFrame, glm::vec3(positions[i], 10, 0), glm::vec3(positions[i] + 1, 10, 0), glm::vec3(0, 1, 0));
+        }
+        return pPath;
+    }
+
+    // Check that every frame's results agree with each other and stay within the budget
+    void checkReplay(const StreamingScheduler::ReplayResults& results, const std::vector<uint64_t>& modelBytes, uint64_t budget, uint32_t& errors)
+    {
+        check(results.residentBytes.size() == results.frameCount && results.residency.size() == results.frameCount, "Replay results don't cover every frame", errors);
+        check(results.overBudgetFrames == 0, std::to_string(results.overBudgetFrames) + " frames over budget", errors);
+        check(budget == 0 || results.stats.peakBytes <= budget, "Peak memory " + std::to_string(results.stats.peakBytes) + " is over the budget", errors);
+
+        uint64_t peakResidentBytes = 0;
+        for(uint32_t frame = 0; frame < results.frameCount && errors == 0; frame++)
+        {
+            uint64_t residentBytes = 0;
+            uint32_t residentModels = 0;
+            for(size_t modelID = 0; modelID < modelBytes.size(); modelID++)
+            {
+                if(results.residency[frame][modelID])
+                {
+                    residentBytes += modelBytes[modelID];
+                    residentModels++;
+                }
+            }
+            check(residentBytes == results.residentBytes[frame] && residentModels == results.residentModels[frame], "Frame " + std::to_string(frame) + " resident bytes don't match the resident models", errors);
+            peakResidentBytes = max(peakResidentBytes, residentBytes);
+        }
+        check(peakResidentBytes <= results.stats.peakBytes, "Resident bytes " + std::to_string(peakResidentBytes) + " exceed the reported peak", errors);
+    }
+
+    bool isSameReplay(const StreamingScheduler::ReplayResults& a, const StreamingScheduler::ReplayResults& b)
+    {
+        return (a.residency == b.residency) && (a.stats.peakBytes == b.stats.peakBytes) && (a.stats.loadCount == b.stats.loadCount) && (a.stats.unloadCount == b.stats.unloadCount);
+    }
+}
+
+MemoryManagementTest::MemoryManagementTest(uint32_t stressFrames) : mStressFrames(stressFrames)
+{
+}
+
+uint32_t MemoryManagementTest::testRingWrapAround()
+{
+    uint32_t errors = 0;
+    const size_t kInvalid = FrameRingAllocator::kInvalidOffset;
+    FrameRingAllocator ring(256);
+
+    check(ring.allocate(100, 1) == 0, "First allocation isn't at offset 0", errors);
+    ring.endFrame(1);
+    check(ring.allocate(100, 1) == 100, "Second frame doesn't follow the first", errors);
+    ring.endFrame(2);
+    check(ring.allocate(100, 1) == kInvalid, "Allocation overlapping an in-flight frame succeeded", errors);
+
+    // The end of the range is too small. The allocation wraps around into the space of the released frame, and the skipped bytes are counted as used
+    ring.releaseCompletedFrames(1);
+    check(ring.allocate(100, 1) == 0, "Allocation didn't wrap around", errors);
+    check(ring.getUsedBytes() == 256, "Wrap-around padding isn't counted, used " + std::to_string(ring.getUsedBytes()), errors);
+    check(ring.getCurrentFrameBytes() == 156, "Wrap-around padding isn't counted in the frame, " + std::to_string(ring.getCurrentFrameBytes()), errors);
+    check(ring.allocate(1, 1) == kInvalid, "Allocation in a full ring succeeded", errors);
+    ring.endFrame(3);
+
+    // The free space is now between the head and the tail of the ring. The bytes skipped by the wrap-around belong to the current frame, so the tail is at 200
+    ring.releaseCompletedFrames(2);
+    check(ring.getUsedBytes() == 156, "Releasing a frame freed " + std::to_string(256 - ring.getUsedBytes()) + " bytes instead of 100", errors);
+    check(ring.allocate(64, 64) == 128, "Aligned allocation between the head and the tail", errors);
+    check(ring.allocate(9, 1) == kInvalid, "Allocation overlapping the tail succeeded", errors);
+    check(ring.allocate(8, 1) == 192, "Allocation ending at the tail", errors);
+    check(ring.allocate(1, 1) == kInvalid, "Allocation in a full ring succeeded", errors);
+    ring.endFrame(4);
+
+    // Once everything is released, the ring rewinds and the whole range is available
+    ring.releaseCompletedFrames(4);
+    check(ring.getUsedBytes() == 0, "Used bytes after releasing all frames", errors);
+    check(ring.allocate(256, 256) == 0, "Full-size allocation after releasing all frames", errors);
+    check(ring.allocate(257, 1) == kInvalid, "Allocation larger than the ring succeeded", errors);
+    check(ring.allocate(0, 1) == kInvalid, "Empty allocation succeeded", errors);
+    return errors;
+}
+
+uint32_t MemoryManagementTest::testRingFenceRelease()
+{
+    uint32_t errors = 0;
+    FrameRingAllocator ring(256);
+
+    ring.allocate(100, 1);
+    ring.endFrame(5);
+    ring.endFrame(6);   // A frame without allocations
+    ring.allocate(50, 1);
+    ring.endFrame(6);   // Frames can share a fence value
+    ring.allocate(50, 1);
+    ring.endFrame(9);
+
+    check(ring.getInFlightFrameCount() == 4, "In-flight frame count", errors);
+    check(ring.getOldestFrameFenceValue() == 5, "Oldest fence value", errors);
+
+    ring.releaseCompletedFrames(4);
+    check(ring.getInFlightFrameCount() == 4, "A frame was released before its fence completed", errors);
+
+    ring.releaseCompletedFrames(6);
+    check(ring.getInFlightFrameCount() == 1, "Frames with completed fences weren't all released", errors);
+    check(ring.getOldestFrameFenceValue() == 9, "Oldest fence value after the release", errors);
+    check(ring.getUsedBytes() == 50, "Used bytes after the release", errors);
+
+    ring.releaseCompletedFrames(8);
+    check(ring.getInFlightFrameCount() == 1, "A frame was released before its fence completed", errors);
+    ring.releaseCompletedFrames(9);
+    check(ring.getInFlightFrameCount() == 0, "Frame wasn't released", errors);
+    check(ring.getOldestFrameFenceValue() == 0, "Oldest fence value of an idle ring", errors);
+
+    // An empty frame closed before the ring rewinds holds an offset from before the rewind. Releasing it must not move the tail past the live allocations
+    ring.allocate(100, 1);
+    ring.endFrame(10);
+    ring.endFrame(11);
+    ring.releaseCompletedFrames(10);
+    check(ring.allocate(50, 1) == 0, "The ring didn't rewind when empty", errors);
+    ring.endFrame(12);
+    ring.releaseCompletedFrames(11);
+    check(ring.allocate(150, 1) == 50, "Allocation after the live frame", errors);
+    check(ring.allocate(100, 1) == FrameRingAllocator::kInvalidOffset, "Allocation overwrote a live frame after an empty frame was released", errors);
+    return errors;
+}
+
+uint32_t MemoryManagementTest::testRingStress()
+{
+    // Random allocations with random GPU latency. Every byte is tagged with the frame which owns it, to catch overlapping allocations
+    const size_t kCapacity = 4096;
+    const uint32_t kNoFrame = (uint32_t)-1;
+
+    uint32_t errors = 0;
+    Random random(1);
+    FrameRingAllocator ring(kCapacity);
+    std::vector<uint32_t> owner(kCapacity, kNoFrame);
+    std::vector<std::vector<std::pair<size_t, size_t>>> frameBlocks;
+    uint64_t completedFence = 0;
+    uint32_t wrapCount = 0;
+    uint32_t failedCount = 0;
+    size_t lastOffset = 0;
+
+    for(uint32_t frame = 0; frame < mStressFrames && errors < 10; frame++)
+    {
+        frameBlocks.push_back(std::vector<std::pair<size_t, size_t>>());
+        uint32_t allocationCount = random.range(0, 8);
+        for(uint32_t i = 0; i < allocationCount; i++)
+        {
+            size_t size = random.range(1, kCapacity / 4);
+            size_t alignment = size_t(1) << random.range(0, 8);
+            size_t offset = ring.allocate(size, alignment);
+            if(offset == FrameRingAllocator::kInvalidOffset)
+            {
+                failedCount++;
+                continue;
+            }
+
+            std::string block = "Frame " + std::to_string(frame) + ", block [" + std::to_string(offset) + ", " + std::to_string(offset + size) + ")";
+            check((offset % alignment) == 0, block + " isn't aligned to " + std::to_string(alignment), errors);
+            check(offset + size <= kCapacity, block + " is out of range", errors);
+            for(size_t b = offset; b < min(offset + size, kCapacity); b++)
+            {
+                if(owner[b] != kNoFrame)
+                {
+                    check(false, block + " overlaps frame " + std::to_string(owner[b]), errors);
+                    break;
+                }
+                owner[b] = frame;
+            }
+            frameBlocks[frame].push_back(std::make_pair(offset, size));
+            wrapCount += (offset < lastOffset) ? 1 : 0;
+            lastOffset = offset;
+        }
+
+        // Fence values are frame + 1. The GPU is up to 3 frames behind
+        ring.endFrame(frame + 1);
+        uint64_t fence = max(completedFence, uint64_t(frame + 1) - min<uint64_t>(frame + 1, random.range(0, 3)));
+        for(uint64_t f = completedFence; f < fence; f++)
+        {
+            for(const auto& block : frameBlocks[(size_t)f])
+            {
+                std::fill(owner.begin() + block.first, owner.begin() + min(block.first + block.second, kCapacity), kNoFrame);
+            }
+        }
+        completedFence = fence;
+        ring.releaseCompletedFrames(completedFence);
+
+        size_t liveBytes = kCapacity - std::count(owner.begin(), owner.end(), kNoFrame);
+        check(ring.getUsedBytes() >= liveBytes && ring.getUsedBytes() <= kCapacity, "Frame " + std::to_string(frame) + " used bytes " + std::to_string(ring.getUsedBytes()) + ", live bytes " + std::to_string(liveBytes), errors);
+        check(ring.getInFlightFrameCount() == frame + 1 - completedFence, "Frame " + std::to_string(frame) + " in-flight frame count", errors);
+    }
+
+    ring.releaseCompletedFrames(mStressFrames);
+    check(ring.getUsedBytes() == 0, "Used bytes after releasing all frames", errors);
+    check(ring.allocate(kCapacity, 1) == 0, "Full-size allocation after releasing all frames", errors);
+
+    // Make sure the test exercised the interesting cases
+    check(wrapCount > 0 || mStressFrames < 100, "The ring never wrapped around", errors);
+    check(failedCount > 0 || mStressFrames < 100, "The ring never ran out of space", errors);
+    return errors;
+}
+
+uint32_t MemoryManagementTest::testResidencyOrder()
+{
+    // A 1000 byte budget with a 10% hysteresis. Once over budget, resources are evicted until 900 bytes remain
+    uint32_t errors = 0;
+    const void* A = kResources[0];
+    const void* B = kResources[1];
+    const void* C = kResources[2];
+    const void* D = kResources[3];
+    const void* E = kResources[4];
+    ResidencyTracker tracker;
+    std::vector<const void*> evicted;
+
+    // Frame 1. Requests report whether the resource has to be made resident
+    check(tracker.markUsed(A, 300, 0), "First request of A", errors);
+    check(tracker.markUsed(B, 300, 0), "First request of B", errors);
+    check(tracker.markUsed(C, 300, 1), "First request of C", errors);
+    check(tracker.markUsed(A, 300, 0) == false, "Second request of A", errors);
+    check(tracker.getUsedBytes() == 900, "A resource used twice is counted twice", errors);
+    tracker.endFrame(1000, 0.1f, evicted);
+    checkEvicted(evicted, "", "Frame 1, within budget", errors);
+
+    // Frame 2 is over budget. A and B are equally old and have the same priority, A became resident first
+    tracker.markUsed(C, 300, 1);
+    tracker.markUsed(D, 300, 0);
+    tracker.endFrame(1000, 0.1f, evicted);
+    checkEvicted(evicted, "A", "Frame 2, equally old resources", errors);
+    check(tracker.getResidentBytes() == 900, "Frame 2 resident bytes " + std::to_string(tracker.getResidentBytes()), errors);
+
+    // Frame 3. B was last used in frame 1 and D in frame 2, but C has a higher priority than both
+    tracker.markUsed(E, 400, 0);
+    tracker.endFrame(1000, 0.1f, evicted);
+    checkEvicted(evicted, "BD", "Frame 3, priority then LRU", errors);
+    check(tracker.isTracked(C) && tracker.isTracked(E), "Frame 3 evicted the wrong resources", errors);
+
+    // Frame 4. An evicted resource becomes resident again when requested. The priority is updated by every request
+    check(tracker.markUsed(A, 300, 0), "Request of an evicted resource", errors);
+    tracker.markUsed(E, 400, 2);
+    tracker.endFrame(1000, 0.1f, evicted);
+    checkEvicted(evicted, "", "Frame 4, within budget", errors);
+
+    // Frame 5. C is now the lowest priority resource which wasn't used in this frame, and evicting it is enough. D was evicted, so it's added with its new size
+    tracker.markUsed(A, 300, 0);
+    tracker.markUsed(D, 200, 3);
+    tracker.endFrame(1000, 0.1f, evicted);
+    checkEvicted(evicted, "C", "Frame 5, updated priorities", errors);
+    return errors;
+}
+
+uint32_t MemoryManagementTest::testResidencyBudget()
+{
+    uint32_t errors = 0;
+    std::vector<const void*> evicted;
+
+    // Resources used in the current frame are never evicted, even over budget
+    ResidencyTracker tracker;
+    for(uint32_t i = 0; i < arraysize(kResources); i++)
+    {
+        tracker.markUsed(kResources[i], 100, 0);
+    }
+    tracker.endFrame(250, 0.1f, evicted);
+    checkEvicted(evicted, "", "Resources used in the current frame", errors);
+    check(tracker.getResidentBytes() == 600, "Resident bytes over budget", errors);
+    check(tracker.getUsedBytes() == 0, "Used bytes weren't reset by endFrame()", errors);
+
+    // The next frame only uses F. The hysteresis target is 225 bytes, so only F and E stay
+    tracker.markUsed(kResources[5], 100, 0);
+    tracker.endFrame(250, 0.1f, evicted);
+    checkEvicted(evicted, "ABCD", "Eviction down to the hysteresis target", errors);
+    check(tracker.getResidentCount() == 2 && tracker.getResidentBytes() == 200, "Resident resources after eviction", errors);
+
+    // Without hysteresis, eviction stops at the budget
+    ResidencyTracker exact;
+    for(uint32_t i = 0; i < arraysize(kResources); i++)
+    {
+        exact.markUsed(kResources[i], 100, 0);
+    }
+    exact.endFrame(0, 0.1f, evicted);
+    checkEvicted(evicted, "", "A zero budget disables eviction", errors);
+    exact.endFrame(300, 0, evicted);
+    checkEvicted(evicted, "ABC", "Eviction without hysteresis", errors);
+
+    // A resource removed by the caller stops counting
+    exact.remove(kResources[3]);
+    exact.remove(kResources[3]);
+    check(exact.getResidentBytes() == 200 && exact.isTracked(kResources[3]) == false, "Removing a resource", errors);
+    return errors;
+}
+
+uint32_t MemoryManagementTest::testStreamingBudget()
+{
+    // An 8MB budget. About 11 models are within the load distance at any time, so the budget limits the residency
+    uint32_t errors = 0;
+    const uint64_t kBudget = 8 * kRowModelBytes;
+    std::vector<uint64_t> modelBytes;
+    StreamingScheduler::UniquePtr pScheduler = createRowScheduler(kBudget, 4, modelBytes);
+    ObjectPath::SharedPtr pPath = createPath({0, kRowSpacing * (kRowModelCount - 1)}, 10);
+
+    StreamingScheduler::ReplayDesc desc;
+    StreamingScheduler::ReplayResults results;
+    check(StreamingScheduler::replayPath(pScheduler.get(), pPath.get(), desc, results), "Replay failed", errors);
+    check(results.frameCount == 601, "Replay frame count " + std::to_string(results.frameCount), errors);
+    checkReplay(results, modelBytes, kBudget, errors);
+
+    // The budget must be used, not just respected
+    check(results.stats.peakBytes == kBudget, "Peak memory " + std::to_string(results.stats.peakBytes) + " doesn't reach the budget", errors);
+
+    // On a one-way path, no model is loaded twice. The camera ends next to the last model
+    check(results.stats.loadCount <= kRowModelCount, std::to_string(results.stats.loadCount) + " loads for " + std::to_string(kRowModelCount) + " models", errors);
+    check(results.stats.unloadCount + results.residentModels.back() == results.stats.loadCount, "Loads and unloads don't add up", errors);
+    check(results.residency.back()[kRowModelCount - 1], "The model next to the camera isn't resident at the end", errors);
+    check(results.residency.back()[0] == false, "The first model is still resident at the end", errors);
+
+    // A new scheduler replays the same path the same way
+    StreamingScheduler::UniquePtr pReplay = createRowScheduler(kBudget, 4, modelBytes);
+    StreamingScheduler::ReplayResults replayResults;
+    StreamingScheduler::replayPath(pReplay.get(), pPath.get(), desc, replayResults);
+    check(isSameReplay(results, replayResults), "Replaying the path gave different results", errors);
+
+    // A fast camera and slow loads, with enough concurrent loads to fill the budget. Models are still loading when the camera has moved on, and their memory stays committed until they finish
+    StreamingScheduler::UniquePtr pFast = createRowScheduler(kBudget, 16, modelBytes);
+    ObjectPath::SharedPtr pFastPath = createPath({0, kRowSpacing * (kRowModelCount - 1)}, 1);
+    desc.loadLatency = 20;
+    StreamingScheduler::replayPath(pFast.get(), pFastPath.get(), desc, results);
+    checkReplay(results, modelBytes, kBudget, errors);
+    return errors;
+}
+
+uint32_t MemoryManagementTest::testStreamingUnlimited()
+{
+    uint32_t errors = 0;
+    std::vector<uint64_t> modelBytes;
+    StreamingScheduler::UniquePtr pScheduler = createRowScheduler(0, 4, modelBytes);
+    ObjectPath::SharedPtr pPath = createPath({0, kRowSpacing * (kRowModelCount - 1)}, 10);
+
+    StreamingScheduler::ReplayDesc desc;
+    StreamingScheduler::ReplayResults results;
+    StreamingScheduler::replayPath(pScheduler.get(), pPath.get(), desc, results);
+    checkReplay(results, modelBytes, 0, errors);
+
+    // Every model is loaded once. Memory is bounded by the load distance rather than by the number of models
+    check(results.stats.loadCount == kRowModelCount, std::to_string(results.stats.loadCount) + " loads for " + std::to_string(kRowModelCount) + " models", errors);
+    check(results.stats.peakBytes > 8 * kRowModelBytes, "Peak memory " + std::to_string(results.stats.peakBytes) + " with an unlimited budget is below the limited run's budget", errors);
+    check(results.stats.peakBytes <= 20 * kRowModelBytes, "Peak memory " + std::to_string(results.stats.peakBytes) + " grows with the path length", errors);
+
+    // A model larger than the budget is skipped, and doesn't stop the others from loading
+    std::vector<StreamingScheduler::Instance> instances(1);
+    instances[0].modelID = 0;
+    instances[0].center = glm::vec3(0);
+    instances[0].radius = 100;
+    instances.push_back(instances[0]);
+    instances[1].modelID = 1;
+    instances[1].radius = 1;
+    StreamingScheduler::Settings settings;
+    settings.budget = 4 * kRowModelBytes;
+    std::vector<uint64_t> largeModelBytes = {16 * kRowModelBytes, kRowModelBytes};
+    StreamingScheduler::UniquePtr pLarge = StreamingScheduler::create(largeModelBytes, instances, settings);
+    ObjectPath::SharedPtr pStill = createPath({0, 0}, 1);
+    StreamingScheduler::replayPath(pLarge.get(), pStill.get(), desc, results);
+    checkReplay(results, largeModelBytes, settings.budget, errors);
+    check(results.residency.back()[0] == false && results.residency.back()[1], "A model larger than the budget blocked a smaller one", errors);
+    return errors;
+}
+
+uint32_t MemoryManagementTest::testStreamingOscillation()
+{
+    // The camera moves back and forth by 10 units around the middle of the row, every 10 frames. The hysteresis must keep the same models resident
+    uint32_t errors = 0;
+    const uint64_t kBudget = 8 * kRowModelBytes;
+    std::vector<float> positions;
+    for(uint32_t i = 0; i < 60; i++)
+    {
+        positions.push_back(1005.0f + ((i & 1) ? 5.0f : -5.0f));
+    }
+    ObjectPath::SharedPtr pPath = createPath(positions, 10.0f / 60.0f);
+
+    std::vector<uint64_t> modelBytes;
+    StreamingScheduler::UniquePtr pScheduler = createRowScheduler(kBudget, 4, modelBytes);
+    StreamingScheduler::ReplayDesc desc;
+    StreamingScheduler::ReplayResults results;
+    StreamingScheduler::replayPath(pScheduler.get(), pPath.get(), desc, results);
+    checkReplay(results, modelBytes, kBudget, errors);
+    check(results.stats.unloadCount == 0, std::to_string(results.stats.unloadCount) + " unloads while the camera oscillates", errors);
+    check(results.stats.loadCount == results.residentModels.back(), std::to_string(results.stats.loadCount) + " loads for " + std::to_string(results.residentModels.back()) + " resident models", errors);
+    return errors;
+}
+
+bool MemoryManagementTest::runTests()
+{
+    bool passed = true;
+    passed = reportTest("Ring wrap-around", testRingWrapAround()) && passed;
+    passed = reportTest("Ring fence release", testRingFenceRelease()) && passed;
+    passed = reportTest("Ring random allocations", testRingStress()) && passed;
+    passed = reportTest("Residency eviction order", testResidencyOrder()) && passed;
+    passed = reportTest("Residency budget", testResidencyBudget()) && passed;
+    passed = reportTest("Streaming replay with budget", testStreamingBudget()) && passed;
+    passed = reportTest("Streaming replay without budget", testStreamingUnlimited()) && passed;
+    passed = reportTest("Streaming oscillating camera", testStreamingOscillation()) && passed;
+    return passed;
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t stressFrames = 10000;
+    for(int argi = 1; argi < argc; ++argi)
+    {
+        std::string arg(argv[argi]);
+        if(arg == "-frames" && argi + 1 < argc)
+        {
+            stressFrames = max(1, atoi(argv[++argi]));
+        }
+        else
+        {
+            printf("Syntax: MemoryManagementTest [-frames N]\n");
+            return 1;
+        }
+    }
+
+    MemoryManagementTest test(stressFrames);
+    return test.runTests() ? 0 : 1;
+}
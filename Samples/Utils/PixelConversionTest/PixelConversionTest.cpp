@@ -0,0 +1,760 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "PixelConversionTest.h"
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    // Scalar reference implementations. They are written from the format definitions rather than from the kernels, so they don't share the kernels' tricks
+
+    void refExpandRgb8ToRgba8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount, uint8_t alpha)
+    {
+        for(size_t i = 0; i < pixelCount; i++)
+        {
+            pDst[i * 4 + 0] = pSrc[i * 3 + 0];
+            pDst[i * 4 + 1] = pSrc[i * 3 + 1];
+            pDst[i * 4 + 2] = pSrc[i * 3 + 2];
+            pDst[i * 4 + 3] = alpha;
+        }
+    }
+
+    void refSwapRedBlue8(const uint8_t* pSrc, uint8_t* pDst, size_t pixelCount)
+    {
+        for(size_t i = 0; i < pixelCount; i++)
+        {
+            pDst[i * 4 + 0] = pSrc[i * 4 + 2];
+            pDst[i * 4 + 1] = pSrc[i * 4 + 1];
+            pDst[i * 4 + 2] = pSrc[i * 4 + 0];
+            pDst[i * 4 + 3] = pSrc[i * 4 + 3];
+        }
+    }
+
+    double refSrgbToLinear(double c)
+    {
+        return (c <= 0.04045) ? (c / 12.92) : pow((c + 0.055) / 1.055, 2.4);
+    }
+
+    double refLinearToSrgb(double c)
+    {
+        return (c <= 0.0031308) ? (c * 12.92) : (1.055 * pow(c, 1.0 / 2.4) - 0.055);
+    }
+
+    // Clamp to [0, 1]. NaNs become 0
+    float refSaturate(float c)
+    {
+        if(c > 1.0f)
+        {
+            return 1.0f;
+        }
+        return (c >= 0.0f) ? c : 0.0f;
+    }
+
+    uint8_t refLinearToSrgb8(float linear)
+    {
+        return uint8_t(floor(refLinearToSrgb(refSaturate(linear)) * 255.0 + 0.5));
+    }
+
+    float refUnormToFloat(uint8_t c)
+    {
+        return float(c) * (1.0f / 255.0f);
+    }
+
+    uint8_t refFloatToUnorm(float c)
+    {
+        return uint8_t(refSaturate(c) * 255.0f + 0.5f);
+    }
+
+    uint32_t floatBits(float value)
+    {
+        uint32_t bits;
+        memcpy(&bits, &value, sizeof(bits));
+        return bits;
+    }
+
+    float floatFromBits(uint32_t bits)
+    {
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Round a truncated value to nearest even, given the discarded bits and the value of half an ulp
+    uint32_t roundToNearestEven(uint32_t value, uint32_t remainder, uint32_t halfUlp)
+    {
+        if((remainder > halfUlp) || ((remainder == halfUlp) && (value & 1)))
+        {
+            value++;
+        }
+        return value;
+    }
+
+    uint16_t refFloatToHalf(float value)
+    {
+        uint32_t bits = floatBits(value);
+        uint32_t sign = (bits >> 16) & 0x8000;
+        uint32_t exponent = (bits >> 23) & 0xFF;
+        uint32_t mantissa = bits & 0x7FFFFF;
+
+        if(exponent == 255)
+        {
+            // NaNs become quiet NaNs
+            return uint16_t(sign | (mantissa ? 0x7E00 : 0x7C00));
+        }
+        if(exponent == 0)
+        {
+            // Float denormals are much smaller than the smallest half denormal
+            return uint16_t(sign);
+        }
+
+        int32_t halfExponent = int32_t(exponent) - 127 + 15;
+        if(halfExponent >= 31)
+        {
+            return uint16_t(sign | 0x7C00);
+        }
+
+        uint32_t result;
+        if(halfExponent > 0)
+        {
+            // Rounding can carry into the exponent, which correctly turns the largest values into infinity
+            result = roundToNearestEven((uint32_t(halfExponent) << 10) | (mantissa >> 13), mantissa & 0x1FFF, 0x1000);
+        }
+        else
+        {
+            // Denormal. The significand is in units of 2^-24
+            uint32_t significand = mantissa | 0x800000;
+            uint32_t shift = uint32_t(14 - halfExponent);
+            if(shift > 24)
+            {
+                return uint16_t(sign);
+            }
+            result = roundToNearestEven(significand >> shift, significand & ((1 << shift) - 1), 1 << (shift - 1));
+        }
+        return uint16_t(sign | result);
+    }
+
+    float refHalfToFloat(uint16_t value)
+    {
+        uint32_t sign = uint32_t(value & 0x8000) << 16;
+        uint32_t exponent = (value >> 10) & 0x1F;
+        uint32_t mantissa = value & 0x3FF;
+
+        if(exponent == 31)
+        {
+            // Infinity or NaN. The NaN payload is kept
+            return floatFromBits(sign | 0x7F800000 | (mantissa << 13));
+        }
+        if(exponent == 0)
+        {
+            return floatFromBits(sign | floatBits(ldexpf(float(mantissa), -24)));
+        }
+        return floatFromBits(sign | ((exponent - 15 + 127) << 23) | (mantissa << 13));
+    }
+
+    void refFlipRows(const uint8_t* pSrc, uint8_t* pDst, size_t rowPitch, uint32_t rowCount)
+    {
+        for(uint32_t y = 0; y < rowCount; y++)
+        {
+            for(size_t x = 0; x < rowPitch; x++)
+            {
+                pDst[(rowCount - 1 - y) * rowPitch + x] = pSrc[y * rowPitch + x];
+            }
+        }
+    }
+
+    // Deterministic pseudo-random data, so that failures are reproducible
+    void fillRandom(uint8_t* pData, size_t size, uint32_t seed)
+    {
+        uint32_t state = seed * 2654435761u + 1;
+        for(size_t i = 0; i < size; i++)
+        {
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            pData[i] = uint8_t(state >> 24);
+        }
+    }
+
+    // The tests write past the expected output into guard bytes, to catch out-of-bounds writes
+    const size_t kGuardSize = 64;
+    const uint8_t kGuardValue = 0xCD;
+
+    bool checkGuard(const std::vector<uint8_t>& buffer, size_t dataSize)
+    {
+        for(size_t i = dataSize; i < buffer.size(); i++)
+        {
+            if(buffer[i] != kGuardValue)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void compareHalves(const char* kernel, const float* pInput, const uint16_t* pResult, size_t count, uint32_t& errors)
+    {
+        for(size_t i = 0; i < count; i++)
+        {
+            uint16_t expected = refFloatToHalf(pInput[i]);
+            if(pResult[i] != expected)
+            {
+                if(errors == 0)
+                {
+                    printf("    %s(0x%08X) returned 0x%04X, expected 0x%04X\n", kernel, floatBits(pInput[i]), pResult[i], expected);
+                }
+                errors++;
+            }
+        }
+    }
+
+    // Check floatToHalf() and convertFloatToHalf() against the reference. The vector kernel also runs from an unaligned start, so that the tail covers different values
+    void checkFloatToHalf(const std::vector<float>& values, uint32_t& errors)
+    {
+        std::vector<uint16_t> result(values.size());
+        for(size_t i = 0; i < values.size(); i++)
+        {
+            result[i] = floatToHalf(values[i]);
+        }
+        compareHalves("floatToHalf", values.data(), result.data(), values.size(), errors);
+
+        convertFloatToHalf(values.data(), result.data(), values.size());
+        compareHalves("convertFloatToHalf", values.data(), result.data(), values.size(), errors);
+
+        if(values.size() > 1)
+        {
+            convertFloatToHalf(values.data() + 1, result.data(), values.size() - 1);
+            compareHalves("convertFloatToHalf", values.data() + 1, result.data(), values.size() - 1, errors);
+        }
+    }
+
+    // The float sweeps are processed in chunks, so that an exhaustive sweep doesn't need 16GB of memory
+    const size_t kSweepChunkSize = 1 << 20;
+
+    // The kernel rounds against thresholds stored as floats, so a float within an ulp of the exact threshold may round either way
+    void checkLinearToSrgb8(float value, uint32_t& errors)
+    {
+        uint8_t result = linearToSrgb8(value);
+        uint8_t expected = refLinearToSrgb8(value);
+        if(result == expected)
+        {
+            return;
+        }
+
+        uint32_t upper = max(result, expected);
+        double threshold = refSrgbToLinear((double(upper) - 0.5) / 255.0);
+        bool ambiguous = (abs(int32_t(result) - int32_t(expected)) == 1) && (fabs(double(value) - threshold) <= double(nextafterf(value, INFINITY) - value));
+        if(ambiguous == false)
+        {
+            if(errors == 0)
+            {
+                printf("    linearToSrgb8(%.9g) returned %u, expected %u\n", value, result, expected);
+            }
+            errors++;
+        }
+    }
+
+    bool reportTest(const char* name, uint32_t errors)
+    {
+        if(errors)
+        {
+            printf("%-32s FAILED, %u mismatches\n", name, errors);
+        }
+        else
+        {
+            printf("%-32s passed\n", name);
+        }
+        return errors == 0;
+    }
+}
+
+PixelConversionTest::PixelConversionTest(uint32_t iterations, uint32_t floatStride) : mIterations(iterations), mFloatStride(floatStride)
+{
+}
+
+uint32_t PixelConversionTest::testExpand()
+{
+    // The kernel switches to the vector path at 6 pixels, and converts a scalar tail at both ends. Cover every tail length with and without an offset to an unaligned address
+    uint32_t errors = 0;
+    const uint8_t alphaValues[] = {0xFF, 0x00, 0x80};
+    for(size_t pixelCount = 0; pixelCount <= 100; pixelCount++)
+    {
+        for(size_t offset = 0; offset < 2; offset++)
+        {
+            for(uint32_t a = 0; a < arraysize(alphaValues); a++)
+            {
+                uint8_t alpha = alphaValues[a];
+                std::vector<uint8_t> src(offset + pixelCount * 3);
+                fillRandom(src.data(), src.size(), uint32_t(pixelCount));
+                std::vector<uint8_t> expected(pixelCount * 4);
+                refExpandRgb8ToRgba8(src.data() + offset, expected.data(), pixelCount, alpha);
+
+                // Out of place
+                std::vector<uint8_t> dst(offset + pixelCount * 4 + kGuardSize, kGuardValue);
+                expandRgb8ToRgba8(src.data() + offset, dst.data() + offset, pixelCount, alpha);
+                bool match = (pixelCount == 0) || (memcmp(dst.data() + offset, expected.data(), expected.size()) == 0);
+                match = match && checkGuard(dst, offset + pixelCount * 4);
+
+                // In place
+                std::vector<uint8_t> data(offset + pixelCount * 4 + kGuardSize, kGuardValue);
+                memcpy(data.data() + offset, src.data() + offset, pixelCount * 3);
+                expandRgb8ToRgba8(data.data() + offset, data.data() + offset, pixelCount, alpha);
+                match = match && ((pixelCount == 0) || (memcmp(data.data() + offset, expected.data(), expected.size()) == 0));
+                match = match && checkGuard(data, offset + pixelCount * 4);
+
+                if(match == false)
+                {
+                    if(errors == 0)
+                    {
+                        printf("    expandRgb8ToRgba8() mismatch. %u pixels, offset %u, alpha %u\n", uint32_t(pixelCount), uint32_t(offset), alpha);
+                    }
+                    errors++;
+                }
+            }
+        }
+    }
+    return errors;
+}
+
+uint32_t PixelConversionTest::testSwizzle()
+{
+    uint32_t errors = 0;
+    for(size_t pixelCount = 0; pixelCount <= 40; pixelCount++)
+    {
+        for(size_t offset = 0; offset < 2; offset++)
+        {
+            std::vector<uint8_t> src(offset + pixelCount * 4);
+            fillRandom(src.data(), src.size(), uint32_t(pixelCount));
+            std::vector<uint8_t> expected(pixelCount * 4);
+            refSwapRedBlue8(src.data() + offset, expected.data(), pixelCount);
+
+            std::vector<uint8_t> dst(offset + pixelCount * 4 + kGuardSize, kGuardValue);
+            swapRedBlue8(src.data() + offset, dst.data() + offset, pixelCount);
+            bool match = (pixelCount == 0) || (memcmp(dst.data() + offset, expected.data(), expected.size()) == 0);
+            match = match && checkGuard(dst, offset + pixelCount * 4);
+
+            std::vector<uint8_t> data(offset + pixelCount * 4 + kGuardSize, kGuardValue);
+            memcpy(data.data(), src.data(), src.size());
+            swapRedBlue8(data.data() + offset, data.data() + offset, pixelCount);
+            match = match && ((pixelCount == 0) || (memcmp(data.data() + offset, expected.data(), expected.size()) == 0));
+            match = match && checkGuard(data, offset + pixelCount * 4);
+
+            // fillAlpha8() only touches the 4th channel
+            for(size_t i = 0; i < pixelCount; i++)
+            {
+                expected[i * 4 + 3] = 0x42;
+            }
+            fillAlpha8(data.data() + offset, pixelCount, 0x42);
+            match = match && ((pixelCount == 0) || (memcmp(data.data() + offset, expected.data(), expected.size()) == 0));
+            match = match && checkGuard(data, offset + pixelCount * 4);
+
+            if(match == false)
+            {
+                if(errors == 0)
+                {
+                    printf("    swapRedBlue8()/fillAlpha8() mismatch. %u pixels, offset %u\n", uint32_t(pixelCount), uint32_t(offset));
+                }
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+uint32_t PixelConversionTest::testSrgb()
+{
+    uint32_t errors = 0;
+
+    // Every 8-bit value decodes to the reference value and encodes back to itself
+    const float* pTable = getSrgbToLinearTable();
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        float expected = float(refSrgbToLinear(double(i) / 255.0));
+        if(floatBits(pTable[i]) != floatBits(expected) || linearToSrgb8(pTable[i]) != i)
+        {
+            if(errors == 0)
+            {
+                printf("    sRGB value %u decodes to %.9g and encodes to %u, expected %.9g\n", i, pTable[i], linearToSrgb8(pTable[i]), expected);
+            }
+            errors++;
+        }
+    }
+
+    // The floats around every rounding threshold, out-of-range values, then a sweep over the linear range
+    std::vector<float> values;
+    for(uint32_t i = 0; i < 255; i++)
+    {
+        float threshold = float(refSrgbToLinear((double(i) + 0.5) / 255.0));
+        values.push_back(nextafterf(threshold, 0.0f));
+        values.push_back(threshold);
+        values.push_back(nextafterf(threshold, 1.0f));
+    }
+    const float kSpecialValues[] = {-0.0f, -1.0f, 1.5f, 1e30f, -INFINITY, INFINITY, NAN};
+    values.insert(values.end(), kSpecialValues, kSpecialValues + arraysize(kSpecialValues));
+
+    for(float value : values)
+    {
+        checkLinearToSrgb8(value, errors);
+    }
+    for(uint64_t bits = 0; bits <= floatBits(1.0f); bits += mFloatStride)
+    {
+        checkLinearToSrgb8(floatFromBits(uint32_t(bits)), errors);
+    }
+    return errors;
+}
+
+uint32_t PixelConversionTest::testUnorm()
+{
+    uint32_t errors = 0;
+
+    // RGBA8 to float. Every channel takes all the 256 values
+    const uint32_t kPixelCount = 256;
+    std::vector<uint8_t> pixels(kPixelCount * 4);
+    for(uint32_t i = 0; i < kPixelCount; i++)
+    {
+        for(uint32_t c = 0; c < 4; c++)
+        {
+            pixels[i * 4 + c] = uint8_t(i + c * 85);
+        }
+    }
+
+    for(uint32_t srgb = 0; srgb < 2; srgb++)
+    {
+        // Run on shorter buffers too, to cover the scalar tail
+        for(uint32_t pixelCount = kPixelCount - 7; pixelCount <= kPixelCount; pixelCount++)
+        {
+            std::vector<float> result(pixelCount * 4);
+            convertRgba8ToFloat(pixels.data() + (kPixelCount - pixelCount) * 4, result.data(), pixelCount, srgb != 0);
+            for(uint32_t i = 0; i < pixelCount * 4; i++)
+            {
+                uint8_t value = pixels[(kPixelCount - pixelCount) * 4 + i];
+                bool isColor = (i % 4) != 3;
+                float expected = (srgb && isColor) ? float(refSrgbToLinear(double(value) / 255.0)) : refUnormToFloat(value);
+                if(floatBits(result[i]) != floatBits(expected))
+                {
+                    if(errors == 0)
+                    {
+                        printf("    convertRgba8ToFloat(%u, sRGB %u) returned %.9g, expected %.9g\n", value, srgb, result[i], expected);
+                    }
+                    errors++;
+                }
+            }
+        }
+    }
+
+    // Float to RGBA8. Use the decoded values, the rounding midpoints and their neighbours, and out-of-range values
+    std::vector<float> values;
+    for(uint32_t i = 0; i < 256; i++)
+    {
+        float midpoint = (float(i) + 0.5f) / 255.0f;
+        values.push_back(refUnormToFloat(uint8_t(i)));
+        values.push_back(float(refSrgbToLinear(double(i) / 255.0)));
+        values.push_back(nextafterf(midpoint, 0.0f));
+        values.push_back(midpoint);
+        values.push_back(nextafterf(midpoint, 1.0f));
+    }
+    const float kSpecialValues[] = {-0.0f, -1.0f, 1.5f, 1e30f, -INFINITY, INFINITY, NAN};
+    values.insert(values.end(), kSpecialValues, kSpecialValues + arraysize(kSpecialValues));
+    while(values.size() % 4)
+    {
+        values.push_back(0.5f);
+    }
+
+    for(uint32_t srgb = 0; srgb < 2; srgb++)
+    {
+        size_t maxPixels = values.size() / 4;
+        for(size_t pixelCount = maxPixels - 7; pixelCount <= maxPixels; pixelCount++)
+        {
+            const float* pSrc = values.data() + (maxPixels - pixelCount) * 4;
+            std::vector<uint8_t> result(pixelCount * 4);
+            convertFloatToRgba8(pSrc, result.data(), pixelCount, srgb != 0);
+            for(size_t i = 0; i < pixelCount * 4; i++)
+            {
+                bool isColor = (i % 4) != 3;
+                // testSrgb() checks linearToSrgb8() against the reference, here the sRGB channels must match it exactly
+                uint8_t expected = (srgb && isColor) ? linearToSrgb8(pSrc[i]) : refFloatToUnorm(pSrc[i]);
+                if(result[i] != expected)
+                {
+                    if(errors == 0)
+                    {
+                        printf("    convertFloatToRgba8(%.9g, sRGB %u) returned %u, expected %u\n", pSrc[i], srgb, result[i], expected);
+                    }
+                    errors++;
+                }
+            }
+        }
+    }
+    return errors;
+}
+
+uint32_t PixelConversionTest::testHalf()
+{
+    uint32_t errors = 0;
+
+    // Every half converts exactly to a float and back
+    std::vector<uint16_t> halves(65536);
+    std::vector<float> floats(65536);
+    for(uint32_t i = 0; i < 65536; i++)
+    {
+        halves[i] = uint16_t(i);
+        floats[i] = refHalfToFloat(uint16_t(i));
+    }
+
+    // The vector path with all the halves, and the scalar tail with an unaligned start
+    std::vector<float> converted(65536);
+    convertHalfToFloat(halves.data(), converted.data(), 65536);
+    std::vector<float> convertedTail(65535);
+    convertHalfToFloat(halves.data() + 1, convertedTail.data(), 65535);
+
+    for(uint32_t i = 0; i < 65536; i++)
+    {
+        uint32_t expected = floatBits(floats[i]);
+        bool match = (floatBits(halfToFloat(uint16_t(i))) == expected) && (floatBits(converted[i]) == expected);
+        match = match && ((i == 0) || (floatBits(convertedTail[i - 1]) == expected));
+        if(match == false)
+        {
+            if(errors == 0)
+            {
+                printf("    halfToFloat(0x%04X) returned 0x%08X, expected 0x%08X\n", i, floatBits(halfToFloat(uint16_t(i))), expected);
+            }
+            errors++;
+        }
+    }
+
+    // Float to half. Every half value, the midpoints between adjacent halves and their neighbours, then a sweep over the float bit patterns
+    std::vector<float> values(floats);
+    for(uint32_t i = 0; i < 65536; i++)
+    {
+        bool isLast = ((i & 0x7FFF) == 0x7BFF);
+        bool isFinite = ((i & 0x7C00) != 0x7C00);
+        if(isFinite && (isLast == false))
+        {
+            // Exact in float, halves have 11 significant bits
+            float midpoint = (floats[i] + floats[i + 1]) * 0.5f;
+            values.push_back(nextafterf(midpoint, 0.0f));
+            values.push_back(midpoint);
+            values.push_back(nextafterf(midpoint, INFINITY));
+            values.push_back(nextafterf(midpoint, -INFINITY));
+        }
+    }
+    // Around the overflow threshold, 65520
+    values.push_back(65519.0f);
+    values.push_back(65520.0f);
+    values.push_back(-65520.0f);
+    values.push_back(65536.0f);
+    checkFloatToHalf(values, errors);
+
+    values.clear();
+    for(uint64_t bits = 0; bits <= 0xFFFFFFFF; bits += mFloatStride)
+    {
+        values.push_back(floatFromBits(uint32_t(bits)));
+        if(values.size() == kSweepChunkSize)
+        {
+            checkFloatToHalf(values, errors);
+            values.clear();
+        }
+    }
+    checkFloatToHalf(values, errors);
+    return errors;
+}
+
+uint32_t PixelConversionTest::testFlip()
+{
+    // Odd pitches, and pitches around flipRows()'s 4KB chunk size
+    const size_t kRowPitches[] = {1, 2, 3, 5, 7, 13, 17, 31, 33, 4095, 4096, 4097, 8191, 8193, 9001};
+    uint32_t errors = 0;
+    for(uint32_t p = 0; p < arraysize(kRowPitches); p++)
+    {
+        size_t rowPitch = kRowPitches[p];
+        for(uint32_t rowCount = 0; rowCount <= 6; rowCount++)
+        {
+            size_t size = rowPitch * rowCount;
+            std::vector<uint8_t> src(size);
+            fillRandom(src.data(), size, uint32_t(rowPitch * 7 + rowCount));
+            std::vector<uint8_t> expected(size);
+            refFlipRows(src.data(), expected.data(), rowPitch, rowCount);
+
+            std::vector<uint8_t> data(size + kGuardSize, kGuardValue);
+            memcpy(data.data(), src.data(), size);
+            flipRows(data.data(), rowPitch, rowCount);
+            bool match = (size == 0) || (memcmp(data.data(), expected.data(), size) == 0);
+            match = match && checkGuard(data, size);
+
+            std::vector<uint8_t> dst(size + kGuardSize, kGuardValue);
+            copyRowsFlipped(src.data(), dst.data(), rowPitch, rowCount);
+            match = match && ((size == 0) || (memcmp(dst.data(), expected.data(), size) == 0));
+            match = match && checkGuard(dst, size);
+
+            if(match == false)
+            {
+                if(errors == 0)
+                {
+                    printf("    flipRows()/copyRowsFlipped() mismatch. Row pitch %u, %u rows\n", uint32_t(rowPitch), rowCount);
+                }
+                errors++;
+            }
+        }
+    }
+    return errors;
+}
+
+bool PixelConversionTest::runTests()
+{
+    bool passed = true;
+    passed = reportTest("Expand RGB8 to RGBA8", testExpand()) && passed;
+    passed = reportTest("Swap red/blue, fill alpha", testSwizzle()) && passed;
+    passed = reportTest("sRGB <-> linear", testSrgb()) && passed;
+    passed = reportTest("RGBA8 <-> float", testUnorm()) && passed;
+    passed = reportTest("Float <-> half", testHalf()) && passed;
+    passed = reportTest("Row flip", testFlip()) && passed;
+    return passed;
+}
+
+float PixelConversionTest::measure(const std::function<void()>& func)
+{
+    // Warm up the caches
+    func();
+
+    CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+    for(uint32_t i = 0; i < mIterations; i++)
+    {
+        func();
+    }
+    return CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint()) / float(mIterations);
+}
+
+void PixelConversionTest::runBenchmark()
+{
+    // 1920x1080 pixels. Large enough to leave the L2 cache
+    const size_t kWidth = 1920;
+    const size_t kHeight = 1080;
+    const size_t kPixelCount = kWidth * kHeight;
+
+    std::vector<uint8_t> rgb(kPixelCount * 3);
+    std::vector<uint8_t> rgba(kPixelCount * 4);
+    std::vector<uint8_t> rgbaDst(kPixelCount * 4);
+    std::vector<float> floats(kPixelCount * 4);
+    std::vector<uint16_t> halves(kPixelCount * 4);
+    fillRandom(rgb.data(), rgb.size(), 1);
+    fillRandom(rgba.data(), rgba.size(), 2);
+    convertRgba8ToFloat(rgba.data(), floats.data(), kPixelCount, false);
+    convertFloatToHalf(floats.data(), halves.data(), floats.size());
+
+    // The float <-> half conversions are measured per RGBA pixel, like the rest
+    struct Kernel
+    {
+        const char* name;
+        std::function<void()> kernel;
+        std::function<void()> reference;
+    };
+    Kernel kernels[] =
+    {
+        {"expandRgb8ToRgba8", [&]() { expandRgb8ToRgba8(rgb.data(), rgbaDst.data(), kPixelCount); }, [&]() { refExpandRgb8ToRgba8(rgb.data(), rgbaDst.data(), kPixelCount, 0xFF); }},
+        {"swapRedBlue8", [&]() { swapRedBlue8(rgba.data(), rgbaDst.data(), kPixelCount); }, [&]() { refSwapRedBlue8(rgba.data(), rgbaDst.data(), kPixelCount); }},
+        {"convertRgba8ToFloat", [&]() { convertRgba8ToFloat(rgba.data(), floats.data(), kPixelCount, false); }, [&]()
+            {
+                for(size_t i = 0; i < kPixelCount * 4; i++) floats[i] = refUnormToFloat(rgba[i]);
+            }},
+        {"convertRgba8ToFloat (sRGB)", [&]() { convertRgba8ToFloat(rgba.data(), floats.data(), kPixelCount, true); }, [&]()
+            {
+                for(size_t i = 0; i < kPixelCount * 4; i++) floats[i] = ((i % 4) == 3) ? refUnormToFloat(rgba[i]) : float(refSrgbToLinear(double(rgba[i]) / 255.0));
+            }},
+        {"convertFloatToRgba8", [&]() { convertFloatToRgba8(floats.data(), rgbaDst.data(), kPixelCount, false); }, [&]()
+            {
+                for(size_t i = 0; i < kPixelCount * 4; i++) rgbaDst[i] = refFloatToUnorm(floats[i]);
+            }},
+        {"convertFloatToRgba8 (sRGB)", [&]() { convertFloatToRgba8(floats.data(), rgbaDst.data(), kPixelCount, true); }, [&]()
+            {
+                for(size_t i = 0; i < kPixelCount * 4; i++) rgbaDst[i] = ((i % 4) == 3) ? refFloatToUnorm(floats[i]) : refLinearToSrgb8(floats[i]);
+            }},
+        {"convertFloatToHalf", [&]() { convertFloatToHalf(floats.data(), halves.data(), floats.size()); }, [&]()
+            {
+                for(size_t i = 0; i < kPixelCount * 4; i++) halves[i] = refFloatToHalf(floats[i]);
+            }},
+        {"convertHalfToFloat", [&]() { convertHalfToFloat(halves.data(), floats.data(), halves.size()); }, [&]()
+            {
+                for(size_t i = 0; i < kPixelCount * 4; i++) floats[i] = refHalfToFloat(halves[i]);
+            }},
+        {"copyRowsFlipped", [&]() { copyRowsFlipped(rgba.data(), rgbaDst.data(), kWidth * 4, uint32_t(kHeight)); }, [&]() { refFlipRows(rgba.data(), rgbaDst.data(), kWidth * 4, uint32_t(kHeight)); }},
+    };
+
+    printf("%-32s %16s %16s %8s\n", "Kernel", "Scalar (MPix/s)", "Kernel (MPix/s)", "Speedup");
+    const float kMegaPixels = float(kPixelCount) * 1e-6f;
+    for(uint32_t i = 0; i < arraysize(kernels); i++)
+    {
+        float reference = measure(kernels[i].reference);
+        float kernel = measure(kernels[i].kernel);
+        printf("%-32s %16.1f %16.1f %7.1fx\n", kernels[i].name, kMegaPixels * 1000.0f / reference, kMegaPixels * 1000.0f / kernel, reference / kernel);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t iterations = 20;
+    uint32_t floatStride = 257;
+    bool runTests = true;
+    bool runBenchmark = true;
+
+    for(int argi = 1; argi < argc; ++argi)
+    {
+        std::string arg(argv[argi]);
+        if(arg == "-iterations" && argi + 1 < argc)
+        {
+            iterations = max(1, atoi(argv[++argi]));
+        }
+        else if(arg == "-exhaustive")
+        {
+            floatStride = 1;
+        }
+        else if(arg == "-notests")
+        {
+            runTests = false;
+        }
+        else if(arg == "-nobenchmark")
+        {
+            runBenchmark = false;
+        }
+        else
+        {
+            printf("Syntax: PixelConversionTest [-iterations N] [-exhaustive] [-notests] [-nobenchmark]\n");
+            return 1;
+        }
+    }
+
+    PixelConversionTest test(iterations, floatStride);
+    bool passed = true;
+    if(runTests)
+    {
+        passed = test.runTests();
+        printf("\n");
+    }
+    if(runBenchmark)
+    {
+        test.runBenchmark();
+    }
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include <functional>
+
+using namespace Falcor;
+
+class PixelConversionTest
+{
+public:
+    /** \param[in] iterations Number of times each kernel runs in the benchmark
+        \param[in] floatStride The step between the float bit patterns checked by the float sweeps. 1 checks every float
+    */
+    PixelConversionTest(uint32_t iterations, uint32_t floatStride);
+
+    /** Check the kernels against the scalar reference implementations. Returns true if all the results match
+    */
+    bool runTests();
+
+    /** Print the throughput of the kernels and of the scalar reference implementations
+    */
+    void runBenchmark();
+
+private:
+    // Each test returns the number of mismatches
+    uint32_t testExpand();
+    uint32_t testSwizzle();
+    uint32_t testSrgb();
+    uint32_t testUnorm();
+    uint32_t testHalf();
+    uint32_t testFlip();
+
+    /** Run a function. Returns the average time in milliseconds
+    */
+    float measure(const std::function<void()>& func);
+
+    uint32_t mIterations;
+    uint32_t mFloatStride;
+};
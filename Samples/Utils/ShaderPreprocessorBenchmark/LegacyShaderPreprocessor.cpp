@@ -0,0 +1,664 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "LegacyShaderPreprocessor.h"
+#include "Utils/OS.h"
+#include "Utils/StringUtils.h"
+#include <set>
+
+namespace Legacy
+{
+    // Only the code path taken by valid shaders is kept. Malformed directives are rejected with a single generic error message
+    size_t npos = std::string::npos;
+
+    bool isInComment(const std::string& str, size_t offset)
+    {
+        // Check for /* */ style
+        size_t prevCommentStart = str.rfind("/*", offset);
+        size_t prevCommentEnd = str.rfind("*/", offset);
+        if((prevCommentStart > prevCommentEnd) && (prevCommentStart != npos))
+        {
+            return true;
+        }
+
+        // Check for '//'
+        size_t prevNewLine = str.rfind("\n", offset);
+        size_t prevComment = str.rfind("//", offset);
+        return (prevComment > prevNewLine) && (prevComment != npos);
+    }
+
+    // Tokens are the characters "+;,=()<" and whitespace-separated strings
+    size_t getNextToken(const std::string& str, size_t offset, std::string& token)
+    {
+        const std::string whitespace = " \t\n\r";
+        const std::string charTokens = "+;,=()<";
+
+        token = std::string();
+        offset = str.find_first_not_of(whitespace, offset);
+        if(offset == npos)
+        {
+            return npos;
+        }
+
+        if(charTokens.find(str[offset]) != npos)
+        {
+            token = str[offset];
+            offset++;
+            return (offset == str.length()) ? npos : offset;
+        }
+
+        size_t endTokenOffset = str.find_first_of(whitespace + charTokens, offset);
+        token = (endTokenOffset != npos) ? str.substr(offset, endTokenOffset - offset) : str.substr(offset);
+        token = removeTrailingWhitespaces(token);
+        return endTokenOffset;
+    }
+
+    size_t getLine(const std::string& str, size_t offset, std::string& subStr)
+    {
+        size_t end = str.find('\n', offset);
+        subStr = (end == npos) ? str.substr(offset) : str.substr(offset, end - offset);
+        return end;
+    }
+
+    size_t getIncludedFileName(const std::string& str, size_t offset, std::string& filename)
+    {
+        size_t filenameStart = str.find_first_of("<\"\n", offset);
+        if(filenameStart == npos || str[filenameStart] == '\n')
+        {
+            return npos;
+        }
+        std::string endToken = std::string("\n") + str[filenameStart];
+        filenameStart += 1;
+
+        size_t filenameEnd = str.find_first_of(endToken, filenameStart);
+        if(filenameEnd == npos || str[filenameEnd] == '\n')
+        {
+            return npos;
+        }
+
+        filename = canonicalizeFilename(str.substr(filenameStart, filenameEnd - filenameStart));
+        return filenameEnd;
+    }
+
+    template<bool bReverse>
+    size_t findShaderDirective(const std::string& code, size_t offset, const std::string directive)
+    {
+        while(offset != npos)
+        {
+            offset = bReverse ? code.rfind(directive, offset) : code.find(directive, offset);
+            if(offset != npos)
+            {
+                if(isInComment(code, offset) == false)
+                {
+                    return offset;
+                }
+                offset = bReverse ? offset - directive.size() : offset + directive.size();
+            }
+        }
+        return offset;
+    }
+
+    void findDirectivePair(const std::string& startPragma, const std::string& endPragma, const std::string& str, size_t& startOffset, size_t& endOffset)
+    {
+        // In case of nesting, this code will return the outer pair
+        startOffset = findShaderDirective<false>(str, 0, startPragma);
+        if(startOffset == npos)
+        {
+            endOffset = findShaderDirective<false>(str, 0, endPragma);
+            return;
+        }
+
+        uint32_t startCount = 1;
+        size_t offset = startOffset + startPragma.size();
+        while(startCount != 0)
+        {
+            size_t nextStart = findShaderDirective<false>(str, offset, startPragma);
+            endOffset = findShaderDirective<false>(str, offset, endPragma);
+            if(endOffset == npos)
+            {
+                return;
+            }
+
+            if(nextStart == npos || endOffset < nextStart)
+            {
+                startCount--;
+                offset = endOffset + endPragma.size();
+            }
+            else
+            {
+                startCount++;
+                offset = nextStart + startPragma.size();
+            }
+        }
+    }
+
+    size_t countNewLines(const std::string& str, size_t start, size_t offset)
+    {
+        const auto& end = (offset == npos) ? str.end() : str.begin() + offset;
+        return std::count(str.begin() + start, end, '\n');
+    }
+
+    // The location is found by searching back for the closest #line directive and counting the new lines since then. This is the main cost of the old implementation
+    void getLineInformation(const std::string& code, size_t offset, size_t& line, std::string& filename, const std::string& rootFileName)
+    {
+        size_t precedingLinePragmaOffset = findShaderDirective<true>(code, offset, "#line");
+        if(precedingLinePragmaOffset == npos)
+        {
+            filename = rootFileName;
+            line = countNewLines(code, 0, offset) + 1;
+            return;
+        }
+
+        std::string pragmaLine;
+        getLine(code, precedingLinePragmaOffset, pragmaLine);
+        std::vector<std::string> tokens = splitString(pragmaLine, " \t");
+
+        // #line tells where the next line is, so we subtract one to compensate for that
+        line = atoi(tokens[1].c_str()) - 1;
+        line += countNewLines(code, precedingLinePragmaOffset, offset);
+
+        if(tokens.size() == 3)
+        {
+            // "#line N \"filename\""
+            filename = tokens[2].substr(1, tokens[2].length() - 2);
+            filename = replaceSubstring(filename, "/", "\\");
+        }
+        else
+        {
+            filename = rootFileName;
+        }
+    }
+
+    std::string getLinePragma(size_t line, const std::string& filename)
+    {
+        // GLSL interprets backslashes as escape characters
+        return std::string("#line ") + std::to_string(line) + " \"" + replaceSubstring(filename, "\\", "/") + "\"\n";
+    }
+
+    std::string getLinePragmaFromOffset(const std::string& code, size_t offset, const std::string& rootFileName)
+    {
+        size_t line;
+        std::string filename;
+        getLineInformation(code, offset, line, filename, rootFileName);
+        return getLinePragma(line, filename);
+    }
+
+    std::string getErrorLocation(const std::string& code, size_t offset, const std::string& rootFileName)
+    {
+        size_t line;
+        std::string filename;
+        getLineInformation(code, offset, line, filename, rootFileName);
+        return filename + "(" + std::to_string(line) + "): ";
+    }
+
+    bool ShaderPreprocessor::addIncludes(std::string& code, Shader::unordered_string_set& includeFileList)
+    {
+        auto getDirAbs = [](const std::string& path) { return path.substr(0, path.find_last_of("/\\")); };
+
+        // The directories of the files which were included so far, used to resolve relative includes
+        std::map<std::string, std::string> pathsAbsToDirsAbs;
+        pathsAbsToDirsAbs[mShaderPathAbs] = getDirAbs(mShaderPathAbs);
+        std::set<std::string> includedPathsAbs;
+
+        // The file is searched from the start after every include, and the whole shader is copied
+        while(true)
+        {
+            size_t offset = findShaderDirective<false>(code, 0, "#include");
+            if(offset == npos)
+            {
+                break;
+            }
+
+            // The including file is always absolute, since we only write absolute paths in #line directives
+            std::string includingPathAbs;
+            size_t line;
+            getLineInformation(code, offset, line, includingPathAbs, mShaderPathAbs);
+
+            std::string includedPathRaw;
+            size_t postFilenameOffset = getIncludedFileName(code, offset, includedPathRaw);
+            if(postFilenameOffset == npos)
+            {
+                mErrorStr += includingPathAbs + "(" + std::to_string(line) + "): Missing included filename";
+                return false;
+            }
+
+            // Absolute path, then the data directories, then relative to the including file
+            std::string includedPathAbs = includedPathRaw;
+            if((doesFileExist(includedPathAbs) == false) && (findFileInDataDirectories(includedPathRaw, includedPathAbs) == false))
+            {
+                includedPathAbs = canonicalizeFilename(pathsAbsToDirsAbs.at(includingPathAbs) + "\\" + includedPathRaw);
+                if(doesFileExist(includedPathAbs) == false)
+                {
+                    mErrorStr += includingPathAbs + "(" + std::to_string(line) + "): Can't find include file \"" + includedPathRaw + "\".";
+                    return false;
+                }
+            }
+            includeFileList.insert(includedPathAbs);
+
+            std::string includedContent;
+            readFileToString(includedPathAbs, includedContent);
+            if(!includedContent.empty() && includedContent.back() != '\n')
+            {
+                includedContent += '\n';
+            }
+
+            bool shouldInclude = (findShaderDirective<false>(includedContent, 0, "#pragma once") == npos) || (includedPathsAbs.find(includedPathAbs) == includedPathsAbs.end());
+
+            std::string prologue = code.substr(0, offset);
+            std::string epilogue = code.substr(postFilenameOffset + 2);
+            if(shouldInclude)
+            {
+                includedPathsAbs.insert(includedPathAbs);
+                pathsAbsToDirsAbs[includedPathAbs] = getDirAbs(includedPathAbs);
+                code = prologue + getLinePragma(1, includedPathAbs) + includedContent + getLinePragma(line + 1, includingPathAbs) + epilogue;
+            }
+            else
+            {
+                code = prologue + epilogue;
+            }
+        }
+
+        return true;
+    }
+
+    using string_tuple = std::vector<std::string>;
+    using string_tuple_vector = std::vector<string_tuple>;
+
+    bool getStringTuples(const std::string& line, size_t& offset, const std::string& endToken, string_tuple& stringVec, bool shouldBeginWithParenthesis)
+    {
+        std::string token;
+        bool hasParanthesis = false;
+        offset = getNextToken(line, offset, token);
+        if(token == "(")
+        {
+            hasParanthesis = true;
+            if(offset == npos)
+            {
+                return false;
+            }
+            offset = getNextToken(line, offset, token);
+        }
+        else if(shouldBeginWithParenthesis)
+        {
+            return false;
+        }
+
+        while(token != "(")
+        {
+            stringVec.push_back(token);
+
+            offset = getNextToken(line, offset, token);
+            if(token == ")")
+            {
+                return hasParanthesis;
+            }
+
+            if(token == endToken || offset == npos)
+            {
+                if(token == endToken)
+                {
+                    // Rewind, so the caller reads the end token
+                    offset = (offset == npos) ? (line.length() - endToken.length()) : offset - endToken.length();
+                }
+                return hasParanthesis == false;
+            }
+
+            if(token != ",")
+            {
+                return false;
+            }
+            offset = getNextToken(line, offset, token);
+        }
+        return false;
+    }
+
+    bool parseForEachLine(const std::string& line, string_tuple& keyTable, string_tuple_vector& valueTable)
+    {
+        // #foreach key in value1, value2, ..., valuen
+        // #foreach key1, key2, ..., keyn in (value1, value2, ..., valuen), (value1, value2, ..., valuen), ...
+        // #foreach (key1, key2, ..., keyn) in (value1, value2, ..., valuen), (value1, value2, ..., valuen), ...
+        std::string token;
+        size_t offset = getNextToken(line, 0, token);
+
+        std::string cleanLine = removeLeadingTrailingWhitespaces(line);
+        if((getStringTuples(cleanLine, offset, "in", keyTable, false) == false) || keyTable.empty())
+        {
+            return false;
+        }
+
+        offset = getNextToken(cleanLine, offset, token);
+        if(token != "in")
+        {
+            return false;
+        }
+
+        if(offset == npos)
+        {
+            // No values
+            return true;
+        }
+
+        // With a single key the values aren't tuples
+        if(keyTable.size() == 1)
+        {
+            string_tuple val;
+            if(getStringTuples(cleanLine, offset, std::string(), val, false) == false)
+            {
+                return false;
+            }
+            for(const auto& a : val)
+            {
+                valueTable.push_back(string_tuple(1, a));
+            }
+            return true;
+        }
+
+        while(true)
+        {
+            string_tuple val;
+            if((getStringTuples(cleanLine, offset, std::string(), val, true) == false) || (val.size() != keyTable.size()))
+            {
+                return false;
+            }
+            valueTable.push_back(val);
+
+            offset = getNextToken(cleanLine, offset, token);
+            if(offset == npos)
+            {
+                return token.empty();
+            }
+            if(token != ",")
+            {
+                return false;
+            }
+        }
+    }
+
+    bool parseForLine(const std::string& forLine, std::string& iteratorName, int32_t& startRange, int32_t& endRange)
+    {
+        // Must be exactly '#for (int arg = start; arg < end; ++arg)', where start and end are integers or macros which expand to integers
+        std::vector<std::string> tokens;
+        std::string token;
+        size_t offset = getNextToken(forLine, 0, token);
+        while(offset != npos)
+        {
+            offset = getNextToken(forLine, offset, token);
+            if(token.size())
+            {
+                tokens.push_back(token);
+            }
+        }
+
+        const char* kPattern[] = {"(", "int", nullptr, "=", nullptr, ";", nullptr, "<", nullptr, ";", "+", "+", nullptr, ")"};
+        if(tokens.size() != arraysize(kPattern))
+        {
+            return false;
+        }
+        for(uint32_t i = 0; i < arraysize(kPattern); i++)
+        {
+            if(kPattern[i] && tokens[i] != kPattern[i])
+            {
+                return false;
+            }
+        }
+
+        iteratorName = tokens[2];
+        char* pStartEnd;
+        char* pRangeEnd;
+        startRange = strtol(tokens[4].c_str(), &pStartEnd, 0);
+        endRange = strtol(tokens[8].c_str(), &pRangeEnd, 0);
+        return (*pStartEnd == 0) && (*pRangeEnd == 0) && (tokens[6] == iteratorName) && (tokens[12] == iteratorName);
+    }
+
+    bool generateForEachBody(const std::string& bodyTemplate, const std::string& foreachLine, std::string& body)
+    {
+        string_tuple keyTable;
+        string_tuple_vector valueTable;
+        if(parseForEachLine(foreachLine, keyTable, valueTable) == false)
+        {
+            return false;
+        }
+
+        for(size_t value = 0; value < valueTable.size(); value++)
+        {
+            std::string valBody = bodyTemplate;
+            for(size_t key = 0; key < keyTable.size(); key++)
+            {
+                valBody = replaceSubstring(valBody, "$(" + keyTable[key] + ")", valueTable[value][key]);
+                valBody = replaceSubstring(valBody, "$(_keyIndex)", std::to_string(key));
+            }
+            body += replaceSubstring(valBody, "$(_valIndex)", std::to_string(value));
+        }
+        return true;
+    }
+
+    bool generateForLoopBody(const std::string& bodyTemplate, const std::string& forLine, std::string& body)
+    {
+        std::string iteratorName;
+        int32_t startRange;
+        int32_t endRange;
+        if(parseForLine(forLine, iteratorName, startRange, endRange) == false)
+        {
+            return false;
+        }
+
+        iteratorName = "$(" + iteratorName + ")";
+        for(int32_t i = startRange; i < endRange; i++)
+        {
+            body += replaceSubstring(bodyTemplate, iteratorName, std::to_string(i));
+        }
+        return true;
+    }
+
+    std::string expandMacros(const std::string& line, const std::map<std::string, std::string>& defines)
+    {
+        std::string s = line;
+        std::string token;
+        size_t offset = 0;
+        while(offset != npos)
+        {
+            offset = getNextToken(s, offset, token);
+            const auto& def = defines.find(token);
+            if(def != defines.end())
+            {
+                // Continue parsing from the start of the inserted value, so macros which use other macros are expanded
+                std::string end;
+                if(offset == npos)
+                {
+                    offset = s.length() - token.size();
+                }
+                else
+                {
+                    end = s.substr(offset);
+                    offset = offset - token.size();
+                }
+                s = s.substr(0, offset) + ' ' + def->second + end;
+            }
+        }
+        return s;
+    }
+
+    bool ShaderPreprocessor::parsePragmaBlock(std::string& shader, const std::string& startDirective, const std::string& endDirective, pragma_block_generate_body pfnGenerateBody)
+    {
+        size_t startDirectiveOffset, endDirectiveOffset;
+        findDirectivePair(startDirective, endDirective, shader, startDirectiveOffset, endDirectiveOffset);
+
+        while(startDirectiveOffset != npos)
+        {
+            if(endDirectiveOffset == npos)
+            {
+                mErrorStr += getErrorLocation(shader, startDirectiveOffset, mShaderPathAbs) + "Found " + startDirective + " directive with no matching " + endDirective + ".";
+                return false;
+            }
+
+            std::string startDirectiveLine;
+            size_t startDirectiveLineOffset = getLine(shader, startDirectiveOffset, startDirectiveLine);
+            startDirectiveLine = expandMacros(startDirectiveLine, mDefineMap);
+
+            std::string bodyTemplate = getLinePragmaFromOffset(shader, startDirectiveLineOffset, mShaderPathAbs) + shader.substr(startDirectiveLineOffset, endDirectiveOffset - startDirectiveLineOffset);
+            std::string body;
+            if(pfnGenerateBody(bodyTemplate, startDirectiveLine, body) == false)
+            {
+                mErrorStr += getErrorLocation(shader, startDirectiveOffset, mShaderPathAbs) + "Malformed " + startDirective + " directive.";
+                return false;
+            }
+
+            std::string prolog = shader.substr(0, startDirectiveOffset);
+            std::string epilogue;
+            size_t endOfEndOffset = shader.find('\n', endDirectiveOffset);
+            if(endOfEndOffset != npos)
+            {
+                epilogue = getLinePragmaFromOffset(shader, endOfEndOffset, mShaderPathAbs) + shader.substr(endOfEndOffset);
+            }
+            shader = prolog + body + epilogue;
+
+            findDirectivePair(startDirective, endDirective, shader, startDirectiveOffset, endDirectiveOffset);
+        }
+
+        if(endDirectiveOffset != npos)
+        {
+            mErrorStr += getErrorLocation(shader, endDirectiveOffset, mShaderPathAbs) + "Found " + endDirective + " directive with no matching " + startDirective + ".";
+            return false;
+        }
+        return true;
+    }
+
+    bool ShaderPreprocessor::parseExpect(std::string& shader)
+    {
+        const std::string expect("#expect");
+        size_t expectOffset = findShaderDirective<false>(shader, 0, expect);
+        while(expectOffset != npos)
+        {
+            size_t line;
+            std::string file;
+            getLineInformation(shader, expectOffset, line, file, mShaderPathAbs);
+
+            std::string expectLine;
+            size_t endLine = getLine(shader, expectOffset + expect.size(), expectLine);
+            expectLine = removeLeadingTrailingWhitespaces(expectLine);
+
+            std::string macro;
+            getNextToken(expectLine, 0, macro);
+            if(mDefineMap.find(macro) == mDefineMap.end())
+            {
+                mErrorStr += file + "(" + std::to_string(line) + "): Expected " + macro + " macro definition. " + removeLeadingWhitespaces(expectLine.substr(macro.size()));
+                return false;
+            }
+
+            // Replace the directive with a #line directive, so that errors appear in the correct location
+            std::string epilogue = (endLine == npos) ? std::string() : shader.substr(endLine);
+            shader = shader.substr(0, expectOffset) + getLinePragma(line, file) + epilogue;
+
+            expectOffset = findShaderDirective<false>(shader, endLine, expect);
+        }
+        return true;
+    }
+
+    bool ShaderPreprocessor::addDefines(std::string& code, const Program::DefineList& shaderDefines)
+    {
+        // The defines are added right after the version string
+        size_t verStart = code.find("#version");
+        size_t verEnd = 0;
+        if(verStart == npos)
+        {
+#ifdef FALCOR_GL
+            mErrorStr += "Can't find version directive\n";
+            return false;
+#endif
+            verStart = 0;
+        }
+        else
+        {
+            verEnd = code.find("\n", verStart);
+            if(verEnd == npos)
+            {
+                code += "\n";
+                verEnd = code.length() - 1;
+            }
+            verEnd++;
+        }
+
+        size_t line;
+        std::string currentFile;
+        getLineInformation(code, verStart, line, currentFile, mShaderPathAbs);
+
+#ifdef FALCOR_DX11
+        std::string allDefines = "#ifndef FALCOR_HLSL\n#define FALCOR_HLSL\n#endif\n\n";
+#elif defined FALCOR_GL
+        std::string allDefines = "#ifndef FALCOR_GLSL\n#define FALCOR_GLSL\n#endif\n#extension GL_ARB_bindless_texture : enable\n";
+#endif
+
+        for(const auto& defDcl : shaderDefines)
+        {
+            std::string def = defDcl.first;
+            if(defDcl.second.size())
+            {
+                def += ' ' + defDcl.second;
+            }
+            addMacroDefinitionToMap(def);
+            allDefines += "#define " + def + "\n";
+        }
+
+        allDefines += getLinePragma(verEnd == 0 ? 0 : line, currentFile) + "\n";
+        code.insert(verEnd, allDefines);
+
+#ifdef FALCOR_DX11
+        if(verEnd != verStart)
+        {
+            // Remove the version pragma
+            code.erase(verStart, verEnd - verStart);
+        }
+#endif
+        return true;
+    }
+
+    void ShaderPreprocessor::addMacroDefinitionToMap(const std::string& defineString)
+    {
+        std::string define = removeLeadingTrailingWhitespaces(defineString);
+        std::string macroName;
+        getNextToken(define, 0, macroName);
+        mDefineMap.insert(std::make_pair(macroName, removeLeadingWhitespaces(define.substr(macroName.size()))));
+    }
+
+    ShaderPreprocessor::ShaderPreprocessor(std::string& errorStr) : mErrorStr(errorStr)
+    {
+        mErrorStr.clear();
+    }
+
+    bool ShaderPreprocessor::parseShader(const std::string& filename, std::string& shader, std::string& errorMsg, Shader::unordered_string_set& includeFileList, const Program::DefineList& shaderDefines)
+    {
+        ShaderPreprocessor preProc(errorMsg);
+        preProc.mShaderPathAbs = canonicalizeFilename(filename);
+
+        // Includes are added first, the rest of the directives might rely on their content
+        return preProc.addIncludes(shader, includeFileList) &&
+            preProc.addDefines(shader, shaderDefines) &&
+            preProc.parseExpect(shader) &&
+            preProc.parsePragmaBlock(shader, "#foreach", "#endforeach", generateForEachBody) &&
+            preProc.parsePragmaBlock(shader, "#for", "#endfor", generateForLoopBody);
+    }
+}
@@ -0,0 +1,63 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include <map>
+
+using namespace Falcor;
+
+namespace Legacy
+{
+    /** The algorithm of the shader pre-processor as it was before the single-pass rewrite of Falcor::ShaderPreprocessor, reduced to the path taken by valid shaders.
+        It rewrites the whole shader string once per directive, finds line numbers by searching back for #line directives and reads included files from disk every time.
+        The old implementation is no longer in the framework, so the benchmark needs this copy to compare the output and the performance of the two on the same shaders.
+    */
+    class ShaderPreprocessor
+    {
+    public:
+        /** Load a shader from file and pre-process it. Same interface as Falcor::ShaderPreprocessor::parseShader()
+        */
+        static bool parseShader(const std::string& filename, std::string& shader, std::string& errorMsg, Shader::unordered_string_set& includeFileList, const Program::DefineList& shaderDefines = Program::DefineList());
+
+    private:
+        ShaderPreprocessor(std::string& errorStr);
+
+        std::string& mErrorStr;
+
+        using pragma_block_generate_body = bool(*)(const std::string& bodyTemplate, const std::string& linePragma, std::string& body);
+
+        bool addDefines(std::string& shader, const Program::DefineList& shaderDefines);
+        bool addIncludes(std::string& shader, Shader::unordered_string_set& includeFileList);
+        bool parsePragmaBlock(std::string& shader, const std::string& startPragma, const std::string& endPragma, pragma_block_generate_body pfnGenerateBody);
+        bool parseExpect(std::string& shader);
+        void addMacroDefinitionToMap(const std::string& defineString);
+
+        std::map<std::string, std::string> mDefineMap;
+        std::string mShaderPathAbs;
+    };
+}
@@ -0,0 +1,188 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "ShaderPreprocessorBenchmark.h"
+#include <sstream>
+
+// The framework's shader set. Used when no files are passed on the command line
+static const char* kFrameworkShaders[] =
+{
+    "DefaultVS.vs",
+    "Framework/FullScreenPass.vs",
+    "Framework/FullScreenPass.gs",
+    "Framework/TextRenderer.vs",
+    "Framework/TextRenderer.fs",
+    "Framework/ParallelReduction.fs",
+    "Effects/SkyBox.vs",
+    "Effects/SkyBox.fs",
+    "Effects/ToneMapping.fs",
+    "Effects/GaussianBlur.fs",
+    "Effects/ShadowPass.vs",
+    "Effects/ShadowPass.gs",
+    "Effects/ShadowPass.fs",
+};
+
+ShaderPreprocessorBenchmark::ShaderPreprocessorBenchmark(const std::vector<std::string>& shaderFiles, uint32_t iterations) : mShaderFiles(shaderFiles), mIterations(iterations)
+{
+    if(mShaderFiles.empty())
+    {
+        mShaderFiles.assign(kFrameworkShaders, kFrameworkShaders + arraysize(kFrameworkShaders));
+    }
+
+    // Satisfy the #expect directives in the framework shaders
+    mDefines.add("_KERNEL_WIDTH", "5");
+    mDefines.add("_OUTPUT_PRIM_COUNT", "4");
+    mDefines.add("_VIEWPORT_MASK", "0xF");
+}
+
+float ShaderPreprocessorBenchmark::measure(const std::string& fullpath, const std::string& source, Mode mode, std::string& output)
+{
+    float total = 0;
+    for(uint32_t i = 0; i < mIterations; i++)
+    {
+        if(mode == Mode::Cold)
+        {
+            ShaderPreprocessor::clearIncludeCache();
+        }
+
+        output = source;
+        std::string errorMsg;
+        Shader::unordered_string_set includeList;
+
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        bool success;
+        if(mode == Mode::Legacy)
+        {
+            success = Legacy::ShaderPreprocessor::parseShader(fullpath, output, errorMsg, includeList, mDefines);
+        }
+        else
+        {
+            success = ShaderPreprocessor::parseShader(fullpath, output, errorMsg, includeList, mDefines);
+        }
+        total += CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+
+        if(success == false)
+        {
+            printf("    %s\n", errorMsg.c_str());
+            return -1;
+        }
+    }
+    return total / float(mIterations);
+}
+
+// The implementations emit different #line directives and blank lines, and the new one drops '#pragma once' and the UTF-8 BOMs of the source files. Compare the rest
+static std::string stripShader(const std::string& shader)
+{
+    const std::string kBom = "\xEF\xBB\xBF";
+    std::istringstream stream(shader);
+    std::string result;
+    std::string line;
+    while(std::getline(stream, line))
+    {
+        if(line.compare(0, kBom.size(), kBom) == 0)
+        {
+            line.erase(0, kBom.size());
+        }
+        line = removeLeadingTrailingWhitespaces(line);
+        if(line.empty() || line.compare(0, 5, "#line") == 0 || line == "#pragma once")
+        {
+            continue;
+        }
+        result += line + '\n';
+    }
+    return result;
+}
+
+void ShaderPreprocessorBenchmark::run()
+{
+    // Legacy is the implementation before the single-pass rewrite. Cold runs of the new implementation re-read and re-tokenize every included file, cached runs reuse the process-wide include cache.
+    // The speedups are the legacy time divided by the cold and cached times. The outputs are compared ignoring formatting differences, see stripShader()
+    printf("%-40s %12s %12s %12s %8s %8s %7s\n", "Shader", "Legacy (ms)", "Cold (ms)", "Cached (ms)", "vs Cold", "vs Cache", "Output");
+
+    float totalLegacy = 0;
+    float totalCold = 0;
+    float totalCached = 0;
+    for(const auto& file : mShaderFiles)
+    {
+        std::string fullpath;
+        std::string source;
+        if(findFileInDataDirectories(file, fullpath) == false || readFileToString(fullpath, source) == false)
+        {
+            printf("%-40s Can't find file\n", file.c_str());
+            continue;
+        }
+
+        std::string legacyOutput;
+        std::string output;
+        float legacy = measure(fullpath, source, Mode::Legacy, legacyOutput);
+        float cold = (legacy < 0) ? -1 : measure(fullpath, source, Mode::Cold, output);
+        float cached = (cold < 0) ? -1 : measure(fullpath, source, Mode::Cached, output);
+        if(cached < 0)
+        {
+            continue;
+        }
+
+        const char* match = (stripShader(legacyOutput) == stripShader(output)) ? "same" : "DIFF";
+        printf("%-40s %12.3f %12.3f %12.3f %7.1fx %7.1fx %7s\n", file.c_str(), legacy, cold, cached, legacy / cold, legacy / cached, match);
+        totalLegacy += legacy;
+        totalCold += cold;
+        totalCached += cached;
+    }
+
+    if(totalCached > 0)
+    {
+        printf("%-40s %12.3f %12.3f %12.3f %7.1fx %7.1fx\n", "Total", totalLegacy, totalCold, totalCached, totalLegacy / totalCold, totalLegacy / totalCached);
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    uint32_t iterations = 20;
+    std::vector<std::string> shaderFiles;
+
+    for(int argi = 1; argi < argc; ++argi)
+    {
+        std::string arg(argv[argi]);
+        if(arg == "-iterations" && argi + 1 < argc)
+        {
+            iterations = max(1, atoi(argv[++argi]));
+        }
+        else
+        {
+            shaderFiles.push_back(arg);
+        }
+    }
+
+    if(argc == 1)
+    {
+        printf("Syntax: ShaderPreprocessorBenchmark [-iterations N] [list of shader files]\nRunning over the framework's shader set.\n\n");
+    }
+
+    ShaderPreprocessorBenchmark benchmark(shaderFiles, iterations);
+    benchmark.run();
+    return 0;
+}
@@ -0,0 +1,56 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#pragma once
+#include "Falcor.h"
+#include "LegacyShaderPreprocessor.h"
+
+using namespace Falcor;
+
+class ShaderPreprocessorBenchmark
+{
+public:
+    ShaderPreprocessorBenchmark(const std::vector<std::string>& shaderFiles, uint32_t iterations);
+    void run();
+
+private:
+    enum class Mode
+    {
+        Legacy,     ///< Legacy::ShaderPreprocessor, the implementation before the single-pass rewrite
+        Cold,       ///< ShaderPreprocessor, clearing the include cache before every run
+        Cached,     ///< ShaderPreprocessor, reusing the include cache
+    };
+
+    /** Pre-process a shader. Returns the average time in milliseconds, or a negative number if pre-processing failed
+        \param[out] output The pre-processed shader
+    */
+    float measure(const std::string& fullpath, const std::string& source, Mode mode, std::string& output);
+
+    std::vector<std::string> mShaderFiles;
+    uint32_t mIterations;
+    Program::DefineList mDefines;
+};
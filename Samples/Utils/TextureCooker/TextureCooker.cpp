@@ -0,0 +1,131 @@
+/***************************************************************************
+# Copyright (c) 2015, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+***************************************************************************/
+#include "TextureCooker.h"
+
+TextureCookerTool::TextureCookerTool(const std::vector<std::string>& files, const TextureCooker::Desc& desc, bool force) : mFiles(files), mDesc(desc), mForce(force)
+{
+}
+
+void TextureCookerTool::run()
+{
+    uint32_t cooked = 0;
+    uint32_t skipped = 0;
+    uint32_t failed = 0;
+    float totalTime = 0;
+
+    for(const auto& file : mFiles)
+    {
+        std::string cookedFilename;
+        if(mForce == false && TextureCooker::findCookedTexture(file, mDesc.isSrgb && (mDesc.isNormalMap == false), cookedFilename))
+        {
+            printf("%s is up-to-date\n", file.c_str());
+            skipped++;
+            continue;
+        }
+
+        printf("Cooking %s ...\n", file.c_str());
+        CpuTimer::TimePoint start = CpuTimer::getCurrentTimePoint();
+        if(TextureCooker::cookTexture(file, mDesc))
+        {
+            float duration = CpuTimer::calcDuration(start, CpuTimer::getCurrentTimePoint());
+            printf("    Done in %.1f ms\n", duration);
+            totalTime += duration;
+            cooked++;
+        }
+        else
+        {
+            printf("    Failed\n");
+            failed++;
+        }
+    }
+
+    printf("Cooked %u, up-to-date %u, failed %u. Total cooking time %.1f ms\n", cooked, skipped, failed, totalTime);
+}
+
+int main(int argc, char* argv[])
+{
+    TextureCooker::Desc desc;
+    bool force = false;
+    std::vector<std::string> files;
+
+    for(int argi = 1; argi < argc; ++argi)
+    {
+        std::string arg(argv[argi]);
+        if(arg == "-linear")
+        {
+            desc.isSrgb = false;
+        }
+        else if(arg == "-normal")
+        {
+            desc.isNormalMap = true;
+        }
+        else if(arg == "-nocompress")
+        {
+            desc.compress = false;
+        }
+        else if(arg == "-nomips")
+        {
+            desc.generateMips = false;
+        }
+        else if(arg == "-force")
+        {
+            force = true;
+        }
+        else if(arg == "-quality" && argi + 1 < argc)
+        {
+            std::string quality(argv[++argi]);
+            if(quality == "fast")
+            {
+                desc.quality = BlockCompressionQuality::Fast;
+            }
+            else if(quality == "high")
+            {
+                desc.quality = BlockCompressionQuality::High;
+            }
+            else
+            {
+                desc.quality = BlockCompressionQuality::Normal;
+            }
+        }
+        else
+        {
+            files.push_back(arg);
+        }
+    }
+
+    if(files.empty())
+    {
+        printf("Syntax: TextureCooker [-linear] [-normal] [-nocompress] [-nomips] [-force] [-quality fast|normal|high] <list of image files>\n");
+        printf("Writes <image>.srgb.dds (or <image>.dds for linear textures) next to each image. createTextureFromFile() loads the cooked file while it's newer than the image.\n");
+        return 1;
+    }
+
+    TextureCookerTool tool(files, desc, force);
+    tool.run();
+    return 0;
+}